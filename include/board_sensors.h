@@ -0,0 +1,13 @@
+#pragma once
+
+#include "telemetry.h"
+
+// Receiver's on-board readings: internal temperature sensor, the supply
+// divider on SUPPLY_SENSE and the fan PWM duty read back from the LEDC
+class BoardTelemetrySensors : public TelemetrySensors {
+public:
+    int16_t chipTempDeciC() override;
+    uint16_t supplyMv() override;
+    uint8_t fans() override;
+    uint8_t fanDuty(uint8_t fan) override;
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+
+// Collapses a burst of changes into a single flush.
+// A burst is due once no new change has arrived for `quietMs`, or `maxDelayMs`
+// after its first change at the latest, so a steady stream can't starve it.
+class ChangeBatcher {
+public:
+    ChangeBatcher(uint32_t quietMs, uint32_t maxDelayMs) : quietMs(quietMs), maxDelayMs(maxDelayMs) {}
+
+    // Records a change at `nowMs`
+    void mark(uint32_t nowMs);
+    // Returns true (once per burst) when the pending burst should be flushed
+    bool due(uint32_t nowMs);
+    bool pending() const { return dirty; }
+
+    // Counters for measuring the reduction: changes marked vs flushes issued
+    uint32_t changes() const { return changeCount; }
+    uint32_t flushes() const { return flushCount; }
+
+private:
+    uint32_t quietMs;
+    uint32_t maxDelayMs;
+    bool dirty = false;
+    uint32_t firstChangeMs = 0;
+    uint32_t lastChangeMs = 0;
+    uint32_t changeCount = 0;
+    uint32_t flushCount = 0;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+#include "transport.h"
+
+// Ranks channels from a survey. Plain data with no Arduino dependencies;
+// callers pass timestamps in.
+class ChannelManager {
+public:
+    // The CHANNEL_CANDIDATES entry with the least activity, counting spill-over
+    // from neighbouring channels. `exclude` (e.g. the current channel) is skipped.
+    static uint8_t pickChannel(const ChannelSurvey& survey, uint8_t exclude = 0);
+    // Activity score used by pickChannel; lower is cleaner
+    static float channelScore(const ChannelSurvey& survey, uint8_t channel);
+
+    // --- Link health (interface) ---
+    // Adds the outcome of one transmission to `attempted` nodes
+    void recordDelivery(uint16_t delivered, uint16_t attempted);
+    // True once per bad window: the last full window fell below CHANNEL_MIGRATE_BELOW
+    // and no migration happened within the cooldown
+    bool shouldMigrate(uint32_t nowMs);
+    float lastDeliveryRate() const { return lastRate; }
+
+    // --- Coordinated switch (both sides) ---
+    void scheduleSwitch(uint8_t channel, uint32_t atMs);
+    bool switchPending() const { return pendingChannel != 0; }
+    // Returns the channel to tune to once the scheduled time has come, else 0
+    uint8_t switchDue(uint32_t nowMs);
+    uint32_t migrations() const { return migrationCount; }
+
+    // --- Hunting for a lost interface (receiver) ---
+    // Cycles through the candidates, moving on every `dwellMs`. The dwell doubles
+    // after each fruitless pass, up to `maxDwellMs`, to keep airtime down.
+    void startHunt(uint32_t nowMs, uint32_t dwellMs, uint32_t maxDwellMs);
+    void stopHunt() { huntActive = false; }
+    bool hunting() const { return huntActive; }
+    // Returns the next channel to try once the dwell has passed, else 0
+    uint8_t huntStep(uint32_t nowMs);
+
+private:
+    uint16_t windowDelivered = 0;
+    uint16_t windowAttempted = 0;
+    float lastRate = 1.0f;
+    bool badWindow = false;
+    bool migrated = false;
+    uint32_t lastMigrationMs = 0;
+    uint32_t migrationCount = 0;
+
+    uint8_t pendingChannel = 0;
+    uint32_t switchAtMs = 0;
+
+    bool huntActive = false;
+    uint8_t huntIndex = 0;
+    uint32_t huntDwellMs = 0;
+    uint32_t huntMaxDwellMs = 0;
+    uint32_t lastHopMs = 0;
+};
@@ -1,25 +1,248 @@
 #pragma once
 
 #include "state.h"
+#include "protocol.h"
+#include "peer_table.h"
+#include "transport.h"
+#include "rx_queue.h"
+#include "time_sync.h"
+#include "effect_vm.h"
+#include "channel_manager.h"
+#include "tx_power.h"
+#include "relay_cache.h"
+#include "squad.h"
+#include "ota.h"
+#include "hud_stream.h"
+#include "duty_cycle.h"
 
-// This is the data structure that will be sent over ESP-NOW.
-// It is a subset of the AppState, containing only what the receiver needs.
-struct CommandPayload {
-    // Visor Settings
-    bool visorOn;
-    VisorMode visorMode;
-    VisorColor visorColor;
-    uint8_t visorBrightness;
-
-    // Thermals
-    bool thermalsOn;
-};
+// Receivers paired with this interface - loaded from Preferences in main.cpp
+extern PeerTable receiverTable;
+
+// Receiver's estimate of the interface clock; stays at identity on the interface
+extern TimeSync effectClock;
+
+// Channel selection and migration state, shared by the interface and receiver paths
+extern ChannelManager channelManager;
+
+// Membership and cues shared with other costumes' interfaces (interface side)
+extern SquadSync squad;
+
+// Wake schedule followed by every node while radio sleep is on
+extern DutyCycle dutyCycle;
+
+// Tiles of the HUD canvas mirrored to a receiver with a display (interface side)
+extern HudEncoder hudEncoder;
+
+// Selects the link used for all protocol traffic. Call once before any send.
+void attachTransport(Transport& transport);
+
+// Broadcasts the current application state to every paired receiver.
+// Each node gets the slice of state its capabilities cover, addressed by MAC
+// inside a single frame. The transport must be up via setupEspComms() in main.cpp.
+void sendStateUpdate();
+
+// Records an ACK frame from a receiver and answers its time request (interface side)
+void handleAck(const RxFrame& frame);
+
+// Re-broadcasts unacknowledged entries once ACK_TIMEOUT_MS has passed (interface side).
+// Call from the comms task.
+void serviceStateAcks();
+
+// Acknowledges a STATE_UPDATE back to the interface that sent it (receiver side).
+// Asks for a time sync when the effect clock is due for one. A command that came
+// through a relay is acked back through `via`.
+void sendAck(const uint8_t* mac, uint16_t seq, const uint8_t* via = nullptr);
+
+// Unwraps a RELAY frame, forwarding it on when `relayEnabled` and this node is asked to.
+// `interfaceMac` is the paired interface, or this device's own MAC on the interface.
+// Returns true when the inner frame is new and meant for this node; `inner` then reads
+// like a frame from the origin, with hops/via recording the path it took.
+bool handleRelayFrame(const RxFrame& frame, const uint8_t* selfMac, const uint8_t* interfaceMac,
+                      bool relayEnabled, RxFrame& inner);
+
+// Sends a forward held back for RELAY_HOLDOFF_MS once no other relay covered it (receiver side).
+// Call from the comms task.
+void serviceRelay();
+
+// Logs how many frames this node forwarded and held back (receiver side)
+void reportRelayStats();
+
+// Completes a time sync exchange addressed to this node (receiver side)
+void handleTimeSync(const RxFrame& frame, const uint8_t* selfMac);
+
+// Microseconds on the timebase shared by the interface and all receivers - and by
+// the whole squad while squad mode is on. Effects should be evaluated against this rather than millis().
+int64_t sharedTimeUs();
+// Converts an esp_timer_get_time() timestamp to the shared timebase
+int64_t toSharedUs(int64_t localUs);
+
+// CRC-16 id of the effect program selected in appState (interface side)
+uint16_t selectedProgramId();
+
+// Broadcasts the selected effect program in chunks if a receiver asks for it (interface side).
+// Requests arriving close together are served by one broadcast.
+void handleProgramRequest(const RxFrame& frame);
+
+// Asks the interface for program `programId`, at most once per PROGRAM_REQUEST_INTERVAL_MS (receiver side)
+void requestProgram(const uint8_t* mac, uint16_t programId);
+
+// Collects program chunks. Once `programId` is complete and its CRC matches,
+// loads it into `vm` and returns true (receiver side).
+bool handleProgramChunk(const RxFrame& frame, uint16_t programId, EffectVm& vm);
+
+// Sends one telemetry record to the interface at `mac` (receiver side)
+void sendTelemetry(const uint8_t* mac, const TelemetrySnapshot& snapshot);
+
+// Updates the sending node's cached telemetry (interface side)
+void handleTelemetry(const RxFrame& frame);
+
+// Telemetry for the HUD: the first receiver that reported within TELEMETRY_STALE_MS,
+// or nullptr when none has (interface side)
+const NodeTelemetry* hudTelemetry();
+
+// Opens pairing for PAIR_MODE_DURATION_MS with a fresh challenge (interface side)
+void startPairing();
+void stopPairing();
+bool pairingActive();
+
+// Sends discovery beacons on the backing-off schedule and closes pairing when it
+// times out (interface side). Call from the comms task.
+void servicePairing();
+
+// Checks a receiver's answer to the current challenge and adds it to receiverTable.
+// Returns true when the node was paired; the caller persists the table (interface side).
+bool handlePairResponse(const RxFrame& frame);
+
+// Answers a pairing beacon with this node's nonce and capabilities (receiver side)
+void answerPairBeacon(const RxFrame& frame, uint8_t capabilities);
+
+// Returns true when `frame` confirms this node's response; the interface's MAC is
+// then frame.mac and the caller persists it (receiver side)
+bool handlePairConfirm(const RxFrame& frame, const uint8_t* selfMac);
+
+// Tells receivers whether to sleep between wake windows, from the next state update on
+// (interface side). Until all have acked waking up, frames for them only go out while a
+// window or slot is open.
+void setReceiverSleep(bool sleep);
 
-// This struct is used during the setup phase to exchange MAC addresses
-struct SetupPayload {
-    char macAddress[18]; // MAC addresses are 17 characters long + null terminator
+// True while some receiver may be sleeping between windows (interface side)
+bool receiversAsleep();
+
+// True when frames for the receivers may go out now (interface side)
+bool receiversListening();
+
+// Stops the fans and LEDs of every paired receiver. The first copy of the burst goes out
+// at once; `pressedUs` is the shared time the chord was pressed (interface side).
+void startEmergencyStop(int64_t pressedUs);
+// True until the whole burst went out and every receiver acked the stop, or until
+// ESTOP_GIVE_UP_MS passed (interface side)
+bool emergencyStopActive();
+
+// Sends the rest of the burst however soon the acks come, then repeats to nodes that
+// haven't acked, and logs the latencies once done (interface side). Call from the comms task.
+void serviceEmergencyStop();
+
+// Records a receiver's EMERGENCY_ACK and logs its press-to-fans-off latency, or the ack
+// time as a bound when its clock isn't synced (interface side)
+void handleEmergencyAck(const RxFrame& frame);
+
+// Confirms copy `seq` of stop `stopId` to the interface, back through `via` when it came
+// through a relay. `pressToOffUs` is -1 when unknown (receiver side).
+void sendEmergencyAck(const uint8_t* mac, uint16_t seq, uint16_t stopId, int32_t pressToOffUs,
+                      const uint8_t* via = nullptr);
+
+// Applies `profile` to this node's radio and restarts TX power control at full power
+void useRadioProfile(RadioProfile profile);
+
+// Steps TX power toward the target margin from the receivers' RSSI (interface side).
+// Call from the comms task.
+void serviceTxPower();
+
+// Surveys the air and tunes to the cleanest candidate channel (interface side, at boot)
+void selectChannel();
+
+// Starts a survey, then announces a coordinated switch to a cleaner channel once it
+// completes. With `onlyIfCleaner` the switch only happens when the current channel is
+// clearly worse (interface side). Returns at once; the survey runs in serviceChannelSurvey.
+void migrateChannel(bool onlyIfCleaner);
+
+// Listens on the next channel of a survey migrateChannel started. Blocks for one scan
+// dwell, so the comms task calls it between passes without holding stateLock.
+void serviceChannelSurvey();
+
+// Acts on a finished survey, migrates when state delivery degrades and performs
+// scheduled switches (interface side). Call from the comms task.
+void serviceChannelMigration();
+
+// Schedules the switch announced by the interface (receiver side)
+void handleChannelSwitch(const RxFrame& frame);
+
+// Unicasts a probe; its send status tells whether the interface is on this channel (receiver side)
+void sendChannelProbe(const uint8_t* mac);
+
+// Keeps this interface and its receivers on `channel`, or frees them to migrate again with 0
+void pinChannel(uint8_t channel);
+
+// Joins the squad sharing `key` on SQUAD_CHANNEL; a higher `priority` wins leader elections
+void startSquad(const char* key, uint8_t priority);
+void stopSquad();
+
+// Exchanges squad hellos and cues within the airtime budget. Returns true with the
+// scene to apply when a cue falls due (interface side). Call from the comms task.
+bool serviceSquad(SquadScene& due);
+
+// Passes a SQUAD frame to the squad (interface side)
+void handleSquadFrame(const RxFrame& frame);
+
+// Logs squad membership, leader and airtime figures (interface side)
+void reportSquadStats();
+
+// Pushes `image` to every paired receiver in turn (interface side)
+void startReceiverUpdate(OtaImageSource& image);
+void stopReceiverUpdate();
+bool receiverUpdateActive();
+
+// Feeds the update one frame at a time and moves on to the next receiver when one
+// finishes (interface side). Call from the comms task.
+void serviceReceiverUpdate();
+
+// Passes a unicast send status to the update. Safe from the radio's callback.
+void noteUpdateSendStatus(const uint8_t* mac, bool delivered);
+
+// Handles an OTA_STATUS from the receiver being updated (interface side)
+void handleOtaStatus(const RxFrame& frame);
+
+// Where the update stands, for the progress screen (interface side)
+struct ReceiverUpdateProgress {
+    uint8_t receiver;       // Index in receiverTable of the node being updated
+    uint8_t percent;        // Of its image confirmed received
+    uint8_t updated;        // Receivers done so far
+    uint8_t failed;
+    float lastKbPerSec;     // Throughput of the last receiver that finished
 };
+ReceiverUpdateProgress receiverUpdateProgress();
+
+// Feeds an OTA_OFFER or OTA_CHUNK into `ota` and answers with its status (receiver side)
+void handleOtaFrame(const RxFrame& frame, OtaReceiver& ota);
+
+// Starts mirroring to the first receiver with NODE_CAP_HUD. Returns false when none is
+// paired. The caller then feeds hudEncoder a canvas to scan (interface side).
+bool startHudMirror();
+void stopHudMirror();
+bool hudMirrorActive();
+
+// Starts frames and sends their tiles as airtime allows (interface side).
+// Call from the comms task.
+void serviceHudMirror();
+
+// Passes a unicast send status to the mirror. Safe from the radio's callback.
+void noteHudSendStatus(const uint8_t* mac, bool delivered);
+
+// Logs the mirror's frame rate and bandwidth since the last report (interface side)
+void reportHudStats();
+
+// Logs per-receiver delivery and fan-out latency figures
+void reportPeerStats();
 
-// Sends the current application state to the receiver device.
-// ESP-NOW must be initialized via setupEspComms() in main.cpp before calling this.
-void sendStateUpdate();
\ No newline at end of file
+// Logs the effect clock offset, drift and achieved sync error (receiver side)
+void reportTimeSync();
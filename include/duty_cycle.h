@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+#include "layout.h"
+
+// Wake schedule on the shared clock (sharedTimeUs), so every node agrees on it without
+// extra traffic. A window opens at the start of each heartbeat period, and short listen
+// slots recur between windows. The interface sends when a window or slot is open;
+// receivers listen from DUTY_GUARD_US before it until DUTY_GUARD_US after, to cover
+// the error of their clock estimate.
+class DutyCycle {
+public:
+    enum class Phase : uint8_t { WINDOW, SLOT, ASLEEP };
+
+    DutyCycle(int64_t periodUs = DUTY_PERIOD_MS * 1000LL, int64_t windowUs = DUTY_WINDOW_MS * 1000LL,
+              int64_t slotPeriodUs = DUTY_SLOT_PERIOD_MS * 1000LL, int64_t slotUs = DUTY_SLOT_MS * 1000LL,
+              int64_t guardUs = DUTY_GUARD_US, int64_t lingerUs = DUTY_LINGER_MS * 1000LL);
+
+    // Where `sharedUs` falls, with windows and slots widened by `marginUs` on each side
+    Phase phase(int64_t sharedUs, int64_t marginUs = 0) const;
+    // Heartbeat period `sharedUs` falls in; the window opens at its start
+    int64_t period(int64_t sharedUs) const;
+    // Earliest time from `sharedUs` on that a receiver should be listening
+    int64_t nextWakeUs(int64_t sharedUs) const;
+
+    // Keeps the radio up for a while after a frame went out or came in
+    void noteTraffic(int64_t sharedUs);
+    // Whether a receiver's radio should be on: listening for a window or slot, or lingering
+    bool awake(int64_t sharedUs) const;
+
+private:
+    int64_t periodUs;
+    int64_t windowUs;
+    int64_t slotPeriodUs;
+    int64_t slotUs;
+    int64_t guardUs;
+    int64_t lingerUs;
+    int64_t lingerUntilUs = 0;
+};
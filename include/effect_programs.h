@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdint.h>
+
+// Built-in effect programs the interface can upload to receivers (VisorMode::PROGRAM)
+#define EFFECT_PROGRAM_COUNT 4
+
+struct EffectProgram {
+    const char* name;
+    const uint8_t* code;
+    uint16_t length;
+};
+
+extern const EffectProgram effectPrograms[EFFECT_PROGRAM_COUNT];
+
+// Program names in menu order, for the VISOR > Effect option
+extern const char* effectProgramNames[EFFECT_PROGRAM_COUNT];
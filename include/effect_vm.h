@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdint.h>
+#include "layout.h"
+
+// Bytecode for per-pixel LED effect programs.
+// A program runs once per LED per frame on a small integer stack and must end
+// with OUT, which emits a packed 0xRRGGBB colour for that LED.
+// Immediates follow their opcode: imm8 is one byte, imm16/addr16 are little-endian.
+enum class VmOp : uint8_t {
+    HALT = 0x00,    // Stop, LED is black
+    PUSH8,          // imm8  -> value
+    PUSH16,         // imm16 -> signed value
+    TIME,           // -> shared clock in ms
+    INDEX,          // -> LED index being rendered
+    COUNT,          // -> number of LEDs
+    COLOR,          // -> visor colour chosen on the interface, packed
+    RAND,           // -> pseudo-random 0-255
+    ADD, SUB, MUL, DIV, MOD,    // a b -> a op b (wraps on overflow, divide by zero yields 0)
+    EQ, LT,         // a b -> 1 or 0
+    MIN, MAX,       // a b -> result
+    DUP,            // a -> a a
+    DROP,           // a ->
+    SWAP,           // a b -> b a
+    LOAD,           // imm8 register -> value
+    STORE,          // value -> (imm8 register)
+    JMP,            // addr16
+    JZ,             // a -> (jump to addr16 if a == 0)
+    SIN,            // phase -> sin8(phase & 255)
+    TRI,            // phase -> tri8(phase & 255)
+    RGB,            // r g b -> packed colour
+    HSV,            // h s v -> packed colour
+    SCALE,          // colour amount -> colour scaled by amount/255
+    BLEND,          // colour1 colour2 t -> mix, t=0 gives colour1, 255 gives colour2
+    OUT,            // colour -> (emit and stop)
+    OP_COUNT
+};
+
+// Inputs available to a program while rendering one LED
+struct VmContext {
+    uint32_t timeMs;
+    uint16_t index;
+    uint16_t count;
+    uint32_t color;
+};
+
+// Interpreter for uploaded effect programs. Programs are verified on load
+// (opcodes, operand lengths, jump targets) and each LED is limited to
+// VM_MAX_STEPS instructions, so a bad program can't hang the receiver.
+class EffectVm {
+public:
+    // Copies and verifies `code`; on failure the previous program stays loaded
+    bool load(const uint8_t* code, uint16_t len);
+    bool loaded() const { return length > 0; }
+    const uint8_t* program() const { return code; }
+    uint16_t programLength() const { return length; }
+
+    // Runs the program for one LED and returns its 0xRRGGBB colour (black on error)
+    uint32_t run(const VmContext& ctx);
+    // True if any LED since the last call hit a runtime fault (stack, step budget)
+    bool takeFault();
+
+private:
+    static bool verify(const uint8_t* code, uint16_t len);
+
+    uint8_t code[VM_MAX_PROGRAM_LEN];
+    uint16_t length = 0;
+    uint32_t rng = 0x2545F491;
+    bool fault = false;
+};
+
+// Operand bytes that follow `op`, or -1 for an unknown opcode
+int vmOperandLength(uint8_t op);
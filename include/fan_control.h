@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+#include "layout.h"
+#include "state.h"
+
+struct FanCurvePoint {
+    int16_t tempDeciC;
+    uint8_t duty;
+};
+
+// Picks the fans' PWM duty for a ThermalsMode: off, full, or in AUTO a point on the
+// FAN_CURVE thermal curve for the measured temperature, with FAN_HYSTERESIS_DECIC of
+// hysteresis so it doesn't hunt around a curve point. Rises are ramped so a fan coming
+// on doesn't pull an inrush spike from the suit's supply; falls take effect at once.
+// Plain code with no Arduino dependency; callers pass the time and temperature in, from
+// whatever TelemetrySensors they read.
+class FanController {
+public:
+    void setMode(ThermalsMode newMode) { currentMode = newMode; }
+    ThermalsMode mode() const { return currentMode; }
+
+    // Moves the duty toward the mode's target for `tempDeciC` at `nowMs` and returns the
+    // duty to drive. Call every FAN_UPDATE_INTERVAL_MS or so.
+    uint8_t update(int16_t tempDeciC, uint32_t nowMs);
+
+    // Mode OFF with the duty at 0 at once; the next rise ramps from off again
+    void stop();
+
+    uint8_t duty() const { return dutyQ8 >> 8; }
+
+    // Duty the curve gives for `tempDeciC`
+    static uint8_t curveDuty(int16_t tempDeciC);
+
+private:
+    ThermalsMode currentMode = ThermalsMode::OFF;
+    uint16_t dutyQ8 = 0;            // Duty in 8.8 fixed point, so slow ramps don't stall
+    uint32_t lastMs = 0;
+    bool tracking = false;          // Whether followedDeciC holds a reading
+    int16_t followedDeciC = 0;      // Temperature the curve is read at
+};
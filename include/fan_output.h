@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+
+// Reasons the fans can be held off; each is released on its own
+#define FAN_HALT_EMERGENCY_STOP 0x01
+#define FAN_HALT_WATCHDOG       0x02
+
+// Drives both fans (FAN_1_CTRL, FAN_2_CTRL) with LEDC PWM at FAN_PWM_FREQ_HZ, through the
+// MOSFET on each fan's low side. halt() may be called from the timer or comms task to cut
+// the fans ahead of the LED task; writes then drive them off until every reason is released,
+// so the LED task can't turn them back on in between.
+class LedcFanOutput {
+public:
+    bool begin();
+
+    // Sets both fans to `duty` (0-255), or off while halted
+    void write(uint8_t duty);
+
+    // Both fans off, and held off for `reason` (FAN_HALT_*) until released
+    void halt(uint8_t reason);
+    // Sets the halt bit only, without touching the peripheral - safe from the receive
+    // callback. The fans go off at the next halt() or write().
+    void hold(uint8_t reason);
+    void release(uint8_t reason);
+    bool halted() const;
+
+    // Duty the LEDC is driving on fan 0 or 1, read back from the peripheral
+    static uint8_t readDuty(uint8_t fan);
+};
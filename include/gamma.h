@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdint.h>
+
+// Perceptual levels to linear light, 16 bits. LEDs are linear in their PWM duty, so
+// colours and levels chosen by eye go through a gamma 2.2 table before any maths.
+
+// Linear value of an 8-bit colour channel (0-255 -> 0-65535)
+uint16_t gamma16(uint8_t value);
+
+// Linear value of a 16-bit perceptual level, interpolated between table entries
+uint16_t gammaLevel16(uint16_t level);
+
+// a * b / 65535, exact at both ends - scales one 16-bit value by another
+inline uint16_t scale16(uint16_t value, uint16_t scale) {
+    return ((uint32_t)value * scale + value) >> 16;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "hud_stream.h"
+
+#ifndef RECEIVER_HUD
+// 1 drives an ST7789 on the HUD_TFT_* pins that mirrors the interface's HUD
+#define RECEIVER_HUD 0
+#endif
+
+#if defined(ARDUINO) && RECEIVER_HUD
+
+#include <Adafruit_ST7789.h>
+
+// Receiver side: the mirror panel, in the interface's landscape orientation
+class St7789HudDisplay : public HudDisplay {
+public:
+    St7789HudDisplay();
+    void begin();
+    void blit(uint16_t x, uint16_t y, uint8_t w, uint8_t h, const uint16_t* pixels) override;
+
+private:
+    Adafruit_ST7789 panel;
+};
+
+#endif
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "layout.h"
+#include "protocol.h"
+
+// Largest encoded tile: encoding byte plus one byte per pixel
+#define HUD_MAX_TILE_LEN (1 + HUD_TILE_SIZE * HUD_TILE_SIZE)
+// Most tiles one packet holds: all solid, 4 bytes each with the index
+#define HUD_MAX_PACKET_TILES ((PROTOCOL_MAX_FRAME_LEN - sizeof(FrameHeader) - sizeof(HudPacketHeader)) / 4)
+
+// RGB332 (TFT_eSPI 8-bit sprites) to RGB565
+inline uint16_t hudColor565(uint8_t c) {
+    uint16_t r = c >> 5, g = (c >> 2) & 0x07, b = c & 0x03;
+    return ((r << 2 | r >> 1) << 11) | ((g << 3 | g) << 5) | (b << 3 | b << 1 | b >> 1);
+}
+
+// Interface side: turns an 8-bit canvas of the HUD into HUD_TILES packets.
+//
+// Each tile is encoded on its own as a single colour, a bit-packed or run-length
+// palette of up to 16 colours, or raw - whichever is smallest - so a lost packet
+// only costs the tiles in it. Tiles of a packet the link layer reported lost go out
+// again with the next frame; keyframes cover losses it didn't see.
+class HudEncoder {
+public:
+    // Hashes every tile of `pixels` (SCREEN_WIDTH x SCREEN_HEIGHT RGB332, which must stay
+    // valid until the next scan) and notes which changed since the last scan.
+    // Returns how many did.
+    uint16_t scan(const uint8_t* pixels);
+    bool tileChanged(uint16_t tile) const { return changed[tile / 8] & (1 << (tile % 8)); }
+
+    // Whether a new frame may start: the last one is out and HUD_MAX_FPS allows
+    bool wantsFrame(uint32_t nowMs) const;
+    // Queues every tile that differs from what the receiver was last sent, or all of
+    // them when a keyframe is due
+    void beginFrame(uint32_t nowMs);
+    // Forgets the canvas and what the receiver holds; frames resume with a keyframe
+    // after the next scan
+    void reset();
+
+    // Writes the next packet into `out` (PROTOCOL_MAX_FRAME_LEN bytes) when the last one
+    // is off the air and the byte budget allows. Returns its length, 0 for nothing now.
+    size_t poll(uint32_t nowMs, uint8_t* out);
+
+    // Send status of the last packet poll() returned. Safe to call from the radio's callback.
+    void sent(bool delivered);
+
+    uint32_t framesSent() const { return frames; }
+    uint32_t keyframesSent() const { return keyframes; }
+    uint32_t tilesSent() const { return tiles; }
+    uint32_t bytesSent() const { return bytes; }
+    uint32_t deliveryFailures() const { return failures.load(std::memory_order_relaxed); }
+
+private:
+    uint32_t hashTile(uint16_t tile) const;
+    size_t encodeTile(uint16_t tile, uint8_t* out) const;
+
+    const uint8_t* canvas = nullptr;
+    uint32_t scanHash[HUD_TILE_COUNT] = {};     // Content at the last scan
+    uint32_t sentHash[HUD_TILE_COUNT] = {};     // Content the receiver was last sent
+    uint8_t changed[(HUD_TILE_COUNT + 7) / 8] = {};
+    uint8_t pending[(HUD_TILE_COUNT + 7) / 8] = {};
+    uint16_t pendingCount = 0;
+    uint16_t cursor = 0;
+
+    bool needKeyframe = true;
+    bool keyframe = false;
+    uint16_t frameId = 0;
+    uint16_t packetSeq = 0;
+    uint32_t lastFrameMs = 0;
+    uint32_t lastKeyframeMs = 0;
+
+    float tokens = PROTOCOL_MAX_FRAME_LEN;
+    uint32_t tokensUpdatedMs = 0;
+    std::atomic<bool> inFlight{false};
+    std::atomic<bool> lastDelivered{true};
+    uint32_t lastSendMs = 0;
+    uint16_t lastTiles[HUD_MAX_PACKET_TILES];  // Tiles in the last packet, resent if it was lost
+    uint8_t lastTileCount = 0;
+
+    uint32_t frames = 0;
+    uint32_t keyframes = 0;
+    uint32_t tiles = 0;
+    uint32_t bytes = 0;
+    std::atomic<uint32_t> failures{0};
+};
+
+// Where decoded tiles go. Pixels are RGB565, row-major, w x h.
+class HudDisplay {
+public:
+    virtual ~HudDisplay() {}
+    virtual void blit(uint16_t x, uint16_t y, uint8_t w, uint8_t h, const uint16_t* pixels) = 0;
+};
+
+// Stand-in drawing into a SCREEN_WIDTH x SCREEN_HEIGHT RGB565 buffer, for host runs
+class MemoryHudDisplay : public HudDisplay {
+public:
+    explicit MemoryHudDisplay(uint16_t* pixels) : pixels(pixels) {}
+    void blit(uint16_t x, uint16_t y, uint8_t w, uint8_t h, const uint16_t* tile) override;
+
+private:
+    uint16_t* pixels;
+};
+
+// Receiver side: decodes HUD_TILES packets onto a display
+class HudDecoder {
+public:
+    // Draws the tiles of one packet. Returns false if it is malformed; tiles before
+    // the bad one are still drawn.
+    bool apply(const uint8_t* data, size_t len, HudDisplay& display);
+
+    uint32_t framesReceived() const { return frames; }
+    uint32_t keyframesReceived() const { return keyframes; }
+    uint32_t tilesReceived() const { return tiles; }
+    uint32_t bytesReceived() const { return bytes; }
+    uint32_t packetsLost() const { return lost; }
+
+private:
+    bool haveSeq = false;
+    uint16_t lastSeq = 0;
+
+    uint32_t frames = 0;
+    uint32_t keyframes = 0;
+    uint32_t tiles = 0;
+    uint32_t bytes = 0;
+    uint32_t lost = 0;
+};
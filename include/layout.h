@@ -13,12 +13,243 @@
 // LED effect timing (milliseconds)
 #define FLASH_INTERVAL_MS 500
 #define STROBE_INTERVAL_MS 100
+#define PULSE_PERIOD_MS 2000
+
+// LED frames are composited at a fixed rate and only pushed to the strips when they change
+// Levels between 8-bit steps are dithered over frames; each dither bit adds a bit of
+// resolution near black and doubles the longest dither cycle (2^bits frames)
+#define LED_FRAME_INTERVAL_US 10000     // 100 Hz
+#define LED_DITHER_BITS 4
+#define LED_LATCH_US 300                // Low time that latches a frame into the strips (WS2812B-V5 needs 280)
+
+// LED segments (led_segments.h): name=strip:start+count[,...] separated by ';'. Strip 0 is
+// LED_DATA, 1 is LED_DATA_2. The first segment is the visor, the rest are accents.
+#define LED_SEGMENT_CONFIG "visor=0:0+2,1:0+2"
+#define LED_SEGMENT_NAME_LEN 8
 
 // Communication timing (milliseconds)
 // Heartbeat keeps receiver's watchdog happy; timeout triggers safety shutdown
 #define HEARTBEAT_INTERVAL_MS 5000
 #define RECEIVER_TIMEOUT_MS 10000
 
+// Receive queue between the ESP-NOW callback and the comms task
+// Depth must be a power of two; one slot is kept free to tell full from empty
+#define RX_QUEUE_DEPTH 8
+#define RX_STATS_INTERVAL_MS 10000
+
+// FreeRTOS tasks (interface and receiver; the setup firmware keeps loop()). Comms shares
+// core 0 with the WiFi stack; the screen (interface) or the LEDs and fans (receiver) get
+// core 1. Stack sizes are in bytes.
+#define COMMS_TASK_CORE 0
+#define COMMS_TASK_PRIORITY 5
+#define COMMS_TASK_STACK 8192
+#define COMMS_POLL_MS 5                 // Button sampling and timers between received frames
+#define RENDER_TASK_CORE 1
+#define RENDER_TASK_PRIORITY 2
+#define RENDER_TASK_STACK 8192
+#define RENDER_INTERVAL_MS 5            // Screen frame pacing; the Matrix rain's speeds count these frames
+#define LED_TASK_CORE 1
+#define LED_TASK_PRIORITY 4
+#define LED_TASK_STACK 6144
+#define STOP_TASK_CORE 0                // Receiver emergency stop: above comms and the LEDs, below WiFi
+#define STOP_TASK_PRIORITY 10
+#define STOP_TASK_STACK 3072
+#define UI_EVENT_QUEUE_LEN 8            // Button events waiting for the render task
+
+// Onboard LED blink on each accepted command (milliseconds)
+#define STATUS_BLINK_MS 50
+
+// Receivers driven by one interface, and per-node ack handling for state updates
+// A retry re-broadcasts only the entries of nodes that haven't acked yet
+#define MAX_RECEIVERS 32
+#define ACK_TIMEOUT_MS 40
+#define ACK_MAX_RETRIES 3
+
+// Shared effect clock - receivers sync to the interface's clock by flagging their
+// heartbeat acks with a time request
+// Exchanges slower than the max round trip are discarded; drift is learned from
+// samples at least the min span apart and smoothed by the gain
+#define TIME_SYNC_INTERVAL_MS HEARTBEAT_INTERVAL_MS
+#define TIME_SYNC_MAX_RTT_US 4000
+#define TIME_SYNC_MIN_DRIFT_SPAN_US 1000000
+#define TIME_SYNC_DRIFT_GAIN 0.1
+// A jump this large means the master clock was stepped (e.g. it joined a squad);
+// the estimate re-anchors without learning drift from it
+#define TIME_SYNC_STEP_US 20000
+
+// LED effect programs (bytecode VM on the receiver)
+// Programs are uploaded in chunks that fit one frame and rendered at a fixed rate
+#define VM_MAX_PROGRAM_LEN 512
+#define VM_STACK_DEPTH 16
+#define VM_REGISTERS 8
+#define VM_MAX_STEPS 256
+#define VM_FRAME_INTERVAL_MS 20
+#define PROGRAM_CHUNK_LEN 200
+#define PROGRAM_REQUEST_INTERVAL_MS 1000
+
+// Menu change batching (milliseconds)
+// A burst of menu changes goes out as one radio frame and one NVS save, flushed once
+// the burst has been quiet for the window or after the max delay at the latest.
+// The state window is longer than the gap between presses when clicking through a menu
+#define STATE_COALESCE_MS 400
+#define STATE_FLUSH_MAX_MS 1500
+#define SAVE_COALESCE_MS 1000
+#define SAVE_FLUSH_MAX_MS 3000
+
+// Receiver telemetry back to the interface
+// Records are deltas against a keyframe sent every N records; analog readings
+// within the dead-band of the keyframe count as unchanged
+#define TELEMETRY_INTERVAL_MS 1000
+#define TELEMETRY_KEYFRAME_EVERY 10
+#define TELEMETRY_STALE_MS (TELEMETRY_INTERVAL_MS * 3)
+#define TELEMETRY_TEMP_DEADBAND 5       // Tenths of a degree C
+#define TELEMETRY_SUPPLY_DEADBAND 50    // Millivolts
+#define TELEMETRY_MARGIN_DEADBAND 1000  // Milliseconds
+#define TELEMETRY_CURRENT_DEADBAND 5    // Tenths of a milliamp
+#define TELEMETRY_DUTY_DEADBAND 4       // Fan PWM duty, 0-255
+#define TELEMETRY_POWER_DEADBAND 100    // Milliwatts
+
+// Runtime pairing (SETTINGS > Pair Receivers, or hold Next + Previous)
+// While open, the interface beacons at an interval that starts short and doubles up to
+// the max. Receivers answer any interface while unpaired, or for the window after their
+// pair button has been held; a paired receiver otherwise only answers its own interface
+#define PAIR_MODE_DURATION_MS 30000
+#define PAIR_BEACON_MIN_MS 20
+#define PAIR_BEACON_MAX_MS 320
+#define PAIR_RECEIVER_WINDOW_MS 60000
+#define PAIR_BUTTON_HOLD_MS 2000
+
+// Channel management
+// Nodes only operate on the non-overlapping candidates, so a lost receiver has few to search.
+// The interface migrates when fewer than CHANNEL_MIGRATE_BELOW of a window of state
+// deliveries got through on the first attempt, announcing the switch ahead of time.
+// A receiver that hears nothing for CHANNEL_LOST_MS hunts for the interface.
+#define CHANNEL_CANDIDATES {1, 6, 11}
+#define CHANNEL_SCAN_DWELL_MS 40
+#define CHANNEL_SCAN_MAX_APS 32
+#define CHANNEL_DELIVERY_WINDOW 20
+#define CHANNEL_MIGRATE_BELOW 0.7
+#define CHANNEL_MIGRATE_COOLDOWN_MS 30000
+#define CHANNEL_SWITCH_DELAY_MS 150
+#define CHANNEL_SWITCH_REPEATS 3
+#define CHANNEL_LOST_MS (HEARTBEAT_INTERVAL_MS + 1000)
+#define CHANNEL_PROBE_INTERVAL_MS 30
+#define CHANNEL_LISTEN_DWELL_MS (PAIR_BEACON_MAX_MS + 50)
+
+// Interface TX power control (power in 0.25 dBm units, as esp_wifi_set_max_tx_power takes it)
+// Power steps down while the weakest receiver keeps more than target + hysteresis dB of
+// margin over the profile's sensitivity, and steps up below the target or on a missed ack
+#define TX_POWER_MIN 8
+#define TX_POWER_STEP 8
+#define TX_POWER_TARGET_MARGIN_DB 15
+#define TX_POWER_HYSTERESIS_DB 5
+#define TX_POWER_ADJUST_INTERVAL_MS 2000
+#define RSSI_SMOOTHING 4    // Each new sample moves a node's average by 1/N
+
+// Multi-hop relay (receivers built with RECEIVER_RELAY=1)
+// Retries go out wrapped for relays, which forward each copy at most once and stop after
+// RELAY_MAX_HOPS. A relay the interface didn't name waits a random holdoff and stays quiet
+// if it hears another relay forward the same copy first.
+#define RELAY_MAX_HOPS 2
+#define RELAY_SEEN_CACHE 16
+#define RELAY_HOLDOFF_MS 8
+
+// Squad mode (SETTINGS > Squad) - the interfaces of several costumes share visor cues
+// Units with the same SQUAD_KEY meet on SQUAD_CHANNEL. The leader beacons the squad clock;
+// everyone else spaces their hellos so the whole squad sends about SQUAD_HELLO_AGGREGATE_HZ.
+// Every squad frame draws on a token bucket, cues before hellos.
+#define SQUAD_CHANNEL 6
+#define SQUAD_MAX_UNITS 16
+#define SQUAD_BEACON_MS 500
+#define SQUAD_HELLO_MIN_MS 1000
+#define SQUAD_HELLO_AGGREGATE_HZ 8
+#define SQUAD_MEMBER_TIMEOUT_HELLOS 4   // Hello intervals missed before a unit is dropped
+#define SQUAD_LEADER_TIMEOUT_MS (SQUAD_BEACON_MS * 4)
+#define SQUAD_CUE_LEAD_MS 150           // Cues apply this long after the leader sends them
+#define SQUAD_CUE_REPEATS 3
+#define SQUAD_CUE_REPEAT_MS 30
+#define SQUAD_SYNC_WINDOW 8             // Leader beacons the clock offset is filtered over
+#define SQUAD_TOKENS_PER_SEC 6
+#define SQUAD_TOKEN_BURST 4
+
+// Receiver firmware updates over ESP-NOW (SETTINGS > Update Receivers)
+// Rounds of up to OTA_WINDOW missing chunks go out one frame at a time; the window must fit in
+// the OTA_STATUS_SPAN a status covers. Without a status the interface re-offers every
+// OTA_POLL_MS and gives a receiver up after OTA_GIVE_UP_MS of silence.
+#define OTA_WINDOW 64
+#define OTA_IN_FLIGHT_TIMEOUT_MS 20     // Send status overdue; carry on without it
+#define OTA_POLL_MS 150
+#define OTA_GIVE_UP_MS 30000
+#define OTA_VERIFY_ATTEMPTS 2
+#define OTA_MAX_IMAGE_LEN (4UL * 1024 * 1024)
+#define OTA_RESTART_DELAY_MS 1000       // Receiver reboots into the new image after answering
+
+// HUD mirror to a receiver with a display (built with RECEIVER_HUD=1)
+// While the screen saver runs the interface renders into an 8-bit canvas and sends the tiles
+// that differ from what the receiver was last sent. One packet is on the air at a time, so the
+// frame rate follows the airtime left over, up to HUD_MAX_FPS and HUD_MAX_BYTES_PER_SEC.
+// A keyframe resends every tile each HUD_KEYFRAME_MS so lost packets heal.
+#define HUD_TILE_SIZE 8
+#define HUD_COLUMNS ((SCREEN_WIDTH + HUD_TILE_SIZE - 1) / HUD_TILE_SIZE)
+#define HUD_ROWS ((SCREEN_HEIGHT + HUD_TILE_SIZE - 1) / HUD_TILE_SIZE)
+#define HUD_TILE_COUNT (HUD_COLUMNS * HUD_ROWS)
+#define HUD_MAX_FPS 15
+#define HUD_MAX_BYTES_PER_SEC 40000
+#define HUD_KEYFRAME_MS 5000
+#define HUD_IN_FLIGHT_TIMEOUT_MS 20     // Send status overdue; carry on without it
+
+// Radio duty cycling (SETTINGS > Radio Sleep)
+// Both ends follow a schedule on the shared clock. A DUTY_WINDOW_MS window opens at the start of
+// every heartbeat period for the heartbeat, acks, time sync and telemetry, and a DUTY_SLOT_MS
+// listen slot every DUTY_SLOT_PERIOD_MS lets menu changes through without waiting for it.
+// Radios are off in between, except for DUTY_LINGER_MS after traffic so answers still land.
+#define DUTY_PERIOD_MS HEARTBEAT_INTERVAL_MS
+#define DUTY_WINDOW_MS 100
+#define DUTY_SLOT_PERIOD_MS 500
+#define DUTY_SLOT_MS 15
+#define DUTY_GUARD_US 2000              // Receivers listen this much early and late for clock error
+#define DUTY_LINGER_MS 60
+#define DUTY_MIN_SLEEP_US 3000          // Shorter gaps aren't worth a light sleep
+
+// Power model - typical ESP32-S3 datasheet currents, for estimates only
+#define POWER_RADIO_RX_MA 90.0f
+#define POWER_RADIO_TX_MA 300.0f
+#define POWER_CPU_MA 40.0f              // Radio off, CPU running
+#define POWER_LIGHT_SLEEP_MA 0.25f
+#define POWER_TX_OVERHEAD_US 100        // Preamble, ack and spacing per frame
+
+// Receiver power budget (power_budget.h) - what the LEDs and fans may draw from the supply
+// WS2812 current follows each channel's duty; LEDs draw their idle current even when dark.
+// At or above POWER_FANS_FIRST_DECIC the fans are served before the LEDs.
+#define POWER_BUDGET_MA 1800            // A 2 A power bank, with some headroom
+#define POWER_LED_CHANNEL_MA 20.0f      // One channel at full duty
+#define POWER_LED_IDLE_MA 1.0f          // Per LED
+#define POWER_FAN_MA 120.0f             // One fan at full duty
+#define POWER_FANS_FIRST_DECIC 550
+#define POWER_NOMINAL_MV 5000           // Supply voltage for the watts when SUPPLY_SENSE reads nothing
+
+// Emergency stop (hold all three buttons, from any screen)
+// The chord counts once every button has been down for ESTOP_CHORD_MS. ESTOP_BURST copies go
+// out ESTOP_BURST_SPACING_MS apart, then one every ESTOP_RETRY_MS - shorter than a listen slot,
+// so sleeping receivers hear it too - until every receiver acked or ESTOP_GIVE_UP_MS passed.
+#define ESTOP_CHORD_MS 30
+#define ESTOP_BURST 4
+#define ESTOP_BURST_SPACING_MS 2
+#define ESTOP_RETRY_MS 10
+#define ESTOP_GIVE_UP_MS 2000
+
+// Receiver fans (fan_control.h) - LEDC PWM on FAN_1_CTRL and FAN_2_CTRL
+// In AUTO the duty follows FAN_CURVE, {tenths of a degree C, duty 0-255} points in rising
+// order, linear in between; off below the first point, the last duty above the last.
+// The curve only follows the temperature down once it is FAN_HYSTERESIS_DECIC below what it
+// followed up to. Rises ramp at full scale per FAN_SOFT_START_MS; falls are immediate.
+#define FAN_CURVE {{450, 80}, {550, 160}, {650, 255}}
+#define FAN_HYSTERESIS_DECIC 20
+#define FAN_SOFT_START_MS 3000
+#define FAN_UPDATE_INTERVAL_MS 100
+#define FAN_PWM_FREQ_HZ 25000           // Above hearing, so the fans don't whine
+#define FAN_PWM_BITS 8
+
 // Screen saver timing (milliseconds)
 #define SCREENSAVER_TIMEOUT_MS 3000
 
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdint.h>
+#include "layout.h"
+#include "state.h"
+#include "wave_tables.h"
+#include "led_segments.h"
+#include "power_budget.h"
+
+// Builds LED frames from three layers, rendered at a fixed rate from the LED task:
+//   base       - each segment's colour, or per-pixel colours from an effect program
+//   modulation - each segment's VisorMode wave from a table, times its brightness
+//   overlay    - a colour blended over every segment, e.g. the safety warning
+// Colours come in packed 0xRRGGBB and are mixed in 16-bit linear light (gamma.h). While
+// the layers animate, the 8-bit frame for the strips carries the bits below 8 over to
+// later frames (temporal dithering), so slow fades near black still move smoothly;
+// still frames are rounded so they never need showing again. With a power budget, each
+// frame is scaled down as a whole before that to stay within it.
+// Plain code with no Arduino dependency; callers pass the time in.
+class LedCompositor {
+public:
+    // Segments the chain is split into, which must outlive the compositor; nullptr puts
+    // every LED in segment 0
+    void setSegmentMap(const LedSegmentMap* map) { segments = map; }
+    // Budget frames are held to, which must outlive the compositor; nullptr for none
+    void setPowerBudget(PowerBudget* budget) { power = budget; }
+
+    // One steady colour at full level on every segment
+    void setBase(uint32_t color);
+    // Layers of one segment: its colour, the wave of `mode` from the effect table and
+    // its level, 0-255, perceptual. In VisorMode::PROGRAM it shows the per-pixel base
+    // instead of `color`.
+    void setSegment(uint8_t segment, uint32_t color, VisorMode mode, uint8_t level);
+    // Per-pixel base of LED_CHAIN_LEN colours for segments in VisorMode::PROGRAM, read
+    // on every render
+    void setBasePixels(const uint32_t* pixels) { basePixels = pixels; }
+
+    // Blends `color` over the frame at up to `level` (0-65535, perceptual), following
+    // `wave` over `periodMs` counted from `startMs`
+    void setOverlay(uint32_t color, Wave wave, uint16_t periodMs, uint16_t level, uint32_t startMs);
+    void setOverlayLevel(uint16_t level) { overlayLevel = level; }
+    void clearOverlay() { overlayLevel = 0; }
+    bool overlayActive() const { return overlayLevel > 0; }
+
+    // Whether frames change over time with the current layers - an overlay always counts
+    bool animated() const;
+
+    // Renders the frame at `timeMs` (shared clock). Returns true when the strips' frame
+    // differs from the last one rendered.
+    bool render(uint32_t timeMs);
+    // Frame for the strips, packed 0xRRGGBB
+    const uint32_t* frame() const { return pixels; }
+    // Linear frame behind it, 3 channels (R, G, B) per LED, after the power budget
+    const uint16_t* linearFrame() const { return linear; }
+
+private:
+    struct Layer {
+        uint32_t color = 0;
+        VisorMode mode = VisorMode::SOLID;
+        uint8_t level = MAX_BRIGHTNESS;
+    };
+
+    uint8_t dither(uint16_t value, uint8_t& carry, bool carryOver);
+    uint8_t segmentCount() const { return segments ? segments->count() : 1; }
+
+    const LedSegmentMap* segments = nullptr;
+    PowerBudget* power = nullptr;
+    Layer layers[LED_SEGMENTS];
+    const uint32_t* basePixels = nullptr;
+
+    uint32_t overlayColor = 0;
+    Wave overlayWave = Wave::CONSTANT;
+    uint16_t overlayPeriodMs = 0;
+    uint16_t overlayLevel = 0;
+    uint32_t overlayStartMs = 0;
+
+    uint16_t linear[LED_CHAIN_LEN * 3] = {};
+    uint8_t carry[LED_CHAIN_LEN * 3] = {};
+    uint32_t pixels[LED_CHAIN_LEN] = {};
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "led_compositor.h"
+
+// The CPU side of a frame, shared with the host benchmark (plain code with no Arduino
+// dependency): packs 0x00RRGGBB pixels into the GRB bytes a WS2812 strip takes
+void encodeGrb(const uint32_t* pixels, uint16_t count, uint8_t* out);
+
+// Expands strip bytes into RMT symbols, 8 per byte MSB first, in the 32-bit layout of
+// rmt_item32_t and rmt_symbol_word_t. Returns the bytes expanded, as many whole bytes as
+// fit in maxSymbols.
+size_t expandWs2812Symbols(const uint8_t* bytes, size_t len, uint32_t* symbols, size_t maxSymbols);
+
+// Drives both strips (LED_DATA, then LED_DATA_2) from a compositor frame of
+// LED_CHAIN_LEN 0x00RRGGBB pixels. Each strip gets its own RMT channel, so both go
+// out at once and in the background; the CPU only encodes the bytes and queues them,
+// with no interrupt-off window. Only one instance may exist, since the RMT
+// callbacks are global.
+class RmtLedOutput {
+public:
+    // False if either strip's RMT channel didn't come up; nothing may be shown then
+    bool begin();
+
+    // Whether the last frame is out and latched, so show() would start at once.
+    // The completion callbacks update this from interrupt context.
+    bool ready();
+
+    // Starts `frame` out to both strips. Returns false while the last frame is still
+    // going out; the caller keeps the frame and tries again.
+    bool show(const uint32_t* frame);
+
+    // Waits, yielding, until the last frame is latched or timeoutMs passes
+    bool wait(uint32_t timeoutMs);
+
+    // Wire time of one frame, both strips going out together
+    static uint32_t frameUs() { return NUM_LEDS * 24 * 125 / 100 + LED_LATCH_US; }
+};
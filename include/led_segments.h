@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+#include "layout.h"
+#include "pins.h"
+#include "state.h"
+
+// Both strips form one chain, LED_DATA's first, as effect programs see them
+#define LED_CHAIN_LEN (NUM_LEDS * 2)
+
+#define LED_NO_SEGMENT 0xFF
+
+// Named groups of LEDs, each made of index ranges on either strip, so accents such as
+// edge strips or chest lights run their own effect next to the visor. Segment 0 is
+// the visor.
+//
+// Built from a compact config (LED_SEGMENT_CONFIG):
+//   name=strip:start+count[,strip:start+count...][;name=...]
+// e.g. "visor=0:0+2,1:0+2;edge=0:2+40". Ranges may not overlap; LEDs in no segment
+// stay dark. Plain code with no Arduino dependency.
+class LedSegmentMap {
+public:
+    // Starts with every LED in the visor
+    LedSegmentMap() { reset(); }
+
+    // Replaces the map with `config`. Returns false, putting every LED back in the
+    // visor, if it is malformed, has too many segments or runs off the strips.
+    bool load(const char* config);
+
+    uint8_t count() const { return segments; }
+    const char* name(uint8_t segment) const { return names[segment]; }
+    uint16_t length(uint8_t segment) const { return lengths[segment]; }
+    // Segment a chain pixel belongs to, or LED_NO_SEGMENT
+    uint8_t segmentOf(uint16_t pixel) const { return owner[pixel]; }
+
+private:
+    void reset();
+    bool parseRanges(const char*& p);
+
+    uint8_t segments;
+    char names[LED_SEGMENTS][LED_SEGMENT_NAME_LEN + 1];
+    uint16_t lengths[LED_SEGMENTS];
+    uint8_t owner[LED_CHAIN_LEN];
+};
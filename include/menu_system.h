@@ -7,6 +7,7 @@
 // Forward-declarations
 class MenuController;
 struct MenuItem;
+class LedSegmentMap;
 
 // Callback invoked when a menu item is selected (receives controller for navigation)
 using ActionCallback = std::function<void(MenuController*)>;
@@ -80,4 +81,7 @@ extern MenuItem mainMenuItems[];
 extern const int mainMenuItemCount;
 
 // Synchronizes menu item states with appState (call after loading saved state)
-void updateMenuFromState();
\ No newline at end of file
+void updateMenuFromState();
+
+// Names the accent segments in the ACCENTS menu after `segments`
+void loadAccentMenu(const LedSegmentMap& segments);
\ No newline at end of file
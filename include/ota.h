@@ -0,0 +1,161 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "layout.h"
+#include "protocol.h"
+#include "sha256.h"
+
+#define OTA_MAX_CHUNKS ((OTA_MAX_IMAGE_LEN + OTA_CHUNK_LEN - 1) / OTA_CHUNK_LEN)
+
+// Where the interface reads the receiver image from
+class OtaImageSource {
+public:
+    virtual ~OtaImageSource() {}
+    virtual uint32_t length() = 0;
+    virtual const uint8_t* sha256() = 0;    // SHA256_DIGEST_LEN bytes over the whole image
+    virtual bool read(uint32_t offset, uint8_t* out, size_t len) = 0;
+};
+
+// Where the receiver writes the image. Chunks arrive in any order.
+class OtaImageSink {
+public:
+    virtual ~OtaImageSink() {}
+    // Prepares room for `len` bytes. Returns false if the image can't be held.
+    virtual bool begin(uint32_t len) = 0;
+    virtual bool write(uint32_t offset, const uint8_t* data, size_t len) = 0;
+    virtual bool read(uint32_t offset, uint8_t* out, size_t len) = 0;
+    // Makes the verified image the one to boot
+    virtual bool commit() = 0;
+    // Drops a partial or rejected image
+    virtual void abort() = 0;
+};
+
+// Stand-ins holding the image in RAM for host runs
+class MemoryImageSource : public OtaImageSource {
+public:
+    MemoryImageSource(const uint8_t* data, uint32_t len);
+    uint32_t length() override { return len; }
+    const uint8_t* sha256() override { return digest; }
+    bool read(uint32_t offset, uint8_t* out, size_t count) override;
+
+private:
+    const uint8_t* data;
+    uint32_t len;
+    uint8_t digest[SHA256_DIGEST_LEN];
+};
+
+class MemoryImageSink : public OtaImageSink {
+public:
+    MemoryImageSink(uint8_t* buffer, uint32_t capacity) : buffer(buffer), capacity(capacity) {}
+    bool begin(uint32_t len) override;
+    bool write(uint32_t offset, const uint8_t* data, size_t count) override;
+    bool read(uint32_t offset, uint8_t* out, size_t count) override;
+    bool commit() override { committed = true; return true; }
+    void abort() override { len = 0; }
+    bool committedImage() const { return committed; }
+
+private:
+    uint8_t* buffer;
+    uint32_t capacity;
+    uint32_t len = 0;
+    bool committed = false;
+};
+
+// Interface side: pushes one image to one receiver.
+//
+// Chunks go out in rounds of up to OTA_WINDOW of the chunks the last status reported
+// missing, one frame on the air at a time. The round's last chunk asks for a status;
+// without one the sender re-offers every OTA_POLL_MS, or at once when the link layer
+// reported the last frame lost (the receiver answers an offer of the image it holds
+// with its status). It gives up after OTA_GIVE_UP_MS of silence.
+class OtaSender {
+public:
+    void begin(OtaImageSource& source, uint32_t nowMs);
+    void cancel() { state = State::IDLE; }
+    bool active() const { return state != State::IDLE && state != State::DONE && state != State::FAILED; }
+    bool succeeded() const { return state == State::DONE; }
+    bool failed() const { return state == State::FAILED; }
+
+    // Writes the next frame for the receiver into `out` (PROTOCOL_MAX_FRAME_LEN bytes).
+    // Returns its length, or 0 while nothing is due or the last frame is still on the air.
+    size_t poll(uint32_t nowMs, uint8_t* out);
+
+    // Send status of the last frame poll() returned. Safe to call from the radio's callback.
+    void sent(bool delivered);
+
+    // Handles an OTA_STATUS from the receiver
+    void receive(const uint8_t* data, size_t len, uint32_t nowMs);
+
+    uint32_t chunkCount() const { return chunks; }
+    uint32_t chunksConfirmed() const { return base; }   // Every chunk before this one arrived
+    uint32_t chunksSent() const { return sentChunks; }
+    uint32_t deliveryFailures() const { return failures.load(std::memory_order_relaxed); }
+    // Transfer time from the receiver accepting the offer to its verified image
+    uint32_t elapsedMs() const { return endMs - startMs; }
+    float kbPerSec() const;
+
+private:
+    enum class State : uint8_t { IDLE, OFFERING, SENDING, WAITING, DONE, FAILED };
+
+    bool missing(uint32_t index) const;
+    int32_t nextMissing(uint32_t from) const;
+    void startRound();
+
+    State state = State::IDLE;
+    OtaImageSource* source = nullptr;
+    OtaOffer offer = {};
+    uint32_t chunks = 0;
+    uint8_t verifyAttempts = 0;
+
+    // Last status: chunks before base arrived, the bitmap covers the OTA_STATUS_SPAN after it
+    uint32_t base = 0;
+    uint8_t bitmap[OTA_STATUS_SPAN / 8] = {};
+
+    uint32_t cursor = 0;        // Next chunk to consider in the current round
+    uint32_t roundEnd = 0;      // First chunk past the current round
+    std::atomic<bool> inFlight{false};
+    std::atomic<bool> lastDelivered{true};
+    uint32_t lastSendMs = 0;
+    uint32_t lastPollMs = 0;
+    uint32_t lastHeardMs = 0;
+
+    uint32_t startMs = 0;
+    uint32_t endMs = 0;
+    bool started = false;
+    uint32_t sentChunks = 0;
+    std::atomic<uint32_t> failures{0};
+};
+
+// Receiver side: collects the image into a sink and verifies it before committing.
+// The bitmap of received chunks survives a link drop, so a re-offer of the same image
+// carries on where the transfer stopped.
+class OtaReceiver {
+public:
+    explicit OtaReceiver(OtaImageSink& sink) : sink(sink) {}
+
+    // Handles an OTA_OFFER or OTA_CHUNK frame. Writes the OTA_STATUS to send back into
+    // `out` (PROTOCOL_MAX_FRAME_LEN bytes) and returns its length, or 0 when none is due.
+    size_t handle(const uint8_t* data, size_t len, uint8_t* out);
+
+    bool receiving() const { return state == OtaState::RECEIVING; }
+    bool complete() const { return state == OtaState::COMPLETE; }
+    uint32_t chunksReceived() const { return received; }
+    uint32_t chunkCount() const { return chunks; }
+
+private:
+    size_t acceptOffer(const OtaOffer& offer, uint8_t* out);
+    size_t acceptChunk(const OtaChunkHeader& chunk, const uint8_t* data, size_t len, uint8_t* out);
+    bool verify();
+    size_t encodeStatus(uint8_t* out, uint32_t statusSession, OtaState statusState);
+
+    OtaImageSink& sink;
+    bool hasSession = false;
+    OtaState state = OtaState::REJECTED;
+    OtaOffer offer = {};
+    uint32_t chunks = 0;
+    uint32_t received = 0;
+    uint32_t firstMissing = 0;
+    uint8_t bitmap[(OTA_MAX_CHUNKS + 7) / 8];
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <esp_partition.h>
+#include "ota.h"
+
+// The receiver image the interface hands out lives in its own data partition
+// (partitions_interface.csv), written by tools/pack_receiver_image.py as an
+// RxImageHeader followed by the receiver's firmware.bin
+#define RX_IMAGE_PARTITION_LABEL "rx_image"
+#define RX_IMAGE_MAGIC 0x4D495852   // "RXIM" little-endian
+
+struct __attribute__((packed)) RxImageHeader {
+    uint32_t magic;
+    uint32_t length;
+    uint8_t sha256[SHA256_DIGEST_LEN];
+};
+
+// Interface side: serves the image straight from flash
+class PartitionImageSource : public OtaImageSource {
+public:
+    // Finds the partition and checks its header. Returns false if no image is stored.
+    bool open();
+    uint32_t length() override { return header.length; }
+    const uint8_t* sha256() override { return header.sha256; }
+    bool read(uint32_t offset, uint8_t* out, size_t len) override;
+
+private:
+    const esp_partition_t* partition = nullptr;
+    RxImageHeader header = {};
+};
+
+// Receiver side: writes into the OTA slot that isn't running. Each 4 KB sector is erased
+// when the first chunk in it arrives, so chunks can land in any order and nothing
+// blocks for a whole-slot erase.
+class OtaPartitionSink : public OtaImageSink {
+public:
+    bool begin(uint32_t len) override;
+    bool write(uint32_t offset, const uint8_t* data, size_t len) override;
+    bool read(uint32_t offset, uint8_t* out, size_t len) override;
+    // Checks the image headers and makes the slot the boot partition
+    bool commit() override;
+    void abort() override { partition = nullptr; }
+
+private:
+    const esp_partition_t* partition = nullptr;
+    uint32_t imageLen = 0;
+    uint8_t erased[OTA_MAX_IMAGE_LEN / 4096 / 8];
+};
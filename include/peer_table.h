@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "layout.h"
+#include "telemetry.h"
+
+// Persisted size of one receiver: MAC + capability bits
+#define PEER_RECORD_LEN 7
+
+// A paired receiver node and the delivery tracking for the last state update
+struct ReceiverNode {
+    uint8_t mac[6];
+    uint8_t capabilities;   // NODE_CAP_* bits - which LEDs and fans this node owns
+
+    // Ack tracking (runtime only, not persisted)
+    bool awaitingAck;
+    uint32_t lastRttUs;     // Send-to-ack time of the most recent ack
+    uint32_t maxRttUs;
+    uint32_t acked;
+    uint32_t missed;        // Updates that exhausted their retries without an ack
+    int8_t rssi;            // Smoothed signal strength of the node's frames (dBm, 0 = unknown)
+
+    // Route learned from the node's acks: through relay `via` when hops > 0
+    uint8_t via[6];
+    uint8_t hops;
+    uint32_t relayedAcks;   // Acks that only arrived through a relay
+
+    NodeTelemetry telemetry; // Last report from the node (runtime only)
+};
+
+// Fixed-size table of receivers driven by one interface.
+// Plain data with no Arduino dependencies; callers pass timestamps in.
+class PeerTable {
+public:
+    // Adds a receiver, or updates the capabilities of a known one.
+    // Returns its index, or -1 when the table is full.
+    int add(const uint8_t* mac, uint8_t capabilities);
+    // Returns the index of `mac`, or -1 if it isn't paired
+    int find(const uint8_t* mac) const;
+    void clear() { count = 0; }
+    uint8_t size() const { return count; }
+    ReceiverNode& operator[](uint8_t index) { return nodes[index]; }
+    const ReceiverNode& operator[](uint8_t index) const { return nodes[index]; }
+
+    // Packs the table as PEER_RECORD_LEN bytes per node; `out` needs MAX_RECEIVERS records
+    size_t serialize(uint8_t* out) const;
+    // Replaces the table with the records in `data`
+    void deserialize(const uint8_t* data, size_t len);
+
+    // Starts a new ack round: every node now owes an ack for `seq`
+    void beginAckRound(uint16_t seq, uint32_t nowUs);
+    // Records an ack; returns false for unknown nodes or stale sequence numbers
+    bool recordAck(const uint8_t* mac, uint16_t seq, uint32_t nowUs);
+    // Number of nodes that still owe an ack for the current round
+    uint8_t pendingCount() const;
+    // Closes the round, counting every outstanding node as missed
+    void expireAckRound();
+
+private:
+    ReceiverNode nodes[MAX_RECEIVERS];
+    uint8_t count = 0;
+    uint16_t roundSeq = 0;
+    uint32_t roundStartUs = 0;
+};
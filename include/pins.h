@@ -14,6 +14,19 @@
 #define LED_DATA 8 // GPIO for addressable LEDs (primary)
 #define LED_DATA_2 9 // GPIO for addressable LEDs (secondary)
 #define FAN_1_CTRL 7 // GPIO for Fan 1 control
-#define FAN_2_CTRL 27 // GPIO for Fan 2 control
+#define FAN_2_CTRL 2 // GPIO for Fan 2 control (27 is a flash pin on the S3)
+#define SUPPLY_SENSE 1 // ADC input for the 5V rail, through a divider
+#define SUPPLY_SENSE_RATIO 2 // 100k/100k divider: rail = pin voltage * 2
+#define RECEIVER_PAIR_BUTTON 0 // S3 BOOT button: hold to let a paired receiver pair again
 
-#define NUM_LEDS 2
+#ifndef NUM_LEDS
+#define NUM_LEDS 2 // LEDs per strip
+#endif
+
+// Receiver HUD display (ST7789 170x320, receivers built with RECEIVER_HUD=1)
+#define HUD_TFT_SCLK 12
+#define HUD_TFT_MOSI 11
+#define HUD_TFT_CS   10
+#define HUD_TFT_DC    6
+#define HUD_TFT_RST   5
+#define HUD_TFT_BL    4
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+#include "layout.h"
+
+// Keeps a receiver's estimated draw within POWER_BUDGET_MA, so full white with both fans
+// on can't brown out a power bank. The LEDs are estimated per frame from their linear
+// channel values, the fans from their duty, and everything else is a base figure from
+// the power model. When the total would go over, the LEDs and fans are scaled down
+// together; while the suit is hot the fans get what they asked for first and the LEDs
+// what is left. Fans change duty less often than frames are rendered, so each side is
+// also held to what the other is drawing at the time: the sum never goes over, and a
+// shift between them settles by the next fan update.
+// Plain code with no Arduino dependency.
+class PowerBudget {
+public:
+    // Draw of everything but the LEDs and fans
+    void setBaseMa(float ma);
+    // Whether the fans go before the LEDs
+    void setHot(bool isHot);
+
+    // Duty for both fans (0-255) allowed when they ask for `requested`, against the
+    // LEDs' last frame
+    uint8_t fanDuty(uint8_t requested);
+    // Scale (0-65535) for a frame whose linear channel values (0-65535) add up to
+    // `sums` (R, G, B), against the fans' last duty
+    uint16_t ledScale(const uint32_t sums[3]);
+
+    // What the LEDs and fans asked for and what they were allowed, after the idle draw
+    float ledDemandMa() const { return ledRequestMa; }
+    float ledMa() const { return ledDrawMa; }
+    float fanDemandMa() const { return fanRequestMa; }
+    float fanMa() const { return fanDrawMa; }
+    // Whole receiver with the allowances in force
+    float totalMa() const;
+    bool limiting() const { return ledDrawMa < ledRequestMa || fanDrawMa < fanRequestMa; }
+
+    // LED draw of a frame with these channel sums, at full scale and without the idle draw
+    static float frameMa(const uint32_t sums[3]);
+
+private:
+    void share();
+    float available() const;
+
+    float baseMa = POWER_RADIO_RX_MA;
+    bool hot = false;
+    float ledRequestMa = 0;
+    float fanRequestMa = 0;
+    float ledGrantMa = 0;
+    float fanGrantMa = 0;
+    float ledDrawMa = 0;            // Allowed to the last frame
+    float fanDrawMa = 0;            // Allowed to the fan duty being driven
+};
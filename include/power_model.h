@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "layout.h"
+
+// What a node's radio and CPU are doing, for the power model
+enum class PowerState : uint8_t { RADIO_ON, RADIO_OFF, LIGHT_SLEEP };
+
+// Estimates a node's average current from the time it spends in each PowerState and
+// the airtime of the frames it sends, using the POWER_* figures in layout.h.
+// Transmit time is charged at the TX current instead of the RX current.
+class PowerModel {
+public:
+    // Starts a new measurement interval in `state`
+    void restart(PowerState state, int64_t nowUs);
+    void enter(PowerState state, int64_t nowUs);
+    // Charges `frames` frames totalling `bytes` sent at `phyKbps` since the last call
+    void noteSent(uint32_t frames, uint32_t bytes, uint16_t phyKbps);
+
+    float averageMa(int64_t nowUs) const;
+    // Share of the interval spent in `state`, 0-1
+    float share(PowerState state, int64_t nowUs) const;
+
+private:
+    int64_t elapsedIn(PowerState state, int64_t nowUs) const;
+
+    PowerState state = PowerState::RADIO_ON;
+    int64_t enteredUs = 0;
+    int64_t startUs = 0;
+    int64_t timeUs[3] = {};
+    int64_t txUs = 0;
+};
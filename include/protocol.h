@@ -0,0 +1,296 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "state.h"
+
+// Wire format shared by the interface and receivers.
+// Everything here is plain data so it can be exercised off-device.
+
+// Largest payload ESP-NOW carries in a single frame
+#define PROTOCOL_MAX_FRAME_LEN 250
+
+// First byte of every framed message, rejects stray traffic on the channel
+#define PROTOCOL_MAGIC 0x5C
+
+// Receiver capability bits - which hardware a node owns
+#define NODE_CAP_VISOR  0x01
+#define NODE_CAP_FAN_1  0x02
+#define NODE_CAP_FAN_2  0x04
+#define NODE_CAP_FANS   (NODE_CAP_FAN_1 | NODE_CAP_FAN_2)
+#define NODE_CAP_ALL    (NODE_CAP_VISOR | NODE_CAP_FANS)
+#define NODE_CAP_RELAY  0x08 // Forwards frames for nodes out of the interface's reach
+#define NODE_CAP_HUD    0x10 // Drives a display that mirrors the interface HUD
+
+enum class MessageType : uint8_t {
+    STATE_UPDATE = 1,   // Interface -> receivers (broadcast), per-node command slices
+    ACK = 2,            // Receiver -> interface (unicast), acknowledges a STATE_UPDATE
+    TIME_SYNC = 3,      // Interface -> receivers (broadcast), answers an ACK's time request
+    PROGRAM_CHUNK = 4,  // Interface -> receivers (broadcast), one fragment of an effect program
+    PROGRAM_REQUEST = 5, // Receiver -> interface (unicast), asks for a program it doesn't have
+    TELEMETRY = 6,      // Receiver -> interface (unicast), delta-encoded telemetry record (telemetry.h)
+    PAIR_BEACON = 7,    // Interface -> receivers (broadcast), pairing is open; carries the challenge
+    PAIR_RESPONSE = 8,  // Receiver -> interface (unicast), answers the challenge with its own nonce
+    PAIR_CONFIRM = 9,   // Interface -> receivers (broadcast), completes pairing with one node
+    CHANNEL_SWITCH = 10, // Interface -> receivers (broadcast), everyone retunes after a delay
+    CHANNEL_PROBE = 11, // Receiver -> interface (unicast), link-level ack tells the hunt it found the channel
+    RELAY = 12,         // Either direction, a frame forwarded on behalf of another node (RelayHeader)
+    SQUAD = 13,         // Interface <-> other costumes' interfaces (broadcast), squad hellos and cues (squad.h)
+    OTA_OFFER = 14,     // Interface -> receiver (unicast), firmware image on offer; also polls for an OTA_STATUS
+    OTA_CHUNK = 15,     // Interface -> receiver (unicast), one slice of the image
+    OTA_STATUS = 16,    // Receiver -> interface (unicast), which chunks have arrived (ota.h)
+    HUD_TILES = 17,     // Interface -> HUD receiver (unicast), changed screen tiles (hud_stream.h)
+    EMERGENCY_STOP = 18, // Interface -> receivers (broadcast), fans and LEDs off now; sent as a burst
+    EMERGENCY_ACK = 19, // Receiver -> interface (unicast), confirms a stop with its latency
+};
+
+// Settings of one accent LED segment (SegmentState on the wire)
+struct __attribute__((packed)) SegmentCommand {
+    bool on;
+    VisorMode mode;
+    VisorColor color;
+    uint8_t brightness;
+};
+
+// The subset of AppState a single receiver needs.
+struct __attribute__((packed)) CommandPayload {
+    // Visor Settings
+    bool visorOn;
+    VisorMode visorMode;
+    VisorColor visorColor;
+    uint8_t visorBrightness;
+
+    // Thermals
+    ThermalsMode thermalsMode;
+
+    // CRC-16 of the effect program to run in VisorMode::PROGRAM
+    uint16_t programId;
+
+    // Radio profile every node should use
+    RadioProfile radioProfile;
+
+    // Sleep between wake windows (duty_cycle.h) instead of listening all the time
+    bool radioSleep;
+
+    // Accent LED segments after the visor (led_segments.h)
+    SegmentCommand accents[LED_SEGMENTS - 1];
+};
+
+// This struct is used during the setup phase to exchange MAC addresses
+struct SetupPayload {
+    char macAddress[18]; // MAC addresses are 17 characters long + null terminator
+    uint8_t capabilities; // NODE_CAP_* bits wired on the announcing receiver
+};
+
+struct __attribute__((packed)) FrameHeader {
+    uint8_t magic;
+    MessageType type;
+    uint16_t seq;
+};
+
+// One addressed entry inside a STATE_UPDATE frame
+struct __attribute__((packed)) NodeCommand {
+    uint8_t mac[6];
+    CommandPayload command;
+};
+
+// ACK body. With ACK_FLAG_TIME_REQUEST set, txUs is the receiver's send
+// time (t1) and the interface answers with a TIME_SYNC.
+#define ACK_FLAG_TIME_REQUEST 0x01
+
+struct __attribute__((packed)) AckPayload {
+    uint8_t flags;
+    int64_t txUs;
+};
+
+// TIME_SYNC body, addressed to the node that asked. Timestamps in microseconds.
+struct __attribute__((packed)) TimeSyncPayload {
+    uint8_t mac[6];
+    int64_t requestTxUs;    // t1 - echoed from the ACK (receiver clock)
+    int64_t requestRxUs;    // t2 - interface clock when the ACK arrived
+    int64_t replyTxUs;      // t3 - interface clock when this reply was sent
+};
+
+// PROGRAM_CHUNK body, followed by up to PROGRAM_CHUNK_LEN program bytes.
+// programId is the CRC-16 of the whole program and doubles as its integrity check.
+struct __attribute__((packed)) ProgramChunkHeader {
+    uint16_t programId;
+    uint16_t totalLen;
+    uint16_t offset;
+};
+
+// PROGRAM_REQUEST body
+struct __attribute__((packed)) ProgramRequest {
+    uint16_t programId;
+};
+
+// PAIR_BEACON body
+struct __attribute__((packed)) PairBeacon {
+    uint32_t challenge;     // Fresh for each pairing session
+};
+
+// PAIR_RESPONSE body
+struct __attribute__((packed)) PairResponse {
+    uint32_t challenge;     // Echo of the beacon being answered
+    uint32_t nonce;         // Receiver's own challenge, echoed in the confirm
+    uint8_t capabilities;   // NODE_CAP_* bits wired on this receiver
+};
+
+// PAIR_CONFIRM body - broadcast, so the receiver needn't be a registered peer
+struct __attribute__((packed)) PairConfirm {
+    uint8_t mac[6];         // Receiver being confirmed
+    uint32_t nonce;
+};
+
+// CHANNEL_SWITCH body
+struct __attribute__((packed)) ChannelSwitch {
+    uint8_t channel;
+    uint16_t delayMs;       // Time left until the switch, from when the frame was sent
+};
+
+// RELAY body, followed by the complete inner frame. The outer header's seq numbers
+// the relayed copy, so every hop can drop copies it has already seen.
+struct __attribute__((packed)) RelayHeader {
+    uint8_t origin[6];      // Node that built the inner frame
+    uint8_t relayer[6];     // Node asked to forward it next; broadcast lets any relay forward
+    uint8_t hops;           // Times forwarded so far
+    uint8_t maxHops;        // Relays stop forwarding once hops reaches this
+};
+
+#define RELAY_FRAME_OVERHEAD (sizeof(FrameHeader) + sizeof(RelayHeader))
+
+// SQUAD body: SquadHeader, the kind's body, then a SQUAD_TAG_LEN-byte tag keyed with the
+// group key over everything before it. Frames from other groups or with a bad tag are ignored.
+#define SQUAD_TAG_LEN 8
+#define SQUAD_FLAG_LEADER 0x01
+
+enum class SquadKind : uint8_t {
+    HELLO = 1,  // Membership; the leader's also carries the squad clock
+    CUE = 2,    // Scene every unit applies at the same squad time
+};
+
+struct __attribute__((packed)) SquadHeader {
+    uint16_t groupId;       // Derived from the group key, filters other squads cheaply
+    uint32_t unitId;        // Sender, from its MAC
+    uint32_t counter;       // Increases with every frame the sender sends, rejects replays
+    SquadKind kind;
+};
+
+struct __attribute__((packed)) SquadHello {
+    uint8_t priority;       // Election rank, before unit id
+    uint8_t flags;          // SQUAD_FLAG_* bits
+    int64_t clockUs;        // Sender's squad clock when the frame was built
+};
+
+// The part of AppState a squad shares. Thermals stay personal.
+struct __attribute__((packed)) SquadScene {
+    bool visorOn;
+    VisorMode visorMode;
+    VisorColor visorColor;
+    uint8_t visorBrightness;
+    uint16_t programId;     // CRC-16 of the effect program, as in CommandPayload
+};
+
+struct __attribute__((packed)) SquadCue {
+    uint16_t cueSeq;
+    int64_t applyAtUs;      // Squad clock
+    SquadScene scene;
+};
+
+// Firmware update. The image is sent in OTA_CHUNK_LEN slices; a status names the first
+// missing chunk (base) and has one bit per chunk from there for OTA_STATUS_SPAN chunks.
+#define OTA_FLAG_STATUS_REQUEST 0x01    // Last chunk of a round - answer with an OTA_STATUS
+#define OTA_STATUS_SPAN 128
+
+enum class OtaState : uint8_t {
+    RECEIVING = 1,      // The bitmap tells what is still missing
+    COMPLETE = 2,       // Image verified and set to boot on the next restart
+    REJECTED = 3,       // Too large, no update slot or a flash error
+    VERIFY_FAILED = 4,  // Every chunk arrived but the hash didn't match; the transfer starts over
+};
+
+struct __attribute__((packed)) OtaOffer {
+    uint32_t sessionId;     // Taken from the image hash, so a re-offer of the same image resumes
+    uint32_t imageLen;
+    uint8_t sha256[32];
+};
+
+struct __attribute__((packed)) OtaChunkHeader {
+    uint32_t sessionId;
+    uint16_t index;
+    uint8_t flags;          // OTA_FLAG_* bits
+};
+
+struct __attribute__((packed)) OtaStatus {
+    uint32_t sessionId;
+    OtaState state;
+    uint16_t base;          // First chunk still missing (chunk count once all arrived)
+    uint8_t bitmap[OTA_STATUS_SPAN / 8];
+};
+
+#define OTA_CHUNK_LEN (PROTOCOL_MAX_FRAME_LEN - sizeof(FrameHeader) - sizeof(OtaChunkHeader))
+
+// HUD_TILES body: HudPacketHeader, then `tileCount` tiles, each a uint16_t tile index
+// (row-major, HUD_TILE_SIZE pixels square), a HudTileEncoding and its data. Pixels are RGB332.
+#define HUD_FLAG_KEYFRAME  0x01 // Part of a full-screen refresh
+#define HUD_FLAG_FRAME_END 0x02 // Last packet of the frame
+
+enum class HudTileEncoding : uint8_t {
+    SOLID = 0,      // One colour
+    PACKED = 1,     // Palette size, palette, then 1/2/4-bit indices
+    RLE = 2,        // Palette size, palette, then runs of (index << 4 | length - 1)
+    RAW = 3,        // One byte per pixel
+};
+
+struct __attribute__((packed)) HudPacketHeader {
+    uint16_t frameId;
+    uint8_t flags;          // HUD_FLAG_* bits
+    uint8_t tileCount;
+};
+
+// EMERGENCY_STOP body. The header's seq numbers the copy within the burst.
+struct __attribute__((packed)) EmergencyStop {
+    uint16_t stopId;        // Same for every copy of one press
+    int64_t pressedUs;      // Shared clock when the chord was pressed
+};
+
+// EMERGENCY_ACK body; the header's seq echoes the copy being acked
+struct __attribute__((packed)) EmergencyAck {
+    uint16_t stopId;
+    int32_t pressToOffUs;   // Press to fans off on the shared clock, -1 while the receiver isn't synced
+};
+
+// STATE_UPDATE layout: FrameHeader, node count, then `count` NodeCommand entries
+#define STATE_FRAME_FIXED_LEN (sizeof(FrameHeader) + 1)
+#define NODES_PER_STATE_FRAME ((PROTOCOL_MAX_FRAME_LEN - STATE_FRAME_FIXED_LEN) / sizeof(NodeCommand))
+#define NODES_PER_RELAYED_STATE_FRAME \
+    ((PROTOCOL_MAX_FRAME_LEN - RELAY_FRAME_OVERHEAD - STATE_FRAME_FIXED_LEN) / sizeof(NodeCommand))
+
+// Writes a frame header into `out` and returns its length
+size_t encodeHeader(uint8_t* out, MessageType type, uint16_t seq);
+
+// Validates magic and length; returns false for anything that isn't one of our frames
+bool decodeHeader(const uint8_t* data, size_t len, FrameHeader& header);
+
+// Builds a STATE_UPDATE frame from `count` entries (at most NODES_PER_STATE_FRAME).
+// Returns the encoded length.
+size_t encodeStateFrame(uint8_t* out, uint16_t seq, const NodeCommand* entries, uint8_t count);
+
+// Wraps `inner` (a complete frame) in a RELAY frame. Returns 0 if it doesn't fit.
+size_t encodeRelayFrame(uint8_t* out, uint16_t relaySeq, const RelayHeader& relay,
+                        const uint8_t* inner, size_t innerLen);
+
+// Splits a RELAY frame into its header and inner frame. Returns false if malformed.
+bool decodeRelayFrame(const uint8_t* data, size_t len, RelayHeader& relay,
+                      const uint8_t*& inner, size_t& innerLen);
+
+// Reads the body of an EMERGENCY_STOP. Returns false for any other frame.
+// Cheap enough to run in the receive callback.
+bool decodeEmergencyStop(const uint8_t* data, size_t len, EmergencyStop& out);
+
+// CRC-16/CCITT-FALSE
+uint16_t crc16(const uint8_t* data, size_t len);
+
+// Finds the command addressed to `mac` inside a STATE_UPDATE frame.
+// Returns false if the frame is malformed or carries nothing for this node.
+bool findNodeCommand(const uint8_t* data, size_t len, const uint8_t* mac, CommandPayload& out);
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdint.h>
+#include "state.h"
+
+// What a radio profile means for TX power control
+struct RadioProfileLimits {
+    int8_t maxTxPower;      // 0.25 dBm units
+    int8_t sensitivityDbm;  // Weakest signal the profile's PHY rate still decodes reliably
+    uint16_t phyKbps;       // PHY rate frames go out at
+};
+
+RadioProfileLimits radioProfileLimits(RadioProfile profile);
+
+// Applies the profile's PHY rate, TX power and modem power-save mode.
+// Every node keeps 802.11 LR enabled alongside b/g/n, so nodes on different
+// profiles still hear each other while a change propagates.
+bool applyRadioProfile(RadioProfile profile);
+
+// Overrides the TX power within the current profile (0.25 dBm units)
+bool setRadioTxPower(int8_t power);
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+#include "layout.h"
+
+// Remembers the last RELAY_SEEN_CACHE relayed copies by origin and relay seq, so a
+// node handles and forwards each copy once however many relays repeat it.
+class RelayCache {
+public:
+    // Returns true the first time a copy is seen, and records it
+    bool firstSighting(const uint8_t* origin, uint16_t relaySeq);
+    void clear() { count = 0; }
+
+private:
+    struct Entry {
+        uint8_t origin[6];
+        uint16_t seq;
+    };
+    Entry entries[RELAY_SEEN_CACHE];
+    uint8_t next = 0;   // Oldest entry, overwritten when full
+    uint8_t count = 0;
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include "layout.h"
+
+// Largest payload ESP-NOW will deliver in a single frame
+#define RX_FRAME_MAX_LEN 250
+
+// A raw frame copied out of the ESP-NOW receive callback
+struct RxFrame {
+    int64_t rxUs;       // Arrival time, taken in the receive callback
+    uint8_t mac[6];
+    int8_t rssi;        // Signal strength in dBm, RSSI_UNKNOWN where the core doesn't report it
+    uint8_t hops;       // Relays the frame passed through (0 when heard from its origin)
+    uint8_t via[6];     // Last relay, when hops > 0
+    uint8_t len;
+    uint8_t data[RX_FRAME_MAX_LEN];
+};
+
+// Bounded single-producer/single-consumer ring buffer.
+// The WiFi task pushes from the receive callback and the comms task pops, so
+// neither side ever blocks or takes a lock. Holds RX_QUEUE_DEPTH - 1 frames.
+class RxQueue {
+public:
+    // Copies a frame into the next free slot (producer side only).
+    // Returns false and counts a drop when the queue is full or the frame is oversized.
+    bool push(const uint8_t* mac, const uint8_t* data, int len, int64_t rxUs, int8_t rssi);
+    // Copies the oldest frame into `out` (consumer side only). Returns false when empty.
+    bool pop(RxFrame& out);
+    // Whether a frame is waiting (consumer side only)
+    bool empty() const { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_relaxed); }
+    // Number of frames dropped since boot
+    uint32_t dropped() const { return dropCount.load(std::memory_order_relaxed); }
+
+private:
+    RxFrame slots[RX_QUEUE_DEPTH];
+    std::atomic<uint8_t> head{0};  // Next slot to write, owned by the producer
+    std::atomic<uint8_t> tail{0};  // Next slot to read, owned by the consumer
+    std::atomic<uint32_t> dropCount{0};
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+#include "layout.h"
+#include "led_compositor.h"
+
+// Warning a receiver shows after losing its interface: red flashing every
+// SHUTDOWN_FLASH_INTERVAL_MS for SHUTDOWN_FLASH_DURATION_MS, then an even fade to off over
+// SHUTDOWN_FADE_DURATION_MS, drawn as the compositor's overlay. Time driven and advanced
+// from the LED task, so commands keep being handled and one can cancel it. Turning the
+// fans off is up to the caller.
+// Plain code with no Arduino dependency; callers pass the time in, on the clock they
+// render with.
+class SafetyShutdown {
+public:
+    enum class Phase : uint8_t { IDLE, FLASHING, FADING };
+
+    explicit SafetyShutdown(LedCompositor& leds) : leds(leds) {}
+
+    // Starts the warning at `nowMs`; does nothing while one is already running
+    void begin(uint32_t nowMs);
+    // Moves the warning on to `nowMs`; call before each render
+    void service(uint32_t nowMs);
+    // Drops the warning at once, e.g. when a command arrives
+    void abort();
+
+    Phase phase() const { return current; }
+    bool active() const { return current != Phase::IDLE; }
+
+private:
+    LedCompositor& leds;
+    Phase current = Phase::IDLE;
+    uint32_t phaseStartMs = 0;
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+#include "fan_output.h"
+
+// Enforces the receiver's RECEIVER_TIMEOUT_MS from an esp_timer, so it holds even when
+// the comms task is stuck. If no command feeds it in time, the timer task halts the fans
+// itself and flags comms, which starts the visual warning when it next gets round to it.
+// Tasks put under the task watchdog with supervise() reset the receiver if one stalls
+// outright; the fans come up off after the reset. Only one instance may exist, since the
+// timer callback is global.
+class SafetyWatchdog {
+public:
+    bool begin(LedcFanOutput& fans);
+
+    // Pushes the deadline RECEIVER_TIMEOUT_MS out and lets the fans run again; call on
+    // every valid command. Nothing fires before the first one.
+    void feed();
+
+    // Whether the deadline passed since the last call
+    bool takeExpired();
+
+    // Puts the calling task under the task watchdog; it must then checkIn() once a pass
+    void supervise();
+    void checkIn();
+};
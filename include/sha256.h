@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SHA256_DIGEST_LEN 32
+
+// FIPS 180-4 SHA-256, incremental. Portable so firmware images can be checked the
+// same way on the device and in host runs.
+class Sha256 {
+public:
+    Sha256() { reset(); }
+    void reset();
+    void update(const uint8_t* data, size_t len);
+    // Writes the digest and leaves the hasher reset
+    void finish(uint8_t* digest);
+
+private:
+    void compress(const uint8_t* block);
+
+    uint32_t state[8];
+    uint8_t buffer[64];
+    size_t buffered;
+    uint64_t totalLen;
+};
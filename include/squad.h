@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "layout.h"
+#include "protocol.h"
+
+// Squad membership, leader election and cue scheduling between the interfaces of
+// several costumes. Plain data with no Arduino dependencies; callers pass esp_timer
+// microseconds in and broadcast whatever poll() hands back.
+//
+// The leader is the live unit claiming leadership with the highest priority, then
+// unit id. A claim is kept while the leader is heard, so a unit joining later only
+// takes over when it has a higher priority. Followers estimate the squad clock from
+// the leader's beacons, keeping the largest (least delayed) offset of the last few.
+class SquadSync {
+public:
+    // Joins the squad sharing `key`
+    void begin(const uint8_t* selfMac, const char* key, uint8_t priority, int64_t nowUs);
+    void end() { running = false; }
+    bool active() const { return running; }
+
+    // Writes the next frame to broadcast into `out` (PROTOCOL_MAX_FRAME_LEN bytes) when one
+    // is due and the airtime budget allows. Returns its length, 0 for nothing. Call until 0.
+    size_t poll(int64_t nowUs, uint8_t* out);
+
+    // Handles a SQUAD frame. Returns false for other groups, bad tags and replays.
+    bool receive(const uint8_t* data, size_t len, int64_t rxUs);
+
+    // Announces `scene` for SQUAD_CUE_LEAD_MS from now. Only the leader cues; returns false otherwise.
+    bool cue(const SquadScene& scene, int64_t nowUs);
+
+    // Returns true once when the latest cue's time has come, with its scene
+    bool cueDue(int64_t nowUs, SquadScene& scene);
+
+    bool leading() const { return running && claimsLead; }
+    uint32_t unitId() const { return selfId; }
+    uint32_t leaderId() const { return leader; }
+    // Live units, including this one
+    uint8_t size() const { return memberCount + 1; }
+    bool synced() const { return leading() || syncCount > 0; }
+
+    // Converts a local timestamp to the squad clock
+    int64_t toSquadUs(int64_t localUs) const { return localUs + offsetUs; }
+
+    uint32_t framesSent() const { return sent; }
+    uint32_t framesThrottled() const { return throttled; }
+    uint32_t framesRejected() const { return rejected; }
+    uint32_t lateCues() const { return late; }    // Cues heard only after their time
+
+private:
+    struct Member {
+        uint32_t id;
+        uint8_t priority;
+        bool claimsLead;
+        int64_t lastSeenUs;
+        uint32_t lastCounter;
+    };
+
+    bool outranks(uint8_t priorityA, uint32_t idA, uint8_t priorityB, uint32_t idB) const;
+    int64_t helloIntervalUs() const;
+    void expireMembers(int64_t nowUs);
+    void elect(int64_t nowUs);
+    void setLeader(uint32_t id);
+    bool spendToken(int64_t nowUs);
+    size_t seal(uint8_t* out, SquadKind kind, const void* body, size_t bodyLen);
+    uint64_t tag(const uint8_t* data, size_t len) const;
+    uint32_t nextRandom();
+
+    bool running = false;
+    uint64_t key[2] = {};
+    uint16_t groupId = 0;
+    uint32_t selfId = 0;
+    uint8_t selfPriority = 0;
+    uint32_t counter = 0;
+    uint32_t randomState = 1;
+    int64_t joinedUs = 0;
+
+    Member members[SQUAD_MAX_UNITS];
+    uint8_t memberCount = 0;
+    bool claimsLead = false;
+    uint32_t leader = 0;        // Unit followed (0 while none is known)
+
+    // Squad clock
+    int64_t offsetUs = 0;
+    int64_t offsetSamples[SQUAD_SYNC_WINDOW];
+    uint8_t syncCount = 0;
+    uint8_t syncNext = 0;
+
+    // Cue being repeated (leader) and cue waiting to apply
+    SquadCue outgoing = {};
+    uint8_t repeatsLeft = 0;
+    int64_t nextRepeatUs = 0;
+    uint16_t cueSeq = 0;
+    bool haveCue = false;
+    uint16_t lastCueSeq = 0;
+    bool cueScheduled = false;
+    int64_t cueLocalUs = 0;
+    SquadScene scheduledScene = {};
+
+    int64_t nextHelloUs = 0;
+    float tokens = SQUAD_TOKEN_BURST;
+    int64_t tokensUpdatedUs = 0;
+    bool waitingForToken = false;
+
+    uint32_t sent = 0;
+    uint32_t throttled = 0;
+    uint32_t rejected = 0;
+    uint32_t late = 0;
+};
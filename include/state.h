@@ -2,7 +2,8 @@
 #include <stdint.h>
 
 // Enum for Visor Mode
-enum class VisorMode : uint8_t { SOLID, FLASHING, PULSING, STROBE };
+// PROGRAM runs an uploaded bytecode effect on the receiver (see effect_vm.h)
+enum class VisorMode : uint8_t { SOLID, FLASHING, PULSING, STROBE, PROGRAM };
 
 // Enum for Visor Color
 enum class VisorColor : uint8_t { WHITE, BLUE, GREEN, YELLOW, ORANGE, RED };
@@ -10,24 +11,50 @@ enum class VisorColor : uint8_t { WHITE, BLUE, GREEN, YELLOW, ORANGE, RED };
 // Enum for HUD Style
 enum class HudStyle : uint8_t { BIOMETRIC, RADAR, MATRIX };
 
+// Enum for Radio Profile (see radio_profile.h)
+enum class RadioProfile : uint8_t { LOW_LATENCY, LONG_RANGE, LOW_POWER };
+
+// Enum for Squad Role (see squad.h) - LEAD outranks MEMBER in the leader election
+enum class SquadRole : uint8_t { OFF, MEMBER, LEAD };
+
+// Enum for Thermals Mode - AUTO follows the thermal curve (fan_control.h), MAX runs the fans flat out
+enum class ThermalsMode : uint8_t { OFF, AUTO, MAX };
+
 // Enum for Boot Sequence
 enum class BootSequence : uint8_t { UNSC_LOGO, PROGRESS_BAR };
 
+// LED segments (led_segments.h): the visor, then up to LED_SEGMENTS - 1 accents such as
+// edge strips or chest lights. Part of the wire format, so every node must agree.
+#define LED_SEGMENTS 4
+
+// Settings of one accent segment; the visor's are the visor fields below
+struct SegmentState {
+    bool on = false;
+    VisorMode mode = VisorMode::SOLID;
+    VisorColor color = VisorColor::BLUE;
+    uint8_t brightness = 3;     // Range 1-4
+};
+
 struct AppState {
     // Visor Settings
     bool visorOn = false;
     VisorMode visorMode = VisorMode::SOLID;
     VisorColor visorColor = VisorColor::BLUE;
     uint8_t visorBrightness = 3; // Range 1-4
+    uint8_t effectProgram = 0;   // Index into effectPrograms, used in PROGRAM mode
+    SegmentState accents[LED_SEGMENTS - 1];
 
     // Thermals
-    bool thermalsOn = false;
+    ThermalsMode thermalsMode = ThermalsMode::OFF;
 
     // HUD
     HudStyle hudStyle = HudStyle::BIOMETRIC;
 
     // Settings
     BootSequence bootSequence = BootSequence::UNSC_LOGO;
+    RadioProfile radioProfile = RadioProfile::LOW_LATENCY;
+    bool radioSleep = false;     // Duty-cycle the radios between wake windows (duty_cycle.h)
+    SquadRole squadRole = SquadRole::OFF;
 };
 
 // Declare a global instance of the state that can be accessed from any file
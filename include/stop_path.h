@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+// Carries an emergency stop from the receive callback to the fans without waiting on
+// stateLock. The callback marks the stop and wakes a dedicated stop task that outranks
+// comms and the LEDs; that task cuts the fans through `cutFans` straight away, and only
+// then does comms take the lock for the rest (LEDs, state, the ack). The watchdog's timer
+// cuts the fans the same way.
+// Plain code with no Arduino dependency; the caller supplies the cut, the clock and the
+// task wake-ups.
+class StopPath {
+public:
+    StopPath(void (*cutFans)(), int64_t (*clockUs)()) : cut(cutFans), clock(clockUs) {}
+
+    // From the receive callback, before waking the stop task
+    void heard() { pending.store(true, std::memory_order_release); }
+
+    // From the stop task: cuts the fans if a stop is waiting. Returns whether it did.
+    bool service();
+
+    // When the fans last went off for a stop, on the clock; 0 before the first
+    int64_t cutUs() const { return lastCutUs.load(std::memory_order_acquire); }
+
+private:
+    void (*cut)();
+    int64_t (*clock)();
+    std::atomic<bool> pending{false};
+    std::atomic<int64_t> lastCutUs{0};
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+// CPU share of one task, from the time it spends working between blocking waits. The
+// task adds each pass; a report from another task takes the totals. Counting it here
+// works whether or not the core was built with FreeRTOS run-time stats.
+// Plain code with no Arduino dependency; callers pass the time in.
+class TaskLoad {
+public:
+    // Adds one pass of work that took `us`
+    void add(uint32_t us);
+
+    // Share of the `elapsedUs` since the last take() spent working (0-1), with the
+    // longest pass in that time. Starts the next interval.
+    float take(uint32_t elapsedUs, uint32_t& longestUs);
+
+private:
+    std::atomic<uint32_t> busyUs{0};
+    std::atomic<uint32_t> longestPassUs{0};
+};
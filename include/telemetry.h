@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Safe-state flags reported by a receiver
+#define SAFE_FLAG_TIMED_OUT      0x01 // Watchdog fired; outputs were forced to the safe state
+#define SAFE_FLAG_UNPAIRED       0x02 // No interface MAC saved, commands accepted from anyone
+#define SAFE_FLAG_PROGRAM_FAULT  0x04 // Effect program faulted since the last report
+#define SAFE_FLAG_EMERGENCY_STOP 0x08 // Stopped by the interface; cleared by a command turning anything on
+
+// Field presence bits of an encoded record
+#define TELEMETRY_FIELD_FANS     0x01
+#define TELEMETRY_FIELD_TEMP     0x02
+#define TELEMETRY_FIELD_SUPPLY   0x04
+#define TELEMETRY_FIELD_FPS      0x08
+#define TELEMETRY_FIELD_MARGIN   0x10
+#define TELEMETRY_FIELD_FLAGS    0x20
+#define TELEMETRY_FIELD_CURRENT  0x40 // Radio/CPU current and the power budget's watts
+#define TELEMETRY_FIELD_ALL      0x7F
+#define TELEMETRY_KEYFRAME       0x80 // Record carries every field and starts a new base
+
+// Keyframe id + field mask + every field
+#define TELEMETRY_MAX_LEN 17
+
+// What a receiver measured about itself
+struct TelemetrySnapshot {
+    uint8_t fans = 0;               // NODE_CAP_FAN_* bits of fans actually driven on
+    uint8_t fanDuty[2] = {0, 0};    // PWM duty driven on each fan, 0-255
+    int16_t chipTempDeciC = 0;      // Tenths of a degree C
+    uint16_t supplyMv = 0;
+    uint8_t ledFps = 0;
+    uint16_t watchdogMarginMs = 0;  // Time left before the safety shutdown
+    uint8_t safeFlags = 0;          // SAFE_FLAG_* bits
+    uint16_t currentDeciMa = 0;     // Power model estimate (power_model.h), tenths of a mA
+    uint16_t powerMw = 0;           // Whole receiver incl. LEDs and fans (power_budget.h)
+};
+
+// Interface-side copy of a receiver's telemetry
+struct NodeTelemetry {
+    bool valid = false;
+    uint8_t keyframeId = 0;
+    TelemetrySnapshot keyframe;     // Base the receiver's deltas refer to
+    TelemetrySnapshot current;
+    uint32_t updatedMs = 0;
+};
+
+// Hardware readings, so the receiver logic can run against a host stand-in
+class TelemetrySensors {
+public:
+    virtual ~TelemetrySensors() {}
+    virtual int16_t chipTempDeciC() = 0;
+    virtual uint16_t supplyMv() = 0;
+    virtual uint8_t fans() = 0;
+    virtual uint8_t fanDuty(uint8_t fan) = 0;   // Fan 0 or 1
+};
+
+// Stand-in with settable readings for host runs
+class FixedTelemetrySensors : public TelemetrySensors {
+public:
+    int16_t tempDeciC = 250;
+    uint16_t millivolts = 5000;
+    uint8_t fanBits = 0;
+    uint8_t duties[2] = {0, 0};
+
+    int16_t chipTempDeciC() override { return tempDeciC; }
+    uint16_t supplyMv() override { return millivolts; }
+    uint8_t fans() override { return fanBits; }
+    uint8_t fanDuty(uint8_t fan) override { return duties[fan]; }
+};
+
+// Delta-encodes snapshots. Each record only carries the fields that differ from
+// the last keyframe (beyond a small dead-band for the noisy analog readings),
+// so a lost record costs one sample rather than corrupting the ones after it.
+class TelemetryEncoder {
+public:
+    // Writes the record for `current` into `out` (TELEMETRY_MAX_LEN bytes); returns its length
+    size_t encode(const TelemetrySnapshot& current, uint8_t* out);
+
+private:
+    bool hasKeyframe = false;
+    uint8_t keyframeId = 0;
+    uint8_t sinceKeyframe = 0;
+    TelemetrySnapshot keyframe;
+};
+
+// Applies a record to `cache`. Deltas against a keyframe the cache never saw
+// are ignored until the next keyframe. Returns false if nothing was applied.
+bool decodeTelemetry(const uint8_t* data, size_t len, NodeTelemetry& cache);
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+
+// NTP-style estimate of the master (interface) clock from the receiver's clock.
+// Each exchange gives four timestamps: t1 local send, t2 master receive,
+// t3 master send, t4 local receive. Offset and drift are tracked so effects can
+// be evaluated on the shared timebase between exchanges.
+class TimeSync {
+public:
+    // Feeds one completed exchange. Returns false if the sample was rejected
+    // because its round trip was too slow to be trustworthy.
+    bool addSample(int64_t t1, int64_t t2, int64_t t3, int64_t t4);
+
+    // Converts a local timestamp to the shared timebase (identity until synced)
+    int64_t toShared(int64_t localUs) const;
+
+    // True once the last accepted sample is older than `intervalUs` (or none yet)
+    bool needsSync(int64_t localUs, int64_t intervalUs) const;
+
+    bool synced() const { return hasSample; }
+    int64_t offsetUs() const { return refOffsetUs; }
+    float driftPpm() const { return drift * 1e6f; }
+    int64_t lastDelayUs() const { return delayUs; }
+    // How far the prediction had wandered from the latest measured offset
+    int64_t lastErrorUs() const { return errorUs; }
+
+private:
+    bool hasSample = false;
+    int64_t refLocalUs = 0;   // Local time the reference offset was measured at
+    int64_t refOffsetUs = 0;  // Master minus local at refLocalUs
+    double drift = 0.0;       // Master rate relative to local, minus one
+    int64_t delayUs = 0;
+    int64_t errorUs = 0;
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Reported as the RSSI of a frame when the radio can't measure it
+#define RSSI_UNKNOWN 0
+
+// 2.4 GHz channels 1-13, indexed by channel number (index 0 unused)
+#define RADIO_CHANNEL_SLOTS 14
+
+// How busy each channel looked during a survey
+struct ChannelSurvey {
+    uint8_t networks[RADIO_CHANNEL_SLOTS] = {};  // Access points heard on the channel
+    float energyMw[RADIO_CHANNEL_SLOTS] = {};    // Sum of their received power
+};
+
+// Radio link used by the protocol code. The firmware uses EspNowTransport;
+// HostTransport (host builds only) carries the same frames over local UDP so
+// interface and receiver logic can run as processes on a development machine.
+class Transport {
+public:
+    // Invoked from the transport's receive context (WiFi task on device, socket thread on host).
+    // Must stay short - copy the frame out and return. `rssi` is in dBm, or RSSI_UNKNOWN.
+    using ReceiveCallback = void (*)(const uint8_t* mac, const uint8_t* data, int len, int8_t rssi);
+    // Reports whether a unicast frame reached its peer; broadcasts always report delivered
+    using SendStatusCallback = void (*)(const uint8_t* mac, bool delivered);
+
+    virtual ~Transport() = default;
+
+    // Brings the link up. Returns false if the radio could not be initialized.
+    virtual bool begin() = 0;
+    // Queues a frame for `mac` (FF:FF:FF:FF:FF:FF broadcasts). Returns false if it was refused.
+    virtual bool send(const uint8_t* mac, const uint8_t* data, size_t len) = 0;
+
+    virtual bool addPeer(const uint8_t* mac) = 0;
+    virtual bool removePeer(const uint8_t* mac) = 0;
+    virtual bool hasPeer(const uint8_t* mac) = 0;
+
+    virtual void onReceive(ReceiveCallback callback) = 0;
+    virtual void onSendStatus(SendStatusCallback callback) = 0;
+
+    // Retunes the radio; peers follow the current channel
+    virtual bool setChannel(uint8_t channel) = 0;
+    virtual uint8_t channel() = 0;
+    // Listens on one channel and adds what it heard to `survey`. Blocks for the scan
+    // dwell, and nothing is received meanwhile; the radio is back on its channel afterwards.
+    virtual bool surveyChannel(uint8_t channel, ChannelSurvey& survey) = 0;
+
+    // Surveys every channel in turn into a fresh `survey`, blocking for all of them
+    bool surveyChannels(ChannelSurvey& survey) {
+        survey = ChannelSurvey();
+        for (uint8_t ch = 1; ch < RADIO_CHANNEL_SLOTS; ch++) {
+            if (!surveyChannel(ch, survey)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Powers the radio down between wake windows, or back up on its channel.
+    // Nothing is heard while it is down, and send() refuses frames.
+    virtual bool setRadioSleep(bool asleep) = 0;
+
+    // Frames and payload bytes handed to the radio so far, for airtime estimates
+    uint32_t framesSent() const { return txFrames; }
+    uint32_t bytesSent() const { return txBytes; }
+
+protected:
+    void countSent(size_t len) {
+        txFrames++;
+        txBytes += len;
+    }
+
+private:
+    uint32_t txFrames = 0;
+    uint32_t txBytes = 0;
+};
+
+// Registers `mac` as a peer unless it already is one
+inline bool ensurePeer(Transport& transport, const uint8_t* mac) {
+    return transport.hasPeer(mac) || transport.addPeer(mac);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "transport.h"
+
+// Transport backed by ESP-NOW. WiFi must already be in station mode.
+// Only one instance may exist, since ESP-NOW callbacks are global.
+class EspNowTransport : public Transport {
+public:
+    bool begin() override;
+    bool send(const uint8_t* mac, const uint8_t* data, size_t len) override;
+
+    bool addPeer(const uint8_t* mac) override;
+    bool removePeer(const uint8_t* mac) override;
+    bool hasPeer(const uint8_t* mac) override;
+
+    void onReceive(ReceiveCallback callback) override;
+    void onSendStatus(SendStatusCallback callback) override;
+
+    bool setChannel(uint8_t channel) override;
+    uint8_t channel() override;
+    bool surveyChannel(uint8_t channel, ChannelSurvey& survey) override;
+    bool setRadioSleep(bool asleep) override;
+
+private:
+    bool asleep = false;
+    uint8_t awakeChannel = 0;
+    int8_t awakeTxPower = 0;
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "transport.h"
+
+#ifndef ARDUINO
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <thread>
+#include <vector>
+
+// UDP ports used by host nodes: a node listens on base + (last MAC byte % HOST_TRANSPORT_MAX_NODES)
+#define HOST_TRANSPORT_BASE_PORT 47000
+#define HOST_TRANSPORT_MAX_NODES 64
+
+// Impairments applied independently to every frame a host node sends
+struct LinkModel {
+    uint32_t latencyUs = 0;
+    uint32_t jitterUs = 0;     // Uniform +/- spread around latencyUs
+    float lossRate = 0.0f;     // Probability (0-1) that a frame never arrives
+    int8_t rssi = -50;         // Reported with every received frame
+    // Extra loss on a congested channel, on top of lossRate. Surveys report it as activity.
+    float channelLoss[RADIO_CHANNEL_SLOTS] = {};
+    // Extra loss towards individual nodes, indexed like their ports (last MAC byte % max nodes),
+    // to lay out multi-hop topologies
+    float nodeLoss[HOST_TRANSPORT_MAX_NODES] = {};
+};
+
+// Channel host nodes start on, as ESP-NOW does without an explicit channel
+#define HOST_TRANSPORT_DEFAULT_CHANNEL 1
+
+// Host stand-in for ESP-NOW carrying frames over 127.0.0.1 UDP.
+// Nodes may live in one process or several; a broadcast fans out to every node port.
+// Frames only reach nodes tuned to the sender's channel, and a unicast reports
+// delivered only when the destination answers with a link-level ack, as on air.
+// Receive callbacks run on a socket thread, like the WiFi task on device.
+class HostTransport : public Transport {
+public:
+    explicit HostTransport(const uint8_t* mac, LinkModel model = LinkModel(),
+                           uint16_t basePort = HOST_TRANSPORT_BASE_PORT);
+    ~HostTransport() override;
+
+    bool begin() override;
+    bool send(const uint8_t* mac, const uint8_t* data, size_t len) override;
+
+    bool addPeer(const uint8_t* mac) override;
+    bool removePeer(const uint8_t* mac) override;
+    bool hasPeer(const uint8_t* mac) override;
+
+    void onReceive(ReceiveCallback callback) override;
+    void onSendStatus(SendStatusCallback callback) override;
+
+    bool setChannel(uint8_t channel) override;
+    uint8_t channel() override;
+    bool surveyChannel(uint8_t channel, ChannelSurvey& survey) override;
+    bool setRadioSleep(bool asleep) override;
+
+    void setLinkModel(const LinkModel& model);
+
+private:
+    struct PendingFrame {
+        uint64_t dueUs;
+        uint16_t port;
+        bool lost;
+        bool unicast;
+        uint8_t dest[6];
+        std::vector<uint8_t> bytes;   // Kind, channel, source MAC, then the payload
+        bool operator>(const PendingFrame& other) const { return dueUs > other.dueUs; }
+    };
+
+    uint16_t portFor(const uint8_t* mac) const;
+    struct AwaitedAck {
+        uint64_t deadlineUs;
+        uint8_t dest[6];
+    };
+
+    void schedule(const uint8_t* dest, uint16_t port, bool unicast, const uint8_t* data, size_t len);
+    void receiveLoop();
+    void deliveryLoop();
+    void sendDatagram(uint16_t port, const uint8_t* bytes, size_t len);
+    void resolveAck(const uint8_t* mac, bool delivered);
+
+    uint8_t selfMac[6];
+    uint16_t basePort;
+    int sock = -1;
+
+    std::mutex lock;
+    std::condition_variable wake;
+    LinkModel model;
+    std::mt19937 rng;
+    std::vector<std::vector<uint8_t>> peers;
+    std::priority_queue<PendingFrame, std::vector<PendingFrame>, std::greater<PendingFrame>> outbox;
+    std::vector<AwaitedAck> awaitedAcks;
+    std::atomic<uint8_t> currentChannel{HOST_TRANSPORT_DEFAULT_CHANNEL};
+    std::atomic<bool> asleep{false};
+
+    std::atomic<ReceiveCallback> receiveCallback{nullptr};
+    std::atomic<SendStatusCallback> sendStatusCallback{nullptr};
+    std::atomic<bool> running{false};
+    std::thread receiver;
+    std::thread sender;
+};
+
+#endif
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+#include "radio_profile.h"
+
+// Steps the interface's TX power down while every receiver has margin to spare.
+// Plain data with no Arduino dependencies; callers pass timestamps in.
+//
+// Only the interface adjusts, so the RSSI it measures is the receiver's signal at
+// full profile power. Assuming a symmetric path, the receiver hears the interface
+// at that RSSI minus however far the interface has stepped down.
+class TxPowerControl {
+public:
+    // Starts over at the profile's full power
+    void reset(RadioProfile profile);
+    // Takes the weakest receiver's RSSI (RSSI_UNKNOWN if none reported one) and whether
+    // any ack was missed since the last call. Returns true when power() changed.
+    bool update(int8_t weakestRssi, bool missedAck, uint32_t nowMs);
+    int8_t power() const { return txPower; }
+    // Estimated margin at the weakest receiver, in dB, from the last update
+    int marginDb() const { return lastMarginDb; }
+
+private:
+    RadioProfileLimits limits = {80, -82, 24000};
+    int8_t txPower = 80;
+    int lastMarginDb = 0;
+    uint32_t lastAdjustMs = 0;
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+
+// Shared 8-bit waveform lookups for LED effects.
+// Phase 0-255 covers one full period; output 0-255.
+
+// Sine wave starting at mid-level (sin8(0) == 128, peak at 64)
+uint8_t sin8(uint8_t phase);
+
+// Triangle wave: 0 at phase 0, 255 at phase 128
+uint8_t tri8(uint8_t phase);
+
+// a * b / 255, rounded - scales one 8-bit value by another
+uint8_t scale8(uint8_t value, uint8_t scale);
+
+// Waveforms an effect can be built from
+enum class Wave : uint8_t {
+    CONSTANT,   // Always 255
+    SINE,       // sin8
+    SQUARE,     // 255 for the first half of the period, 0 for the second
+};
+
+// Value of `wave` at `phase`
+uint8_t wave8(Wave wave, uint8_t phase);
@@ -0,0 +1,32 @@
+#ifdef ARDUINO
+
+#include "board_sensors.h"
+#include <Arduino.h>
+#include "pins.h"
+#include "fan_output.h"
+#include "protocol.h"
+
+int16_t BoardTelemetrySensors::chipTempDeciC() {
+    return (int16_t)(temperatureRead() * 10);
+}
+
+uint16_t BoardTelemetrySensors::supplyMv() {
+    return analogReadMilliVolts(SUPPLY_SENSE) * SUPPLY_SENSE_RATIO;
+}
+
+uint8_t BoardTelemetrySensors::fans() {
+    uint8_t bits = 0;
+    if (fanDuty(0) > 0) {
+        bits |= NODE_CAP_FAN_1;
+    }
+    if (fanDuty(1) > 0) {
+        bits |= NODE_CAP_FAN_2;
+    }
+    return bits;
+}
+
+uint8_t BoardTelemetrySensors::fanDuty(uint8_t fan) {
+    return LedcFanOutput::readDuty(fan);
+}
+
+#endif
@@ -0,0 +1,22 @@
+#include "change_batcher.h"
+
+void ChangeBatcher::mark(uint32_t nowMs) {
+    if (!dirty) {
+        dirty = true;
+        firstChangeMs = nowMs;
+    }
+    lastChangeMs = nowMs;
+    changeCount++;
+}
+
+bool ChangeBatcher::due(uint32_t nowMs) {
+    if (!dirty) {
+        return false;
+    }
+    if (nowMs - lastChangeMs < quietMs && nowMs - firstChangeMs < maxDelayMs) {
+        return false;
+    }
+    dirty = false;
+    flushCount++;
+    return true;
+}
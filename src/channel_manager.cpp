@@ -0,0 +1,105 @@
+#include "channel_manager.h"
+#include "layout.h"
+
+static const uint8_t candidates[] = CHANNEL_CANDIDATES;
+static const uint8_t candidateCount = sizeof(candidates) / sizeof(candidates[0]);
+
+// Received power that counts as much as one extra network on the channel
+#define CHANNEL_ENERGY_REF_MW 1e-7f // -70 dBm
+
+float ChannelManager::channelScore(const ChannelSurvey& survey, uint8_t channel) {
+    // 20 MHz channels are 5 MHz apart, so anything within four channels overlaps,
+    // weighted by how much
+    float score = 0;
+    for (int ch = channel - 4; ch <= channel + 4; ch++) {
+        if (ch < 1 || ch >= RADIO_CHANNEL_SLOTS) {
+            continue;
+        }
+        int distance = ch > channel ? ch - channel : channel - ch;
+        float overlap = 1.0f - distance / 5.0f;
+        score += overlap * (survey.networks[ch] + survey.energyMw[ch] / CHANNEL_ENERGY_REF_MW);
+    }
+    return score;
+}
+
+uint8_t ChannelManager::pickChannel(const ChannelSurvey& survey, uint8_t exclude) {
+    uint8_t best = 0;
+    float bestScore = 0;
+    for (uint8_t i = 0; i < candidateCount; i++) {
+        if (candidates[i] == exclude) {
+            continue;
+        }
+        float score = channelScore(survey, candidates[i]);
+        if (best == 0 || score < bestScore) {
+            best = candidates[i];
+            bestScore = score;
+        }
+    }
+    return best;
+}
+
+void ChannelManager::recordDelivery(uint16_t delivered, uint16_t attempted) {
+    windowDelivered += delivered;
+    windowAttempted += attempted;
+    if (windowAttempted >= CHANNEL_DELIVERY_WINDOW) {
+        lastRate = (float)windowDelivered / windowAttempted;
+        badWindow = lastRate < CHANNEL_MIGRATE_BELOW;
+        windowDelivered = 0;
+        windowAttempted = 0;
+    }
+}
+
+bool ChannelManager::shouldMigrate(uint32_t nowMs) {
+    if (!badWindow || switchPending()) {
+        return false;
+    }
+    if (migrated && nowMs - lastMigrationMs < CHANNEL_MIGRATE_COOLDOWN_MS) {
+        return false;
+    }
+    badWindow = false;
+    return true;
+}
+
+void ChannelManager::scheduleSwitch(uint8_t channel, uint32_t atMs) {
+    pendingChannel = channel;
+    switchAtMs = atMs;
+}
+
+uint8_t ChannelManager::switchDue(uint32_t nowMs) {
+    if (pendingChannel == 0 || (int32_t)(nowMs - switchAtMs) < 0) {
+        return 0;
+    }
+    uint8_t channel = pendingChannel;
+    pendingChannel = 0;
+    migrated = true;
+    lastMigrationMs = nowMs;
+    migrationCount++;
+
+    // Judge the new channel on its own deliveries
+    windowDelivered = 0;
+    windowAttempted = 0;
+    badWindow = false;
+    return channel;
+}
+
+void ChannelManager::startHunt(uint32_t nowMs, uint32_t dwellMs, uint32_t maxDwellMs) {
+    if (huntActive) {
+        return;
+    }
+    huntActive = true;
+    huntDwellMs = dwellMs;
+    huntMaxDwellMs = maxDwellMs;
+    lastHopMs = nowMs - dwellMs; // Hop on the first step
+}
+
+uint8_t ChannelManager::huntStep(uint32_t nowMs) {
+    if (!huntActive || nowMs - lastHopMs < huntDwellMs) {
+        return 0;
+    }
+    lastHopMs = nowMs;
+    huntIndex = (huntIndex + 1) % candidateCount;
+    if (huntIndex == 0 && huntDwellMs < huntMaxDwellMs) {
+        huntDwellMs = huntDwellMs * 2 < huntMaxDwellMs ? huntDwellMs * 2 : huntMaxDwellMs;
+    }
+    return candidates[huntIndex];
+}
@@ -1,23 +1,1268 @@
 #include "communication.h"
 #include <Arduino.h>
-#include <esp_now.h>
+#include <esp_timer.h>
+#include <atomic>
+#include "effect_programs.h"
 
-// Receiver MAC address - defined in main.cpp, loaded from Preferences
-extern uint8_t recvAddress[];
+// Broadcast address and this device's MAC - defined in main.cpp
+extern uint8_t broadcastAddress[];
+extern uint8_t selfAddress[];
 
-void sendStateUpdate() {
+PeerTable receiverTable;
+TimeSync effectClock;
+ChannelManager channelManager;
+SquadSync squad;
+HudEncoder hudEncoder;
+DutyCycle dutyCycle;
+
+static Transport* radio = nullptr;
+
+static uint16_t stateSeq = 0;
+static unsigned long lastProgramSendTime = 0;
+static bool programSent = false;
+static unsigned long lastProgramRequestTime = 0;
+static bool programRequested = false;
+
+// Receiver-side reassembly of an incoming program
+static uint8_t programBuffer[VM_MAX_PROGRAM_LEN];
+static uint16_t assemblingId = 0;
+static uint16_t assemblingLen = 0;
+static uint32_t receivedChunks = 0; // One bit per PROGRAM_CHUNK_LEN slice
+static uint8_t retriesLeft = 0;
+static unsigned long lastStateSendTime = 0;
+static uint8_t attemptNodes = 0;    // Nodes included in the last state transmission
+static bool attemptOpen = false;
+
+// Pairing - challenge and beacon schedule on the interface, pending answer on a receiver
+static bool pairingOpen = false;
+static unsigned long pairingStartTime = 0;
+static unsigned long lastBeaconTime = 0;
+static uint16_t beaconIntervalMs = PAIR_BEACON_MIN_MS;
+static uint32_t pairingChallenge = 0;
+static uint8_t pairingInterface[6];
+static uint32_t answeredChallenge = 0;
+static uint32_t pairingNonce = 0;
+static uint32_t confirmedChallenge = 0;
+
+static TxPowerControl txPowerControl;
+static uint32_t lastMissedTotal = 0;
+
+static TelemetryEncoder telemetryEncoder;
+static uint16_t telemetrySeq = 0;
+
+// Relaying - copies already seen, the node a receiver last heard the interface through,
+// and a forward held back while another relay may cover it
+static RelayCache relayCache;
+static uint16_t relaySeq = 0;
+static uint8_t upstreamHop[6];
+static bool upstreamKnown = false;
+static uint8_t heldRelay[PROTOCOL_MAX_FRAME_LEN];
+static size_t heldRelayLen = 0;
+static uint8_t heldOrigin[6];
+static uint16_t heldSeq = 0;
+static unsigned long heldDueTime = 0;
+static uint32_t relayForwarded = 0;
+static uint32_t relaySuppressed = 0;
+
+static uint8_t pinnedChannel = 0;   // Non-zero while squad mode holds the channel
+
+// Survey for a migration, taken one channel per comms pass outside stateLock. surveyNext
+// is the channel to listen on next (0 = no survey, RADIO_CHANNEL_SLOTS = complete).
+static std::atomic<uint8_t> surveyNext{0};
+static std::atomic<bool> surveyFailed{false};
+static ChannelSurvey migrationSurvey;
+static bool surveyOnlyIfCleaner = false;
+
+// Radio sleep (interface side) - what receivers are told, whether any may still be asleep,
+// and whether the state round in progress tells them all to stay up
+static bool receiverSleep = false;
+static bool receiversMaySleep = false;
+static bool wakeRoundOpen = false;
+
+// Emergency stop (interface side) - the press being sent, nodes that haven't acked it
+// (one bit per receiverTable index) and the burst schedule
+static uint16_t estopId = 0;
+static int64_t estopPressedUs = 0;
+static uint32_t estopPending = 0;
+static uint16_t estopCopies = 0;
+static unsigned long estopStartTime = 0;
+static unsigned long estopLastSendTime = 0;
+static bool estopRunning = false;       // Until the whole burst is out and every receiver acked
+static int32_t estopWorstUs = 0;        // Worst press-to-fans-off a receiver measured
+static uint8_t estopMeasured = 0;       // Acks that carried a measurement
+static long estopWorstAckUs = 0;        // Worst press-to-ack, an upper bound on fans off
+
+// Receiver firmware update (interface side)
+static OtaSender otaSender;
+static OtaImageSource* updateImage = nullptr;
+static ReceiverUpdateProgress updateProgress;
+
+// HUD mirror (interface side) - the receiver streamed to, and counters at the last report
+static int8_t hudTarget = -1;
+static unsigned long lastHudReportTime = 0;
+static uint32_t lastHudFrames = 0;
+static uint32_t lastHudBytes = 0;
+
+// Masks the global appState down to what a node's hardware can act on
+static CommandPayload commandForNode(const ReceiverNode& node) {
     CommandPayload payload;
+    bool hasVisor = node.capabilities & NODE_CAP_VISOR;
+    bool hasFans = node.capabilities & NODE_CAP_FANS;
 
-    // Map the global appState to the payload
-    payload.visorOn = appState.visorOn;
+    payload.visorOn = hasVisor && appState.visorOn;
     payload.visorMode = appState.visorMode;
     payload.visorColor = appState.visorColor;
     payload.visorBrightness = appState.visorBrightness;
-    payload.thermalsOn = appState.thermalsOn;
+    payload.thermalsMode = hasFans ? appState.thermalsMode : ThermalsMode::OFF;
+    payload.programId = selectedProgramId();
+    payload.radioProfile = appState.radioProfile;
+    payload.radioSleep = receiverSleep;
+    for (uint8_t i = 0; i < LED_SEGMENTS - 1; i++) {
+        const SegmentState& accent = appState.accents[i];
+        payload.accents[i].on = hasVisor && accent.on;
+        payload.accents[i].mode = accent.mode;
+        payload.accents[i].color = accent.color;
+        payload.accents[i].brightness = accent.brightness;
+    }
+    return payload;
+}
 
-    esp_err_t result = esp_now_send(recvAddress, (uint8_t *) &payload, sizeof(payload));
+void attachTransport(Transport& transport) {
+    radio = &transport;
+}
 
-    if (result != ESP_OK) {
+static void broadcastFrame(const uint8_t* frame, size_t len) {
+    if (!radio->send(broadcastAddress, frame, len)) {
         Serial.println("Error sending the data");
     }
 }
+
+// Folds a frame's RSSI into the node's running average
+static void noteRssi(ReceiverNode& node, int8_t rssi) {
+    if (rssi == RSSI_UNKNOWN) {
+        return;
+    }
+    if (node.rssi == RSSI_UNKNOWN) {
+        node.rssi = rssi;
+    } else {
+        node.rssi += (rssi - node.rssi) / RSSI_SMOOTHING;
+    }
+}
+
+// Feeds the channel manager with how many nodes acked the last transmission.
+// Acks that come after the next transmission are counted as misses.
+static void closeDeliveryAttempt() {
+    if (attemptOpen) {
+        attemptOpen = false;
+        channelManager.recordDelivery(attemptNodes - receiverTable.pendingCount(), attemptNodes);
+    }
+}
+
+// True when any paired receiver can forward frames for the others
+static bool relaysAvailable() {
+    for (uint8_t i = 0; i < receiverTable.size(); i++) {
+        if (receiverTable[i].capabilities & NODE_CAP_RELAY) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Broadcasts `inner` wrapped for relays; `relayer` is the relay asked to forward it
+// first, or the broadcast address to let any relay step in
+static void broadcastRelayed(const uint8_t* relayer, const uint8_t* inner, size_t innerLen) {
+    uint8_t frame[PROTOCOL_MAX_FRAME_LEN];
+    RelayHeader relay;
+    memcpy(relay.origin, selfAddress, 6);
+    memcpy(relay.relayer, relayer, 6);
+    relay.hops = 0;
+    relay.maxHops = RELAY_MAX_HOPS;
+
+    size_t len = encodeRelayFrame(frame, ++relaySeq, relay, inner, innerLen);
+    relayCache.firstSighting(selfAddress, relaySeq); // Relays repeating it aren't news
+    broadcastFrame(frame, len);
+}
+
+static void broadcastRelayedState(const uint8_t* relayer, const NodeCommand* entries, uint8_t count) {
+    uint8_t inner[PROTOCOL_MAX_FRAME_LEN];
+    broadcastRelayed(relayer, inner, encodeStateFrame(inner, stateSeq, entries, count));
+}
+
+// Packs the addressed entries into as few frames as possible.
+// With `pendingOnly`, only nodes that still owe an ack are included.
+// Nodes last reached through a relay, and every retry while relays are paired,
+// go out wrapped for relaying; the rest go out as plain STATE_UPDATE frames.
+static void transmitStateFrames(bool pendingOnly) {
+    NodeCommand entries[NODES_PER_STATE_FRAME];
+    uint8_t frame[PROTOCOL_MAX_FRAME_LEN];
+    uint8_t entryCount = 0;
+    bool relayed[MAX_RECEIVERS] = {};
+    bool useRelays = relaysAvailable();
+    attemptNodes = 0;
+
+    for (uint8_t i = 0; i < receiverTable.size(); i++) {
+        const ReceiverNode& node = receiverTable[i];
+        if (pendingOnly && !node.awaitingAck) {
+            continue;
+        }
+        attemptNodes++;
+        if (useRelays && (pendingOnly || node.hops > 0)) {
+            relayed[i] = true;
+            continue;
+        }
+
+        memcpy(entries[entryCount].mac, node.mac, 6);
+        entries[entryCount].command = commandForNode(node);
+        entryCount++;
+
+        if (entryCount == NODES_PER_STATE_FRAME) {
+            broadcastFrame(frame, encodeStateFrame(frame, stateSeq, entries, entryCount));
+            entryCount = 0;
+        }
+    }
+
+    if (entryCount > 0) {
+        broadcastFrame(frame, encodeStateFrame(frame, stateSeq, entries, entryCount));
+    }
+
+    // One wrapped frame per relay, grouping the nodes routed through it
+    for (uint8_t i = 0; i < receiverTable.size(); i++) {
+        if (!relayed[i]) {
+            continue;
+        }
+        const uint8_t* relayer = receiverTable[i].hops > 0 ? receiverTable[i].via : broadcastAddress;
+        entryCount = 0;
+        for (uint8_t j = i; j < receiverTable.size(); j++) {
+            const ReceiverNode& node = receiverTable[j];
+            const uint8_t* route = node.hops > 0 ? node.via : broadcastAddress;
+            if (!relayed[j] || memcmp(route, relayer, 6) != 0) {
+                continue;
+            }
+            relayed[j] = false;
+            memcpy(entries[entryCount].mac, node.mac, 6);
+            entries[entryCount].command = commandForNode(node);
+            entryCount++;
+
+            if (entryCount == NODES_PER_RELAYED_STATE_FRAME) {
+                broadcastRelayedState(relayer, entries, entryCount);
+                entryCount = 0;
+            }
+        }
+        if (entryCount > 0) {
+            broadcastRelayedState(relayer, entries, entryCount);
+        }
+    }
+
+    lastStateSendTime = millis();
+    attemptOpen = attemptNodes > 0;
+}
+
+void sendStateUpdate() {
+    if (!radio || receiverTable.size() == 0) {
+        return;
+    }
+
+    closeDeliveryAttempt();
+    stateSeq++;
+    wakeRoundOpen = !receiverSleep;
+    receiverTable.beginAckRound(stateSeq, micros());
+    retriesLeft = ACK_MAX_RETRIES;
+    transmitStateFrames(false);
+}
+
+void handleAck(const RxFrame& frame) {
+    FrameHeader header;
+    AckPayload ack;
+    if (!decodeHeader(frame.data, frame.len, header) || frame.len < sizeof(FrameHeader) + sizeof(AckPayload)) {
+        return;
+    }
+    memcpy(&ack, frame.data + sizeof(FrameHeader), sizeof(ack));
+
+    int index = receiverTable.find(frame.mac);
+    if (index < 0) {
+        return; // Not one of ours
+    }
+    ReceiverNode& node = receiverTable[index];
+    if (receiverTable.recordAck(frame.mac, header.seq, micros())) {
+        // The path this ack took is the one to use for the node next time
+        node.hops = frame.hops;
+        if (frame.hops > 0) {
+            memcpy(node.via, frame.via, 6);
+            node.relayedAcks++;
+        }
+    }
+    noteRssi(node, frame.rssi);
+
+    // A relayed exchange is too slow to yield a usable sample
+    if ((ack.flags & ACK_FLAG_TIME_REQUEST) && frame.hops == 0) {
+        // Broadcast with the node's MAC inside, so receivers needn't be registered peers
+        TimeSyncPayload sync;
+        memcpy(sync.mac, frame.mac, 6);
+        sync.requestTxUs = ack.txUs;
+        sync.requestRxUs = squad.toSquadUs(frame.rxUs);
+
+        uint8_t out[sizeof(FrameHeader) + sizeof(TimeSyncPayload)];
+        size_t len = encodeHeader(out, MessageType::TIME_SYNC, header.seq);
+        sync.replyTxUs = squad.toSquadUs(esp_timer_get_time());
+        memcpy(out + len, &sync, sizeof(sync));
+        radio->send(broadcastAddress, out, len + sizeof(sync));
+    }
+}
+
+void serviceStateAcks() {
+    if (millis() - lastStateSendTime < ACK_TIMEOUT_MS) {
+        return;
+    }
+    closeDeliveryAttempt();
+    if (receiverTable.pendingCount() == 0) {
+        if (wakeRoundOpen) {
+            wakeRoundOpen = false;
+            receiversMaySleep = false;  // Every receiver heard it's time to stay up
+        }
+        return;
+    }
+
+    // A node that missed the last attempt is asleep until the next window or slot
+    if (!receiversListening()) {
+        return;
+    }
+    if (retriesLeft > 0) {
+        retriesLeft--;
+        transmitStateFrames(true);
+    } else {
+        Serial.printf("State update %u unacknowledged by %u receiver(s)\n",
+                      stateSeq, receiverTable.pendingCount());
+        // A route that failed every retry is forgotten, so any relay may step in next time
+        for (uint8_t i = 0; i < receiverTable.size(); i++) {
+            if (receiverTable[i].awaitingAck) {
+                receiverTable[i].hops = 0;
+            }
+        }
+        receiverTable.expireAckRound();
+        wakeRoundOpen = false;
+    }
+}
+
+void setReceiverSleep(bool sleep) {
+    receiverSleep = sleep;
+    if (sleep) {
+        receiversMaySleep = true;
+    }
+}
+
+bool receiversAsleep() {
+    return receiversMaySleep;
+}
+
+bool receiversListening() {
+    return !receiversMaySleep || dutyCycle.phase(sharedTimeUs()) != DutyCycle::Phase::ASLEEP;
+}
+
+// Unicasts `frame` to the interface at `mac`, or back along the path a command came in on
+// when it arrived through relay `via` (receiver side)
+static void sendToInterface(const uint8_t* mac, const uint8_t* frame, size_t len, const uint8_t* via) {
+    if (!via) {
+        radio->send(mac, frame, len);
+        return;
+    }
+    RelayHeader relay;
+    memcpy(relay.origin, selfAddress, 6);
+    memcpy(relay.relayer, via, 6);
+    relay.hops = 0;
+    relay.maxHops = RELAY_MAX_HOPS;
+    uint8_t out[PROTOCOL_MAX_FRAME_LEN];
+    radio->send(via, out, encodeRelayFrame(out, ++relaySeq, relay, frame, len));
+}
+
+void sendAck(const uint8_t* mac, uint16_t seq, const uint8_t* via) {
+    // The interface may not be registered yet (e.g. the receiver was never told its MAC)
+    const uint8_t* nextHop = via ? via : mac;
+    if (!radio || !ensurePeer(*radio, nextHop)) {
+        Serial.println("Failed to add interface peer for ack");
+        return;
+    }
+
+    AckPayload ack;
+    ack.flags = effectClock.needsSync(esp_timer_get_time(), TIME_SYNC_INTERVAL_MS * 1000LL) ? ACK_FLAG_TIME_REQUEST : 0;
+
+    uint8_t frame[sizeof(FrameHeader) + sizeof(AckPayload)];
+    size_t len = encodeHeader(frame, MessageType::ACK, seq);
+    ack.txUs = esp_timer_get_time();
+    memcpy(frame + len, &ack, sizeof(ack));
+    sendToInterface(mac, frame, len + sizeof(ack), via);
+}
+
+// Whether a relayed frame carries anything for nodes other than this one
+static bool addressesOthers(const uint8_t* inner, size_t len, const uint8_t* selfMac) {
+    FrameHeader header;
+    if (!decodeHeader(inner, len, header) || header.type != MessageType::STATE_UPDATE) {
+        return true;
+    }
+    if (len < STATE_FRAME_FIXED_LEN) {
+        return false;
+    }
+    uint8_t count = inner[sizeof(FrameHeader)];
+    const uint8_t* entry = inner + STATE_FRAME_FIXED_LEN;
+    for (uint8_t i = 0; i < count && entry + sizeof(NodeCommand) <= inner + len; i++, entry += sizeof(NodeCommand)) {
+        if (memcmp(entry, selfMac, 6) != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void sendHeldRelay() {
+    if (heldRelayLen > 0) {
+        broadcastFrame(heldRelay, heldRelayLen);
+        heldRelayLen = 0;
+        relayForwarded++;
+    }
+}
+
+bool handleRelayFrame(const RxFrame& frame, const uint8_t* selfMac, const uint8_t* interfaceMac,
+                      bool relayEnabled, RxFrame& inner) {
+    FrameHeader header;
+    RelayHeader relay;
+    const uint8_t* body;
+    size_t bodyLen;
+    if (!radio || !decodeHeader(frame.data, frame.len, header) ||
+        !decodeRelayFrame(frame.data, frame.len, relay, body, bodyLen)) {
+        return false;
+    }
+
+    if (!relayCache.firstSighting(relay.origin, header.seq)) {
+        // Another relay already covered the copy we were holding back
+        if (heldRelayLen > 0 && heldSeq == header.seq && memcmp(heldOrigin, relay.origin, 6) == 0) {
+            heldRelayLen = 0;
+            relaySuppressed++;
+        }
+        return false;
+    }
+
+    bool atInterface = memcmp(selfMac, interfaceMac, 6) == 0;
+    bool downstream = memcmp(relay.origin, interfaceMac, 6) == 0;
+    bool addressedHere = memcmp(relay.relayer, selfMac, 6) == 0;
+    bool anyRelay = memcmp(relay.relayer, broadcastAddress, 6) == 0;
+
+    if (atInterface) {
+        if (downstream || !addressedHere) {
+            return false;
+        }
+    } else if (downstream) {
+        memcpy(upstreamHop, frame.mac, 6);
+        upstreamKnown = true;
+
+        if (relayEnabled && relay.hops < relay.maxHops && (addressedHere || anyRelay) &&
+            addressesOthers(body, bodyLen, selfMac)) {
+            // Past the first hop nobody knows the way, so any relay may carry it on
+            RelayHeader forward = relay;
+            forward.hops++;
+            memcpy(forward.relayer, broadcastAddress, 6);
+            sendHeldRelay();
+            heldRelayLen = encodeRelayFrame(heldRelay, header.seq, forward, body, bodyLen);
+            memcpy(heldOrigin, relay.origin, 6);
+            heldSeq = header.seq;
+            heldDueTime = millis() + (addressedHere ? 0 : esp_random() % (RELAY_HOLDOFF_MS + 1));
+        }
+    } else {
+        // Upstream: only the chosen hop carries it on towards the interface
+        if (relayEnabled && addressedHere && upstreamKnown && relay.hops < relay.maxHops &&
+            ensurePeer(*radio, upstreamHop)) {
+            relay.hops++;
+            memcpy(relay.relayer, upstreamHop, 6);
+            uint8_t out[PROTOCOL_MAX_FRAME_LEN];
+            radio->send(upstreamHop, out, encodeRelayFrame(out, header.seq, relay, body, bodyLen));
+            relayForwarded++;
+        }
+        return false;
+    }
+
+    inner.rxUs = frame.rxUs;
+    memcpy(inner.mac, relay.origin, 6);
+    inner.rssi = RSSI_UNKNOWN; // Measured on the last hop, not the origin's link
+    inner.hops = relay.hops;
+    memcpy(inner.via, frame.mac, 6);
+    inner.len = bodyLen;
+    memcpy(inner.data, body, bodyLen);
+    return true;
+}
+
+void serviceRelay() {
+    if (heldRelayLen > 0 && (long)(millis() - heldDueTime) >= 0) {
+        sendHeldRelay();
+    }
+}
+
+void reportRelayStats() {
+    Serial.printf("Relay: forwarded=%lu suppressed=%lu\n",
+                  (unsigned long)relayForwarded, (unsigned long)relaySuppressed);
+}
+
+void handleTimeSync(const RxFrame& frame, const uint8_t* selfMac) {
+    TimeSyncPayload sync;
+    if (frame.len < sizeof(FrameHeader) + sizeof(TimeSyncPayload)) {
+        return;
+    }
+    memcpy(&sync, frame.data + sizeof(FrameHeader), sizeof(sync));
+    if (memcmp(sync.mac, selfMac, 6) != 0) {
+        return;
+    }
+    effectClock.addSample(sync.requestTxUs, sync.requestRxUs, sync.replyTxUs, frame.rxUs);
+}
+
+int64_t sharedTimeUs() {
+    return toSharedUs(esp_timer_get_time());
+}
+
+int64_t toSharedUs(int64_t localUs) {
+    // Only one of the two is ever active: the squad clock on an interface, effectClock on a receiver
+    return effectClock.toShared(squad.toSquadUs(localUs));
+}
+
+uint16_t selectedProgramId() {
+    const EffectProgram& program = effectPrograms[appState.effectProgram % EFFECT_PROGRAM_COUNT];
+    return crc16(program.code, program.length);
+}
+
+void handleProgramRequest(const RxFrame& frame) {
+    ProgramRequest request;
+    if (receiverTable.find(frame.mac) < 0 || frame.len < sizeof(FrameHeader) + sizeof(request)) {
+        return;
+    }
+    memcpy(&request, frame.data + sizeof(FrameHeader), sizeof(request));
+
+    // Only the current selection is served; a stale request will be repeated with the new id
+    uint16_t programId = selectedProgramId();
+    if (request.programId != programId) {
+        return;
+    }
+    if (programSent && millis() - lastProgramSendTime < PROGRAM_REQUEST_INTERVAL_MS / 4) {
+        return;
+    }
+    programSent = true;
+    lastProgramSendTime = millis();
+
+    const EffectProgram& program = effectPrograms[appState.effectProgram % EFFECT_PROGRAM_COUNT];
+    uint8_t out[PROTOCOL_MAX_FRAME_LEN];
+    for (uint16_t offset = 0; offset < program.length; offset += PROGRAM_CHUNK_LEN) {
+        ProgramChunkHeader chunk = {programId, program.length, offset};
+        uint16_t chunkLen = min<uint16_t>(PROGRAM_CHUNK_LEN, program.length - offset);
+
+        size_t len = encodeHeader(out, MessageType::PROGRAM_CHUNK, offset / PROGRAM_CHUNK_LEN);
+        memcpy(out + len, &chunk, sizeof(chunk));
+        len += sizeof(chunk);
+        memcpy(out + len, program.code + offset, chunkLen);
+        radio->send(broadcastAddress, out, len + chunkLen);
+    }
+    Serial.printf("Sent effect program '%s' (%u bytes)\n", program.name, program.length);
+}
+
+void requestProgram(const uint8_t* mac, uint16_t programId) {
+    if (programRequested && millis() - lastProgramRequestTime < PROGRAM_REQUEST_INTERVAL_MS) {
+        return;
+    }
+    if (!radio || !ensurePeer(*radio, mac)) {
+        return;
+    }
+    programRequested = true;
+    lastProgramRequestTime = millis();
+
+    ProgramRequest request = {programId};
+    uint8_t out[sizeof(FrameHeader) + sizeof(request)];
+    size_t len = encodeHeader(out, MessageType::PROGRAM_REQUEST, 0);
+    memcpy(out + len, &request, sizeof(request));
+    radio->send(mac, out, len + sizeof(request));
+}
+
+bool handleProgramChunk(const RxFrame& frame, uint16_t programId, EffectVm& vm) {
+    ProgramChunkHeader chunk;
+    if (frame.len < sizeof(FrameHeader) + sizeof(chunk)) {
+        return false;
+    }
+    memcpy(&chunk, frame.data + sizeof(FrameHeader), sizeof(chunk));
+    const uint8_t* bytes = frame.data + sizeof(FrameHeader) + sizeof(chunk);
+    uint16_t chunkLen = frame.len - sizeof(FrameHeader) - sizeof(chunk);
+
+    if (chunk.programId != programId || chunk.totalLen == 0 || chunk.totalLen > VM_MAX_PROGRAM_LEN ||
+        chunk.offset % PROGRAM_CHUNK_LEN != 0 || chunk.offset + chunkLen > chunk.totalLen) {
+        return false;
+    }
+
+    if (assemblingId != chunk.programId || assemblingLen != chunk.totalLen) {
+        assemblingId = chunk.programId;
+        assemblingLen = chunk.totalLen;
+        receivedChunks = 0;
+    }
+    memcpy(programBuffer + chunk.offset, bytes, chunkLen);
+    receivedChunks |= 1UL << (chunk.offset / PROGRAM_CHUNK_LEN);
+
+    uint16_t chunkCount = (assemblingLen + PROGRAM_CHUNK_LEN - 1) / PROGRAM_CHUNK_LEN;
+    if (receivedChunks != (1UL << chunkCount) - 1) {
+        return false;
+    }
+
+    receivedChunks = 0;
+    if (crc16(programBuffer, assemblingLen) != programId) {
+        Serial.println("Effect program failed CRC check");
+        return false;
+    }
+    if (!vm.load(programBuffer, assemblingLen)) {
+        Serial.println("Effect program failed verification");
+        return false;
+    }
+    programRequested = false;
+    return true;
+}
+
+void sendTelemetry(const uint8_t* mac, const TelemetrySnapshot& snapshot) {
+    if (!radio || !ensurePeer(*radio, mac)) {
+        return;
+    }
+    uint8_t out[sizeof(FrameHeader) + TELEMETRY_MAX_LEN];
+    size_t len = encodeHeader(out, MessageType::TELEMETRY, telemetrySeq++);
+    len += telemetryEncoder.encode(snapshot, out + len);
+    radio->send(mac, out, len);
+}
+
+void handleTelemetry(const RxFrame& frame) {
+    int index = receiverTable.find(frame.mac);
+    if (index < 0) {
+        return;
+    }
+    noteRssi(receiverTable[index], frame.rssi);
+    NodeTelemetry& cache = receiverTable[index].telemetry;
+    if (decodeTelemetry(frame.data + sizeof(FrameHeader), frame.len - sizeof(FrameHeader), cache)) {
+        cache.updatedMs = millis();
+    }
+}
+
+const NodeTelemetry* hudTelemetry() {
+    for (uint8_t i = 0; i < receiverTable.size(); i++) {
+        const NodeTelemetry& telemetry = receiverTable[i].telemetry;
+        if (telemetry.valid && millis() - telemetry.updatedMs < TELEMETRY_STALE_MS) {
+            return &telemetry;
+        }
+    }
+    return nullptr;
+}
+
+static void sendPairBeacon() {
+    PairBeacon beacon = {pairingChallenge};
+    uint8_t out[sizeof(FrameHeader) + sizeof(beacon)];
+    size_t len = encodeHeader(out, MessageType::PAIR_BEACON, 0);
+    memcpy(out + len, &beacon, sizeof(beacon));
+    radio->send(broadcastAddress, out, len + sizeof(beacon));
+    lastBeaconTime = millis();
+}
+
+void startPairing() {
+    if (!radio) {
+        return;
+    }
+    pairingOpen = true;
+    pairingStartTime = millis();
+    pairingChallenge = esp_random() | 1; // Zero means "nothing answered"
+    beaconIntervalMs = PAIR_BEACON_MIN_MS;
+    sendPairBeacon();
+    Serial.println("Pairing open");
+}
+
+void stopPairing() {
+    if (pairingOpen) {
+        pairingOpen = false;
+        Serial.println("Pairing closed");
+    }
+}
+
+bool pairingActive() {
+    return pairingOpen;
+}
+
+void servicePairing() {
+    if (!pairingOpen) {
+        return;
+    }
+    if (millis() - pairingStartTime >= PAIR_MODE_DURATION_MS) {
+        stopPairing();
+        return;
+    }
+    if (millis() - lastBeaconTime >= beaconIntervalMs) {
+        sendPairBeacon();
+        beaconIntervalMs = min<uint16_t>(beaconIntervalMs * 2, PAIR_BEACON_MAX_MS);
+    }
+}
+
+bool handlePairResponse(const RxFrame& frame) {
+    PairResponse response;
+    if (!pairingOpen || frame.len < sizeof(FrameHeader) + sizeof(response)) {
+        return false;
+    }
+    memcpy(&response, frame.data + sizeof(FrameHeader), sizeof(response));
+    if (response.challenge != pairingChallenge) {
+        return false; // Stale beacon from an earlier session
+    }
+    if (receiverTable.add(frame.mac, response.capabilities) < 0) {
+        Serial.println("Receiver table full");
+        return false;
+    }
+
+    PairConfirm confirm;
+    memcpy(confirm.mac, frame.mac, 6);
+    confirm.nonce = response.nonce;
+    uint8_t out[sizeof(FrameHeader) + sizeof(confirm)];
+    size_t len = encodeHeader(out, MessageType::PAIR_CONFIRM, 0);
+    memcpy(out + len, &confirm, sizeof(confirm));
+    radio->send(broadcastAddress, out, len + sizeof(confirm));
+
+    // Another receiver may be coming up right behind this one
+    beaconIntervalMs = PAIR_BEACON_MIN_MS;
+    return true;
+}
+
+void answerPairBeacon(const RxFrame& frame, uint8_t capabilities) {
+    PairBeacon beacon;
+    if (frame.len < sizeof(FrameHeader) + sizeof(beacon)) {
+        return;
+    }
+    memcpy(&beacon, frame.data + sizeof(FrameHeader), sizeof(beacon));
+    if (beacon.challenge == confirmedChallenge) {
+        return; // Already paired in this session
+    }
+    if (!radio || !ensurePeer(*radio, frame.mac)) {
+        return;
+    }
+
+    // Keep the nonce while answering repeats of the same beacon
+    if (beacon.challenge != answeredChallenge || memcmp(pairingInterface, frame.mac, 6) != 0) {
+        answeredChallenge = beacon.challenge;
+        memcpy(pairingInterface, frame.mac, 6);
+        pairingNonce = esp_random();
+    }
+
+    PairResponse response = {beacon.challenge, pairingNonce, capabilities};
+    uint8_t out[sizeof(FrameHeader) + sizeof(response)];
+    size_t len = encodeHeader(out, MessageType::PAIR_RESPONSE, 0);
+    memcpy(out + len, &response, sizeof(response));
+    radio->send(frame.mac, out, len + sizeof(response));
+}
+
+bool handlePairConfirm(const RxFrame& frame, const uint8_t* selfMac) {
+    PairConfirm confirm;
+    if (answeredChallenge == 0 || frame.len < sizeof(FrameHeader) + sizeof(confirm)) {
+        return false;
+    }
+    memcpy(&confirm, frame.data + sizeof(FrameHeader), sizeof(confirm));
+    if (memcmp(confirm.mac, selfMac, 6) != 0 || memcmp(frame.mac, pairingInterface, 6) != 0 ||
+        confirm.nonce != pairingNonce) {
+        return false;
+    }
+    confirmedChallenge = answeredChallenge;
+    answeredChallenge = 0;
+    return true;
+}
+
+// Broadcasts the next copy of the current stop. Every other copy goes out wrapped,
+// so nodes only reachable through a relay get it too.
+static void sendEmergencyCopy() {
+    EmergencyStop stop;
+    stop.stopId = estopId;
+    stop.pressedUs = estopPressedUs;
+    uint8_t frame[sizeof(FrameHeader) + sizeof(EmergencyStop)];
+    size_t len = encodeHeader(frame, MessageType::EMERGENCY_STOP, estopCopies);
+    memcpy(frame + len, &stop, sizeof(stop));
+    len += sizeof(stop);
+
+    if (estopCopies % 2 == 1 && relaysAvailable()) {
+        broadcastRelayed(broadcastAddress, frame, len);
+    } else {
+        broadcastFrame(frame, len);
+    }
+    estopCopies++;
+    estopLastSendTime = millis();
+}
+
+void startEmergencyStop(int64_t pressedUs) {
+    if (!radio || receiverTable.size() == 0) {
+        return;
+    }
+    // Random, so a stop after a reboot isn't taken for a copy of the last one
+    estopId = esp_random();
+    estopPressedUs = pressedUs;
+    estopPending = receiverTable.size() >= 32 ? 0xFFFFFFFF : (1UL << receiverTable.size()) - 1;
+    estopCopies = 0;
+    estopStartTime = millis();
+    estopRunning = true;
+    estopWorstUs = 0;
+    estopMeasured = 0;
+    estopWorstAckUs = 0;
+    sendEmergencyCopy();
+}
+
+bool emergencyStopActive() {
+    return estopRunning;
+}
+
+void serviceEmergencyStop() {
+    if (!estopRunning) {
+        return;
+    }
+    if (millis() - estopStartTime >= ESTOP_GIVE_UP_MS) {
+        Serial.printf("Emergency stop unacknowledged by %d receiver(s)\n", __builtin_popcount(estopPending));
+        estopPending = 0;
+        estopRunning = false;
+        return;
+    }
+    // The whole burst goes out whatever the acks and the wake schedule, since a copy can
+    // be lost on the way to a receiver that hasn't acked yet; the retries after it go only
+    // while some receiver hasn't acked, and wait for a window or slot to reach the sleepers
+    bool burst = estopCopies < ESTOP_BURST;
+    unsigned long spacing = burst ? ESTOP_BURST_SPACING_MS : ESTOP_RETRY_MS;
+    if ((burst || estopPending != 0) && millis() - estopLastSendTime >= spacing &&
+        (burst || receiversListening())) {
+        sendEmergencyCopy();
+    }
+    if (estopPending != 0 || estopCopies < ESTOP_BURST) {
+        return;
+    }
+
+    estopRunning = false;
+    if (estopMeasured > 0) {
+        Serial.printf("Emergency stop: all %u receivers stopped, worst press to fans off %ld us (measured by %u), "
+                      "all acked within %ld us, %u copies sent\n",
+                      receiverTable.size(), (long)estopWorstUs, estopMeasured, estopWorstAckUs, estopCopies);
+    } else {
+        // No receiver had a synced clock; the fans went off before each ack left
+        Serial.printf("Emergency stop: all %u receivers stopped, press to fans off unknown but under %ld us "
+                      "(all acked by then), %u copies sent\n",
+                      receiverTable.size(), estopWorstAckUs, estopCopies);
+    }
+}
+
+void handleEmergencyAck(const RxFrame& frame) {
+    FrameHeader header;
+    EmergencyAck ack;
+    if (!decodeHeader(frame.data, frame.len, header) || frame.len < sizeof(FrameHeader) + sizeof(EmergencyAck)) {
+        return;
+    }
+    memcpy(&ack, frame.data + sizeof(FrameHeader), sizeof(ack));
+
+    int index = receiverTable.find(frame.mac);
+    if (index < 0 || ack.stopId != estopId || !(estopPending & (1UL << index))) {
+        return; // Not ours, an older stop, or a copy already acked
+    }
+    estopPending &= ~(1UL << index);
+    long ackedUs = (long)(sharedTimeUs() - estopPressedUs);
+    if (ackedUs > estopWorstAckUs) {
+        estopWorstAckUs = ackedUs;
+    }
+
+    if (ack.pressToOffUs >= 0) {
+        Serial.printf("Emergency stop: %02X:%02X:%02X:%02X:%02X:%02X fans off %ld us after the press (copy %u, acked after %ld us)\n",
+                      frame.mac[0], frame.mac[1], frame.mac[2], frame.mac[3], frame.mac[4], frame.mac[5],
+                      (long)ack.pressToOffUs, header.seq, ackedUs);
+        if (estopMeasured == 0 || ack.pressToOffUs > estopWorstUs) {
+            estopWorstUs = ack.pressToOffUs;
+        }
+        estopMeasured++;
+    } else {
+        // Without a synced clock the ack time is the best bound there is
+        Serial.printf("Emergency stop: %02X:%02X:%02X:%02X:%02X:%02X fans off, acked %ld us after the press (copy %u)\n",
+                      frame.mac[0], frame.mac[1], frame.mac[2], frame.mac[3], frame.mac[4], frame.mac[5],
+                      ackedUs, header.seq);
+    }
+}
+
+void sendEmergencyAck(const uint8_t* mac, uint16_t seq, uint16_t stopId, int32_t pressToOffUs, const uint8_t* via) {
+    const uint8_t* nextHop = via ? via : mac;
+    if (!radio || !ensurePeer(*radio, nextHop)) {
+        return;
+    }
+    EmergencyAck ack;
+    ack.stopId = stopId;
+    ack.pressToOffUs = pressToOffUs;
+    uint8_t frame[sizeof(FrameHeader) + sizeof(EmergencyAck)];
+    size_t len = encodeHeader(frame, MessageType::EMERGENCY_ACK, seq);
+    memcpy(frame + len, &ack, sizeof(ack));
+    sendToInterface(mac, frame, len + sizeof(ack), via);
+}
+
+void useRadioProfile(RadioProfile profile) {
+    applyRadioProfile(profile);
+    txPowerControl.reset(profile);
+}
+
+void serviceTxPower() {
+    int8_t weakest = RSSI_UNKNOWN;
+    uint32_t missedTotal = 0;
+    for (uint8_t i = 0; i < receiverTable.size(); i++) {
+        const ReceiverNode& node = receiverTable[i];
+        if (node.rssi != RSSI_UNKNOWN && (weakest == RSSI_UNKNOWN || node.rssi < weakest)) {
+            weakest = node.rssi;
+        }
+        missedTotal += node.missed;
+    }
+    bool missedAck = missedTotal != lastMissedTotal;
+    lastMissedTotal = missedTotal;
+
+    if (txPowerControl.update(weakest, missedAck, millis())) {
+        setRadioTxPower(txPowerControl.power());
+    }
+}
+
+void selectChannel() {
+    ChannelSurvey survey;
+    if (!radio || !radio->surveyChannels(survey)) {
+        return;
+    }
+    uint8_t channel = ChannelManager::pickChannel(survey);
+    radio->setChannel(channel);
+    Serial.printf("Operating on channel %u (score %.1f)\n", channel, ChannelManager::channelScore(survey, channel));
+}
+
+// Tells receivers to follow us to `target` and schedules our own switch
+static void announceSwitch(uint8_t target) {
+    // Repeated so a receiver that misses one copy still moves with us
+    ChannelSwitch announce = {target, CHANNEL_SWITCH_DELAY_MS};
+    uint8_t out[sizeof(FrameHeader) + sizeof(announce)];
+    unsigned long start = millis();
+    for (uint8_t i = 0; i < CHANNEL_SWITCH_REPEATS; i++) {
+        announce.delayMs = CHANNEL_SWITCH_DELAY_MS - (millis() - start);
+        size_t len = encodeHeader(out, MessageType::CHANNEL_SWITCH, i);
+        memcpy(out + len, &announce, sizeof(announce));
+        radio->send(broadcastAddress, out, len + sizeof(announce));
+    }
+    channelManager.scheduleSwitch(target, start + CHANNEL_SWITCH_DELAY_MS);
+}
+
+void migrateChannel(bool onlyIfCleaner) {
+    if (!radio || pinnedChannel || channelManager.switchPending() || surveyNext.load() != 0) {
+        return;
+    }
+    migrationSurvey = ChannelSurvey();
+    surveyOnlyIfCleaner = onlyIfCleaner;
+    surveyFailed = false;
+    surveyNext.store(1, std::memory_order_release);
+}
+
+void serviceChannelSurvey() {
+    uint8_t channel = surveyNext.load(std::memory_order_acquire);
+    if (!radio || channel == 0 || channel >= RADIO_CHANNEL_SLOTS) {
+        return;
+    }
+    if (!radio->surveyChannel(channel, migrationSurvey)) {
+        surveyFailed = true;
+    }
+    surveyNext.store(channel + 1, std::memory_order_release);
+}
+
+// Picks a channel from a finished survey and announces the move
+static void finishMigration(const ChannelSurvey& survey, bool onlyIfCleaner) {
+    uint8_t current = radio->channel();
+    uint8_t target = ChannelManager::pickChannel(survey, current);
+    if (target == 0) {
+        return;
+    }
+    float currentScore = ChannelManager::channelScore(survey, current);
+    float targetScore = ChannelManager::channelScore(survey, target);
+    if (onlyIfCleaner && targetScore >= currentScore / 2) {
+        return;
+    }
+
+    announceSwitch(target);
+    Serial.printf("Moving from channel %u (score %.1f) to %u (score %.1f), delivery %.0f%%\n",
+                  current, currentScore, target, targetScore, channelManager.lastDeliveryRate() * 100);
+}
+
+void pinChannel(uint8_t channel) {
+    pinnedChannel = channel;
+    if (radio && channel && radio->channel() != channel && !channelManager.switchPending()) {
+        announceSwitch(channel);
+        Serial.printf("Moving to channel %u\n", channel);
+    }
+}
+
+void serviceChannelMigration() {
+    if (!radio) {
+        return;
+    }
+    if (surveyNext.load(std::memory_order_acquire) == RADIO_CHANNEL_SLOTS) {
+        if (!surveyFailed && !pinnedChannel && !channelManager.switchPending()) {
+            finishMigration(migrationSurvey, surveyOnlyIfCleaner);
+        }
+        surveyNext = 0;
+        return;
+    }
+    uint8_t channel = channelManager.switchDue(millis());
+    if (channel) {
+        radio->setChannel(channel);
+        // Confirms the new channel to receivers without waiting for the heartbeat
+        sendStateUpdate();
+        return;
+    }
+    if (channelManager.shouldMigrate(millis()) && !pinnedChannel) {
+        migrateChannel(false);
+    }
+}
+
+void handleChannelSwitch(const RxFrame& frame) {
+    ChannelSwitch announce;
+    if (frame.len < sizeof(FrameHeader) + sizeof(announce)) {
+        return;
+    }
+    memcpy(&announce, frame.data + sizeof(FrameHeader), sizeof(announce));
+    if (announce.channel == 0 || announce.channel >= RADIO_CHANNEL_SLOTS) {
+        return;
+    }
+    channelManager.scheduleSwitch(announce.channel, millis() + announce.delayMs);
+}
+
+void startSquad(const char* key, uint8_t priority) {
+    if (!radio) {
+        return;
+    }
+    // Every costume's interface has to be on the same channel to hear the others
+    pinChannel(SQUAD_CHANNEL);
+    squad.begin(selfAddress, key, priority, esp_timer_get_time());
+    Serial.printf("Squad mode on as unit %08lX\n", (unsigned long)squad.unitId());
+}
+
+void stopSquad() {
+    if (squad.active()) {
+        squad.end();
+        pinChannel(0);
+        Serial.println("Squad mode off");
+    }
+}
+
+bool serviceSquad(SquadScene& due) {
+    if (!radio || !squad.active()) {
+        return false;
+    }
+    uint8_t out[PROTOCOL_MAX_FRAME_LEN];
+    size_t len;
+    while ((len = squad.poll(esp_timer_get_time(), out)) > 0) {
+        radio->send(broadcastAddress, out, len);
+    }
+    return squad.cueDue(esp_timer_get_time(), due);
+}
+
+void handleSquadFrame(const RxFrame& frame) {
+    squad.receive(frame.data, frame.len, frame.rxUs);
+}
+
+void reportSquadStats() {
+    if (!squad.active()) {
+        return;
+    }
+    Serial.printf("Squad: %u units, leader %08lX%s%s, sent=%lu throttled=%lu rejected=%lu late cues=%lu\n",
+                  squad.size(), (unsigned long)squad.leaderId(), squad.leading() ? " (us)" : "",
+                  squad.synced() ? "" : ", clock not synced",
+                  (unsigned long)squad.framesSent(), (unsigned long)squad.framesThrottled(),
+                  (unsigned long)squad.framesRejected(), (unsigned long)squad.lateCues());
+}
+
+static void beginNodeUpdate(uint32_t nowMs) {
+    const ReceiverNode& node = receiverTable[updateProgress.receiver];
+    if (!ensurePeer(*radio, node.mac)) {
+        Serial.println("Failed to add receiver peer for update");
+    }
+    otaSender.begin(*updateImage, nowMs);
+    Serial.printf("Updating receiver %02X:%02X:%02X:%02X:%02X:%02X (%lu bytes)\n",
+                  node.mac[0], node.mac[1], node.mac[2], node.mac[3], node.mac[4], node.mac[5],
+                  (unsigned long)updateImage->length());
+}
+
+void startReceiverUpdate(OtaImageSource& image) {
+    if (!radio || receiverTable.size() == 0) {
+        return;
+    }
+    updateImage = &image;
+    updateProgress = ReceiverUpdateProgress();
+    beginNodeUpdate(millis());
+}
+
+void stopReceiverUpdate() {
+    otaSender.cancel();
+    updateImage = nullptr;
+}
+
+bool receiverUpdateActive() {
+    return updateImage != nullptr;
+}
+
+void serviceReceiverUpdate() {
+    if (!radio || !updateImage) {
+        return;
+    }
+    const uint8_t* mac = receiverTable[updateProgress.receiver].mac;
+    uint8_t out[PROTOCOL_MAX_FRAME_LEN];
+    size_t len = otaSender.poll(millis(), out);
+    if (len > 0 && !radio->send(mac, out, len)) {
+        otaSender.sent(false);
+    }
+    if (otaSender.active()) {
+        return;
+    }
+
+    if (otaSender.succeeded()) {
+        updateProgress.updated++;
+        updateProgress.lastKbPerSec = otaSender.kbPerSec();
+        Serial.printf("Receiver updated: %lu chunks in %lu ms, %.1f KB/s, %lu sent (%lu send failures)\n",
+                      (unsigned long)otaSender.chunkCount(), (unsigned long)otaSender.elapsedMs(),
+                      otaSender.kbPerSec(), (unsigned long)otaSender.chunksSent(),
+                      (unsigned long)otaSender.deliveryFailures());
+    } else {
+        updateProgress.failed++;
+        Serial.printf("Receiver update failed after %lu of %lu chunks\n",
+                      (unsigned long)otaSender.chunksConfirmed(), (unsigned long)otaSender.chunkCount());
+    }
+    if (++updateProgress.receiver < receiverTable.size()) {
+        beginNodeUpdate(millis());
+    } else {
+        Serial.printf("Receiver update finished: %u updated, %u failed\n", updateProgress.updated, updateProgress.failed);
+        updateImage = nullptr;
+    }
+}
+
+void noteUpdateSendStatus(const uint8_t* mac, bool delivered) {
+    if (updateImage && memcmp(mac, receiverTable[updateProgress.receiver].mac, 6) == 0) {
+        otaSender.sent(delivered);
+    }
+}
+
+void handleOtaStatus(const RxFrame& frame) {
+    if (updateImage && memcmp(frame.mac, receiverTable[updateProgress.receiver].mac, 6) == 0) {
+        otaSender.receive(frame.data, frame.len, millis());
+    }
+}
+
+ReceiverUpdateProgress receiverUpdateProgress() {
+    ReceiverUpdateProgress progress = updateProgress;
+    if (updateImage && otaSender.chunkCount() > 0) {
+        progress.percent = (uint8_t)(otaSender.chunksConfirmed() * 100 / otaSender.chunkCount());
+    }
+    return progress;
+}
+
+void handleOtaFrame(const RxFrame& frame, OtaReceiver& ota) {
+    if (!radio || !ensurePeer(*radio, frame.mac)) {
+        return;
+    }
+    uint8_t out[PROTOCOL_MAX_FRAME_LEN];
+    size_t len = ota.handle(frame.data, frame.len, out);
+    if (len > 0) {
+        radio->send(frame.mac, out, len);
+    }
+}
+
+bool startHudMirror() {
+    hudTarget = -1;
+    if (!radio) {
+        return false;
+    }
+    for (uint8_t i = 0; i < receiverTable.size(); i++) {
+        if (receiverTable[i].capabilities & NODE_CAP_HUD) {
+            hudTarget = i;
+            break;
+        }
+    }
+    if (hudTarget < 0 || !ensurePeer(*radio, receiverTable[hudTarget].mac)) {
+        hudTarget = -1;
+        return false;
+    }
+    hudEncoder.reset();
+    lastHudReportTime = millis();
+    lastHudFrames = hudEncoder.framesSent();
+    lastHudBytes = hudEncoder.bytesSent();
+    return true;
+}
+
+void stopHudMirror() {
+    hudTarget = -1;
+}
+
+bool hudMirrorActive() {
+    return hudTarget >= 0;
+}
+
+void serviceHudMirror() {
+    if (!radio || hudTarget < 0) {
+        return;
+    }
+    uint32_t now = millis();
+    if (hudEncoder.wantsFrame(now)) {
+        hudEncoder.beginFrame(now);
+    }
+    uint8_t out[PROTOCOL_MAX_FRAME_LEN];
+    size_t len = hudEncoder.poll(now, out);
+    if (len > 0 && !radio->send(receiverTable[hudTarget].mac, out, len)) {
+        hudEncoder.sent(false);
+    }
+}
+
+void noteHudSendStatus(const uint8_t* mac, bool delivered) {
+    int8_t target = hudTarget;
+    if (target >= 0 && memcmp(mac, receiverTable[target].mac, 6) == 0) {
+        hudEncoder.sent(delivered);
+    }
+}
+
+void reportHudStats() {
+    if (hudTarget < 0) {
+        return;
+    }
+    unsigned long now = millis();
+    float seconds = (now - lastHudReportTime) / 1000.0f;
+    if (seconds <= 0) {
+        return;
+    }
+    Serial.printf("HUD mirror: %.1f fps, %.0f B/s, %lu keyframes, %lu tiles, %lu send failures\n",
+                  (hudEncoder.framesSent() - lastHudFrames) / seconds,
+                  (hudEncoder.bytesSent() - lastHudBytes) / seconds,
+                  (unsigned long)hudEncoder.keyframesSent(), (unsigned long)hudEncoder.tilesSent(),
+                  (unsigned long)hudEncoder.deliveryFailures());
+    lastHudReportTime = now;
+    lastHudFrames = hudEncoder.framesSent();
+    lastHudBytes = hudEncoder.bytesSent();
+}
+
+void sendChannelProbe(const uint8_t* mac) {
+    if (!radio || !ensurePeer(*radio, mac)) {
+        return;
+    }
+    uint8_t out[sizeof(FrameHeader)];
+    size_t len = encodeHeader(out, MessageType::CHANNEL_PROBE, 0);
+    radio->send(mac, out, len);
+}
+
+void reportPeerStats() {
+    for (uint8_t i = 0; i < receiverTable.size(); i++) {
+        const ReceiverNode& node = receiverTable[i];
+        Serial.printf("Receiver %02X:%02X:%02X:%02X:%02X:%02X acked=%lu missed=%lu rtt=%lu us (max %lu us) rssi=%d dBm\n",
+                      node.mac[0], node.mac[1], node.mac[2], node.mac[3], node.mac[4], node.mac[5],
+                      (unsigned long)node.acked, (unsigned long)node.missed,
+                      (unsigned long)node.lastRttUs, (unsigned long)node.maxRttUs, node.rssi);
+        if (node.relayedAcks > 0) {
+            Serial.printf("  relayed acks=%lu, route %s %02X:%02X:%02X:%02X:%02X:%02X (%u hops)\n",
+                          (unsigned long)node.relayedAcks, node.hops > 0 ? "via" : "direct, last via",
+                          node.via[0], node.via[1], node.via[2], node.via[3], node.via[4], node.via[5], node.hops);
+        }
+        if (node.telemetry.valid) {
+            const TelemetrySnapshot& t = node.telemetry.current;
+            Serial.printf("  telemetry: fans=%02X duty=%u/%u temp=%.1f C supply=%u mV current=%.1f mA power=%.2f W leds=%u fps margin=%u ms flags=%02X (%lu ms ago)\n",
+                          t.fans, t.fanDuty[0], t.fanDuty[1], t.chipTempDeciC / 10.0, t.supplyMv, t.currentDeciMa / 10.0, t.powerMw / 1000.0, t.ledFps, t.watchdogMarginMs, t.safeFlags,
+                          (unsigned long)(millis() - node.telemetry.updatedMs));
+        }
+    }
+    Serial.printf("TX power %.2f dBm, weakest receiver margin %d dB\n", txPowerControl.power() / 4.0, txPowerControl.marginDb());
+}
+
+void reportTimeSync() {
+    if (!effectClock.synced()) {
+        Serial.println("Time sync: waiting for first exchange");
+        return;
+    }
+    Serial.printf("Time sync: offset=%lld us drift=%.2f ppm error=%lld us rtt=%lld us\n",
+                  (long long)effectClock.offsetUs(), effectClock.driftPpm(),
+                  (long long)effectClock.lastErrorUs(), (long long)effectClock.lastDelayUs());
+}
@@ -0,0 +1,56 @@
+#include "duty_cycle.h"
+
+// Rounds toward minus infinity, so times before the epoch land in the right period
+static int64_t floorDiv(int64_t a, int64_t b) {
+    int64_t q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+// Whether an opening of `len` every `interval`, widened by `margin`, covers `t`
+static bool covers(int64_t t, int64_t interval, int64_t len, int64_t margin) {
+    int64_t start = floorDiv(t + margin, interval) * interval - margin;
+    return t - start < len + 2 * margin;
+}
+
+// First time from `t` on that such an opening covers
+static int64_t nextOpening(int64_t t, int64_t interval, int64_t len, int64_t margin) {
+    if (covers(t, interval, len, margin)) {
+        return t;
+    }
+    return (floorDiv(t + margin, interval) + 1) * interval - margin;
+}
+
+DutyCycle::DutyCycle(int64_t periodUs, int64_t windowUs, int64_t slotPeriodUs, int64_t slotUs,
+                     int64_t guardUs, int64_t lingerUs)
+    : periodUs(periodUs), windowUs(windowUs), slotPeriodUs(slotPeriodUs), slotUs(slotUs),
+      guardUs(guardUs), lingerUs(lingerUs) {}
+
+DutyCycle::Phase DutyCycle::phase(int64_t sharedUs, int64_t marginUs) const {
+    if (covers(sharedUs, periodUs, windowUs, marginUs)) {
+        return Phase::WINDOW;
+    }
+    if (covers(sharedUs, slotPeriodUs, slotUs, marginUs)) {
+        return Phase::SLOT;
+    }
+    return Phase::ASLEEP;
+}
+
+int64_t DutyCycle::period(int64_t sharedUs) const {
+    return floorDiv(sharedUs, periodUs);
+}
+
+int64_t DutyCycle::nextWakeUs(int64_t sharedUs) const {
+    int64_t window = nextOpening(sharedUs, periodUs, windowUs, guardUs);
+    int64_t slot = nextOpening(sharedUs, slotPeriodUs, slotUs, guardUs);
+    return window < slot ? window : slot;
+}
+
+void DutyCycle::noteTraffic(int64_t sharedUs) {
+    if (sharedUs + lingerUs > lingerUntilUs) {
+        lingerUntilUs = sharedUs + lingerUs;
+    }
+}
+
+bool DutyCycle::awake(int64_t sharedUs) const {
+    return sharedUs < lingerUntilUs || phase(sharedUs, guardUs) != Phase::ASLEEP;
+}
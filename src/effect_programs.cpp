@@ -0,0 +1,52 @@
+#include "effect_programs.h"
+#include "effect_vm.h"
+
+#define OP(op) (uint8_t)VmOp::op
+#define U16(v) (uint8_t)((v) & 0xFF), (uint8_t)((v) >> 8)
+
+// Single lit LED sweeping along the strip over a dim base
+static const uint8_t scannerCode[] = {
+    /*  0 */ OP(TIME), OP(PUSH16), U16(150), OP(DIV), OP(COUNT), OP(MOD),
+    /*  7 */ OP(INDEX), OP(EQ), OP(JZ), U16(14),
+    /* 12 */ OP(COLOR), OP(OUT),
+    /* 14 */ OP(COLOR), OP(PUSH8), 24, OP(SCALE), OP(OUT),
+};
+
+// Sine-wave brightness travelling across the LEDs
+static const uint8_t breatheCode[] = {
+    OP(COLOR),
+    OP(TIME), OP(PUSH8), 8, OP(DIV),
+    OP(INDEX), OP(PUSH8), 64, OP(MUL), OP(ADD),
+    OP(SIN), OP(SCALE), OP(OUT),
+};
+
+// Hue cycling over time, offset per LED (ignores the chosen visor colour)
+static const uint8_t rainbowCode[] = {
+    OP(TIME), OP(PUSH8), 10, OP(DIV),
+    OP(INDEX), OP(PUSH8), 40, OP(MUL), OP(ADD),
+    OP(PUSH8), 255, OP(PUSH8), 255, OP(HSV), OP(OUT),
+};
+
+// Moving head with a tail that loses two thirds of its brightness per LED
+// r0 = distance behind the head, r1 = brightness. The loop ends once the tail
+// has faded out, so long strips stay inside the step limit.
+static const uint8_t cometCode[] = {
+    /*  0 */ OP(TIME), OP(PUSH8), 120, OP(DIV), OP(COUNT), OP(MOD),
+    /*  6 */ OP(INDEX), OP(SUB), OP(COUNT), OP(ADD), OP(COUNT), OP(MOD),
+    /* 12 */ OP(STORE), 0, OP(PUSH8), 255, OP(STORE), 1,
+    /* 18 */ OP(LOAD), 0, OP(JZ), U16(45),
+    /* 23 */ OP(LOAD), 1, OP(JZ), U16(45),
+    /* 28 */ OP(LOAD), 1, OP(PUSH8), 3, OP(DIV), OP(STORE), 1,
+    /* 35 */ OP(LOAD), 0, OP(PUSH8), 1, OP(SUB), OP(STORE), 0,
+    /* 42 */ OP(JMP), U16(18),
+    /* 45 */ OP(COLOR), OP(LOAD), 1, OP(SCALE), OP(OUT),
+};
+
+const EffectProgram effectPrograms[EFFECT_PROGRAM_COUNT] = {
+    {"Scanner", scannerCode, sizeof(scannerCode)},
+    {"Breathe", breatheCode, sizeof(breatheCode)},
+    {"Rainbow", rainbowCode, sizeof(rainbowCode)},
+    {"Comet",   cometCode,   sizeof(cometCode)},
+};
+
+const char* effectProgramNames[EFFECT_PROGRAM_COUNT] = {"Scanner", "Breathe", "Rainbow", "Comet"};
@@ -0,0 +1,262 @@
+#include "effect_vm.h"
+#include "wave_tables.h"
+#include <string.h>
+
+int vmOperandLength(uint8_t op) {
+    switch ((VmOp)op) {
+        case VmOp::PUSH8:
+        case VmOp::LOAD:
+        case VmOp::STORE:
+            return 1;
+        case VmOp::PUSH16:
+        case VmOp::JMP:
+        case VmOp::JZ:
+            return 2;
+        default:
+            return op < (uint8_t)VmOp::OP_COUNT ? 0 : -1;
+    }
+}
+
+bool EffectVm::verify(const uint8_t* code, uint16_t len) {
+    if (len == 0 || len > VM_MAX_PROGRAM_LEN) {
+        return false;
+    }
+
+    // Mark instruction boundaries so jumps can't land inside an operand
+    bool boundary[VM_MAX_PROGRAM_LEN] = {false};
+    for (uint16_t pc = 0; pc < len;) {
+        int operands = vmOperandLength(code[pc]);
+        if (operands < 0 || pc + 1 + operands > len) {
+            return false;
+        }
+        if ((code[pc] == (uint8_t)VmOp::LOAD || code[pc] == (uint8_t)VmOp::STORE) && code[pc + 1] >= VM_REGISTERS) {
+            return false;
+        }
+        boundary[pc] = true;
+        pc += 1 + operands;
+    }
+
+    for (uint16_t pc = 0; pc < len; pc += 1 + vmOperandLength(code[pc])) {
+        if (code[pc] == (uint8_t)VmOp::JMP || code[pc] == (uint8_t)VmOp::JZ) {
+            uint16_t target = code[pc + 1] | (code[pc + 2] << 8);
+            if (target >= len || !boundary[target]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool EffectVm::load(const uint8_t* newCode, uint16_t len) {
+    if (!verify(newCode, len)) {
+        return false;
+    }
+    memcpy(code, newCode, len);
+    length = len;
+    return true;
+}
+
+bool EffectVm::takeFault() {
+    bool hadFault = fault;
+    fault = false;
+    return hadFault;
+}
+
+static uint8_t constrainByte(int32_t value) {
+    return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+static uint32_t packColor(int32_t r, int32_t g, int32_t b) {
+    r = r < 0 ? 0 : (r > 255 ? 255 : r);
+    g = g < 0 ? 0 : (g > 255 ? 255 : g);
+    b = b < 0 ? 0 : (b > 255 ? 255 : b);
+    return ((uint32_t)r << 16) | ((uint32_t)g << 8) | (uint32_t)b;
+}
+
+static uint32_t scaleColor(uint32_t color, uint8_t amount) {
+    return packColor(scale8(color >> 16, amount), scale8(color >> 8, amount), scale8(color, amount));
+}
+
+static uint32_t blendColor(uint32_t c1, uint32_t c2, uint8_t t) {
+    int32_t channels[3];
+    for (int i = 0; i < 3; i++) {
+        int32_t a = (c1 >> (16 - i * 8)) & 0xFF;
+        int32_t b = (c2 >> (16 - i * 8)) & 0xFF;
+        channels[i] = a + ((b - a) * t + 127) / 255;
+    }
+    return packColor(channels[0], channels[1], channels[2]);
+}
+
+static uint32_t hsvToColor(uint8_t h, uint8_t s, uint8_t v) {
+    // Six 43-step hue sectors
+    uint8_t sector = h / 43;
+    uint8_t rem = (h - sector * 43) * 6;
+    uint8_t p = scale8(v, 255 - s);
+    uint8_t q = scale8(v, 255 - scale8(s, rem));
+    uint8_t t = scale8(v, 255 - scale8(s, 255 - rem));
+    switch (sector) {
+        case 0:  return packColor(v, t, p);
+        case 1:  return packColor(q, v, p);
+        case 2:  return packColor(p, v, t);
+        case 3:  return packColor(p, q, v);
+        case 4:  return packColor(t, p, v);
+        default: return packColor(v, p, q);
+    }
+}
+
+uint32_t EffectVm::run(const VmContext& ctx) {
+    int32_t stack[VM_STACK_DEPTH];
+    int32_t regs[VM_REGISTERS] = {0};
+    int sp = 0;
+    uint16_t pc = 0;
+
+    // Stack guards: bail out to black rather than touching memory outside the stack
+    #define NEED(n) if (sp < (n)) { fault = true; return 0; }
+    #define ROOM()  if (sp >= VM_STACK_DEPTH) { fault = true; return 0; }
+    #define POP()   (stack[--sp])
+    #define PUSH(v) do { ROOM(); stack[sp++] = (v); } while (0)
+
+    for (uint16_t steps = 0; steps < VM_MAX_STEPS && pc < length; steps++) {
+        VmOp op = (VmOp)code[pc++];
+        switch (op) {
+            case VmOp::HALT:
+                return 0;
+            case VmOp::PUSH8:
+                PUSH(code[pc]);
+                pc += 1;
+                break;
+            case VmOp::PUSH16:
+                PUSH((int16_t)(code[pc] | (code[pc + 1] << 8)));
+                pc += 2;
+                break;
+            case VmOp::TIME:  PUSH((int32_t)(ctx.timeMs & 0x7FFFFFFF)); break;
+            case VmOp::INDEX: PUSH(ctx.index); break;
+            case VmOp::COUNT: PUSH(ctx.count); break;
+            case VmOp::COLOR: PUSH((int32_t)ctx.color); break;
+            case VmOp::RAND:
+                rng ^= rng << 13;
+                rng ^= rng >> 17;
+                rng ^= rng << 5;
+                PUSH(rng & 0xFF);
+                break;
+            case VmOp::ADD:
+            case VmOp::SUB:
+            case VmOp::MUL:
+            case VmOp::DIV:
+            case VmOp::MOD:
+            case VmOp::EQ:
+            case VmOp::LT:
+            case VmOp::MIN:
+            case VmOp::MAX: {
+                NEED(2);
+                int32_t b = POP();
+                int32_t a = POP();
+                int32_t r = 0;
+                switch (op) {
+                    // Wrap on overflow rather than trust a program to stay in range
+                    case VmOp::ADD: r = (int32_t)((uint32_t)a + (uint32_t)b); break;
+                    case VmOp::SUB: r = (int32_t)((uint32_t)a - (uint32_t)b); break;
+                    case VmOp::MUL: r = (int32_t)((uint32_t)a * (uint32_t)b); break;
+                    // INT32_MIN / -1 overflows too, so -1 negates with wraparound
+                    case VmOp::DIV: r = b == -1 ? (int32_t)(0u - (uint32_t)a) : b ? a / b : 0; break;
+                    case VmOp::MOD: r = b == -1 || b == 0 ? 0 : a % b; break;
+                    case VmOp::EQ:  r = a == b; break;
+                    case VmOp::LT:  r = a < b; break;
+                    case VmOp::MIN: r = a < b ? a : b; break;
+                    default:        r = a > b ? a : b; break;
+                }
+                PUSH(r);
+                break;
+            }
+            case VmOp::DUP: {
+                NEED(1);
+                int32_t top = stack[sp - 1];
+                PUSH(top);
+                break;
+            }
+            case VmOp::DROP:
+                NEED(1);
+                sp--;
+                break;
+            case VmOp::SWAP: {
+                NEED(2);
+                int32_t tmp = stack[sp - 1];
+                stack[sp - 1] = stack[sp - 2];
+                stack[sp - 2] = tmp;
+                break;
+            }
+            case VmOp::LOAD:
+                PUSH(regs[code[pc]]);
+                pc += 1;
+                break;
+            case VmOp::STORE:
+                NEED(1);
+                regs[code[pc]] = POP();
+                pc += 1;
+                break;
+            case VmOp::JMP:
+                pc = code[pc] | (code[pc + 1] << 8);
+                break;
+            case VmOp::JZ: {
+                NEED(1);
+                uint16_t target = code[pc] | (code[pc + 1] << 8);
+                pc = POP() == 0 ? target : pc + 2;
+                break;
+            }
+            case VmOp::SIN:
+                NEED(1);
+                stack[sp - 1] = sin8(stack[sp - 1] & 0xFF);
+                break;
+            case VmOp::TRI:
+                NEED(1);
+                stack[sp - 1] = tri8(stack[sp - 1] & 0xFF);
+                break;
+            case VmOp::RGB: {
+                NEED(3);
+                int32_t b = POP();
+                int32_t g = POP();
+                int32_t r = POP();
+                PUSH((int32_t)packColor(r, g, b));
+                break;
+            }
+            case VmOp::HSV: {
+                NEED(3);
+                int32_t v = POP();
+                int32_t s = POP();
+                int32_t h = POP();
+                PUSH((int32_t)hsvToColor(h & 0xFF, constrainByte(s), constrainByte(v)));
+                break;
+            }
+            case VmOp::SCALE: {
+                NEED(2);
+                int32_t amount = POP();
+                uint32_t color = POP();
+                PUSH((int32_t)scaleColor(color, constrainByte(amount)));
+                break;
+            }
+            case VmOp::BLEND: {
+                NEED(3);
+                uint8_t t = constrainByte(POP());
+                uint32_t c2 = POP();
+                uint32_t c1 = POP();
+                PUSH((int32_t)blendColor(c1, c2, t));
+                break;
+            }
+            case VmOp::OUT:
+                NEED(1);
+                return (uint32_t)POP() & 0xFFFFFF;
+            default:
+                fault = true;
+                return 0;
+        }
+    }
+
+    #undef NEED
+    #undef ROOM
+    #undef POP
+    #undef PUSH
+
+    // Ran off the end or out of steps without emitting a colour
+    fault = true;
+    return 0;
+}
@@ -0,0 +1,57 @@
+#include "fan_control.h"
+
+static const FanCurvePoint fanCurve[] = FAN_CURVE;
+static const uint8_t fanCurvePoints = sizeof(fanCurve) / sizeof(fanCurve[0]);
+
+uint8_t FanController::curveDuty(int16_t tempDeciC) {
+    if (tempDeciC < fanCurve[0].tempDeciC) {
+        return 0;
+    }
+    for (uint8_t i = 1; i < fanCurvePoints; i++) {
+        const FanCurvePoint& low = fanCurve[i - 1];
+        const FanCurvePoint& high = fanCurve[i];
+        if (tempDeciC < high.tempDeciC) {
+            int32_t span = high.tempDeciC - low.tempDeciC;
+            return low.duty + (int32_t)(high.duty - low.duty) * (tempDeciC - low.tempDeciC) / span;
+        }
+    }
+    return fanCurve[fanCurvePoints - 1].duty;
+}
+
+uint8_t FanController::update(int16_t tempDeciC, uint32_t nowMs) {
+    // A late or first call ramps one interval's worth, not the whole gap
+    uint32_t elapsed = nowMs - lastMs;
+    if (elapsed > FAN_UPDATE_INTERVAL_MS) {
+        elapsed = FAN_UPDATE_INTERVAL_MS;
+    }
+    lastMs = nowMs;
+
+    // Follow rises at once, falls only past the hysteresis
+    if (!tracking || tempDeciC > followedDeciC) {
+        followedDeciC = tempDeciC;
+        tracking = true;
+    } else if (tempDeciC + FAN_HYSTERESIS_DECIC < followedDeciC) {
+        followedDeciC = tempDeciC + FAN_HYSTERESIS_DECIC;
+    }
+
+    uint8_t target = 0;
+    if (currentMode == ThermalsMode::MAX) {
+        target = 255;
+    } else if (currentMode == ThermalsMode::AUTO) {
+        target = curveDuty(followedDeciC);
+    }
+
+    uint16_t targetQ8 = target << 8;
+    if (targetQ8 <= dutyQ8) {
+        dutyQ8 = targetQ8;
+    } else {
+        uint32_t step = elapsed * (255u << 8) / FAN_SOFT_START_MS;
+        dutyQ8 = (uint32_t)(targetQ8 - dutyQ8) > step ? dutyQ8 + step : targetQ8;
+    }
+    return duty();
+}
+
+void FanController::stop() {
+    currentMode = ThermalsMode::OFF;
+    dutyQ8 = 0;
+}
@@ -0,0 +1,92 @@
+#ifdef ARDUINO
+
+#include "fan_output.h"
+#include "layout.h"
+#include "pins.h"
+#include <Arduino.h>
+#include <atomic>
+
+static const uint8_t fanPins[2] = {FAN_1_CTRL, FAN_2_CTRL};
+static std::atomic<uint32_t> haltReasons{0};
+
+// Core 3 addresses LEDC by pin; older cores by channel, one per fan here
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+static bool attachFan(uint8_t fan) {
+    return ledcAttach(fanPins[fan], FAN_PWM_FREQ_HZ, FAN_PWM_BITS);
+}
+
+static void writeFan(uint8_t fan, uint8_t duty) {
+    ledcWrite(fanPins[fan], duty);
+}
+
+static uint8_t readFan(uint8_t fan) {
+    return ledcRead(fanPins[fan]);
+}
+#else
+static bool attachFan(uint8_t fan) {
+    if (ledcSetup(fan, FAN_PWM_FREQ_HZ, FAN_PWM_BITS) == 0) {
+        return false;
+    }
+    ledcAttachPin(fanPins[fan], fan);
+    return true;
+}
+
+static void writeFan(uint8_t fan, uint8_t duty) {
+    ledcWrite(fan, duty);
+}
+
+static uint8_t readFan(uint8_t fan) {
+    return ledcRead(fan);
+}
+#endif
+
+bool LedcFanOutput::begin() {
+    for (uint8_t fan = 0; fan < 2; fan++) {
+        if (!attachFan(fan)) {
+            Serial.printf("Error initializing PWM for fan %u\n", fan + 1);
+            return false;
+        }
+        writeFan(fan, 0);
+    }
+    return true;
+}
+
+void LedcFanOutput::write(uint8_t duty) {
+    if (halted()) {
+        duty = 0;
+    }
+    for (uint8_t fan = 0; fan < 2; fan++) {
+        writeFan(fan, duty);
+    }
+    // A halt that landed during the writes must win
+    if (halted()) {
+        for (uint8_t fan = 0; fan < 2; fan++) {
+            writeFan(fan, 0);
+        }
+    }
+}
+
+void LedcFanOutput::halt(uint8_t reason) {
+    haltReasons.fetch_or(reason, std::memory_order_acq_rel);
+    for (uint8_t fan = 0; fan < 2; fan++) {
+        writeFan(fan, 0);
+    }
+}
+
+void LedcFanOutput::hold(uint8_t reason) {
+    haltReasons.fetch_or(reason, std::memory_order_acq_rel);
+}
+
+void LedcFanOutput::release(uint8_t reason) {
+    haltReasons.fetch_and(~(uint32_t)reason, std::memory_order_acq_rel);
+}
+
+bool LedcFanOutput::halted() const {
+    return haltReasons.load(std::memory_order_acquire) != 0;
+}
+
+uint8_t LedcFanOutput::readDuty(uint8_t fan) {
+    return readFan(fan);
+}
+
+#endif
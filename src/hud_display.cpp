@@ -0,0 +1,25 @@
+#include "hud_display.h"
+
+#if defined(ARDUINO) && RECEIVER_HUD
+
+#include <Arduino.h>
+#include <SPI.h>
+#include "pins.h"
+
+St7789HudDisplay::St7789HudDisplay() : panel(&SPI, HUD_TFT_CS, HUD_TFT_DC, HUD_TFT_RST) {}
+
+void St7789HudDisplay::begin() {
+    SPI.begin(HUD_TFT_SCLK, -1, HUD_TFT_MOSI, HUD_TFT_CS);
+    panel.init(170, 320);
+    panel.setRotation(3);
+    panel.setSPISpeed(40000000);
+    panel.fillScreen(ST77XX_BLACK);
+    pinMode(HUD_TFT_BL, OUTPUT);
+    digitalWrite(HUD_TFT_BL, HIGH);
+}
+
+void St7789HudDisplay::blit(uint16_t x, uint16_t y, uint8_t w, uint8_t h, const uint16_t* pixels) {
+    panel.drawRGBBitmap(x, y, pixels, w, h);
+}
+
+#endif
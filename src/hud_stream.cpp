@@ -0,0 +1,376 @@
+#include "hud_stream.h"
+#include <string.h>
+
+#define HUD_TILE_PIXELS (HUD_TILE_SIZE * HUD_TILE_SIZE)
+#define HUD_PALETTE_MAX 16
+
+// Edge tiles are cut short by the screen
+static void tileRect(uint16_t tile, uint16_t& x, uint16_t& y, uint8_t& w, uint8_t& h) {
+    x = (tile % HUD_COLUMNS) * HUD_TILE_SIZE;
+    y = (tile / HUD_COLUMNS) * HUD_TILE_SIZE;
+    w = SCREEN_WIDTH - x < HUD_TILE_SIZE ? SCREEN_WIDTH - x : HUD_TILE_SIZE;
+    h = SCREEN_HEIGHT - y < HUD_TILE_SIZE ? SCREEN_HEIGHT - y : HUD_TILE_SIZE;
+}
+
+static uint8_t indexBits(uint8_t paletteSize) {
+    return paletteSize <= 2 ? 1 : paletteSize <= 4 ? 2 : 4;
+}
+
+// --- Encoder ---
+
+uint32_t HudEncoder::hashTile(uint16_t tile) const {
+    uint16_t x, y;
+    uint8_t w, h;
+    tileRect(tile, x, y, w, h);
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (uint8_t row = 0; row < h; row++) {
+        const uint8_t* p = canvas + (y + row) * SCREEN_WIDTH + x;
+        for (uint8_t col = 0; col < w; col++) {
+            hash = (hash ^ p[col]) * 16777619u;
+        }
+    }
+    return hash;
+}
+
+uint16_t HudEncoder::scan(const uint8_t* pixels) {
+    canvas = pixels;
+    uint16_t count = 0;
+    memset(changed, 0, sizeof(changed));
+    for (uint16_t tile = 0; tile < HUD_TILE_COUNT; tile++) {
+        uint32_t hash = hashTile(tile);
+        if (hash != scanHash[tile]) {
+            scanHash[tile] = hash;
+            changed[tile / 8] |= 1 << (tile % 8);
+            count++;
+        }
+    }
+    return count;
+}
+
+bool HudEncoder::wantsFrame(uint32_t nowMs) const {
+    return canvas && pendingCount == 0 && nowMs - lastFrameMs >= 1000 / HUD_MAX_FPS;
+}
+
+void HudEncoder::beginFrame(uint32_t nowMs) {
+    lastFrameMs = nowMs;
+    keyframe = needKeyframe || nowMs - lastKeyframeMs >= HUD_KEYFRAME_MS;
+    if (keyframe) {
+        needKeyframe = false;
+        lastKeyframeMs = nowMs;
+    }
+    memset(pending, 0, sizeof(pending));
+    pendingCount = 0;
+    for (uint16_t tile = 0; tile < HUD_TILE_COUNT; tile++) {
+        if (keyframe || scanHash[tile] != sentHash[tile]) {
+            pending[tile / 8] |= 1 << (tile % 8);
+            pendingCount++;
+        }
+    }
+    cursor = 0;
+    if (pendingCount > 0) {
+        frameId++;
+    }
+}
+
+void HudEncoder::reset() {
+    canvas = nullptr;
+    needKeyframe = true;
+    pendingCount = 0;
+    inFlight = false;
+    lastDelivered = true;
+    lastTileCount = 0;
+}
+
+size_t HudEncoder::encodeTile(uint16_t tile, uint8_t* out) const {
+    uint16_t x, y;
+    uint8_t w, h;
+    tileRect(tile, x, y, w, h);
+    uint8_t px[HUD_TILE_PIXELS];
+    uint8_t n = 0;
+    for (uint8_t row = 0; row < h; row++) {
+        memcpy(px + n, canvas + (y + row) * SCREEN_WIDTH + x, w);
+        n += w;
+    }
+
+    // Palette, and pixel indices into it
+    uint8_t palette[HUD_PALETTE_MAX];
+    uint8_t paletteSize = 0;
+    uint8_t index[HUD_TILE_PIXELS];
+    bool fits = true;
+    for (uint8_t i = 0; i < n && fits; i++) {
+        uint8_t p = 0;
+        while (p < paletteSize && palette[p] != px[i]) {
+            p++;
+        }
+        if (p == paletteSize) {
+            if (paletteSize == HUD_PALETTE_MAX) {
+                fits = false;
+                break;
+            }
+            palette[paletteSize++] = px[i];
+        }
+        index[i] = p;
+    }
+
+    if (fits && paletteSize == 1) {
+        out[0] = (uint8_t)HudTileEncoding::SOLID;
+        out[1] = palette[0];
+        return 2;
+    }
+
+    size_t best = 1 + n;
+    HudTileEncoding encoding = HudTileEncoding::RAW;
+    size_t packedLen = 0, rleLen = 0;
+    if (fits) {
+        uint8_t bits = indexBits(paletteSize);
+        packedLen = 2 + paletteSize + (n * bits + 7) / 8;
+        rleLen = 2 + paletteSize;
+        for (uint8_t i = 0; i < n;) {
+            uint8_t run = 1;
+            while (i + run < n && run < 16 && index[i + run] == index[i]) {
+                run++;
+            }
+            rleLen++;
+            i += run;
+        }
+        if (packedLen < best) {
+            best = packedLen;
+            encoding = HudTileEncoding::PACKED;
+        }
+        if (rleLen < best) {
+            best = rleLen;
+            encoding = HudTileEncoding::RLE;
+        }
+    }
+
+    out[0] = (uint8_t)encoding;
+    if (encoding == HudTileEncoding::RAW) {
+        memcpy(out + 1, px, n);
+        return 1 + n;
+    }
+    out[1] = paletteSize;
+    memcpy(out + 2, palette, paletteSize);
+    size_t len = 2 + paletteSize;
+    if (encoding == HudTileEncoding::PACKED) {
+        uint8_t bits = indexBits(paletteSize);
+        memset(out + len, 0, packedLen - len);
+        for (uint8_t i = 0; i < n; i++) {
+            uint16_t bit = i * bits;
+            out[len + bit / 8] |= index[i] << (bit % 8);
+        }
+        return packedLen;
+    }
+    for (uint8_t i = 0; i < n;) {
+        uint8_t run = 1;
+        while (i + run < n && run < 16 && index[i + run] == index[i]) {
+            run++;
+        }
+        out[len++] = index[i] << 4 | (run - 1);
+        i += run;
+    }
+    return len;
+}
+
+size_t HudEncoder::poll(uint32_t nowMs, uint8_t* out) {
+    if (pendingCount == 0 || !canvas) {
+        return 0;
+    }
+    if (inFlight.load(std::memory_order_acquire)) {
+        if (nowMs - lastSendMs < HUD_IN_FLIGHT_TIMEOUT_MS) {
+            return 0;
+        }
+        inFlight = false;   // The send status never came
+    }
+    if (!lastDelivered.load(std::memory_order_acquire)) {
+        // Make the next frame carry them again
+        for (uint8_t i = 0; i < lastTileCount; i++) {
+            sentHash[lastTiles[i]] = ~scanHash[lastTiles[i]];
+        }
+        lastTileCount = 0;
+        lastDelivered = true;
+    }
+
+    // Airtime budget: a full packet's worth must be saved up
+    tokens += (nowMs - tokensUpdatedMs) * (HUD_MAX_BYTES_PER_SEC / 1000.0f);
+    tokensUpdatedMs = nowMs;
+    if (tokens > 2 * PROTOCOL_MAX_FRAME_LEN) {
+        tokens = 2 * PROTOCOL_MAX_FRAME_LEN;
+    }
+    if (tokens < PROTOCOL_MAX_FRAME_LEN) {
+        return 0;
+    }
+
+    size_t len = encodeHeader(out, MessageType::HUD_TILES, ++packetSeq);
+    HudPacketHeader header;
+    header.frameId = frameId;
+    header.flags = keyframe ? HUD_FLAG_KEYFRAME : 0;
+    header.tileCount = 0;
+    size_t headerAt = len;
+    len += sizeof(header);
+    lastTileCount = 0;
+
+    uint8_t tileBuf[HUD_MAX_TILE_LEN];
+    for (; cursor < HUD_TILE_COUNT && pendingCount > 0; cursor++) {
+        if (!(pending[cursor / 8] & (1 << (cursor % 8)))) {
+            continue;
+        }
+        size_t tileLen = encodeTile(cursor, tileBuf);
+        if (len + 2 + tileLen > PROTOCOL_MAX_FRAME_LEN) {
+            break;
+        }
+        memcpy(out + len, &cursor, 2);
+        memcpy(out + len + 2, tileBuf, tileLen);
+        len += 2 + tileLen;
+        header.tileCount++;
+        lastTiles[lastTileCount++] = cursor;
+        // The canvas may have moved on since the scan; remember what actually went out
+        sentHash[cursor] = hashTile(cursor);
+        pending[cursor / 8] &= ~(1 << (cursor % 8));
+        pendingCount--;
+    }
+
+    if (pendingCount == 0) {
+        header.flags |= HUD_FLAG_FRAME_END;
+        frames++;
+        if (keyframe) {
+            keyframes++;
+        }
+    }
+    memcpy(out + headerAt, &header, sizeof(header));
+    tiles += header.tileCount;
+    bytes += len;
+    tokens -= len;
+    lastSendMs = nowMs;
+    inFlight.store(true, std::memory_order_release);
+    return len;
+}
+
+void HudEncoder::sent(bool delivered) {
+    if (!delivered) {
+        failures.fetch_add(1, std::memory_order_relaxed);
+    }
+    lastDelivered.store(delivered, std::memory_order_release);
+    inFlight.store(false, std::memory_order_release);
+}
+
+// --- Decoder ---
+
+void MemoryHudDisplay::blit(uint16_t x, uint16_t y, uint8_t w, uint8_t h, const uint16_t* tile) {
+    for (uint8_t row = 0; row < h; row++) {
+        memcpy(pixels + (y + row) * SCREEN_WIDTH + x, tile + row * w, w * sizeof(uint16_t));
+    }
+}
+
+bool HudDecoder::apply(const uint8_t* data, size_t len, HudDisplay& display) {
+    FrameHeader frame;
+    HudPacketHeader header;
+    if (!decodeHeader(data, len, frame) || frame.type != MessageType::HUD_TILES ||
+        len < sizeof(FrameHeader) + sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, data + sizeof(FrameHeader), sizeof(header));
+
+    uint16_t gap = frame.seq - lastSeq - 1;
+    if (haveSeq && gap < 0x8000) {
+        lost += gap;
+    }
+    haveSeq = true;
+    lastSeq = frame.seq;
+    bytes += len;
+
+    size_t pos = sizeof(FrameHeader) + sizeof(header);
+    uint16_t pixels[HUD_TILE_PIXELS];
+    for (uint8_t t = 0; t < header.tileCount; t++) {
+        uint16_t tile;
+        if (pos + 3 > len) {
+            return false;
+        }
+        memcpy(&tile, data + pos, 2);
+        HudTileEncoding encoding = (HudTileEncoding)data[pos + 2];
+        pos += 3;
+        if (tile >= HUD_TILE_COUNT) {
+            return false;
+        }
+        uint16_t x, y;
+        uint8_t w, h;
+        tileRect(tile, x, y, w, h);
+        uint8_t n = w * h;
+
+        if (encoding == HudTileEncoding::SOLID) {
+            if (pos + 1 > len) {
+                return false;
+            }
+            uint16_t color = hudColor565(data[pos++]);
+            for (uint8_t i = 0; i < n; i++) {
+                pixels[i] = color;
+            }
+        } else if (encoding == HudTileEncoding::RAW) {
+            if (pos + n > len) {
+                return false;
+            }
+            for (uint8_t i = 0; i < n; i++) {
+                pixels[i] = hudColor565(data[pos + i]);
+            }
+            pos += n;
+        } else if (encoding == HudTileEncoding::PACKED || encoding == HudTileEncoding::RLE) {
+            if (pos + 1 > len) {
+                return false;
+            }
+            uint8_t paletteSize = data[pos++];
+            if (paletteSize == 0 || paletteSize > HUD_PALETTE_MAX || pos + paletteSize > len) {
+                return false;
+            }
+            uint16_t palette[HUD_PALETTE_MAX];
+            for (uint8_t p = 0; p < paletteSize; p++) {
+                palette[p] = hudColor565(data[pos + p]);
+            }
+            pos += paletteSize;
+
+            if (encoding == HudTileEncoding::PACKED) {
+                uint8_t bits = indexBits(paletteSize);
+                size_t packedLen = (n * bits + 7) / 8;
+                if (pos + packedLen > len) {
+                    return false;
+                }
+                for (uint8_t i = 0; i < n; i++) {
+                    uint16_t bit = i * bits;
+                    uint8_t p = (data[pos + bit / 8] >> (bit % 8)) & ((1 << bits) - 1);
+                    if (p >= paletteSize) {
+                        return false;
+                    }
+                    pixels[i] = palette[p];
+                }
+                pos += packedLen;
+            } else {
+                for (uint8_t i = 0; i < n;) {
+                    if (pos + 1 > len) {
+                        return false;
+                    }
+                    uint8_t p = data[pos] >> 4;
+                    uint8_t run = (data[pos] & 0x0F) + 1;
+                    pos++;
+                    if (p >= paletteSize || i + run > n) {
+                        return false;
+                    }
+                    for (uint8_t r = 0; r < run; r++) {
+                        pixels[i++] = palette[p];
+                    }
+                }
+            }
+        } else {
+            return false;
+        }
+
+        display.blit(x, y, w, h, pixels);
+        tiles++;
+    }
+
+    if (header.flags & HUD_FLAG_FRAME_END) {
+        frames++;
+        if (header.flags & HUD_FLAG_KEYFRAME) {
+            keyframes++;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,141 @@
+#include "led_compositor.h"
+#include "gamma.h"
+
+#define DITHER_MASK ((1 << LED_DITHER_BITS) - 1)
+
+// Modulation for each VisorMode, indexed by the enum
+struct EffectSpec {
+    Wave wave;
+    uint16_t periodMs;
+};
+
+static const EffectSpec effectTable[] = {
+    {Wave::CONSTANT, 0},                    // SOLID
+    {Wave::SQUARE, FLASH_INTERVAL_MS * 2},  // FLASHING
+    {Wave::SINE, PULSE_PERIOD_MS},          // PULSING
+    {Wave::SQUARE, STROBE_INTERVAL_MS * 2}, // STROBE
+    {Wave::CONSTANT, 0},                    // PROGRAM - the program animates itself
+};
+
+// Modes past the table, e.g. from a newer interface, render as SOLID
+static const EffectSpec& effectFor(VisorMode mode) {
+    uint8_t index = (uint8_t)mode;
+    return index < sizeof(effectTable) / sizeof(effectTable[0]) ? effectTable[index] : effectTable[0];
+}
+
+static uint8_t wavePhase(uint32_t timeMs, uint16_t periodMs) {
+    return periodMs ? (uint8_t)((timeMs % periodMs) * 256 / periodMs) : 0;
+}
+
+void LedCompositor::setBase(uint32_t color) {
+    for (uint8_t s = 0; s < LED_SEGMENTS; s++) {
+        layers[s] = Layer();
+        layers[s].color = color;
+    }
+}
+
+void LedCompositor::setSegment(uint8_t segment, uint32_t color, VisorMode mode, uint8_t level) {
+    layers[segment].color = color;
+    layers[segment].mode = mode;
+    layers[segment].level = level;
+}
+
+void LedCompositor::setOverlay(uint32_t color, Wave wave, uint16_t periodMs, uint16_t level, uint32_t startMs) {
+    overlayColor = color;
+    overlayWave = wave;
+    overlayPeriodMs = periodMs;
+    overlayLevel = level;
+    overlayStartMs = startMs;
+}
+
+bool LedCompositor::animated() const {
+    // Overlays are transient and their level is often faded from outside
+    if (overlayLevel > 0) {
+        return true;
+    }
+    for (uint8_t s = 0; s < segmentCount(); s++) {
+        VisorMode mode = layers[s].mode;
+        if ((mode == VisorMode::PROGRAM && basePixels) || effectFor(mode).wave != Wave::CONSTANT) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Takes a linear value to 8 bits. With `carryOver`, the LED_DITHER_BITS below the
+// 8 are carried into the next frame so the average over frames matches the linear value;
+// otherwise it is rounded.
+uint8_t LedCompositor::dither(uint16_t value, uint8_t& carry, bool carryOver) {
+    uint32_t fixed = ((uint32_t)value * (255 << LED_DITHER_BITS) + 32767) / 65535;
+    if (!carryOver) {
+        carry = 0;
+        return (fixed + (DITHER_MASK + 1) / 2) >> LED_DITHER_BITS;
+    }
+    fixed += carry;
+    carry = fixed & DITHER_MASK;
+    return fixed >> LED_DITHER_BITS;
+}
+
+bool LedCompositor::render(uint32_t timeMs) {
+    // Each segment's level and, unless it comes per pixel, its linear colour
+    uint16_t amount[LED_SEGMENTS];
+    uint16_t segmentRgb[LED_SEGMENTS][3];
+    bool perPixel[LED_SEGMENTS];
+    for (uint8_t s = 0; s < segmentCount(); s++) {
+        const Layer& layer = layers[s];
+        const EffectSpec& effect = effectFor(layer.mode);
+        amount[s] = gammaLevel16(layer.level * wave8(effect.wave, wavePhase(timeMs, effect.periodMs)) * 257 / 255);
+        perPixel[s] = layer.mode == VisorMode::PROGRAM && basePixels;
+        for (uint8_t c = 0; c < 3; c++) {
+            segmentRgb[s][c] = scale16(gamma16(layer.color >> (16 - 8 * c)), amount[s]);
+        }
+    }
+
+    uint16_t overlay = 0;
+    uint16_t overlayRgb[3];
+    if (overlayLevel > 0) {
+        uint8_t wave = wave8(overlayWave, wavePhase(timeMs - overlayStartMs, overlayPeriodMs));
+        overlay = gammaLevel16((uint32_t)overlayLevel * wave / 255);
+        for (uint8_t c = 0; c < 3; c++) {
+            overlayRgb[c] = scale16(gamma16(overlayColor >> (16 - 8 * c)), overlay);
+        }
+    }
+
+    uint32_t sums[3] = {0, 0, 0};
+    for (uint16_t i = 0; i < LED_CHAIN_LEN; i++) {
+        uint8_t s = segments ? segments->segmentOf(i) : 0;
+        for (uint8_t c = 0; c < 3; c++) {
+            // LEDs in no segment stay dark
+            if (s == LED_NO_SEGMENT) {
+                linear[i * 3 + c] = 0;
+                continue;
+            }
+            uint16_t value = perPixel[s] ? scale16(gamma16(basePixels[i] >> (16 - 8 * c)), amount[s]) : segmentRgb[s][c];
+            if (overlay > 0) {
+                value = scale16(value, 65535 - overlay) + overlayRgb[c];
+            }
+            linear[i * 3 + c] = value;
+            sums[c] += value;
+        }
+    }
+
+    // The whole frame comes down evenly, so colours and effects keep their shape
+    uint16_t limit = power ? power->ledScale(sums) : 65535;
+    bool moving = animated();
+    bool changed = false;
+    for (uint16_t i = 0; i < LED_CHAIN_LEN; i++) {
+        uint32_t out = 0;
+        for (uint8_t c = 0; c < 3; c++) {
+            uint16_t& value = linear[i * 3 + c];
+            if (limit < 65535) {
+                value = scale16(value, limit);
+            }
+            out = out << 8 | dither(value, carry[i * 3 + c], moving);
+        }
+        if (out != pixels[i]) {
+            pixels[i] = out;
+            changed = true;
+        }
+    }
+    return changed;
+}
@@ -0,0 +1,200 @@
+#include "led_output.h"
+
+// WS2812 bit timings in ticks of a 10 MHz RMT clock: 0.3/0.9 us for a 0, 0.9/0.3 us for a 1
+#define RMT_RESOLUTION_HZ 10000000
+#define BIT_SHORT_TICKS 3
+#define BIT_LONG_TICKS 9
+
+// duration0 in bits 0-14, level0 in bit 15, duration1 in bits 16-30, level1 in bit 31
+#define SYMBOL(high, low) ((uint32_t)(high) | 1u << 15 | (uint32_t)(low) << 16)
+
+void encodeGrb(const uint32_t* pixels, uint16_t count, uint8_t* out) {
+    for (uint16_t i = 0; i < count; i++) {
+        uint32_t color = pixels[i];
+        out[0] = color >> 8;
+        out[1] = color >> 16;
+        out[2] = color;
+        out += 3;
+    }
+}
+
+size_t expandWs2812Symbols(const uint8_t* bytes, size_t len, uint32_t* symbols, size_t maxSymbols) {
+    static const uint32_t bitSymbols[2] = {SYMBOL(BIT_SHORT_TICKS, BIT_LONG_TICKS),
+                                           SYMBOL(BIT_LONG_TICKS, BIT_SHORT_TICKS)};
+    size_t size = 0;
+    for (; size < len && (size + 1) * 8 <= maxSymbols; size++) {
+        uint8_t byte = bytes[size];
+        for (int bit = 0; bit < 8; bit++) {
+            *symbols++ = bitSymbols[(byte >> (7 - bit)) & 1];
+        }
+    }
+    return size;
+}
+
+#ifdef ARDUINO
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <esp_idf_version.h>
+#include <soc/soc_caps.h>
+#include <atomic>
+
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+#include <driver/rmt_tx.h>
+#else
+#include <driver/rmt.h>
+#endif
+
+static const uint8_t stripPins[2] = {LED_DATA, LED_DATA_2};
+static uint8_t stripBytes[2][NUM_LEDS * 3];     // GRB, kept until the strip is out
+
+static std::atomic<uint32_t> busyStrips{0};     // One bit per strip still going out
+static std::atomic<uint32_t> doneUs{0};         // When the last strip finished (low 32 bits)
+
+// Runs in interrupt context as each strip finishes
+static void IRAM_ATTR stripDone(uint32_t strip) {
+    if (busyStrips.fetch_and(~(1u << strip)) == (1u << strip)) {
+        doneUs.store((uint32_t)esp_timer_get_time());
+    }
+}
+
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+
+#define RMT_DMA_SYMBOLS 1024
+
+static rmt_channel_handle_t channels[2];
+static rmt_encoder_handle_t encoders[2];       // Encoders hold per-transfer state, so one each
+
+static bool IRAM_ATTR onTransDone(rmt_channel_handle_t channel, const rmt_tx_done_event_data_t* event, void* arg) {
+    stripDone((uint32_t)(uintptr_t)arg);
+    return false;
+}
+
+static bool beginStrip(uint8_t strip) {
+    rmt_tx_channel_config_t config = {};
+    config.gpio_num = (gpio_num_t)stripPins[strip];
+    config.clk_src = RMT_CLK_SRC_DEFAULT;
+    config.resolution_hz = RMT_RESOLUTION_HZ;
+    config.mem_block_symbols = 64;
+    config.trans_queue_depth = 1;
+#if SOC_RMT_SUPPORT_DMA
+    // The S3 feeds one TX channel by DMA, so that strip needs no refill interrupts at all.
+    // With DMA the symbol count sizes the DMA buffer instead of the channel memory.
+    rmt_tx_channel_config_t dmaConfig = config;
+    dmaConfig.mem_block_symbols = RMT_DMA_SYMBOLS;
+    dmaConfig.flags.with_dma = 1;
+    if (rmt_new_tx_channel(&dmaConfig, &channels[strip]) == ESP_OK) {
+        Serial.printf("LED strip %u on RMT DMA\n", strip + 1);
+    } else
+#endif
+    if (rmt_new_tx_channel(&config, &channels[strip]) != ESP_OK) {
+        return false;
+    }
+
+    rmt_bytes_encoder_config_t encoder = {};
+    encoder.bit0.level0 = 1;
+    encoder.bit0.duration0 = BIT_SHORT_TICKS;
+    encoder.bit0.level1 = 0;
+    encoder.bit0.duration1 = BIT_LONG_TICKS;
+    encoder.bit1.level0 = 1;
+    encoder.bit1.duration0 = BIT_LONG_TICKS;
+    encoder.bit1.level1 = 0;
+    encoder.bit1.duration1 = BIT_SHORT_TICKS;
+    encoder.flags.msb_first = 1;
+    if (rmt_new_bytes_encoder(&encoder, &encoders[strip]) != ESP_OK) {
+        return false;
+    }
+
+    rmt_tx_event_callbacks_t callbacks = {};
+    callbacks.on_trans_done = onTransDone;
+    return rmt_tx_register_event_callbacks(channels[strip], &callbacks, (void*)(uintptr_t)strip) == ESP_OK &&
+           rmt_enable(channels[strip]) == ESP_OK;
+}
+
+static bool transmitStrip(uint8_t strip) {
+    rmt_transmit_config_t config = {};
+    return rmt_transmit(channels[strip], encoders[strip], stripBytes[strip], sizeof(stripBytes[strip]), &config) == ESP_OK;
+}
+
+#else
+
+// Older cores only have the legacy driver, which translates bytes to symbols in its ISR
+static const rmt_channel_t channels[2] = {RMT_CHANNEL_0, RMT_CHANNEL_1};
+
+static void IRAM_ATTR translate(const void* src, rmt_item32_t* dest, size_t srcSize, size_t wanted,
+                                size_t* translatedSize, size_t* itemCount) {
+    size_t size = expandWs2812Symbols((const uint8_t*)src, srcSize, &dest->val, wanted);
+    *translatedSize = size;
+    *itemCount = size * 8;
+}
+
+static void IRAM_ATTR onTxEnd(rmt_channel_t channel, void* arg) {
+    for (uint8_t strip = 0; strip < 2; strip++) {
+        if (channels[strip] == channel) {
+            stripDone(strip);
+        }
+    }
+}
+
+static bool beginStrip(uint8_t strip) {
+    rmt_config_t config = RMT_DEFAULT_CONFIG_TX((gpio_num_t)stripPins[strip], channels[strip]);
+    config.clk_div = 80000000 / RMT_RESOLUTION_HZ;
+    if (rmt_config(&config) != ESP_OK || rmt_driver_install(channels[strip], 0, 0) != ESP_OK) {
+        return false;
+    }
+    rmt_translator_init(channels[strip], translate);
+    rmt_register_tx_end_callback(onTxEnd, nullptr);
+    return true;
+}
+
+static bool transmitStrip(uint8_t strip) {
+    return rmt_write_sample(channels[strip], stripBytes[strip], sizeof(stripBytes[strip]), false) == ESP_OK;
+}
+
+#endif
+
+bool RmtLedOutput::begin() {
+    for (uint8_t strip = 0; strip < 2; strip++) {
+        if (!beginStrip(strip)) {
+            Serial.printf("Error initializing RMT for LED strip %u\n", strip + 1);
+            return false;
+        }
+    }
+    doneUs.store((uint32_t)esp_timer_get_time() - LED_LATCH_US);
+    return true;
+}
+
+bool RmtLedOutput::ready() {
+    return busyStrips.load() == 0 && (uint32_t)esp_timer_get_time() - doneUs.load() >= LED_LATCH_US;
+}
+
+bool RmtLedOutput::show(const uint32_t* frame) {
+    if (!ready()) {
+        return false;
+    }
+    for (uint8_t strip = 0; strip < 2; strip++) {
+        encodeGrb(frame + strip * NUM_LEDS, NUM_LEDS, stripBytes[strip]);
+    }
+
+    busyStrips.store(3);
+    for (uint8_t strip = 0; strip < 2; strip++) {
+        // A strip that didn't start won't call back; its old frame stays up
+        if (!transmitStrip(strip)) {
+            stripDone(strip);
+        }
+    }
+    return true;
+}
+
+bool RmtLedOutput::wait(uint32_t timeoutMs) {
+    unsigned long start = millis();
+    while (!ready()) {
+        if (millis() - start >= timeoutMs) {
+            return false;
+        }
+        delay(1);
+    }
+    return true;
+}
+
+#endif
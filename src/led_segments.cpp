@@ -0,0 +1,86 @@
+#include "led_segments.h"
+#include <stdlib.h>
+#include <string.h>
+
+void LedSegmentMap::reset() {
+    segments = 1;
+    strcpy(names[0], "visor");
+    lengths[0] = LED_CHAIN_LEN;
+    memset(owner, 0, sizeof(owner));
+}
+
+// Reads the ranges of segment `segments` up to the next ';' or the end
+bool LedSegmentMap::parseRanges(const char*& p) {
+    lengths[segments] = 0;
+    while (true) {
+        char* end;
+        unsigned long strip = strtoul(p, &end, 10);
+        if (end == p || *end != ':') {
+            return false;
+        }
+        p = end + 1;
+        unsigned long start = strtoul(p, &end, 10);
+        if (end == p || *end != '+') {
+            return false;
+        }
+        p = end + 1;
+        unsigned long count = strtoul(p, &end, 10);
+        if (end == p || count == 0 || strip > 1 || start >= NUM_LEDS || count > NUM_LEDS - start) {
+            return false;
+        }
+        p = end;
+
+        for (uint16_t i = 0; i < count; i++) {
+            uint8_t& slot = owner[strip * NUM_LEDS + start + i];
+            if (slot != LED_NO_SEGMENT) {
+                return false;
+            }
+            slot = segments;
+        }
+        lengths[segments] += count;
+
+        if (*p != ',') {
+            return true;
+        }
+        p++;
+    }
+}
+
+bool LedSegmentMap::load(const char* config) {
+    segments = 0;
+    memset(owner, LED_NO_SEGMENT, sizeof(owner));
+
+    const char* p = config;
+    while (*p) {
+        if (segments == LED_SEGMENTS) {
+            reset();
+            return false;
+        }
+        const char* equals = strchr(p, '=');
+        size_t nameLen = equals ? equals - p : 0;
+        if (nameLen == 0 || nameLen > LED_SEGMENT_NAME_LEN || memchr(p, ';', nameLen)) {
+            reset();
+            return false;
+        }
+        memcpy(names[segments], p, nameLen);
+        names[segments][nameLen] = '\0';
+        p = equals + 1;
+
+        if (!parseRanges(p) || (*p != ';' && *p != '\0')) {
+            reset();
+            return false;
+        }
+        segments++;
+        // A ';' must lead to another segment
+        if (*p == ';' && !*++p) {
+            reset();
+            return false;
+        }
+    }
+
+    if (segments == 0) {
+        reset();
+        return false;
+    }
+    return true;
+}
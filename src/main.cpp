@@ -6,12 +6,34 @@
 #include "menu_system.h"
 #include "communication.h"
 #include "screensavers.h"
+#include "rx_queue.h"
+#include "transport_espnow.h"
+#include "change_batcher.h"
+#include "effect_vm.h"
+#include "board_sensors.h"
+#include "effect_programs.h"
+#include "led_compositor.h"
+#include "led_output.h"
+#include "safety_shutdown.h"
+#include "fan_control.h"
+#include "fan_output.h"
+#include "stop_path.h"
+#include "safety_watchdog.h"
+#include "task_load.h"
+#include "ota_flash.h"
+#include "hud_display.h"
+#include "power_model.h"
+#include "power_budget.h"
+#include "radio_profile.h"
 #include <Adafruit_NeoPixel.h>
 #include <WiFi.h>
-#include <esp_now.h>
 #include <OneButton.h>
 #include <Preferences.h>
+#include <esp_timer.h>
+#include <esp_sleep.h>
+#include <freertos/semphr.h>
 #include <memory>
+#include <atomic>
 
 enum class DeviceMode : uint8_t {
   INTERFACE,
@@ -25,6 +47,25 @@ enum class DeviceMode : uint8_t {
 #define DEVICE_MODE DeviceMode::INTERFACE
 #endif
 
+#ifndef RECEIVER_CAPABILITIES
+// Hardware a receiver announces during pairing (NODE_CAP_* bits); override per node via build flags
+#define RECEIVER_CAPABILITIES NODE_CAP_ALL
+#endif
+
+#ifndef RECEIVER_RELAY
+// 1 makes this receiver forward commands and acks for nodes out of the interface's reach
+#define RECEIVER_RELAY 0
+#endif
+
+#ifndef SQUAD_KEY
+// Passphrase shared by every costume in a squad; build each interface with the same value
+#define SQUAD_KEY "spartan-squad"
+#endif
+
+// What a receiver announces during pairing
+const uint8_t receiverCapabilities = RECEIVER_CAPABILITIES | (RECEIVER_RELAY ? NODE_CAP_RELAY : 0) |
+                                     (RECEIVER_HUD ? NODE_CAP_HUD : 0);
+
 const bool isInterface = DEVICE_MODE == DeviceMode::INTERFACE;
 const bool isInterfaceSetup = DEVICE_MODE == DeviceMode::INTERFACE_SETUP;
 const bool isReceiver = DEVICE_MODE == DeviceMode::RECEIVER;
@@ -32,14 +73,18 @@ const bool isReceiverSetup = DEVICE_MODE == DeviceMode::RECEIVER_SETUP;
 
 // --- Globals ---
 TFT_eSPI tft = TFT_eSPI();
-Adafruit_NeoPixel pixels(NUM_LEDS, LED_DATA, NEO_GRB + NEO_KHZ800);
-Adafruit_NeoPixel pixels2(NUM_LEDS, LED_DATA_2, NEO_GRB + NEO_KHZ800);
+// 8-bit copy of the screen saver the HUD mirror sends from (interface, while mirroring)
+TFT_eSprite hudCanvas = TFT_eSprite(&tft);
+bool hudMirroring = false;
+RmtLedOutput ledOutput;
 Adafruit_NeoPixel onboardLED(1, 48, NEO_GRB + NEO_KHZ800);
 OneButton buttonOne(BUTTON_1, true, true);
 OneButton buttonTwo(BUTTON_2, true, true);
 OneButton buttonThree(BUTTON_3, true, true);
+OneButton pairButton(RECEIVER_PAIR_BUTTON, true, true); // Receiver only
 
 Preferences preferences;
+EspNowTransport espNowTransport;
 
 std::unique_ptr<MenuController> menuController;
 
@@ -48,9 +93,10 @@ extern MenuItem mainMenuItems[];
 extern const int mainMenuItemCount;
 
 // Peer MAC addresses - loaded from Preferences after running setup firmware
-// These defaults are placeholders; run setup firmware to pair devices
+// These defaults are placeholders; run setup firmware to pair devices.
+// Receiver MACs live in receiverTable (communication.cpp).
 uint8_t sendAddress[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}; // Interface MAC (set by setup)
-uint8_t recvAddress[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}; // Receiver MAC (set by setup)
+uint8_t selfAddress[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}; // This device's MAC
 uint8_t broadcastAddress[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
 
 String macAddress; // This will hold the MAC address string
@@ -58,13 +104,159 @@ String macAddress; // This will hold the MAC address string
 // Receiver watchdog - tracks last message time to detect connection loss
 unsigned long lastMessageTime = 0;
 
+// Frames handed from the ESP-NOW callback (WiFi task) to the comms task
+RxQueue rxQueue;
+std::atomic<uint32_t> rxRejected{0};     // Frames from unknown senders
+std::atomic<uint32_t> rxCallbackMaxUs{0}; // Worst-case time spent in OnDataRecv
+unsigned long lastRxStatsTime = 0;
+
+// Onboard LED status blink - cleared by the comms task once the blink has elapsed
+unsigned long statusBlinkStart = 0;
+bool statusBlinkActive = false;
+
 // Interface heartbeat - tracks last time state was sent to receiver
 unsigned long lastHeartbeatTime = 0;
 
+// Uploaded effect program (receiver) - run by the VM in VisorMode::PROGRAM into the
+// compositor's per-pixel base
+EffectVm effectVm;
+uint16_t loadedProgramId = 0;
+uint16_t wantedProgramId = 0;
+unsigned long lastEffectFrameTime = 0;
+uint32_t programPixels[LED_CHAIN_LEN];
+
+// Visor and accent segments of the strips, from LED_SEGMENT_CONFIG (both sides; the
+// interface only needs the names)
+LedSegmentMap ledSegments;
+
+// LED frames (receiver) - composited every LED_FRAME_INTERVAL_US. The timing figures
+// cover the current RX stats interval.
+LedCompositor ledCompositor;
+SafetyShutdown safetyShutdown(ledCompositor);   // Warning after losing the interface
+int64_t nextLedFrameUs = 0;
+bool ledFrameForced = false;     // Render now rather than on the schedule
+bool ledFramePending = false;    // Rendered frame waiting for the strips to finish the last
+bool ledOutputUp = false;        // Both strips' RMT channels came up; nothing is shown otherwise
+uint32_t ledFramesRendered = 0;
+uint32_t ledFramesShown = 0;
+uint64_t ledBusyUs = 0;          // Spent rendering and showing
+uint64_t ledBlockedSumUs = 0;    // Spent handing frames to the strips
+uint32_t ledBlockedMaxUs = 0;
+uint64_t ledLatenessSumUs = 0;
+uint32_t ledLatenessMaxUs = 0;
+
+// Receiver telemetry - measured state reported back to the interface
+BoardTelemetrySensors boardSensors;
+uint8_t interfaceAddress[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}; // Sender of the last accepted command
+bool interfaceKnown = false;
+unsigned long lastTelemetryTime = 0;
+uint32_t ledFrameCount = 0; // Strip updates since the last report
+bool safeStateActive = false;
+bool programFaulted = false;
+
+// Receiver fans - the thermal control and the PWM driving them
+FanController fanController;
+LedcFanOutput fanOutput;
+SafetyWatchdog safetyWatchdog;  // Enforces RECEIVER_TIMEOUT_MS even if the tasks hang
+unsigned long lastFanUpdateTime = 0;
+
+// Radio profile currently applied to this node's radio
+RadioProfile appliedRadioProfile = RadioProfile::LOW_LATENCY;
+
+// Radio sleep - what receivers were last told (interface), what the interface asked for
+// (receiver), whether this node's radio is down, and the heartbeat period last served
+bool receiverSleepApplied = false;
+bool sleepCommanded = false;
+bool radioAsleep = false;
+int64_t heartbeatPeriod = -1;
+
+// Power estimate for this node, the transport counters already charged to it, and the
+// average over the last RX stats interval (0 until the first one ends)
+PowerModel powerModel;
+PowerBudget powerBudget;    // Receiver: holds the LEDs and fans to POWER_BUDGET_MA
+uint32_t chargedFrames = 0;
+uint32_t chargedBytes = 0;
+float averageCurrentMa = 0;
+
+// Emergency stop - chord timing and latch (interface); the stop copies the receive callback
+// took, and the one applied with when its fans went off (receiver)
+int64_t stopChordStartUs = 0;
+bool stopChordLatched = false;
+RxQueue stopQueue;      // Kept apart from rxQueue so a stop goes ahead of anything queued
+void cutFansForStop();
+int64_t stopClockUs() { return esp_timer_get_time(); }
+StopPath stopPath(cutFansForStop, stopClockUs);
+uint16_t appliedStopId = 0;
+int64_t emergencyStopUs = 0;
+bool emergencyStopped = false;
+
+// Scene last cued to the squad while leading it
+SquadScene lastCuedScene = {};
+
+// Menu change batching - one radio update and one NVS save per burst of changes
+ChangeBatcher stateBatch(STATE_COALESCE_MS, STATE_FLUSH_MAX_MS);
+ChangeBatcher saveBatch(SAVE_COALESCE_MS, SAVE_FLUSH_MAX_MS);
+
+// Receiver channel hunt - contact with the interface, and probe acks from the WiFi task
+std::atomic<bool> channelProbeAcked{false};
+unsigned long lastContactTime = 0;
+bool hadContact = false;
+
+// Runtime pairing screen (interface) - redrawn when the count changes and once a second
+bool pairingScreenShown = false;
+unsigned long lastPairingDraw = 0;
+uint8_t pairingDrawnCount = 0;
+
+// Receiver firmware update - image served from flash (interface), update slot and
+// reboot once the new image is verified (receiver)
+PartitionImageSource receiverImage;
+bool updateScreenShown = false;
+unsigned long lastUpdateDraw = 0;
+bool noticeShown = false;           // Why an update couldn't start, in place of the menu
+unsigned long noticeTime = 0;
+OtaPartitionSink otaSink;
+OtaReceiver otaReceiver(otaSink);
+#if RECEIVER_HUD
+St7789HudDisplay hudDisplay;
+HudDecoder hudDecoder;
+#endif
+unsigned long otaRestartTime = 0;
+
+// Receiver setup firmware - MAC announcement schedule
+unsigned long lastSetupAnnounceTime = 0;
+
 // Screen saver - tracks last interaction time and active state
 unsigned long lastInteractionTime = 0;
 bool screenSaverActive = false;
 
+// Tasks (interface and receiver) - input and comms on one core, the screen or the LEDs
+// and fans on the other. stateLock guards everything they share: appState, the menu,
+// the radio protocol state and the LED pipeline. Clicks reach the render task as UiEvents.
+enum class UiEvent : uint8_t {
+  NEXT,
+  PREVIOUS,
+  SELECT,
+  PAIR,   // Next + Previous held
+  WAKE,   // Back to the menu after an emergency stop
+};
+SemaphoreHandle_t stateLock = nullptr;
+QueueHandle_t uiEvents = nullptr;
+TaskHandle_t commsTask = nullptr;
+TaskHandle_t renderTask = nullptr;
+TaskHandle_t ledTask = nullptr;
+TaskHandle_t stopTask = nullptr;
+esp_timer_handle_t ledWakeTimer = nullptr;  // Wakes the LED task when its next frame is due
+TaskLoad commsLoad;
+TaskLoad renderLoad;
+TaskLoad ledLoad;
+bool pairChordSent = false;
+
+// Holds stateLock for a scope
+struct StateGuard {
+  StateGuard() { xSemaphoreTake(stateLock, portMAX_DELAY); }
+  ~StateGuard() { xSemaphoreGive(stateLock); }
+};
+
 // --- Forward Declarations ---
 void handleNext();
 void handlePrevious();
@@ -74,22 +266,75 @@ void setupReceiver();
 void setupInterfaceSetup();
 void setupReceiverSetup();
 void setupEspComms();
-void OnDataSent(const uint8_t *mac_addr, esp_now_send_status_t status);
-void OnDataRecv(const uint8_t * mac, const uint8_t *incomingData, int len);
+void setupTasks();
+void runCommsTask(void* arg);
+void runStopTask(void* arg);
+void runRenderTask(void* arg);
+void runLedTask(void* arg);
+int64_t serviceComms();
+bool serviceScreen();
+void postUiEvent(UiEvent event);
+void handleUiEvent(UiEvent event);
+void reportTasks();
+void OnDataSent(const uint8_t *mac_addr, bool delivered);
+void OnDataRecv(const uint8_t *mac, const uint8_t *incomingData, int len, int8_t rssi);
+bool isAllowedSender(const uint8_t *mac, const uint8_t *data, int len);
+bool receiverPairingOpen();
+void openReceiverPairing();
+void startPairingMode();
+void applySquadRole();
+SquadScene currentSquadScene();
+void applySquadScene(const SquadScene& scene);
+void serviceReceiverChannel();
+void noteInterfaceContact();
+void renderPairingScreen();
+void startReceiverUpdateMode();
+void renderUpdateScreen();
+void processIncomingFrames();
+void handleIncomingFrame(const RxFrame& frame);
+void startStatusBlink();
+void updateStatusBlink();
+void reportRxStats();
 void updateHardwareState(const CommandPayload& payload);
 void saveAppState();
+void markStateChanged(bool notifyReceivers);
+void flushStateChanges();
 void loadAppState();
 void parseMacAddress(const char* macStr, uint8_t* macBytes);
 void savePeerAddresses();
 bool loadPeerAddresses();
 void updateMenuFromState(); // Defined in menu_system.cpp
-void pulseLeds();
-void flashLeds();
-void strobeLeds();
+void serviceLeds();
+void serviceFans();
+void forceLedFrame();
+int64_t fanIdleUs();
+int64_t ledIdleUs();
+void renderEffectProgram();
+void pushLedFrame();
+void flushLedFrame();
+void showBlankLeds();
+void reportLedStats();
+TelemetrySnapshot readTelemetry(TelemetrySensors& sensors);
+void reportTelemetry();
+bool serviceStopChord();
+void triggerEmergencyStop(int64_t pressedUs);
+void applyEmergencyStop(const EmergencyStop& stop, uint16_t seq, const uint8_t* mac, int64_t fansOffUs,
+                        const uint8_t* via);
+int64_t serviceRadioSleep();
+void lightSleepUntil(int64_t wakeUs);
+bool receiverMaySleep();
+void reportPower();
+void saveEffectProgram();
+void loadEffectProgram();
 uint32_t getVisorColorValue(VisorColor color);
+VisorMode knownVisorMode(VisorMode mode);
+bool lightsOn(const AppState& state);
+void lightsOff();
+void setLedSegment(uint8_t segment, bool on, VisorMode mode, VisorColor color, uint8_t brightness);
 void resetToSafeState();
 void initScreenSaver();
 void renderScreenSaver();
+void presentHudCanvas();
 void resetIdleTimer();
 void exitScreenSaver();
 
@@ -104,10 +349,10 @@ void setupInterface() {
     // Initialize the menu system
     menuController = std::make_unique<MenuController>(mainMenuItems, mainMenuItemCount, tft);
 
-    // Attach button handlers
-    buttonOne.attachClick(handleNext);
-    buttonTwo.attachClick(handleSelect);
-    buttonThree.attachClick(handlePrevious);
+    // Attach button handlers - the comms task samples the buttons, the render task acts on them
+    buttonOne.attachClick([] { postUiEvent(UiEvent::NEXT); });
+    buttonTwo.attachClick([] { postUiEvent(UiEvent::SELECT); });
+    buttonThree.attachClick([] { postUiEvent(UiEvent::PREVIOUS); });
 
     // Initialize idle timer for screen saver
     resetIdleTimer();
@@ -116,19 +361,25 @@ void setupInterface() {
 void setupReceiver() {
   Serial.println("Setting up receiver");
 
-  pixels.begin();
-  pixels.clear();
-  pixels.show();
-
-  pixels2.begin();
-  pixels2.clear();
-  pixels2.show();
+  ledCompositor.setSegmentMap(&ledSegments);
+  ledCompositor.setBasePixels(programPixels);
+  ledCompositor.setPowerBudget(&powerBudget);
+  ledOutputUp = ledOutput.begin();
+  if (!ledOutputUp) {
+    Serial.println("LED output failed to start, the strips stay dark");
+  }
 
   onboardLED.begin();
   onboardLED.clear();
   onboardLED.show();
 
-  pinMode(FAN_1_CTRL, OUTPUT);
+  fanOutput.begin();
+  safetyWatchdog.begin(fanOutput);
+  pairButton.setPressMs(PAIR_BUTTON_HOLD_MS);
+  pairButton.attachLongPressStart(openReceiverPairing);
+#if RECEIVER_HUD
+  hudDisplay.begin();
+#endif
   delay(100); // Allow pins to settle
 }
 
@@ -145,28 +396,21 @@ void setupInterfaceSetup() {
   tft.setCursor(0, 20);
   tft.print(WiFi.macAddress());
 
-  if (esp_now_init() != ESP_OK) {
-    Serial.println("Error initializing ESP-NOW");
+  if (!espNowTransport.begin()) {
     return;
   }
-  esp_now_register_recv_cb(esp_now_recv_cb_t(OnDataRecv));
+  espNowTransport.onReceive(OnDataRecv);
 }
 
 void setupReceiverSetup() {
   Serial.println("Setting up receiver setup");
 
-  if (esp_now_init() != ESP_OK) {
-    Serial.println("Error initializing ESP-NOW");
+  if (!espNowTransport.begin()) {
     return;
   }
-  esp_now_register_send_cb(esp_now_send_cb_t(OnDataSent));
-
-  esp_now_peer_info_t peerInfo = {};
-  memcpy(peerInfo.peer_addr, broadcastAddress, 6);
-  peerInfo.channel = 0;  
-  peerInfo.encrypt = false;
-  
-  if (esp_now_add_peer(&peerInfo) != ESP_OK) {
+  espNowTransport.onSendStatus(OnDataSent);
+
+  if (!espNowTransport.addPeer(broadcastAddress)) {
     Serial.println("Failed to add peer");
     return;
   }
@@ -178,7 +422,7 @@ void setupEspComms() {
 
   if (!hasAddresses) {
     Serial.println("WARNING: No peer addresses configured!");
-    Serial.println("Run the setup firmware to pair devices.");
+    Serial.println("Pair from SETTINGS > Pair Receivers.");
 
     if (isInterface) {
       // Show warning on display
@@ -188,9 +432,9 @@ void setupEspComms() {
       tft.setCursor(10, 60);
       tft.print("No peer configured!");
       tft.setCursor(10, 90);
-      tft.print("Run setup firmware");
+      tft.print("Pair from SETTINGS");
       tft.setCursor(10, 110);
-      tft.print("to pair devices.");
+      tft.print("> Pair Receivers");
       tft.setTextColor(TFT_WHITE);
       delay(3000);
     }
@@ -198,31 +442,32 @@ void setupEspComms() {
 
   // Init ESP-NOW
   Serial.println("Initializing ESP-NOW");
-  if (esp_now_init() != ESP_OK) {
-    Serial.println("Error initializing ESP-NOW");
+  if (!espNowTransport.begin()) {
     return;
   }
+  attachTransport(espNowTransport);
+  useRadioProfile(appState.radioProfile);
+  appliedRadioProfile = appState.radioProfile;
 
   // Register callbacks
   Serial.println("Registering callbacks");
-  esp_now_register_send_cb(esp_now_send_cb_t(OnDataSent));
-  esp_now_register_recv_cb(esp_now_recv_cb_t(OnDataRecv));
+  espNowTransport.onSendStatus(OnDataSent);
+  espNowTransport.onReceive(OnDataRecv);
+
+  // Register peer - Interface broadcasts to all receivers, Receiver acks to Interface.
+  // A receiver without a saved interface MAC registers it on the first ack instead.
+  if (isInterface || hasAddresses) {
+    Serial.println("Adding peer");
+    if (!espNowTransport.addPeer(isInterface ? broadcastAddress : sendAddress)) {
+      Serial.println("Failed to add peer");
+      return;
+    }
+  }
 
-  // Register peer - Interface sends to Receiver, Receiver sends to Interface
-  Serial.println("Registering peer");
-  esp_now_peer_info_t peerInfo = {};
+  // Receivers find the interface's channel themselves (serviceReceiverChannel)
   if (isInterface) {
-    memcpy(peerInfo.peer_addr, recvAddress, 6);
-  } else {
-    memcpy(peerInfo.peer_addr, sendAddress, 6);
-  }
-  peerInfo.channel = 0;  
-  peerInfo.encrypt = false;
-  
-  Serial.println("Adding peer");
-  if (esp_now_add_peer(&peerInfo) != ESP_OK) {
-    Serial.println("Failed to add peer");
-    return;
+    selectChannel();
+    applySquadRole();
   }
 
   Serial.print("Awaiting messages at ");
@@ -234,6 +479,10 @@ void setup() {
     delay(1000);
     Serial.println("Starting SpartanOS...");
 
+    if (!ledSegments.load(LED_SEGMENT_CONFIG)) {
+        Serial.println("Bad LED_SEGMENT_CONFIG, driving every LED as the visor");
+    }
+    loadAccentMenu(ledSegments);
     loadAppState();
     updateMenuFromState();
 
@@ -242,6 +491,7 @@ void setup() {
     delay(100);
 
     macAddress = WiFi.macAddress();
+    parseMacAddress(macAddress.c_str(), selfAddress);
 
     if (isInterfaceSetup) {
       setupInterfaceSetup();
@@ -258,6 +508,7 @@ void setup() {
 
     if (isReceiver) {
       setupReceiver();
+      loadEffectProgram();
     }
     
     if (isInterface || isReceiver) {
@@ -266,72 +517,360 @@ void setup() {
     
     // Send the initial state to the receiver on boot
     sendStateUpdate();
+
+    if (isInterface || isReceiver) {
+      setupTasks();
+    }
 }
 
 void loop() {
+    // The interface and receiver run from their own tasks (setupTasks)
+    if (isInterface || isReceiver) {
+      vTaskDelete(nullptr);
+    }
+
     if (isReceiverSetup) {
       SetupPayload setupPayload;
       strncpy(setupPayload.macAddress, WiFi.macAddress().c_str(), sizeof(setupPayload.macAddress) - 1);
       setupPayload.macAddress[sizeof(setupPayload.macAddress) - 1] = '\0';
-      esp_now_send(broadcastAddress, (uint8_t *) &setupPayload, sizeof(setupPayload));
-      Serial.println("Sent MAC address");
-      delay(2000);
+      setupPayload.capabilities = receiverCapabilities;
+      if (millis() - lastSetupAnnounceTime >= 2000) {
+        lastSetupAnnounceTime = millis();
+        espNowTransport.send(broadcastAddress, (uint8_t *) &setupPayload, sizeof(setupPayload));
+        Serial.println("Sent MAC address");
+      }
       return;
     }
 
     if (isInterfaceSetup) {
       // Keep alive to receive messages
+      processIncomingFrames();
       delay(100);
       return;
     }
+}
+
+// --- Tasks ---
 
-    buttonOne.tick();
-    buttonTwo.tick();
-    buttonThree.tick();
+// Starts `run` pinned to `core`. Stack sizes are in bytes, as ESP-IDF counts them.
+bool startTask(void (*run)(void*), const char* name, uint32_t stackBytes, UBaseType_t priority,
+               BaseType_t core, TaskHandle_t* handle) {
+    if (xTaskCreatePinnedToCore(run, name, stackBytes, nullptr, priority, handle, core) != pdPASS) {
+        Serial.printf("Error creating the %s task\n", name);
+        return false;
+    }
+    return true;
+}
 
-    // Screen saver logic (interface only)
+// Runs from esp_timer when the LED task's next frame or fan step falls due
+void wakeLedTask(void* arg) {
+    xTaskNotifyGive(ledTask);
+}
+
+// Splits the interface and receiver over both cores: input and the radio next to the
+// WiFi stack, the screen or the LEDs and fans on the other core, so a slow screen saver
+// frame can't hold up a button and radio traffic can't hold up an LED frame. loop() ends
+// once they are running.
+void setupTasks() {
+    stateLock = xSemaphoreCreateMutex();
     if (isInterface) {
-        if (!screenSaverActive && (millis() - lastInteractionTime >= SCREENSAVER_TIMEOUT_MS)) {
-            screenSaverActive = true;
-            initScreenSaver();
+        uiEvents = xQueueCreate(UI_EVENT_QUEUE_LEN, sizeof(UiEvent));
+        startTask(runRenderTask, "render", RENDER_TASK_STACK, RENDER_TASK_PRIORITY, RENDER_TASK_CORE, &renderTask);
+    }
+    if (isReceiver) {
+        // Before anything that could hear a stop
+        startTask(runStopTask, "stop", STOP_TASK_STACK, STOP_TASK_PRIORITY, STOP_TASK_CORE, &stopTask);
+        esp_timer_create_args_t args = {};
+        args.callback = wakeLedTask;
+        args.dispatch_method = ESP_TIMER_TASK;
+        args.name = "ledWake";
+        if (esp_timer_create(&args, &ledWakeTimer) != ESP_OK) {
+            Serial.println("Error creating the LED wake timer, waking the LED task every tick");
+            ledWakeTimer = nullptr;
+        }
+        startTask(runLedTask, "leds", LED_TASK_STACK, LED_TASK_PRIORITY, LED_TASK_CORE, &ledTask);
+    }
+    // Last, so everything the receive callback wakes it for is in place
+    startTask(runCommsTask, "comms", COMMS_TASK_STACK, COMMS_TASK_PRIORITY, COMMS_TASK_CORE, &commsTask);
+}
+
+// Input and radio: woken by each accepted frame, and at least every COMMS_POLL_MS to
+// sample the buttons and run the timers
+void runCommsTask(void* arg) {
+    if (isReceiver) {
+        safetyWatchdog.supervise();
+    }
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(COMMS_POLL_MS));
+        int64_t sleepUntilUs;
+        {
+            StateGuard guard;
+            int64_t start = esp_timer_get_time();
+            sleepUntilUs = serviceComms();
+            commsLoad.add(esp_timer_get_time() - start);
+        }
+        if (sleepUntilUs > 0) {
+            lightSleepUntil(sleepUntilUs);
+        }
+        if (isInterface) {
+            // A channel survey listens one channel per pass, with the lock let go so the
+            // screen carries on and the stop chord is sampled between channels
+            serviceChannelSurvey();
+        }
+        if (isReceiver) {
+            safetyWatchdog.checkIn();
         }
+    }
+}
 
-        if (screenSaverActive) {
+// Interface screen: acts on button events as they come and draws a frame every
+// RENDER_INTERVAL_MS. Screen saver frames draw without stateLock, so however long one
+// takes, comms carries on; the telemetry readout is all they share, a field at a time.
+void runRenderTask(void* arg) {
+    for (;;) {
+        UiEvent event;
+        bool received = xQueueReceive(uiEvents, &event, pdMS_TO_TICKS(RENDER_INTERVAL_MS)) == pdTRUE;
+        bool saverDue;
+        {
+            StateGuard guard;
+            int64_t start = esp_timer_get_time();
+            for (; received; received = xQueueReceive(uiEvents, &event, 0) == pdTRUE) {
+                handleUiEvent(event);
+            }
+            saverDue = serviceScreen();
+            renderLoad.add(esp_timer_get_time() - start);
+        }
+        if (saverDue) {
+            int64_t start = esp_timer_get_time();
             renderScreenSaver();
-        } else if (menuController) {
-            menuController->render();
+            renderLoad.add(esp_timer_get_time() - start);
         }
     }
+}
+
+// Receiver LEDs and fans: renders each frame on schedule whatever the radio is doing.
+// Sleeps until the next frame or fan step falls due, or comms forces a frame.
+void runLedTask(void* arg) {
+    safetyWatchdog.supervise();
+    for (;;) {
+        int64_t waitUs;
+        {
+            StateGuard guard;
+            int64_t start = esp_timer_get_time();
+            serviceFans();
+            serviceLeds();
+            waitUs = min(ledIdleUs(), fanIdleUs());
+            ledLoad.add(esp_timer_get_time() - start);
+        }
+        safetyWatchdog.checkIn();
+
+        // The timer wakes it to the microsecond; a frame waiting on the strips is retried
+        // every tick. The timeout only backs the timer up.
+        bool timed = waitUs > 0 && ledWakeTimer;
+        if (timed) {
+            esp_timer_stop(ledWakeTimer);
+            esp_timer_start_once(ledWakeTimer, waitUs);
+        }
+        ulTaskNotifyTake(pdTRUE, timed ? pdMS_TO_TICKS(FAN_UPDATE_INTERVAL_MS) : 1);
+    }
+}
+
+// Receiver emergency stop: woken by the receive callback, cuts the fans without waiting
+// for stateLock, then wakes comms to do the rest under the lock
+void runStopTask(void* arg) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        stopPath.service();
+        xTaskNotifyGive(commsTask);
+    }
+}
+
+void cutFansForStop() {
+    fanOutput.halt(FAN_HALT_EMERGENCY_STOP);
+}
+
+// One pass of input and radio work, under stateLock. Returns the esp_timer time a
+// receiver's CPU may light-sleep until once the lock is let go, or 0 to stay up.
+int64_t serviceComms() {
+    // An emergency stop the receive callback took goes ahead of everything else. One ack
+    // answers however many copies of the burst came in since the last pass.
+    RxFrame heardStop{};
+    bool stopHeard = false;
+    while (isReceiver && stopQueue.pop(heardStop)) {
+        stopHeard = true;
+    }
+    EmergencyStop stop;
+    FrameHeader stopHeader;
+    if (stopHeard && decodeEmergencyStop(heardStop.data, heardStop.len, stop) &&
+        decodeHeader(heardStop.data, heardStop.len, stopHeader)) {
+        // The stop task has normally cut the fans already
+        int64_t fansOffUs = stopPath.cutUs() >= heardStop.rxUs ? stopPath.cutUs() : esp_timer_get_time();
+        applyEmergencyStop(stop, stopHeader.seq, heardStop.mac, fansOffUs, nullptr);
+    }
+
+    if (isInterface) {
+        // Holding all three buttons is the emergency stop, from any screen. The buttons
+        // don't reach the menu again until they have all been let go.
+        bool chordHeld = serviceStopChord();
+        serviceEmergencyStop();
+        if (!chordHeld) {
+            buttonOne.tick();
+            buttonTwo.tick();
+            buttonThree.tick();
+        }
+
+        // Holding Next + Previous together opens pairing from any screen, once per hold
+        bool pairChord = buttonOne.isLongPressed() && buttonThree.isLongPressed();
+        if (pairChord && !pairChordSent && !pairingActive()) {
+            postUiEvent(UiEvent::PAIR);
+        }
+        pairChordSent = pairChord;
+        servicePairing();
+    }
+
+    if (isReceiver) {
+        pairButton.tick();
+    }
 
-    // Interface heartbeat - periodically send state to keep receiver's watchdog happy
+    // Radio up or down for the wake schedule before anything is sent
+    int64_t sleepUntilUs = serviceRadioSleep();
+
+    // Send and save whatever the menu changed once the burst settles
     if (isInterface) {
-        if (millis() - lastHeartbeatTime >= HEARTBEAT_INTERVAL_MS) {
+        flushStateChanges();
+    }
+
+    // Interface heartbeat - periodically send state to keep receiver's watchdog happy.
+    // While receivers may be asleep it goes out as each wake window opens instead.
+    if (isInterface) {
+        int64_t shared = sharedTimeUs();
+        if (receiversAsleep()) {
+            if (dutyCycle.phase(shared) == DutyCycle::Phase::WINDOW && dutyCycle.period(shared) != heartbeatPeriod) {
+                heartbeatPeriod = dutyCycle.period(shared);
+                lastHeartbeatTime = millis();
+                sendStateUpdate();
+            }
+        } else if (millis() - lastHeartbeatTime >= HEARTBEAT_INTERVAL_MS) {
             lastHeartbeatTime = millis();
             sendStateUpdate();
         }
     }
 
-    // Receiver watchdog - reset to safe state if no messages received
-    if (isReceiver && lastMessageTime > 0) {
-        if (millis() - lastMessageTime > RECEIVER_TIMEOUT_MS) {
-            if (appState.visorOn || appState.thermalsOn) {
-                resetToSafeState();
+    // Apply everything the ESP-NOW callback queued since the last pass
+    processIncomingFrames();
+    reportRxStats();
+    if (isReceiver) {
+        updateStatusBlink();
+        reportTelemetry();
+    }
+
+    // Retry state updates that some receivers haven't acknowledged
+    if (isInterface) {
+        SquadScene cued;
+        if (serviceSquad(cued)) {
+            applySquadScene(cued);
+        }
+        serviceStateAcks();
+        serviceChannelMigration();
+        serviceTxPower();
+        serviceReceiverUpdate();
+        serviceHudMirror();
+    }
+    if (isReceiver) {
+        serviceReceiverChannel();
+        serviceRelay();
+
+        // Reboot into a verified update once the interface has had its answer
+        if (otaRestartTime > 0 && millis() >= otaRestartTime) {
+            Serial.println("Restarting into the updated firmware");
+            resetToSafeState();
+            showBlankLeds();
+            ESP.restart();
+        }
+    }
+
+    // Receiver watchdog - its timer has already cut the fans; bring the rest to the safe state
+    if (isReceiver && safetyWatchdog.takeExpired()) {
+        if (lightsOn(appState) || appState.thermalsMode != ThermalsMode::OFF) {
+            resetToSafeState();
+        }
+    }
+    return sleepUntilUs;
+}
+
+// Brings the interface screen up to date, under stateLock. Returns true when a screen
+// saver frame is due, for the caller to draw once it has let go.
+bool serviceScreen() {
+    if (!screenSaverActive && !pairingActive() && !receiverUpdateActive() &&
+        (millis() - lastInteractionTime >= SCREENSAVER_TIMEOUT_MS)) {
+        screenSaverActive = true;
+        initScreenSaver();
+    }
+
+    if (pairingActive()) {
+        renderPairingScreen();
+    } else if (receiverUpdateActive()) {
+        renderUpdateScreen();
+    } else if (pairingScreenShown || updateScreenShown) {
+        // Pairing closed (finished or timed out) - back to the menu
+        pairingScreenShown = false;
+        updateScreenShown = false;
+        resetIdleTimer();
+        if (menuController) {
+            menuController->forceRedraw();
+        }
+    } else if (noticeShown) {
+        if (millis() - noticeTime >= 2000) {
+            noticeShown = false;
+            if (menuController) {
+                menuController->forceRedraw();
             }
         }
+    } else if (screenSaverActive) {
+        return true;
+    } else if (menuController) {
+        menuController->render();
     }
+    return false;
+}
 
-    if (isReceiver && appState.visorOn && appState.visorMode == VisorMode::PULSING) {
-        pulseLeds();
-    } else if (isReceiver && appState.visorOn && appState.visorMode == VisorMode::FLASHING) {
-        flashLeds();
-    } else if (isReceiver && appState.visorOn && appState.visorMode == VisorMode::STROBE) {
-        strobeLeds();
+// Hands a button event to the render task; dropped if it is that far behind
+void postUiEvent(UiEvent event) {
+    xQueueSend(uiEvents, &event, 0);
+}
+
+void handleUiEvent(UiEvent event) {
+    switch (event) {
+        case UiEvent::NEXT:
+            handleNext();
+            break;
+        case UiEvent::PREVIOUS:
+            handlePrevious();
+            break;
+        case UiEvent::SELECT:
+            handleSelect();
+            break;
+        case UiEvent::PAIR:
+            if (!pairingActive()) {
+                startPairingMode();
+            }
+            break;
+        case UiEvent::WAKE:
+            exitScreenSaver();
+            resetIdleTimer();
+            if (menuController) {
+                menuController->forceRedraw();
+            }
+            break;
     }
 }
 
 // --- Button Handlers ---
 void handleNext() {
     resetIdleTimer();
+    if (pairingActive() || receiverUpdateActive()) {
+        return;
+    }
     if (screenSaverActive) {
         exitScreenSaver();
         return;
@@ -343,6 +882,9 @@ void handleNext() {
 
 void handlePrevious() {
     resetIdleTimer();
+    if (pairingActive() || receiverUpdateActive()) {
+        return;
+    }
     if (screenSaverActive) {
         exitScreenSaver();
         return;
@@ -354,6 +896,14 @@ void handlePrevious() {
 
 void handleSelect() {
     resetIdleTimer();
+    if (pairingActive()) {
+        stopPairing(); // Select finishes pairing early
+        return;
+    }
+    if (receiverUpdateActive()) {
+        stopReceiverUpdate(); // Select abandons the update; receivers keep what they have for a retry
+        return;
+    }
     if (screenSaverActive) {
         exitScreenSaver();
         return;
@@ -364,59 +914,295 @@ void handleSelect() {
 }
 
 // Callback when data is sent
-void OnDataSent(const uint8_t *mac_addr, esp_now_send_status_t status) {
-  Serial.print("\r\nLast Packet Send Status:\t");
-  Serial.println(status == ESP_NOW_SEND_SUCCESS ? "Delivery Success" : "Delivery Fail");
+void OnDataSent(const uint8_t *mac_addr, bool delivered) {
+  if (isInterface) {
+    noteUpdateSendStatus(mac_addr, delivered);
+    noteHudSendStatus(mac_addr, delivered);
+  }
+  // Printing every status would throttle an update or the HUD mirror to the speed of the serial port
+  if (!receiverUpdateActive() && !hudMirrorActive()) {
+    Serial.print("\r\nLast Packet Send Status:\t");
+    Serial.println(delivered ? "Delivery Success" : "Delivery Fail");
+  }
+
+  // Any unicast the interface acked proves we share its channel
+  if (isReceiver && delivered && memcmp(mac_addr, sendAddress, 6) == 0) {
+    channelProbeAcked = true;
+  }
 }
 
 // Callback when data is received
-void OnDataRecv(const uint8_t * mac, const uint8_t *incomingData, int len) {
+// Runs in the WiFi task: only filter and copy the frame, all handling happens in the comms task
+void OnDataRecv(const uint8_t *mac, const uint8_t *incomingData, int len, int8_t rssi) {
+  int64_t arrival = esp_timer_get_time();
+  unsigned long start = micros();
+
+  EmergencyStop stop;
+  if (isAllowedSender(mac, incomingData, len)) {
+    // Handled now rather than at the next poll
+    TaskHandle_t handler = commsTask;
+    if (isReceiver && decodeEmergencyStop(incomingData, len, stop)) {
+      // Fans held off from here on, so the LED task can't drive them again. The stop
+      // task cuts them as soon as this returns and then wakes comms for the rest.
+      fanOutput.hold(FAN_HALT_EMERGENCY_STOP);
+      stopQueue.push(mac, incomingData, len, arrival, rssi);
+      stopPath.heard();
+      if (stopTask) {
+        handler = stopTask;
+      }
+    } else {
+      rxQueue.push(mac, incomingData, len, arrival, rssi);
+    }
+    if (handler) {
+      xTaskNotifyGive(handler);
+    }
+  } else {
+    rxRejected.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  uint32_t elapsed = micros() - start;
+  uint32_t worst = rxCallbackMaxUs.load(std::memory_order_relaxed);
+  while (elapsed > worst && !rxCallbackMaxUs.compare_exchange_weak(worst, elapsed, std::memory_order_relaxed)) {
+  }
+}
+
+// The receiver only accepts commands from its paired interface.
+// Until a pairing exists (all-zero address) every sender is accepted, and
+// pairing traffic from any interface is let through while pairing is open.
+// Relayed frames may come from any node; their origin is checked once unwrapped.
+bool isAllowedSender(const uint8_t *mac, const uint8_t *data, int len) {
+  if (!isReceiver) {
+    return true;
+  }
+  static const uint8_t unpaired[6] = {0};
+  if (memcmp(sendAddress, unpaired, 6) == 0) {
+    return true;
+  }
+  if (len >= (int)sizeof(FrameHeader) && receiverPairingOpen()) {
+    MessageType type = (MessageType)data[1];
+    if (type == MessageType::PAIR_BEACON || type == MessageType::PAIR_CONFIRM) {
+      return true;
+    }
+  }
+  if (len >= (int)sizeof(FrameHeader) && (MessageType)data[1] == MessageType::RELAY) {
+    return true;
+  }
+  return memcmp(mac, sendAddress, 6) == 0;
+}
+
+// When the pair button was last held, 0 if pairing hasn't been opened since power-on
+uint32_t receiverPairingOpenedAt = 0;
+
+// A receiver can be paired by any interface while unpaired, or for a while after its pair
+// button is held. A reboot alone doesn't open it, so nobody else can take it over then.
+bool receiverPairingOpen() {
+  static const uint8_t unpaired[6] = {0};
+  if (memcmp(sendAddress, unpaired, 6) == 0) {
+    return true;
+  }
+  return receiverPairingOpenedAt != 0 && millis() - receiverPairingOpenedAt < PAIR_RECEIVER_WINDOW_MS;
+}
+
+void openReceiverPairing() {
+  receiverPairingOpenedAt = millis() | 1;
+  Serial.println("Pair button held: answering any interface's pairing beacon");
+}
+
+// Drains the receive queue from the comms task
+void processIncomingFrames() {
+  RxFrame frame{};
+  while (rxQueue.pop(frame)) {
+    dutyCycle.noteTraffic(sharedTimeUs());
+    handleIncomingFrame(frame);
+  }
+}
+
+void handleIncomingFrame(const RxFrame& frame) {
+  int len = frame.len;
+  FrameHeader header;
   if (isReceiver) {
-    if (len == sizeof(CommandPayload)) {
-      CommandPayload payload;
-      memcpy(&payload, incomingData, sizeof(CommandPayload));
-      Serial.print("Bytes received (CommandPayload): ");
+    CommandPayload payload;
+    if (!decodeHeader(frame.data, len, header)) {
+      Serial.print("Received unexpected frame for receiver, bytes: ");
       Serial.println(len);
-      // Process CommandPayload
+      return;
+    }
+    noteInterfaceContact();
+
+    if (header.type == MessageType::RELAY) {
+      RxFrame inner{};
+      if (handleRelayFrame(frame, selfAddress, sendAddress, RECEIVER_RELAY, inner)) {
+        handleIncomingFrame(inner);
+      }
+    } else if (header.type == MessageType::OTA_OFFER || header.type == MessageType::OTA_CHUNK) {
+      // Firmware is only taken straight from the paired interface - an unpaired node refuses it
+      if (frame.hops == 0 && memcmp(frame.mac, sendAddress, 6) == 0) {
+        handleOtaFrame(frame, otaReceiver);
+        if (otaReceiver.complete() && otaRestartTime == 0) {
+          otaRestartTime = millis() + OTA_RESTART_DELAY_MS;
+        }
+      }
+    } else if (header.type == MessageType::HUD_TILES) {
+#if RECEIVER_HUD
+      if (frame.hops == 0 && memcmp(frame.mac, sendAddress, 6) == 0) {
+        hudDecoder.apply(frame.data, frame.len, hudDisplay);
+      }
+#endif
+    } else if (header.type == MessageType::EMERGENCY_STOP) {
+      // A copy that came through a relay; direct ones are taken in OnDataRecv
+      EmergencyStop stop;
+      if (decodeEmergencyStop(frame.data, len, stop)) {
+        applyEmergencyStop(stop, header.seq, frame.mac, esp_timer_get_time(), frame.hops > 0 ? frame.via : nullptr);
+      }
+    } else if (header.type == MessageType::CHANNEL_SWITCH) {
+      handleChannelSwitch(frame);
+    } else if (header.type == MessageType::TIME_SYNC) {
+      handleTimeSync(frame, selfAddress);
+    } else if (header.type == MessageType::PAIR_BEACON) {
+      // Our own interface may always pair us again, e.g. to pick up changed capabilities
+      if (receiverPairingOpen() || memcmp(frame.mac, sendAddress, 6) == 0) {
+        answerPairBeacon(frame, receiverCapabilities);
+      }
+    } else if (header.type == MessageType::PAIR_CONFIRM) {
+      if (handlePairConfirm(frame, selfAddress)) {
+        // Commands are only accepted from this interface from now on
+        memcpy(sendAddress, frame.mac, 6);
+        savePeerAddresses();
+        receiverPairingOpenedAt = 0;
+        Serial.printf("Paired with interface %02X:%02X:%02X:%02X:%02X:%02X\n",
+                      frame.mac[0], frame.mac[1], frame.mac[2], frame.mac[3], frame.mac[4], frame.mac[5]);
+      }
+    } else if (header.type == MessageType::PROGRAM_CHUNK) {
+      if (handleProgramChunk(frame, wantedProgramId, effectVm)) {
+        loadedProgramId = wantedProgramId;
+        saveEffectProgram();
+        Serial.printf("Loaded effect program %04X (%u bytes)\n", loadedProgramId, effectVm.programLength());
+      }
+    } else if (header.type == MessageType::STATE_UPDATE &&
+               findNodeCommand(frame.data, len, selfAddress, payload)) {
+      // Sent before an emergency stop - the interface follows the stop with the stopped state
+      if (frame.rxUs < emergencyStopUs) {
+        return;
+      }
+
+      // The interface is back - its command replaces the warning from the next frame
+      if (safetyShutdown.active()) {
+        safetyShutdown.abort();
+        Serial.println("Safety shutdown cancelled by a command");
+      }
+
+      // Process the CommandPayload addressed to this node
       appState.visorOn = payload.visorOn;
-      appState.visorMode = payload.visorMode;
+      appState.visorMode = knownVisorMode(payload.visorMode);
       appState.visorColor = payload.visorColor;
       appState.visorBrightness = payload.visorBrightness;
-      appState.thermalsOn = payload.thermalsOn;
+      for (uint8_t i = 0; i < LED_SEGMENTS - 1; i++) {
+        appState.accents[i].on = payload.accents[i].on;
+        appState.accents[i].mode = knownVisorMode(payload.accents[i].mode);
+        appState.accents[i].color = payload.accents[i].color;
+        appState.accents[i].brightness = payload.accents[i].brightness;
+      }
+      appState.thermalsMode = payload.thermalsMode;
+      if (lightsOn(appState) || appState.thermalsMode != ThermalsMode::OFF) {
+        emergencyStopped = false;
+        fanOutput.release(FAN_HALT_EMERGENCY_STOP);
+      }
       updateHardwareState(payload);
 
+      if (payload.radioProfile != appliedRadioProfile) {
+        appliedRadioProfile = payload.radioProfile;
+        appState.radioProfile = payload.radioProfile;
+        useRadioProfile(payload.radioProfile);
+      }
+      sleepCommanded = payload.radioSleep;
+
       // Reset watchdog timer
       lastMessageTime = millis();
+      safetyWatchdog.feed();
+      safeStateActive = false;
+
+      // Telemetry goes back to whoever is driving this node
+      memcpy(interfaceAddress, frame.mac, 6);
+      interfaceKnown = true;
+
+      // Fetch the selected effect program if this node doesn't have it yet
+      wantedProgramId = payload.programId;
+      bool programWanted = appState.visorMode == VisorMode::PROGRAM;
+      for (uint8_t i = 0; i < LED_SEGMENTS - 1; i++) {
+        programWanted |= appState.accents[i].mode == VisorMode::PROGRAM;
+      }
+      if (programWanted && payload.programId != loadedProgramId) {
+        requestProgram(frame.mac, payload.programId);
+      }
 
       // Blink onboard LED on receiver for incoming message
-      onboardLED.setPixelColor(0, onboardLED.Color(0, 0, 255)); // Blue color
-      onboardLED.setBrightness(10);
-      onboardLED.show();
-      delay(50);
-      onboardLED.clear();
-      onboardLED.show();
-    } else {
-      Serial.print("Received unexpected payload size for receiver: ");
-      Serial.println(len);
+      startStatusBlink();
+      sendAck(frame.mac, header.seq, frame.hops > 0 ? frame.via : nullptr);
+    }
+  } else if (isInterface) {
+    if (!decodeHeader(frame.data, len, header)) {
+      return;
+    }
+    if (header.type == MessageType::ACK) {
+      handleAck(frame);
+    } else if (header.type == MessageType::RELAY) {
+      // An ack that reached us through other receivers
+      RxFrame inner{};
+      if (handleRelayFrame(frame, selfAddress, selfAddress, false, inner)) {
+        handleIncomingFrame(inner);
+      }
+    } else if (header.type == MessageType::EMERGENCY_ACK) {
+      handleEmergencyAck(frame);
+    } else if (header.type == MessageType::TELEMETRY) {
+      handleTelemetry(frame);
+    } else if (header.type == MessageType::CHANNEL_PROBE) {
+      // A receiver just found our channel - bring it up to date
+      sendStateUpdate();
+    } else if (header.type == MessageType::PAIR_RESPONSE) {
+      if (handlePairResponse(frame)) {
+        // Persist straight away so a power loss can't undo the pairing
+        memcpy(sendAddress, selfAddress, 6);
+        savePeerAddresses();
+        sendStateUpdate();
+        Serial.printf("Paired receiver %02X:%02X:%02X:%02X:%02X:%02X (%u total)\n",
+                      frame.mac[0], frame.mac[1], frame.mac[2], frame.mac[3], frame.mac[4], frame.mac[5],
+                      receiverTable.size());
+      }
+    } else if (header.type == MessageType::PROGRAM_REQUEST) {
+      handleProgramRequest(frame);
+    } else if (header.type == MessageType::SQUAD) {
+      handleSquadFrame(frame);
+    } else if (header.type == MessageType::OTA_STATUS) {
+      handleOtaStatus(frame);
     }
   } else if (isInterfaceSetup) {
     if (len == sizeof(SetupPayload)) {
       SetupPayload setupPayload;
-      memcpy(&setupPayload, incomingData, sizeof(SetupPayload));
+      memcpy(&setupPayload, frame.data, sizeof(SetupPayload));
+      setupPayload.macAddress[sizeof(setupPayload.macAddress) - 1] = '\0';
       Serial.print("Bytes received (SetupPayload): ");
       Serial.println(len);
       Serial.print("Receiver MAC: ");
       Serial.println(setupPayload.macAddress);
 
-      // Parse and save both MAC addresses
+      // Parse and save the interface MAC and the announcing receiver.
+      // The table starts empty each setup session, so this replaces any earlier pairing.
+      uint8_t receiverMac[6];
       parseMacAddress(WiFi.macAddress().c_str(), sendAddress);
-      parseMacAddress(setupPayload.macAddress, recvAddress);
+      parseMacAddress(setupPayload.macAddress, receiverMac);
+      if (receiverTable.add(receiverMac, setupPayload.capabilities) < 0) {
+        Serial.println("Receiver table full");
+        return;
+      }
       savePeerAddresses();
 
+      tft.fillRect(0, 60, SCREEN_WIDTH, SCREEN_HEIGHT - 60, TFT_BLACK);
       tft.setCursor(0, 60);
       tft.print("Receiver MAC:");
       tft.setCursor(0, 80);
       tft.print(setupPayload.macAddress);
+      tft.setCursor(0, 100);
+      tft.printf("Receivers: %u", receiverTable.size());
       tft.setCursor(0, 120);
       tft.setTextColor(TFT_GREEN);
       tft.print("Addresses saved!");
@@ -434,165 +1220,678 @@ void OnDataRecv(const uint8_t * mac, const uint8_t *incomingData, int len) {
   }
 }
 
+void startStatusBlink() {
+  onboardLED.setPixelColor(0, onboardLED.Color(0, 0, 255)); // Blue color
+  onboardLED.setBrightness(10);
+  onboardLED.show();
+  statusBlinkStart = millis();
+  statusBlinkActive = true;
+}
+
+void updateStatusBlink() {
+  if (statusBlinkActive && millis() - statusBlinkStart >= STATUS_BLINK_MS) {
+    statusBlinkActive = false;
+    onboardLED.clear();
+    onboardLED.show();
+  }
+}
+
+// Periodically logs receive-path health (drops, rejected senders, callback cost)
+void reportRxStats() {
+  if (millis() - lastRxStatsTime < RX_STATS_INTERVAL_MS) {
+    return;
+  }
+  lastRxStatsTime = millis();
+  Serial.printf("RX stats: dropped=%lu rejected=%lu max callback=%lu us\n",
+                (unsigned long)rxQueue.dropped(),
+                (unsigned long)rxRejected.load(std::memory_order_relaxed),
+                (unsigned long)rxCallbackMaxUs.load(std::memory_order_relaxed));
+  reportPower();
+  reportTasks();
+  if (isReceiver) {
+    reportTimeSync();
+    reportLedStats();
+    if (RECEIVER_RELAY) {
+      reportRelayStats();
+    }
+#if RECEIVER_HUD
+    Serial.printf("HUD: %lu frames (%lu keyframes), %lu tiles, %lu bytes, %lu packets lost\n",
+                  (unsigned long)hudDecoder.framesReceived(), (unsigned long)hudDecoder.keyframesReceived(),
+                  (unsigned long)hudDecoder.tilesReceived(), (unsigned long)hudDecoder.bytesReceived(),
+                  (unsigned long)hudDecoder.packetsLost());
+#endif
+  }
+  if (isInterface) {
+    reportPeerStats();
+    reportSquadStats();
+    reportHudStats();
+    Serial.printf("Batching: %lu changes -> %lu radio updates, %lu changes -> %lu saves\n",
+                  (unsigned long)stateBatch.changes(), (unsigned long)stateBatch.flushes(),
+                  (unsigned long)saveBatch.changes(), (unsigned long)saveBatch.flushes());
+  }
+}
+
 // Converts a VisorColor enum to its RGB color value
 uint32_t getVisorColorValue(VisorColor color) {
     switch (color) {
-        case VisorColor::WHITE:  return pixels.Color(255, 255, 255);
-        case VisorColor::BLUE:   return pixels.Color(0, 0, 255);
-        case VisorColor::GREEN:  return pixels.Color(0, 255, 0);
-        case VisorColor::YELLOW: return pixels.Color(255, 255, 0);
-        case VisorColor::ORANGE: return pixels.Color(255, 128, 0);
-        case VisorColor::RED:    return pixels.Color(255, 0, 0);
-        default:                 return pixels.Color(0, 0, 0);
+        case VisorColor::WHITE:  return Adafruit_NeoPixel::Color(255, 255, 255);
+        case VisorColor::BLUE:   return Adafruit_NeoPixel::Color(0, 0, 255);
+        case VisorColor::GREEN:  return Adafruit_NeoPixel::Color(0, 255, 0);
+        case VisorColor::YELLOW: return Adafruit_NeoPixel::Color(255, 255, 0);
+        case VisorColor::ORANGE: return Adafruit_NeoPixel::Color(255, 128, 0);
+        case VisorColor::RED:    return Adafruit_NeoPixel::Color(255, 0, 0);
+        default:                 return Adafruit_NeoPixel::Color(0, 0, 0);
+    }
+}
+
+// A mode from the wire, with values this build doesn't know shown as SOLID
+VisorMode knownVisorMode(VisorMode mode) {
+    return (uint8_t)mode <= (uint8_t)VisorMode::PROGRAM ? mode : VisorMode::SOLID;
+}
+
+// Whether the visor or any accent segment is lit
+bool lightsOn(const AppState& state) {
+    bool on = state.visorOn;
+    for (uint8_t i = 0; i < LED_SEGMENTS - 1; i++) {
+        on |= state.accents[i].on;
+    }
+    return on;
+}
+
+// Turns the visor and every accent segment off
+void lightsOff() {
+    appState.visorOn = false;
+    for (uint8_t i = 0; i < LED_SEGMENTS - 1; i++) {
+        appState.accents[i].on = false;
+    }
+}
+
+// Hands one segment's settings to the compositor. Programs pick their own levels.
+void setLedSegment(uint8_t segment, bool on, VisorMode mode, VisorColor color, uint8_t brightness) {
+    if (!on) {
+        ledCompositor.setSegment(segment, 0, VisorMode::SOLID, 0);
+    } else if (mode == VisorMode::PROGRAM) {
+        ledCompositor.setSegment(segment, 0, mode, MAX_BRIGHTNESS);
+    } else {
+        ledCompositor.setSegment(segment, getVisorColorValue(color), mode, brightness * BRIGHTNESS_STEP);
     }
 }
 
 // Function to update the hardware state based on the CommandPayload
 void updateHardwareState(const CommandPayload& payload) {
-  // Update LEDs
-  if (payload.visorOn) {
-    uint32_t color = getVisorColorValue(payload.visorColor);
-    if (payload.visorMode != VisorMode::PULSING) {
-      pixels.setBrightness(payload.visorBrightness * BRIGHTNESS_STEP);
-      pixels2.setBrightness(payload.visorBrightness * BRIGHTNESS_STEP);
-    }
-    pixels.fill(color, 0, NUM_LEDS);
-    pixels2.fill(color, 0, NUM_LEDS);
-  } else {
-    pixels.clear();
-    pixels2.clear();
-  }
-  pixels.show();
-  pixels2.show();
+  // LEDs follow appState; show the change without waiting for the next frame
+  forceLedFrame();
 
-  // Update Fans
-  digitalWrite(FAN_1_CTRL, payload.thermalsOn ? HIGH : LOW);
-  // Assuming FAN_2_CTRL also exists and follows thermalsOn
-  // digitalWrite(FAN_2_CTRL, payload.thermalsOn ? HIGH : LOW);
+  // Fans ramp to the new mode from serviceFans()
+  fanController.setMode(payload.thermalsMode);
 }
 
-// Resets hardware to safe state when connection is lost
+// Resets hardware to safe state when connection is lost. The fans go off here; the LED
+// warning then runs from serviceLeds() until it ends or a command cancels it.
 void resetToSafeState() {
   Serial.println("WARNING: Connection timeout - resetting to safe state");
 
   // Turn off fans immediately (safety first)
-  digitalWrite(FAN_1_CTRL, LOW);
+  fanController.stop();
+  fanOutput.write(0);
+  safeStateActive = true;
 
   // Update app state to reflect safe state
-  appState.visorOn = false;
-  appState.thermalsOn = false;
+  lightsOff();
+  appState.thermalsMode = ThermalsMode::OFF;
 
   // Set onboard LED red to indicate timeout
   onboardLED.setPixelColor(0, onboardLED.Color(255, 0, 0));
   onboardLED.setBrightness(10);
   onboardLED.show();
 
-  // Phase 1: Flash bright red for 5 seconds
-  uint32_t red = pixels.Color(255, 0, 0);
-  unsigned long flashStart = millis();
-  bool ledOn = true;
-
-  pixels.setBrightness(MAX_BRIGHTNESS);
-  pixels2.setBrightness(MAX_BRIGHTNESS);
-  while (millis() - flashStart < SHUTDOWN_FLASH_DURATION_MS) {
-    if (ledOn) {
-      pixels.fill(red, 0, NUM_LEDS);
-      pixels2.fill(red, 0, NUM_LEDS);
-    } else {
-      pixels.clear();
-      pixels2.clear();
-    }
-    pixels.show();
-    pixels2.show();
-    ledOn = !ledOn;
-    delay(SHUTDOWN_FLASH_INTERVAL_MS);
-  }
+  // Flash red, then fade to off (layout.h timings)
+  safetyShutdown.begin(sharedTimeUs() / 1000);
+  forceLedFrame();
+}
+
+// How long until serviceFans() next steps the fans
+int64_t fanIdleUs() {
+  uint32_t elapsed = millis() - lastFanUpdateTime;
+  return elapsed >= FAN_UPDATE_INTERVAL_MS ? 0 : (FAN_UPDATE_INTERVAL_MS - elapsed) * 1000LL;
+}
 
-  // Phase 2: Fade from bright red to off over 5 seconds
-  unsigned long fadeStart = millis();
-  pixels.fill(red, 0, NUM_LEDS);
-  pixels2.fill(red, 0, NUM_LEDS);
-
-  while (millis() - fadeStart < SHUTDOWN_FADE_DURATION_MS) {
-    float progress = (float)(millis() - fadeStart) / SHUTDOWN_FADE_DURATION_MS;
-    uint8_t brightness = MAX_BRIGHTNESS * (1.0 - progress);
-    pixels.setBrightness(brightness);
-    pixels2.setBrightness(brightness);
-    pixels.show();
-    pixels2.show();
-    delay(20);  // Smooth fade with ~50 updates per second
+// Steps the fan duty toward the thermals mode every FAN_UPDATE_INTERVAL_MS, from the chip
+// temperature, within what the power budget allows. Output is ignored while an emergency
+// stop holds the fans off.
+void serviceFans() {
+  if (millis() - lastFanUpdateTime < FAN_UPDATE_INTERVAL_MS) {
+    return;
   }
+  lastFanUpdateTime = millis();
+  int16_t tempDeciC = boardSensors.chipTempDeciC();
+  powerBudget.setHot(tempDeciC >= POWER_FANS_FIRST_DECIC);
+  uint8_t duty = fanController.update(tempDeciC, lastFanUpdateTime);
+  fanOutput.write(powerBudget.fanDuty(duty));
+}
 
-  // Final state: LEDs off
-  pixels.clear();
-  pixels2.clear();
-  pixels.show();
-  pixels2.show();
+// Has the LED task render a frame now rather than on the schedule
+void forceLedFrame() {
+    ledFrameForced = true;
+    if (ledTask) {
+        xTaskNotifyGive(ledTask);
+    }
 }
 
-void pulseLeds() {
-    // Non-blocking pulsing effect
-    // Uses a sine wave to smoothly ramp the brightness up and down
-    float brightness = (sin(millis() / 1000.0 * PI) + 1) / 2.0;
+// Renders an LED frame every LED_FRAME_INTERVAL_US from appState and pushes it to the
+// strips only when it changed. Missed frames are skipped rather than caught up.
+void serviceLeds() {
+    flushLedFrame();
+    int64_t now = esp_timer_get_time();
+    if (!ledFrameForced && now < nextLedFrameUs) {
+        return;
+    }
+    if (!ledFrameForced && nextLedFrameUs > 0) {
+        uint32_t lateness = now - nextLedFrameUs;
+        ledLatenessSumUs += lateness;
+        if (lateness > ledLatenessMaxUs) {
+            ledLatenessMaxUs = lateness;
+        }
+    }
+    nextLedFrameUs += LED_FRAME_INTERVAL_US;
+    if (ledFrameForced || nextLedFrameUs <= now) {
+        nextLedFrameUs = now + LED_FRAME_INTERVAL_US;
+    }
+    ledFrameForced = false;
+
+    bool programShown = appState.visorOn && appState.visorMode == VisorMode::PROGRAM;
+    setLedSegment(0, appState.visorOn, appState.visorMode, appState.visorColor, appState.visorBrightness);
+    for (uint8_t i = 0; i + 1 < ledSegments.count(); i++) {
+        const SegmentState& accent = appState.accents[i];
+        setLedSegment(i + 1, accent.on, accent.mode, accent.color, accent.brightness);
+        programShown |= accent.on && accent.mode == VisorMode::PROGRAM;
+    }
+    if (programShown) {
+        renderEffectProgram();
+    }
 
-    uint32_t color = getVisorColorValue(appState.visorColor);
-    pixels.fill(color, 0, NUM_LEDS);
-    pixels2.fill(color, 0, NUM_LEDS);
-    pixels.setBrightness(brightness * (appState.visorBrightness * BRIGHTNESS_STEP));
-    pixels2.setBrightness(brightness * (appState.visorBrightness * BRIGHTNESS_STEP));
-    Serial.println("Brightness: " + String(brightness * (appState.visorBrightness * BRIGHTNESS_STEP)));
-    pixels.show();
-    pixels2.show();
+    uint32_t timeMs = sharedTimeUs() / 1000;
+    safetyShutdown.service(timeMs);
+    if (ledCompositor.render(timeMs)) {
+        pushLedFrame();
+    }
+    ledFramesRendered++;
+    ledBusyUs += esp_timer_get_time() - now;
 }
 
-void flashLeds() {
-    // Non-blocking flashing effect
-    // Uses millis() to toggle the LEDs on and off
-    static unsigned long lastToggle = 0;
-    unsigned long currentMillis = millis();
+// Runs the effect program into programPixels at VM_FRAME_INTERVAL_MS; the compositor
+// holds the last result in between
+void renderEffectProgram() {
+    if (!effectVm.loaded()) {
+        memset(programPixels, 0, sizeof(programPixels));
+        return;
+    }
+    if (millis() - lastEffectFrameTime < VM_FRAME_INTERVAL_MS) {
+        return;
+    }
+    lastEffectFrameTime = millis();
+
+    VmContext ctx;
+    ctx.timeMs = sharedTimeUs() / 1000;
+    ctx.count = LED_CHAIN_LEN;
+    ctx.color = getVisorColorValue(appState.visorColor);
+    for (uint16_t i = 0; i < LED_CHAIN_LEN; i++) {
+        ctx.index = i;
+        programPixels[i] = effectVm.run(ctx);
+    }
+
+    if (effectVm.takeFault()) {
+        Serial.println("Effect program fault");
+        programFaulted = true;
+    }
+}
 
-    if (currentMillis - lastToggle >= FLASH_INTERVAL_MS) {
-        lastToggle = currentMillis;
+// Sends the compositor's frame to the strips, or as soon as they finish the last one
+void pushLedFrame() {
+    ledFramePending = true;
+    flushLedFrame();
+}
 
-        if (pixels.getBrightness() > 0) {
-            pixels.setBrightness(0);
-            pixels2.setBrightness(0);
-        } else {
-            pixels.setBrightness(appState.visorBrightness * BRIGHTNESS_STEP);
-            pixels2.setBrightness(appState.visorBrightness * BRIGHTNESS_STEP);
+// Hands a pending frame to the strips once they are free and counts it for the telemetry
+// frame rate. The compositor's frame is read at that point, so a newer one replaces a
+// frame still waiting.
+void flushLedFrame() {
+    if (!ledOutputUp) {
+        ledFramePending = false;
+        return;
+    }
+    if (!ledFramePending || !ledOutput.ready()) {
+        return;
+    }
+    int64_t start = esp_timer_get_time();
+    if (!ledOutput.show(ledCompositor.frame())) {
+        return;
+    }
+    uint32_t blocked = esp_timer_get_time() - start;
+    ledBlockedSumUs += blocked;
+    if (blocked > ledBlockedMaxUs) {
+        ledBlockedMaxUs = blocked;
+    }
+    ledFramePending = false;
+    ledFrameCount++;
+    ledFramesShown++;
+}
+
+// Turns both strips off straight away, bypassing the compositor (emergency stop)
+void showBlankLeds() {
+    static const uint32_t blank[LED_CHAIN_LEN] = {};
+    if (!ledOutputUp) {
+        return;
+    }
+    ledOutput.wait(RmtLedOutput::frameUs() / 1000 + 1);
+    if (ledOutput.show(blank)) {
+        ledFrameCount++;
+        ledFramesShown++;
+    }
+}
+
+// Logs the LED frame rate, CPU share and how late frames started since the last report
+void reportLedStats() {
+    static int64_t lastReportUs = 0;
+    int64_t now = esp_timer_get_time();
+    int64_t elapsed = now - lastReportUs;
+    if (lastReportUs > 0 && elapsed > 0 && ledFramesRendered > 0) {
+        Serial.printf("LEDs: %lu frames rendered, %lu shown, load %.2f%%, start jitter avg %lu us max %lu us, "
+                      "output blocked avg %lu us max %lu us of %lu us on the wire\n",
+                      (unsigned long)ledFramesRendered, (unsigned long)ledFramesShown,
+                      ledBusyUs * 100.0 / elapsed, (unsigned long)(ledLatenessSumUs / ledFramesRendered),
+                      (unsigned long)ledLatenessMaxUs,
+                      (unsigned long)(ledFramesShown > 0 ? ledBlockedSumUs / ledFramesShown : 0),
+                      (unsigned long)ledBlockedMaxUs, (unsigned long)RmtLedOutput::frameUs());
+    }
+    lastReportUs = now;
+    ledFramesRendered = 0;
+    ledFramesShown = 0;
+    ledBusyUs = 0;
+    ledLatenessSumUs = 0;
+    ledLatenessMaxUs = 0;
+    ledBlockedSumUs = 0;
+    ledBlockedMaxUs = 0;
+}
+
+// Logs one task's CPU share, longest pass and the least stack it has had left
+void reportTask(const char* name, TaskHandle_t task, TaskLoad& load, uint32_t elapsedUs) {
+    if (!task) {
+        return;
+    }
+    uint32_t longestUs;
+    float share = load.take(elapsedUs, longestUs);
+    Serial.printf("Task %s: load %.2f%%, longest pass %lu us, stack %lu bytes never used\n", name,
+                  share * 100, (unsigned long)longestUs, (unsigned long)uxTaskGetStackHighWaterMark(task));
+}
+
+void reportTasks() {
+    static int64_t lastReportUs = 0;
+    int64_t now = esp_timer_get_time();
+    uint32_t elapsed = now - lastReportUs;
+    lastReportUs = now;
+    reportTask("comms", commsTask, commsLoad, elapsed);
+    reportTask("render", renderTask, renderLoad, elapsed);
+    reportTask("leds", ledTask, ledLoad, elapsed);
+}
+
+TelemetrySnapshot readTelemetry(TelemetrySensors& sensors) {
+    static const uint8_t unpaired[6] = {0};
+    TelemetrySnapshot snapshot;
+    snapshot.fans = sensors.fans();
+    snapshot.fanDuty[0] = sensors.fanDuty(0);
+    snapshot.fanDuty[1] = sensors.fanDuty(1);
+    snapshot.chipTempDeciC = sensors.chipTempDeciC();
+    snapshot.supplyMv = sensors.supplyMv();
+
+    unsigned long elapsed = millis() - lastTelemetryTime;
+    snapshot.ledFps = elapsed > 0 ? min<unsigned long>(255, ledFrameCount * 1000UL / elapsed) : 0;
+
+    // The watchdog only runs once the first command has arrived
+    if (lastMessageTime == 0) {
+        snapshot.watchdogMarginMs = RECEIVER_TIMEOUT_MS;
+    } else {
+        unsigned long silent = millis() - lastMessageTime;
+        snapshot.watchdogMarginMs = silent < RECEIVER_TIMEOUT_MS ? RECEIVER_TIMEOUT_MS - silent : 0;
+    }
+
+    if (safeStateActive) snapshot.safeFlags |= SAFE_FLAG_TIMED_OUT;
+    if (memcmp(sendAddress, unpaired, 6) == 0) snapshot.safeFlags |= SAFE_FLAG_UNPAIRED;
+    if (programFaulted) snapshot.safeFlags |= SAFE_FLAG_PROGRAM_FAULT;
+    if (emergencyStopped) snapshot.safeFlags |= SAFE_FLAG_EMERGENCY_STOP;
+    float currentMa = averageCurrentMa > 0 ? averageCurrentMa : powerModel.averageMa(esp_timer_get_time());
+    snapshot.currentDeciMa = currentMa * 10;
+    uint16_t supplyMv = snapshot.supplyMv > 0 ? snapshot.supplyMv : POWER_NOMINAL_MV;
+    snapshot.powerMw = powerBudget.totalMa() * supplyMv / 1000;
+    return snapshot;
+}
+
+// Sends a telemetry record every TELEMETRY_INTERVAL_MS once an interface has been heard from
+void reportTelemetry() {
+    if (millis() - lastTelemetryTime < TELEMETRY_INTERVAL_MS) {
+        return;
+    }
+    // A sleeping interface only hears it while a window or slot is open
+    if (receiverMaySleep() && dutyCycle.phase(sharedTimeUs()) == DutyCycle::Phase::ASLEEP) {
+        return;
+    }
+    if (interfaceKnown) {
+        sendTelemetry(interfaceAddress, readTelemetry(boardSensors));
+        programFaulted = false;
+    }
+    lastTelemetryTime = millis();
+    ledFrameCount = 0;
+}
+
+// --- Emergency stop ---
+
+// Watches for all three buttons held together (interface). Returns true while they
+// belong to the chord and shouldn't reach the menu.
+bool serviceStopChord() {
+    bool one = digitalRead(BUTTON_1) == LOW;
+    bool two = digitalRead(BUTTON_2) == LOW;
+    bool three = digitalRead(BUTTON_3) == LOW;
+
+    if (stopChordLatched) {
+        if (one || two || three) {
+            return true;
         }
+        // Let go - forget the half-finished presses so nothing counts as a click
+        stopChordLatched = false;
+        buttonOne.reset();
+        buttonTwo.reset();
+        buttonThree.reset();
+        return false;
+    }
+    if (!(one && two && three)) {
+        stopChordStartUs = 0;
+        return false;
+    }
 
-        uint32_t color = getVisorColorValue(appState.visorColor);
-        pixels.fill(color, 0, NUM_LEDS);
-        pixels2.fill(color, 0, NUM_LEDS);
-        pixels.show();
-        pixels2.show();
+    int64_t now = esp_timer_get_time();
+    if (stopChordStartUs == 0) {
+        stopChordStartUs = now;
+    }
+    if (now - stopChordStartUs < ESTOP_CHORD_MS * 1000LL) {
+        return false;
     }
+    stopChordLatched = true;
+    triggerEmergencyStop(stopChordStartUs);
+    return true;
 }
 
-void strobeLeds() {
-    // Non-blocking strobe effect
-    // Uses millis() to toggle the LEDs on and off rapidly
-    static unsigned long lastToggle = 0;
-    unsigned long currentMillis = millis();
+// Sends the stop to every receiver, then brings our own state, menu and screen in line.
+// `pressedUs` is when the chord went down (esp_timer_get_time()).
+void triggerEmergencyStop(int64_t pressedUs) {
+    Serial.println("EMERGENCY STOP");
+    // The stop can't wait for the next wake window
+    if (radioAsleep && espNowTransport.setRadioSleep(false)) {
+        radioAsleep = false;
+    }
+    startEmergencyStop(toSharedUs(pressedUs));
 
-    if (currentMillis - lastToggle >= STROBE_INTERVAL_MS) {
-        lastToggle = currentMillis;
+    lightsOff();
+    appState.thermalsMode = ThermalsMode::OFF;
+    lastCuedScene = currentSquadScene();   // Our own costume only, not a squad cue
+    updateMenuFromState();
+    postUiEvent(UiEvent::WAKE);
 
-        if (pixels.getBrightness() > 0) {
-            pixels.setBrightness(0);
-            pixels2.setBrightness(0);
-        } else {
-            pixels.setBrightness(appState.visorBrightness * BRIGHTNESS_STEP);
-            pixels2.setBrightness(appState.visorBrightness * BRIGHTNESS_STEP);
+    // The stopped state follows at once, so no retry or heartbeat turns anything back on
+    sendStateUpdate();
+    lastHeartbeatTime = millis();
+    saveBatch.mark(millis());
+}
+
+// Fans and LEDs off without going through the effects, then acks the copy (receiver).
+// `fansOffUs` is when the fans went off; commands that arrived before it are stale.
+void applyEmergencyStop(const EmergencyStop& stop, uint16_t seq, const uint8_t* mac, int64_t fansOffUs,
+                        const uint8_t* via) {
+    fanOutput.halt(FAN_HALT_EMERGENCY_STOP);
+    fanController.stop();
+    lightsOff();
+    appState.thermalsMode = ThermalsMode::OFF;
+    safetyShutdown.abort();
+    showBlankLeds();
+
+    if (stop.stopId != appliedStopId || !emergencyStopped) {
+        appliedStopId = stop.stopId;
+        emergencyStopUs = fansOffUs;
+        emergencyStopped = true;
+        Serial.println("EMERGENCY STOP - fans and LEDs off");
+    }
+    int32_t pressToOffUs = effectClock.synced() ? (int32_t)(toSharedUs(emergencyStopUs) - stop.pressedUs) : -1;
+    sendEmergencyAck(mac, seq, stop.stopId, pressToOffUs, via);
+}
+
+// --- Pairing ---
+
+// Called from the SETTINGS menu action and the Next + Previous hold
+void startPairingMode() {
+    if (!isInterface) {
+        return;
+    }
+    exitScreenSaver();
+    // Pairing is a good moment to leave a channel that has become crowded
+    migrateChannel(true);
+    startPairing();
+}
+
+// --- Channel (receiver) ---
+
+void noteInterfaceContact() {
+    hadContact = true;
+    lastContactTime = millis();
+    channelManager.stopHunt();
+}
+
+// Follows announced switches, and searches the candidate channels when the
+// interface has gone quiet (or at boot). A paired receiver probes each channel
+// and stops at the one where the interface acks; an unpaired one listens for
+// pairing beacons instead.
+void serviceReceiverChannel() {
+    uint8_t channel = channelManager.switchDue(millis());
+    if (channel) {
+        espNowTransport.setChannel(channel);
+        Serial.printf("Switched to channel %u\n", channel);
+    }
+
+    if (channelProbeAcked.exchange(false)) {
+        noteInterfaceContact();
+    }
+
+    static const uint8_t unpaired[6] = {0};
+    bool paired = memcmp(sendAddress, unpaired, 6) != 0;
+    bool silent = !hadContact || millis() - lastContactTime > CHANNEL_LOST_MS;
+    if (silent && !channelManager.hunting() && !channelManager.switchPending()) {
+        channelManager.startHunt(millis(), paired ? CHANNEL_PROBE_INTERVAL_MS : CHANNEL_LISTEN_DWELL_MS,
+                                 CHANNEL_LISTEN_DWELL_MS);
+    }
+
+    channel = channelManager.huntStep(millis());
+    if (channel) {
+        espNowTransport.setChannel(channel);
+        if (paired) {
+            sendChannelProbe(sendAddress);
         }
+    }
+}
+
+// --- Radio sleep ---
 
-        uint32_t color = getVisorColorValue(appState.visorColor);
-        pixels.fill(color, 0, NUM_LEDS);
-        pixels2.fill(color, 0, NUM_LEDS);
-        pixels.show();
-        pixels2.show();
+// Whether this receiver may follow the wake schedule right now. Anything that needs the
+// radio between windows keeps it up - relaying, the HUD mirror, an update, pairing and
+// the channel hunt - and so does a clock not yet synced to the schedule.
+bool receiverMaySleep() {
+    return isReceiver && sleepCommanded && !RECEIVER_RELAY && !RECEIVER_HUD && effectClock.synced() &&
+           !receiverPairingOpen() && !channelManager.hunting() && !channelManager.switchPending() &&
+           !otaReceiver.receiving() && otaRestartTime == 0;
+}
+
+// How long the LEDs can go without a new frame. Sleeping would stall a frame going out.
+int64_t ledIdleUs() {
+    if (ledOutputUp && (ledFramePending || !ledOutput.ready())) {
+        return 0;
+    }
+    if (!ledCompositor.animated()) {
+        return INT64_MAX;
     }
+    return max<int64_t>(0, nextLedFrameUs - esp_timer_get_time());
+}
+
+// Powers the radio down outside the wake schedule and charges the power model.
+// The interface decides whether receivers sleep at all; its own radio follows them.
+// Returns the esp_timer time a receiver's CPU may light-sleep until, or 0 to stay up.
+int64_t serviceRadioSleep() {
+    int64_t now = esp_timer_get_time();
+    int64_t shared = sharedTimeUs();
+
+    // Charge what went out since the last call, and stay up a while after any traffic
+    uint32_t frames = espNowTransport.framesSent();
+    if (frames != chargedFrames) {
+        powerModel.noteSent(frames - chargedFrames, espNowTransport.bytesSent() - chargedBytes,
+                            radioProfileLimits(appliedRadioProfile).phyKbps);
+        chargedFrames = frames;
+        chargedBytes = espNowTransport.bytesSent();
+        dutyCycle.noteTraffic(shared);
+    }
+    if (!rxQueue.empty() || !stopQueue.empty()) {
+        dutyCycle.noteTraffic(shared);
+    }
+
+    bool sleep = false;
+    if (isInterface) {
+        // Anything that needs the receivers between windows keeps them up
+        bool wanted = appState.radioSleep && !pairingActive() && !receiverUpdateActive() &&
+                      !hudMirrorActive() && !squad.active();
+        if (wanted != receiverSleepApplied) {
+            receiverSleepApplied = wanted;
+            setReceiverSleep(wanted);
+            stateBatch.mark(millis());
+        }
+        sleep = wanted && receiversAsleep() && !emergencyStopActive() && !dutyCycle.awake(shared);
+    } else if (isReceiver) {
+        sleep = receiverMaySleep() && !dutyCycle.awake(shared);
+    }
+    if (sleep != radioAsleep && espNowTransport.setRadioSleep(sleep)) {
+        radioAsleep = sleep;
+    }
+
+    powerModel.enter(radioAsleep ? PowerState::RADIO_OFF : PowerState::RADIO_ON, now);
+
+    // Nothing for the receiver's CPU to do either until the next window or LED frame
+    if (radioAsleep && isReceiver) {
+        return now + min(dutyCycle.nextWakeUs(shared) - shared, ledIdleUs());
+    }
+    return 0;
+}
+
+// Light-sleeps the CPU until `wakeUs` (esp_timer), if that is long enough to be worth it.
+// Called with stateLock let go, so the LED task can take it the moment the CPU wakes.
+void lightSleepUntil(int64_t wakeUs) {
+    int64_t start = esp_timer_get_time();
+    if (wakeUs - start < DUTY_MIN_SLEEP_US) {
+        return;
+    }
+    Serial.flush();
+    esp_sleep_enable_timer_wakeup(wakeUs - start);
+    esp_light_sleep_start();
+
+    StateGuard guard;
+    powerModel.enter(PowerState::LIGHT_SLEEP, start);
+    powerModel.enter(radioAsleep ? PowerState::RADIO_OFF : PowerState::RADIO_ON, esp_timer_get_time());
+}
+
+// Logs this node's estimated current over the last interval and starts the next
+void reportPower() {
+    int64_t now = esp_timer_get_time();
+    averageCurrentMa = powerModel.averageMa(now);
+    Serial.printf("Power: ~%.1f mA (radio on %.0f%%, light sleep %.0f%%)%s\n", averageCurrentMa,
+                  powerModel.share(PowerState::RADIO_ON, now) * 100,
+                  powerModel.share(PowerState::LIGHT_SLEEP, now) * 100,
+                  (receiverSleepApplied || receiverMaySleep()) ? ", radio sleep on" : "");
+    if (isReceiver) {
+        powerBudget.setBaseMa(averageCurrentMa);
+        Serial.printf("Power budget: ~%.0f of %d mA, LEDs %.0f mA (asked %.0f), fans %.0f mA (asked %.0f)%s\n",
+                      powerBudget.totalMa(), POWER_BUDGET_MA, powerBudget.ledMa(), powerBudget.ledDemandMa(),
+                      powerBudget.fanMa(), powerBudget.fanDemandMa(), powerBudget.limiting() ? ", limiting" : "");
+    }
+    powerModel.restart(radioAsleep ? PowerState::RADIO_OFF : PowerState::RADIO_ON, now);
+}
+
+void renderPairingScreen() {
+    if (pairingScreenShown && receiverTable.size() == pairingDrawnCount && millis() - lastPairingDraw < 1000) {
+        return;
+    }
+    if (!pairingScreenShown) {
+        tft.fillScreen(TFT_BLACK);
+        pairingScreenShown = true;
+    }
+    lastPairingDraw = millis();
+    pairingDrawnCount = receiverTable.size();
+
+    tft.setTextSize(2);
+    tft.setTextColor(HEX_BORDER, TFT_BLACK);
+    tft.setCursor(10, 20);
+    tft.print("PAIRING");
+    tft.setTextColor(TFT_WHITE, TFT_BLACK);
+    tft.setCursor(10, 60);
+    tft.print("Power on receivers");
+    tft.setCursor(10, 90);
+    tft.printf("Receivers: %u  ", receiverTable.size());
+    tft.setCursor(10, 140);
+    tft.setTextSize(1);
+    tft.print("Press Select to finish");
+}
+
+// --- Receiver Update (interface) ---
+
+// Called from the SETTINGS menu action
+void startReceiverUpdateMode() {
+    if (!isInterface) {
+        return;
+    }
+    exitScreenSaver();
+    if (receiverTable.size() == 0 || !receiverImage.open()) {
+        tft.fillScreen(TFT_BLACK);
+        tft.setTextColor(TFT_YELLOW);
+        tft.setTextSize(2);
+        tft.setCursor(10, 60);
+        tft.print(receiverTable.size() == 0 ? "No receivers paired" : "No receiver image");
+        tft.setTextColor(TFT_WHITE);
+        // Left up for a while by serviceScreen(), which runs under the lock comms needs
+        noticeShown = true;
+        noticeTime = millis();
+        return;
+    }
+    startReceiverUpdate(receiverImage);
+}
+
+void renderUpdateScreen() {
+    if (updateScreenShown && millis() - lastUpdateDraw < 500) {
+        return;
+    }
+    if (!updateScreenShown) {
+        tft.fillScreen(TFT_BLACK);
+        updateScreenShown = true;
+    }
+    lastUpdateDraw = millis();
+    ReceiverUpdateProgress progress = receiverUpdateProgress();
+
+    tft.setTextSize(2);
+    tft.setTextColor(HEX_BORDER, TFT_BLACK);
+    tft.setCursor(10, 20);
+    tft.print("UPDATING");
+    tft.setTextColor(TFT_WHITE, TFT_BLACK);
+    tft.setCursor(10, 60);
+    tft.printf("Receiver %u of %u  ", progress.receiver + 1, receiverTable.size());
+    tft.setCursor(10, 90);
+    tft.printf("%u%%  ", progress.percent);
+    if (progress.updated > 0) {
+        tft.printf("(%.1f KB/s)  ", progress.lastKbPerSec);
+    }
+    tft.setCursor(10, 140);
+    tft.setTextSize(1);
+    tft.print("Press Select to cancel");
 }
 
 // --- Screen Saver Functions ---
@@ -602,6 +1901,11 @@ void resetIdleTimer() {
 }
 
 void exitScreenSaver() {
+    if (hudMirroring) {
+        stopHudMirror();
+        hudCanvas.deleteSprite();
+        hudMirroring = false;
+    }
     if (screenSaverActive) {
         screenSaverActive = false;
         // Force menu to redraw on next loop iteration
@@ -625,21 +1929,143 @@ void initScreenSaver() {
             break;
     }
     tft.fillScreen(TFT_BLACK);
+
+    // With a HUD receiver paired, draw into an 8-bit canvas the mirror can read back
+    if (startHudMirror()) {
+        hudCanvas.setColorDepth(8);
+        hudCanvas.setSwapBytes(true);
+        hudMirroring = hudCanvas.createSprite(SCREEN_WIDTH, SCREEN_HEIGHT) != nullptr;
+        if (hudMirroring) {
+            hudCanvas.fillSprite(TFT_BLACK);
+        } else {
+            Serial.println("No memory for the HUD canvas, not mirroring");
+            stopHudMirror();
+        }
+    }
 }
 
 void renderScreenSaver() {
+    TFT_eSPI& target = hudMirroring ? hudCanvas : tft;
     // Render the appropriate screen saver animation based on HUD style
     switch (appState.hudStyle) {
         case HudStyle::BIOMETRIC:
-            renderBiometricScreenSaver(tft);
+            renderBiometricScreenSaver(target);
             break;
         case HudStyle::RADAR:
-            renderRadarScreenSaver(tft);
+            renderRadarScreenSaver(target);
             break;
         case HudStyle::MATRIX:
-            renderMatrixScreenSaver(tft);
+            renderMatrixScreenSaver(target);
             break;
     }
+    // The mirror sends from the same scan
+    if (hudMirroring) {
+        StateGuard guard;
+        presentHudCanvas();
+    }
+}
+
+// Finds the tiles the last render changed and copies them to the panel, each run of
+// neighbouring tiles in one push. The mirror sends from the same scan.
+void presentHudCanvas() {
+    if (hudEncoder.scan((const uint8_t*)hudCanvas.getPointer()) == 0) {
+        return;
+    }
+    for (uint16_t row = 0; row < HUD_ROWS; row++) {
+        uint16_t col = 0;
+        while (col < HUD_COLUMNS) {
+            if (!hudEncoder.tileChanged(row * HUD_COLUMNS + col)) {
+                col++;
+                continue;
+            }
+            uint16_t first = col;
+            while (col < HUD_COLUMNS && hudEncoder.tileChanged(row * HUD_COLUMNS + col)) {
+                col++;
+            }
+            int32_t x = first * HUD_TILE_SIZE;
+            int32_t y = row * HUD_TILE_SIZE;
+            int32_t w = min((int32_t)SCREEN_WIDTH, (int32_t)(col * HUD_TILE_SIZE)) - x;
+            int32_t h = min((int32_t)SCREEN_HEIGHT, y + HUD_TILE_SIZE) - y;
+            hudCanvas.pushSprite(x, y, x, y, w, h);
+        }
+    }
+}
+
+// Joins or leaves the squad to match appState.squadRole (interface only)
+void applySquadRole() {
+    if (!isInterface) {
+        return;
+    }
+    if (appState.squadRole == SquadRole::OFF) {
+        stopSquad();
+    } else {
+        startSquad(SQUAD_KEY, appState.squadRole == SquadRole::LEAD ? 1 : 0);
+        lastCuedScene = currentSquadScene();
+    }
+}
+
+SquadScene currentSquadScene() {
+    SquadScene scene;
+    scene.visorOn = appState.visorOn;
+    scene.visorMode = appState.visorMode;
+    scene.visorColor = appState.visorColor;
+    scene.visorBrightness = appState.visorBrightness;
+    scene.programId = selectedProgramId();
+    return scene;
+}
+
+// Applies a squad cue as if it had been picked from the menu, without the batching delay
+void applySquadScene(const SquadScene& scene) {
+    appState.visorOn = scene.visorOn;
+    appState.visorMode = knownVisorMode(scene.visorMode);
+    appState.visorColor = scene.visorColor;
+    appState.visorBrightness = scene.visorBrightness;
+    for (uint8_t i = 0; i < EFFECT_PROGRAM_COUNT; i++) {
+        if (crc16(effectPrograms[i].code, effectPrograms[i].length) == scene.programId) {
+            appState.effectProgram = i;
+        }
+    }
+
+    updateMenuFromState();
+    if (menuController) {
+        menuController->forceRedraw();
+    }
+    sendStateUpdate();
+    lastHeartbeatTime = millis();
+    saveBatch.mark(millis());
+}
+
+// Called by menu callbacks instead of sending/saving immediately
+void markStateChanged(bool notifyReceivers) {
+    if (notifyReceivers) {
+        stateBatch.mark(millis());
+    }
+    saveBatch.mark(millis());
+}
+
+void flushStateChanges() {
+    // Sleeping receivers take the change in the next listen slot
+    if (receiversListening() && stateBatch.due(millis())) {
+        // Receivers keep LR reception enabled, so they still hear the update sent at the new rate
+        if (appState.radioProfile != appliedRadioProfile) {
+            appliedRadioProfile = appState.radioProfile;
+            useRadioProfile(appliedRadioProfile);
+        }
+
+        // A squad leader's visor change goes out as a cue; our own receivers get it
+        // when the cue falls due, together with everyone else's
+        SquadScene scene = currentSquadScene();
+        if (squad.leading() && memcmp(&scene, &lastCuedScene, sizeof(scene)) != 0 && squad.cue(scene, esp_timer_get_time())) {
+            lastCuedScene = scene;
+        } else {
+            sendStateUpdate();
+            // The update also serves as this period's heartbeat
+            lastHeartbeatTime = millis();
+        }
+    }
+    if (saveBatch.due(millis())) {
+        saveAppState();
+    }
 }
 
 void saveAppState() {
@@ -648,9 +2074,14 @@ void saveAppState() {
     preferences.putUChar("visorMode", (uint8_t)appState.visorMode);
     preferences.putUChar("visorColor", (uint8_t)appState.visorColor);
     preferences.putUChar("visorBrightness", appState.visorBrightness);
-    preferences.putBool("thermalsOn", appState.thermalsOn);
+    preferences.putUChar("thermalsMode", (uint8_t)appState.thermalsMode);
     preferences.putUChar("hudStyle", (uint8_t)appState.hudStyle);
     preferences.putUChar("bootSequence", (uint8_t)appState.bootSequence);
+    preferences.putUChar("effectProgram", appState.effectProgram);
+    preferences.putUChar("radioProfile", (uint8_t)appState.radioProfile);
+    preferences.putUChar("squadRole", (uint8_t)appState.squadRole);
+    preferences.putBool("radioSleep", appState.radioSleep);
+    preferences.putBytes("accents", appState.accents, sizeof(appState.accents));
     preferences.end();
 }
 
@@ -660,9 +2091,38 @@ void loadAppState() {
     appState.visorMode = (VisorMode)preferences.getUChar("visorMode", (uint8_t)VisorMode::SOLID); // Default to SOLID
     appState.visorColor = (VisorColor)preferences.getUChar("visorColor", (uint8_t)VisorColor::BLUE); // Default to BLUE
     appState.visorBrightness = preferences.getUChar("visorBrightness", 3); // Default to 3
-    appState.thermalsOn = preferences.getBool("thermalsOn", false); // Default to false
+    // Older firmware saved an on/off switch, which was full speed
+    ThermalsMode savedThermals = preferences.getBool("thermalsOn", false) ? ThermalsMode::MAX : ThermalsMode::OFF;
+    appState.thermalsMode = (ThermalsMode)preferences.getUChar("thermalsMode", (uint8_t)savedThermals);
     appState.hudStyle = (HudStyle)preferences.getUChar("hudStyle", (uint8_t)HudStyle::BIOMETRIC); // Default to BIOMETRIC
     appState.bootSequence = (BootSequence)preferences.getUChar("bootSequence", (uint8_t)BootSequence::UNSC_LOGO); // Default to UNSC_LOGO
+    appState.effectProgram = preferences.getUChar("effectProgram", 0); // Default to the first built-in program
+    appState.radioProfile = (RadioProfile)preferences.getUChar("radioProfile", (uint8_t)RadioProfile::LOW_LATENCY); // Default to LOW_LATENCY
+    appState.squadRole = (SquadRole)preferences.getUChar("squadRole", (uint8_t)SquadRole::OFF); // Default to OFF
+    appState.radioSleep = preferences.getBool("radioSleep", false); // Default to false
+    if (preferences.getBytesLength("accents") == sizeof(appState.accents)) {
+        preferences.getBytes("accents", appState.accents, sizeof(appState.accents));
+    }
+    preferences.end();
+}
+
+// Receiver keeps the last uploaded program so PROGRAM mode works straight after boot
+void saveEffectProgram() {
+    preferences.begin("spartan-fx", false);
+    preferences.putBytes("program", effectVm.program(), effectVm.programLength());
+    preferences.end();
+}
+
+void loadEffectProgram() {
+    preferences.begin("spartan-fx", true);
+    size_t len = preferences.getBytesLength("program");
+    if (len > 0 && len <= VM_MAX_PROGRAM_LEN) {
+        uint8_t code[VM_MAX_PROGRAM_LEN];
+        preferences.getBytes("program", code, len);
+        if (effectVm.load(code, len)) {
+            loadedProgramId = crc16(code, len);
+        }
+    }
     preferences.end();
 }
 
@@ -674,9 +2134,13 @@ void parseMacAddress(const char* macStr, uint8_t* macBytes) {
 }
 
 void savePeerAddresses() {
+    uint8_t records[MAX_RECEIVERS * PEER_RECORD_LEN];
+    size_t len = receiverTable.serialize(records);
+
     preferences.begin("spartan-peers", false);
     preferences.putBytes("sendAddr", sendAddress, 6);
-    preferences.putBytes("recvAddr", recvAddress, 6);
+    preferences.putBytes("receivers", records, len);
+    preferences.remove("recvAddr"); // Superseded by the receiver table
     preferences.end();
     Serial.println("Peer addresses saved to preferences");
 }
@@ -684,28 +2148,36 @@ void savePeerAddresses() {
 bool loadPeerAddresses() {
     preferences.begin("spartan-peers", true);
     bool hasSendAddr = preferences.isKey("sendAddr");
-    bool hasRecvAddr = preferences.isKey("recvAddr");
-
-    if (hasSendAddr && hasRecvAddr) {
+    if (hasSendAddr) {
         preferences.getBytes("sendAddr", sendAddress, 6);
-        preferences.getBytes("recvAddr", recvAddress, 6);
-        preferences.end();
-
-        Serial.print("Loaded peer addresses - Interface: ");
-        for (int i = 0; i < 6; i++) {
-            Serial.printf("%02X", sendAddress[i]);
-            if (i < 5) Serial.print(":");
-        }
-        Serial.print(" Receiver: ");
-        for (int i = 0; i < 6; i++) {
-            Serial.printf("%02X", recvAddress[i]);
-            if (i < 5) Serial.print(":");
-        }
-        Serial.println();
-        return true;
     }
 
+    receiverTable.clear();
+    if (preferences.isKey("receivers")) {
+        uint8_t records[MAX_RECEIVERS * PEER_RECORD_LEN];
+        size_t len = preferences.getBytes("receivers", records, sizeof(records));
+        receiverTable.deserialize(records, len);
+    } else if (preferences.isKey("recvAddr")) {
+        // Pairing from before multi-receiver support: a single node owning everything
+        uint8_t recvAddr[6];
+        preferences.getBytes("recvAddr", recvAddr, 6);
+        receiverTable.add(recvAddr, NODE_CAP_ALL);
+    }
     preferences.end();
-    Serial.println("No saved peer addresses found, using defaults");
-    return false;
-}
\ No newline at end of file
+
+    // The interface needs at least one receiver; a receiver needs its interface
+    bool paired = isReceiver ? hasSendAddr : (hasSendAddr && receiverTable.size() > 0);
+    if (!paired) {
+        Serial.println("No saved peer addresses found, using defaults");
+        return false;
+    }
+
+    Serial.print("Loaded peer addresses - Interface: ");
+    for (int i = 0; i < 6; i++) {
+        Serial.printf("%02X", sendAddress[i]);
+        if (i < 5) Serial.print(":");
+    }
+    Serial.printf(" Receivers: %u", receiverTable.size());
+    Serial.println();
+    return true;
+}
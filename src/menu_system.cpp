@@ -3,51 +3,113 @@
 #include "state.h"
 #include "communication.h"
 #include "layout.h"
-
-extern void saveAppState(); // Forward declaration for saving app state"
+#include "effect_programs.h"
+#include "led_segments.h"
+
+// Defined in main.cpp - batches the radio update and NVS save for a burst of changes
+extern void markStateChanged(bool notifyReceivers);
+// Defined in main.cpp - opens runtime pairing and shows the pairing screen
+extern void startPairingMode();
+// Defined in main.cpp - pushes the stored receiver image to every paired receiver
+extern void startReceiverUpdateMode();
+// Defined in main.cpp - joins or leaves the squad to match appState.squadRole
+extern void applySquadRole();
 
 // --- Callback Functions ---
 
 void onVisorToggle(MenuItem* item) {
     appState.visorOn = item->currentOption;
-    sendStateUpdate();
-    saveAppState();
+    markStateChanged(true);
 }
 
 void onVisorModeChange(MenuItem* item) {
     appState.visorMode = (VisorMode)item->currentOption;
-    sendStateUpdate();
-    saveAppState();
+    markStateChanged(true);
 }
 
 void onVisorColorChange(MenuItem* item) {
     appState.visorColor = (VisorColor)item->currentOption;
-    sendStateUpdate();
-    saveAppState();
+    markStateChanged(true);
+}
+
+void onVisorEffectChange(MenuItem* item) {
+    appState.effectProgram = item->currentOption;
+    markStateChanged(true);
 }
 
 void onVisorBrightnessChange(MenuItem* item) {
     appState.visorBrightness = item->currentOption + 1; // Options are "1", "2", etc.
-    sendStateUpdate();
-    saveAppState();
+    markStateChanged(true);
+}
+
+// Accent segment the ACCENTS items edit
+static uint8_t selectedAccent = 0;
+
+void onAccentSelect(MenuItem* item) {
+    selectedAccent = item->currentOption;
+    updateMenuFromState();
+}
+
+void onAccentToggle(MenuItem* item) {
+    appState.accents[selectedAccent].on = item->currentOption;
+    markStateChanged(true);
 }
 
-void onThermalsToggle(MenuItem* item) {
-    appState.thermalsOn = item->currentOption;
-    sendStateUpdate();
-    saveAppState();
+void onAccentModeChange(MenuItem* item) {
+    appState.accents[selectedAccent].mode = (VisorMode)item->currentOption;
+    markStateChanged(true);
+}
+
+void onAccentColorChange(MenuItem* item) {
+    appState.accents[selectedAccent].color = (VisorColor)item->currentOption;
+    markStateChanged(true);
+}
+
+void onAccentBrightnessChange(MenuItem* item) {
+    appState.accents[selectedAccent].brightness = item->currentOption + 1;
+    markStateChanged(true);
+}
+
+void onThermalsModeChange(MenuItem* item) {
+    appState.thermalsMode = (ThermalsMode)item->currentOption;
+    markStateChanged(true);
 }
 
 void onHudChange(MenuItem* item) {
     appState.hudStyle = (HudStyle)item->currentOption;
     // This is a local-only change, no need to send ESP-NOW update
-    saveAppState();
+    markStateChanged(false);
 }
 
 void onBootSeqChange(MenuItem* item) {
     appState.bootSequence = (BootSequence)item->currentOption;
     // Also a local-only change
-    saveAppState();
+    markStateChanged(false);
+}
+
+void onRadioProfileChange(MenuItem* item) {
+    appState.radioProfile = (RadioProfile)item->currentOption;
+    markStateChanged(true);
+}
+
+void onRadioSleepToggle(MenuItem* item) {
+    appState.radioSleep = item->currentOption == 1;
+    markStateChanged(true);
+}
+
+void onSquadRoleChange(MenuItem* item) {
+    appState.squadRole = (SquadRole)item->currentOption;
+    // Local-only; the squad itself is joined straight away
+    markStateChanged(false);
+    applySquadRole();
+}
+
+void onPairReceivers(MenuController* controller) {
+    startPairingMode();
+}
+
+void onUpdateReceivers(MenuController* controller) {
+    startReceiverUpdateMode();
 }
 
 
@@ -56,22 +118,35 @@ void onBootSeqChange(MenuItem* item) {
 
 // --- VISOR SUBMENU ---
 const char* visorOnOffOptions[] = {"Off", "On"};
-const char* visorModeOptions[] = {"Solid", "Flashing", "Pulsing", "Strobe"};
+const char* visorModeOptions[] = {"Solid", "Flashing", "Pulsing", "Strobe", "Custom"};
 const char* visorColorOptions[] = {"White", "Blue", "Green", "Yellow", "Orange", "Red"};
 const char* visorBrightnessOptions[] = {"1", "2", "3", "4"};
 MenuItem visorMenuItems[] = {
     {"On/Off",     MenuItemType::TOGGLE, nullptr, 0, visorOnOffOptions,      2, nullptr, onVisorToggle,          0},
-    {"Mode",       MenuItemType::CYCLE,  nullptr, 0, visorModeOptions,       4, nullptr, onVisorModeChange,      0},
+    {"Mode",       MenuItemType::CYCLE,  nullptr, 0, visorModeOptions,       5, nullptr, onVisorModeChange,      0},
     {"Color",      MenuItemType::CYCLE,  nullptr, 0, visorColorOptions,      6, nullptr, onVisorColorChange,     0},
     {"Brightness", MenuItemType::CYCLE,  nullptr, 0, visorBrightnessOptions, 4, nullptr, onVisorBrightnessChange,0},
+    {"Effect",     MenuItemType::CYCLE,  nullptr, 0, effectProgramNames, EFFECT_PROGRAM_COUNT, nullptr, onVisorEffectChange, 0},
     {"<- Back",    MenuItemType::BACK,   nullptr, 0, nullptr,                0, nullptr, nullptr,                0}
 };
 
+// --- ACCENTS SUBMENU ---
+// Segment names come from the segment map at boot (loadAccentMenu)
+const char* accentNames[LED_SEGMENTS - 1] = {"None"};
+MenuItem accentMenuItems[] = {
+    {"Segment",    MenuItemType::CYCLE,  nullptr, 0, accentNames,            1, nullptr, onAccentSelect,          0},
+    {"On/Off",     MenuItemType::TOGGLE, nullptr, 0, visorOnOffOptions,      2, nullptr, onAccentToggle,          0},
+    {"Mode",       MenuItemType::CYCLE,  nullptr, 0, visorModeOptions,       5, nullptr, onAccentModeChange,      0},
+    {"Color",      MenuItemType::CYCLE,  nullptr, 0, visorColorOptions,      6, nullptr, onAccentColorChange,     0},
+    {"Brightness", MenuItemType::CYCLE,  nullptr, 0, visorBrightnessOptions, 4, nullptr, onAccentBrightnessChange,0},
+    {"<- Back",    MenuItemType::BACK,   nullptr, 0, nullptr,                0, nullptr, nullptr,                 0}
+};
+
 // --- THERMALS SUBMENU ---
-const char* thermalsOnOffOptions[] = {"Off", "On"};
+const char* thermalsModeOptions[] = {"Off", "Auto", "Max"};
 MenuItem thermalsMenuItems[] = {
-    {"On/Off",   MenuItemType::TOGGLE, nullptr, 0, thermalsOnOffOptions, 2, nullptr, onThermalsToggle, 0},
-    {"<- Back",  MenuItemType::BACK,   nullptr, 0, nullptr,              0, nullptr, nullptr,          0}
+    {"Mode",     MenuItemType::CYCLE,  nullptr, 0, thermalsModeOptions, 3, nullptr, onThermalsModeChange, 0},
+    {"<- Back",  MenuItemType::BACK,   nullptr, 0, nullptr,             0, nullptr, nullptr,              0}
 };
 
 // --- HUD SUBMENU ---
@@ -83,14 +158,23 @@ MenuItem hudMenuItems[] = {
 
 // --- SETTINGS SUBMENU ---
 const char* bootSeqOptions[] = {"UNSC Logo", "Progress Bar"};
+const char* radioProfileOptions[] = {"Fast", "Long Range", "Low Power"};
+const char* radioSleepOptions[] = {"Off", "On"};
+const char* squadRoleOptions[] = {"Off", "Member", "Lead"};
 MenuItem settingsMenuItems[] = {
-    {"Boot Sequence", MenuItemType::CYCLE,  nullptr, 0, bootSeqOptions, 2, nullptr, onBootSeqChange, 0},
-    {"<- Back",       MenuItemType::BACK,   nullptr, 0, nullptr,        0, nullptr, nullptr,         0}
+    {"Boot Sequence", MenuItemType::CYCLE,  nullptr, 0, bootSeqOptions,      2, nullptr,         onBootSeqChange,      0},
+    {"Radio",         MenuItemType::CYCLE,  nullptr, 0, radioProfileOptions, 3, nullptr,         onRadioProfileChange, 0},
+    {"Radio Sleep",   MenuItemType::TOGGLE, nullptr, 0, radioSleepOptions,   2, nullptr,         onRadioSleepToggle,   0},
+    {"Squad",         MenuItemType::CYCLE,  nullptr, 0, squadRoleOptions,    3, nullptr,         onSquadRoleChange,    0},
+    {"Pair Receivers",MenuItemType::ACTION, nullptr, 0, nullptr,             0, onPairReceivers, nullptr,              0},
+    {"Update Receivers",MenuItemType::ACTION, nullptr, 0, nullptr,           0, onUpdateReceivers, nullptr,            0},
+    {"<- Back",       MenuItemType::BACK,   nullptr, 0, nullptr,             0, nullptr,         nullptr,              0}
 };
 
 // --- MAIN MENU ---
 MenuItem mainMenuItems[] = {
     {"VISOR",    MenuItemType::SUBMENU, visorMenuItems,    sizeof(visorMenuItems) / sizeof(MenuItem),    nullptr, 0, nullptr, nullptr, 0},
+    {"ACCENTS",  MenuItemType::SUBMENU, accentMenuItems,   sizeof(accentMenuItems) / sizeof(MenuItem),   nullptr, 0, nullptr, nullptr, 0},
     {"THERMALS", MenuItemType::SUBMENU, thermalsMenuItems, sizeof(thermalsMenuItems) / sizeof(MenuItem), nullptr, 0, nullptr, nullptr, 0},
     {"HUD",      MenuItemType::SUBMENU, hudMenuItems,      sizeof(hudMenuItems) / sizeof(MenuItem),      nullptr, 0, nullptr, nullptr, 0},
     {"SETTINGS", MenuItemType::SUBMENU, settingsMenuItems, sizeof(settingsMenuItems) / sizeof(MenuItem), nullptr, 0, nullptr, nullptr, 0}
@@ -103,15 +187,35 @@ void updateMenuFromState() {
     visorMenuItems[1].currentOption = (int)appState.visorMode;
     visorMenuItems[2].currentOption = (int)appState.visorColor;
     visorMenuItems[3].currentOption = appState.visorBrightness - 1;
+    visorMenuItems[4].currentOption = appState.effectProgram % EFFECT_PROGRAM_COUNT;
+
+    // Accents - the segment picked in the first item
+    const SegmentState& accent = appState.accents[selectedAccent];
+    accentMenuItems[0].currentOption = selectedAccent;
+    accentMenuItems[1].currentOption = accent.on ? 1 : 0;
+    accentMenuItems[2].currentOption = (int)accent.mode;
+    accentMenuItems[3].currentOption = (int)accent.color;
+    accentMenuItems[4].currentOption = accent.brightness - 1;
 
     // Thermals
-    thermalsMenuItems[0].currentOption = appState.thermalsOn ? 1 : 0;
+    thermalsMenuItems[0].currentOption = (int)appState.thermalsMode;
 
     // HUD
     hudMenuItems[0].currentOption = (int)appState.hudStyle;
 
     // Settings
     settingsMenuItems[0].currentOption = (int)appState.bootSequence;
+    settingsMenuItems[1].currentOption = (int)appState.radioProfile;
+    settingsMenuItems[2].currentOption = appState.radioSleep ? 1 : 0;
+    settingsMenuItems[3].currentOption = (int)appState.squadRole;
+}
+
+void loadAccentMenu(const LedSegmentMap& segments) {
+    uint8_t count = segments.count() - 1;
+    for (uint8_t i = 0; i < count; i++) {
+        accentNames[i] = segments.name(i + 1);
+    }
+    accentMenuItems[0].numOptions = count > 0 ? count : 1;
 }
 
 
@@ -0,0 +1,357 @@
+#include "ota.h"
+#include <string.h>
+
+static inline bool bitSet(const uint8_t* bits, uint32_t index) {
+    return bits[index / 8] & (1 << (index % 8));
+}
+
+static inline uint32_t chunkBytes(uint32_t imageLen, uint32_t index) {
+    uint32_t offset = index * OTA_CHUNK_LEN;
+    return imageLen - offset < OTA_CHUNK_LEN ? imageLen - offset : OTA_CHUNK_LEN;
+}
+
+// --- Host stand-ins ---
+
+MemoryImageSource::MemoryImageSource(const uint8_t* data, uint32_t len) : data(data), len(len) {
+    Sha256 hash;
+    hash.update(data, len);
+    hash.finish(digest);
+}
+
+bool MemoryImageSource::read(uint32_t offset, uint8_t* out, size_t count) {
+    if (offset > len || count > len - offset) {
+        return false;
+    }
+    memcpy(out, data + offset, count);
+    return true;
+}
+
+bool MemoryImageSink::begin(uint32_t imageLen) {
+    if (imageLen > capacity) {
+        return false;
+    }
+    len = imageLen;
+    committed = false;
+    return true;
+}
+
+bool MemoryImageSink::write(uint32_t offset, const uint8_t* data, size_t count) {
+    if (offset > len || count > len - offset) {
+        return false;
+    }
+    memcpy(buffer + offset, data, count);
+    return true;
+}
+
+bool MemoryImageSink::read(uint32_t offset, uint8_t* out, size_t count) {
+    if (offset > len || count > len - offset) {
+        return false;
+    }
+    memcpy(out, buffer + offset, count);
+    return true;
+}
+
+// --- Sender ---
+
+void OtaSender::begin(OtaImageSource& image, uint32_t nowMs) {
+    source = &image;
+    offer.imageLen = image.length();
+    memcpy(offer.sha256, image.sha256(), SHA256_DIGEST_LEN);
+    memcpy(&offer.sessionId, offer.sha256, sizeof(offer.sessionId));
+    chunks = (offer.imageLen + OTA_CHUNK_LEN - 1) / OTA_CHUNK_LEN;
+    verifyAttempts = 0;
+    base = 0;
+    memset(bitmap, 0, sizeof(bitmap));
+    cursor = 0;
+    roundEnd = 0;
+    inFlight = false;
+    lastDelivered = true;
+    lastHeardMs = nowMs;
+    lastPollMs = nowMs - OTA_POLL_MS;   // Offer straight away
+    started = false;
+    startMs = nowMs;
+    endMs = nowMs;
+    sentChunks = 0;
+    failures = 0;
+    state = (chunks == 0 || chunks > OTA_MAX_CHUNKS) ? State::FAILED : State::OFFERING;
+}
+
+bool OtaSender::missing(uint32_t index) const {
+    if (index < base) {
+        return false;
+    }
+    uint32_t offset = index - base;
+    return offset >= OTA_STATUS_SPAN || !bitSet(bitmap, offset);
+}
+
+int32_t OtaSender::nextMissing(uint32_t from) const {
+    // Only the span of the last status is known
+    uint32_t limit = base + OTA_STATUS_SPAN < chunks ? base + OTA_STATUS_SPAN : chunks;
+    for (uint32_t i = from < base ? base : from; i < limit; i++) {
+        if (missing(i)) {
+            return (int32_t)i;
+        }
+    }
+    return -1;
+}
+
+void OtaSender::startRound() {
+    cursor = base;
+    roundEnd = base;
+    uint8_t count = 0;
+    int32_t next = nextMissing(base);
+    while (next >= 0 && count < OTA_WINDOW) {
+        count++;
+        roundEnd = next + 1;
+        next = nextMissing(next + 1);
+    }
+    state = count > 0 ? State::SENDING : State::WAITING;
+}
+
+size_t OtaSender::poll(uint32_t nowMs, uint8_t* out) {
+    if (!active()) {
+        return 0;
+    }
+    if (nowMs - lastHeardMs >= OTA_GIVE_UP_MS) {
+        state = State::FAILED;
+        endMs = nowMs;
+        return 0;
+    }
+    if (inFlight.load(std::memory_order_acquire)) {
+        if (nowMs - lastSendMs < OTA_IN_FLIGHT_TIMEOUT_MS) {
+            return 0;
+        }
+        inFlight = false;   // The send status never came
+    }
+
+    size_t len = 0;
+    if (state == State::SENDING) {
+        int32_t next = nextMissing(cursor);
+        if (next >= 0 && (uint32_t)next < roundEnd) {
+            int32_t after = nextMissing(next + 1);
+            bool last = after < 0 || (uint32_t)after >= roundEnd;
+
+            OtaChunkHeader chunk;
+            chunk.sessionId = offer.sessionId;
+            chunk.index = (uint16_t)next;
+            chunk.flags = last ? OTA_FLAG_STATUS_REQUEST : 0;
+            uint32_t count = chunkBytes(offer.imageLen, next);
+            len = encodeHeader(out, MessageType::OTA_CHUNK, (uint16_t)next);
+            memcpy(out + len, &chunk, sizeof(chunk));
+            len += sizeof(chunk);
+            if (!source->read(next * OTA_CHUNK_LEN, out + len, count)) {
+                state = State::FAILED;
+                endMs = nowMs;
+                return 0;
+            }
+            len += count;
+            cursor = next + 1;
+            sentChunks++;
+            if (last) {
+                state = State::WAITING;
+                lastPollMs = nowMs;
+            }
+        } else {
+            // A newer status already covered the rest of the round
+            state = State::WAITING;
+            lastPollMs = nowMs - OTA_POLL_MS;
+        }
+    }
+
+    // Offers start the transfer and, while waiting, ask for a status again
+    bool pollDue = nowMs - lastPollMs >= OTA_POLL_MS || !lastDelivered.load(std::memory_order_acquire);
+    if (len == 0 && state != State::SENDING && pollDue) {
+        len = encodeHeader(out, MessageType::OTA_OFFER, 0);
+        memcpy(out + len, &offer, sizeof(offer));
+        len += sizeof(offer);
+        lastPollMs = nowMs;
+    }
+
+    if (len > 0) {
+        lastSendMs = nowMs;
+        lastDelivered = true;
+        inFlight.store(true, std::memory_order_release);
+    }
+    return len;
+}
+
+void OtaSender::sent(bool delivered) {
+    if (!delivered) {
+        failures.fetch_add(1, std::memory_order_relaxed);
+    }
+    lastDelivered.store(delivered, std::memory_order_release);
+    inFlight.store(false, std::memory_order_release);
+}
+
+void OtaSender::receive(const uint8_t* data, size_t len, uint32_t nowMs) {
+    FrameHeader header;
+    if (!decodeHeader(data, len, header) || header.type != MessageType::OTA_STATUS ||
+        len < sizeof(FrameHeader) + sizeof(OtaStatus)) {
+        return;
+    }
+    OtaStatus status;
+    memcpy(&status, data + sizeof(FrameHeader), sizeof(status));
+    if (!active() || status.sessionId != offer.sessionId) {
+        return;
+    }
+    lastHeardMs = nowMs;
+
+    switch (status.state) {
+        case OtaState::COMPLETE:
+            base = chunks;
+            state = State::DONE;
+            endMs = nowMs;
+            return;
+        case OtaState::REJECTED:
+            state = State::FAILED;
+            endMs = nowMs;
+            return;
+        case OtaState::VERIFY_FAILED:
+            // The receiver dropped what it had; the next offer starts over
+            if (++verifyAttempts >= OTA_VERIFY_ATTEMPTS) {
+                state = State::FAILED;
+                endMs = nowMs;
+                return;
+            }
+            base = 0;
+            memset(bitmap, 0, sizeof(bitmap));
+            state = State::OFFERING;
+            lastPollMs = nowMs - OTA_POLL_MS;
+            return;
+        case OtaState::RECEIVING:
+            break;
+        default:
+            return;
+    }
+
+    if (!started) {
+        started = true;
+        startMs = nowMs;
+    }
+    base = status.base;
+    memcpy(bitmap, status.bitmap, sizeof(bitmap));
+    if (state != State::SENDING) {
+        startRound();
+    }
+}
+
+float OtaSender::kbPerSec() const {
+    if (state != State::DONE || elapsedMs() == 0) {
+        return 0.0f;
+    }
+    return offer.imageLen / 1024.0f / (elapsedMs() / 1000.0f);
+}
+
+// --- Receiver ---
+
+size_t OtaReceiver::handle(const uint8_t* data, size_t len, uint8_t* out) {
+    FrameHeader header;
+    if (!decodeHeader(data, len, header)) {
+        return 0;
+    }
+    const uint8_t* body = data + sizeof(FrameHeader);
+    size_t bodyLen = len - sizeof(FrameHeader);
+    if (header.type == MessageType::OTA_OFFER && bodyLen >= sizeof(OtaOffer)) {
+        OtaOffer incoming;
+        memcpy(&incoming, body, sizeof(incoming));
+        return acceptOffer(incoming, out);
+    }
+    if (header.type == MessageType::OTA_CHUNK && bodyLen > sizeof(OtaChunkHeader)) {
+        OtaChunkHeader chunk;
+        memcpy(&chunk, body, sizeof(chunk));
+        return acceptChunk(chunk, body + sizeof(chunk), bodyLen - sizeof(chunk), out);
+    }
+    return 0;
+}
+
+size_t OtaReceiver::acceptOffer(const OtaOffer& incoming, uint8_t* out) {
+    // The image we already hold (partly or whole): report where it stands
+    if (hasSession && incoming.sessionId == offer.sessionId && incoming.imageLen == offer.imageLen &&
+        memcmp(incoming.sha256, offer.sha256, SHA256_DIGEST_LEN) == 0) {
+        return encodeStatus(out, offer.sessionId, state);
+    }
+
+    if (hasSession && state == OtaState::RECEIVING) {
+        sink.abort();
+    }
+    hasSession = false;
+    if (incoming.imageLen == 0 || incoming.imageLen > OTA_MAX_IMAGE_LEN || !sink.begin(incoming.imageLen)) {
+        return encodeStatus(out, incoming.sessionId, OtaState::REJECTED);
+    }
+
+    offer = incoming;
+    chunks = (offer.imageLen + OTA_CHUNK_LEN - 1) / OTA_CHUNK_LEN;
+    received = 0;
+    firstMissing = 0;
+    memset(bitmap, 0, (chunks + 7) / 8);
+    state = OtaState::RECEIVING;
+    hasSession = true;
+    return encodeStatus(out, offer.sessionId, state);
+}
+
+size_t OtaReceiver::acceptChunk(const OtaChunkHeader& chunk, const uint8_t* data, size_t len, uint8_t* out) {
+    if (!hasSession || state != OtaState::RECEIVING || chunk.sessionId != offer.sessionId ||
+        chunk.index >= chunks || len != chunkBytes(offer.imageLen, chunk.index)) {
+        return 0;
+    }
+
+    if (!bitSet(bitmap, chunk.index)) {
+        if (!sink.write(chunk.index * OTA_CHUNK_LEN, data, len)) {
+            sink.abort();
+            state = OtaState::REJECTED;
+            return encodeStatus(out, offer.sessionId, state);
+        }
+        bitmap[chunk.index / 8] |= 1 << (chunk.index % 8);
+        received++;
+        while (firstMissing < chunks && bitSet(bitmap, firstMissing)) {
+            firstMissing++;
+        }
+    }
+
+    if (received == chunks) {
+        if (verify()) {
+            state = sink.commit() ? OtaState::COMPLETE : OtaState::REJECTED;
+        } else {
+            // Start over on the next offer rather than trust any of it
+            sink.abort();
+            hasSession = false;
+            state = OtaState::VERIFY_FAILED;
+        }
+        return encodeStatus(out, offer.sessionId, state);
+    }
+    return (chunk.flags & OTA_FLAG_STATUS_REQUEST) ? encodeStatus(out, offer.sessionId, state) : 0;
+}
+
+bool OtaReceiver::verify() {
+    // Hash what actually landed in the sink, not what went past in frames
+    Sha256 hash;
+    uint8_t block[256];
+    for (uint32_t offset = 0; offset < offer.imageLen; offset += sizeof(block)) {
+        size_t count = offer.imageLen - offset < sizeof(block) ? offer.imageLen - offset : sizeof(block);
+        if (!sink.read(offset, block, count)) {
+            return false;
+        }
+        hash.update(block, count);
+    }
+    uint8_t digest[SHA256_DIGEST_LEN];
+    hash.finish(digest);
+    return memcmp(digest, offer.sha256, SHA256_DIGEST_LEN) == 0;
+}
+
+size_t OtaReceiver::encodeStatus(uint8_t* out, uint32_t statusSession, OtaState statusState) {
+    OtaStatus status;
+    status.sessionId = statusSession;
+    status.state = statusState;
+    status.base = (uint16_t)firstMissing;
+    memset(status.bitmap, 0, sizeof(status.bitmap));
+    if (statusState == OtaState::RECEIVING) {
+        for (uint32_t i = 0; i < OTA_STATUS_SPAN && firstMissing + i < chunks; i++) {
+            if (bitSet(bitmap, firstMissing + i)) {
+                status.bitmap[i / 8] |= 1 << (i % 8);
+            }
+        }
+    }
+    size_t len = encodeHeader(out, MessageType::OTA_STATUS, 0);
+    memcpy(out + len, &status, sizeof(status));
+    return len + sizeof(status);
+}
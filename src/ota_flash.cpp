@@ -0,0 +1,77 @@
+#ifdef ARDUINO
+
+#include "ota_flash.h"
+#include <Arduino.h>
+#include <esp_ota_ops.h>
+#include <string.h>
+
+#define FLASH_SECTOR_LEN 4096
+
+bool PartitionImageSource::open() {
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, RX_IMAGE_PARTITION_LABEL);
+    if (!partition) {
+        Serial.println("No " RX_IMAGE_PARTITION_LABEL " partition");
+        return false;
+    }
+    if (esp_partition_read(partition, 0, &header, sizeof(header)) != ESP_OK || header.magic != RX_IMAGE_MAGIC ||
+        header.length == 0 || header.length > partition->size - sizeof(header)) {
+        Serial.println("No receiver image stored");
+        return false;
+    }
+    return true;
+}
+
+bool PartitionImageSource::read(uint32_t offset, uint8_t* out, size_t len) {
+    if (!partition || offset > header.length || len > header.length - offset) {
+        return false;
+    }
+    return esp_partition_read(partition, sizeof(header) + offset, out, len) == ESP_OK;
+}
+
+bool OtaPartitionSink::begin(uint32_t len) {
+    partition = esp_ota_get_next_update_partition(nullptr);
+    if (!partition || len > partition->size || len > OTA_MAX_IMAGE_LEN) {
+        Serial.println("No update slot large enough for the offered image");
+        partition = nullptr;
+        return false;
+    }
+    imageLen = len;
+    memset(erased, 0, sizeof(erased));
+    Serial.printf("Receiving %lu byte image into %s\n", (unsigned long)len, partition->label);
+    return true;
+}
+
+bool OtaPartitionSink::write(uint32_t offset, const uint8_t* data, size_t len) {
+    if (!partition || offset > imageLen || len > imageLen - offset) {
+        return false;
+    }
+    for (uint32_t sector = offset / FLASH_SECTOR_LEN; sector <= (offset + len - 1) / FLASH_SECTOR_LEN; sector++) {
+        if (erased[sector / 8] & (1 << (sector % 8))) {
+            continue;
+        }
+        if (esp_partition_erase_range(partition, sector * FLASH_SECTOR_LEN, FLASH_SECTOR_LEN) != ESP_OK) {
+            return false;
+        }
+        erased[sector / 8] |= 1 << (sector % 8);
+    }
+    return esp_partition_write(partition, offset, data, len) == ESP_OK;
+}
+
+bool OtaPartitionSink::read(uint32_t offset, uint8_t* out, size_t len) {
+    if (!partition || offset > imageLen || len > imageLen - offset) {
+        return false;
+    }
+    return esp_partition_read(partition, offset, out, len) == ESP_OK;
+}
+
+bool OtaPartitionSink::commit() {
+    // Validates the app image before switching, so a well-hashed but unbootable file is refused too
+    if (!partition || esp_ota_set_boot_partition(partition) != ESP_OK) {
+        Serial.println("Update slot holds no valid app image");
+        return false;
+    }
+    Serial.printf("Boot partition set to %s\n", partition->label);
+    return true;
+}
+
+#endif
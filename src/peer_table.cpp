@@ -0,0 +1,86 @@
+#include "peer_table.h"
+#include <string.h>
+
+int PeerTable::add(const uint8_t* mac, uint8_t capabilities) {
+    int index = find(mac);
+    if (index < 0) {
+        if (count >= MAX_RECEIVERS) {
+            return -1;
+        }
+        index = count++;
+        nodes[index] = ReceiverNode();
+        memcpy(nodes[index].mac, mac, 6);
+    }
+    nodes[index].capabilities = capabilities;
+    return index;
+}
+
+int PeerTable::find(const uint8_t* mac) const {
+    for (uint8_t i = 0; i < count; i++) {
+        if (memcmp(nodes[i].mac, mac, 6) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+size_t PeerTable::serialize(uint8_t* out) const {
+    for (uint8_t i = 0; i < count; i++) {
+        memcpy(out + i * PEER_RECORD_LEN, nodes[i].mac, 6);
+        out[i * PEER_RECORD_LEN + 6] = nodes[i].capabilities;
+    }
+    return count * PEER_RECORD_LEN;
+}
+
+void PeerTable::deserialize(const uint8_t* data, size_t len) {
+    clear();
+    for (size_t offset = 0; offset + PEER_RECORD_LEN <= len; offset += PEER_RECORD_LEN) {
+        add(data + offset, data[offset + 6]);
+    }
+}
+
+void PeerTable::beginAckRound(uint16_t seq, uint32_t nowUs) {
+    roundSeq = seq;
+    roundStartUs = nowUs;
+    for (uint8_t i = 0; i < count; i++) {
+        nodes[i].awaitingAck = true;
+    }
+}
+
+bool PeerTable::recordAck(const uint8_t* mac, uint16_t seq, uint32_t nowUs) {
+    int index = find(mac);
+    if (index < 0 || seq != roundSeq) {
+        return false;
+    }
+
+    ReceiverNode& node = nodes[index];
+    if (!node.awaitingAck) {
+        return true; // Duplicate ack from a retransmission
+    }
+    node.awaitingAck = false;
+    node.acked++;
+    node.lastRttUs = nowUs - roundStartUs;
+    if (node.lastRttUs > node.maxRttUs) {
+        node.maxRttUs = node.lastRttUs;
+    }
+    return true;
+}
+
+uint8_t PeerTable::pendingCount() const {
+    uint8_t pending = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        if (nodes[i].awaitingAck) {
+            pending++;
+        }
+    }
+    return pending;
+}
+
+void PeerTable::expireAckRound() {
+    for (uint8_t i = 0; i < count; i++) {
+        if (nodes[i].awaitingAck) {
+            nodes[i].awaitingAck = false;
+            nodes[i].missed++;
+        }
+    }
+}
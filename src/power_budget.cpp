@@ -0,0 +1,73 @@
+#include "power_budget.h"
+#include "led_segments.h"
+
+// Fans are driven together at one duty
+#define FAN_COUNT 2
+
+static const float ledIdleMa = LED_CHAIN_LEN * POWER_LED_IDLE_MA;
+// Frames are rounded or dithered to 8-bit steps, so one can land up to a step per
+// channel above its allowance
+static const float ledRoundingMa = LED_CHAIN_LEN * 3 * POWER_LED_CHANNEL_MA / 255;
+
+float PowerBudget::frameMa(const uint32_t sums[3]) {
+    return ((float)sums[0] + sums[1] + sums[2]) * POWER_LED_CHANNEL_MA / 65535;
+}
+
+void PowerBudget::setBaseMa(float ma) {
+    baseMa = ma;
+    share();
+}
+
+void PowerBudget::setHot(bool isHot) {
+    hot = isHot;
+    share();
+}
+
+// What the budget leaves for the LEDs and fans after the base and idle draw
+float PowerBudget::available() const {
+    float left = POWER_BUDGET_MA - baseMa - ledIdleMa - ledRoundingMa;
+    return left > 0 ? left : 0;
+}
+
+// Splits what is available between the LEDs' and fans' demands
+void PowerBudget::share() {
+    float left = available();
+    float demand = ledRequestMa + fanRequestMa;
+    if (demand <= left) {
+        ledGrantMa = ledRequestMa;
+        fanGrantMa = fanRequestMa;
+    } else if (hot) {
+        fanGrantMa = fanRequestMa < left ? fanRequestMa : left;
+        ledGrantMa = left - fanGrantMa;
+    } else {
+        float share = left / demand;
+        ledGrantMa = ledRequestMa * share;
+        fanGrantMa = fanRequestMa * share;
+    }
+}
+
+uint8_t PowerBudget::fanDuty(uint8_t requested) {
+    fanRequestMa = requested * (FAN_COUNT * POWER_FAN_MA) / 255;
+    share();
+    float room = available() - ledDrawMa;
+    fanDrawMa = fanGrantMa < room ? fanGrantMa : (room > 0 ? room : 0);
+    if (fanDrawMa >= fanRequestMa) {
+        return requested;
+    }
+    return (uint8_t)(requested * fanDrawMa / fanRequestMa);
+}
+
+uint16_t PowerBudget::ledScale(const uint32_t sums[3]) {
+    ledRequestMa = frameMa(sums);
+    share();
+    float room = available() - fanDrawMa;
+    ledDrawMa = ledGrantMa < room ? ledGrantMa : (room > 0 ? room : 0);
+    if (ledDrawMa >= ledRequestMa) {
+        return 65535;
+    }
+    return (uint16_t)(ledDrawMa / ledRequestMa * 65535);
+}
+
+float PowerBudget::totalMa() const {
+    return baseMa + ledIdleMa + ledDrawMa + fanDrawMa;
+}
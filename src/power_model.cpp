@@ -0,0 +1,53 @@
+#include "power_model.h"
+
+static const float stateMa[] = {POWER_RADIO_RX_MA, POWER_CPU_MA, POWER_LIGHT_SLEEP_MA};
+
+void PowerModel::restart(PowerState newState, int64_t nowUs) {
+    state = newState;
+    enteredUs = nowUs;
+    startUs = nowUs;
+    timeUs[0] = timeUs[1] = timeUs[2] = 0;
+    txUs = 0;
+}
+
+void PowerModel::enter(PowerState newState, int64_t nowUs) {
+    if (newState == state) {
+        return;
+    }
+    timeUs[(uint8_t)state] += nowUs - enteredUs;
+    state = newState;
+    enteredUs = nowUs;
+}
+
+void PowerModel::noteSent(uint32_t frames, uint32_t bytes, uint16_t phyKbps) {
+    if (phyKbps == 0) {
+        return;
+    }
+    txUs += frames * (int64_t)POWER_TX_OVERHEAD_US + bytes * 8000LL / phyKbps;
+}
+
+int64_t PowerModel::elapsedIn(PowerState which, int64_t nowUs) const {
+    int64_t t = timeUs[(uint8_t)which];
+    if (which == state) {
+        t += nowUs - enteredUs;
+    }
+    return t;
+}
+
+float PowerModel::averageMa(int64_t nowUs) const {
+    int64_t total = nowUs - startUs;
+    if (total <= 0) {
+        return stateMa[(uint8_t)state];
+    }
+    float charge = 0;
+    for (uint8_t i = 0; i < 3; i++) {
+        charge += stateMa[i] * elapsedIn((PowerState)i, nowUs);
+    }
+    charge += (POWER_RADIO_TX_MA - POWER_RADIO_RX_MA) * txUs;
+    return charge / total;
+}
+
+float PowerModel::share(PowerState which, int64_t nowUs) const {
+    int64_t total = nowUs - startUs;
+    return total > 0 ? (float)elapsedIn(which, nowUs) / total : (which == state ? 1.0f : 0.0f);
+}
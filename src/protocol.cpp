@@ -0,0 +1,91 @@
+#include "protocol.h"
+#include <string.h>
+
+size_t encodeHeader(uint8_t* out, MessageType type, uint16_t seq) {
+    FrameHeader header = {PROTOCOL_MAGIC, type, seq};
+    memcpy(out, &header, sizeof(header));
+    return sizeof(header);
+}
+
+bool decodeHeader(const uint8_t* data, size_t len, FrameHeader& header) {
+    if (len < sizeof(FrameHeader)) {
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    return header.magic == PROTOCOL_MAGIC;
+}
+
+bool decodeEmergencyStop(const uint8_t* data, size_t len, EmergencyStop& out) {
+    FrameHeader header;
+    if (!decodeHeader(data, len, header) || header.type != MessageType::EMERGENCY_STOP ||
+        len < sizeof(FrameHeader) + sizeof(EmergencyStop)) {
+        return false;
+    }
+    memcpy(&out, data + sizeof(FrameHeader), sizeof(out));
+    return true;
+}
+
+size_t encodeStateFrame(uint8_t* out, uint16_t seq, const NodeCommand* entries, uint8_t count) {
+    if (count > NODES_PER_STATE_FRAME) {
+        count = NODES_PER_STATE_FRAME;
+    }
+    size_t len = encodeHeader(out, MessageType::STATE_UPDATE, seq);
+    out[len++] = count;
+    memcpy(out + len, entries, count * sizeof(NodeCommand));
+    return len + count * sizeof(NodeCommand);
+}
+
+bool findNodeCommand(const uint8_t* data, size_t len, const uint8_t* mac, CommandPayload& out) {
+    if (len < STATE_FRAME_FIXED_LEN) {
+        return false;
+    }
+    uint8_t count = data[sizeof(FrameHeader)];
+    if (len < STATE_FRAME_FIXED_LEN + count * sizeof(NodeCommand)) {
+        return false;
+    }
+
+    const uint8_t* entry = data + STATE_FRAME_FIXED_LEN;
+    for (uint8_t i = 0; i < count; i++, entry += sizeof(NodeCommand)) {
+        if (memcmp(entry, mac, 6) == 0) {
+            memcpy(&out, entry + 6, sizeof(CommandPayload));
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t encodeRelayFrame(uint8_t* out, uint16_t relaySeq, const RelayHeader& relay,
+                        const uint8_t* inner, size_t innerLen) {
+    if (innerLen + RELAY_FRAME_OVERHEAD > PROTOCOL_MAX_FRAME_LEN) {
+        return 0;
+    }
+    size_t len = encodeHeader(out, MessageType::RELAY, relaySeq);
+    memcpy(out + len, &relay, sizeof(relay));
+    len += sizeof(relay);
+    memcpy(out + len, inner, innerLen);
+    return len + innerLen;
+}
+
+bool decodeRelayFrame(const uint8_t* data, size_t len, RelayHeader& relay,
+                      const uint8_t*& inner, size_t& innerLen) {
+    FrameHeader header;
+    if (len < RELAY_FRAME_OVERHEAD + sizeof(FrameHeader)) {
+        return false;
+    }
+    memcpy(&relay, data + sizeof(FrameHeader), sizeof(relay));
+    inner = data + RELAY_FRAME_OVERHEAD;
+    innerLen = len - RELAY_FRAME_OVERHEAD;
+    // Relays never nest
+    return decodeHeader(inner, innerLen, header) && header.type != MessageType::RELAY;
+}
+
+uint16_t crc16(const uint8_t* data, size_t len) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
@@ -0,0 +1,60 @@
+#include "radio_profile.h"
+
+// LOW_LATENCY: 24 Mbps OFDM keeps frames short; full power, never sleeps.
+// LONG_RANGE: Espressif 802.11 LR at 250 kbps, about 4x the range of 11b; full power, never sleeps.
+// LOW_POWER: 11 Mbps 11b at reduced power with modem sleep between beacons.
+static const RadioProfileLimits limits[] = {
+    {80, -82, 24000},
+    {80, -100, 250},
+    {40, -88, 11000},
+};
+
+RadioProfileLimits radioProfileLimits(RadioProfile profile) {
+    return limits[(uint8_t)profile % (sizeof(limits) / sizeof(limits[0]))];
+}
+
+#ifdef ARDUINO
+
+#include <Arduino.h>
+#include <esp_wifi.h>
+
+struct RadioProfileSettings {
+    wifi_phy_rate_t rate;
+    wifi_ps_type_t powerSave;
+};
+
+static const RadioProfileSettings settings[] = {
+    {WIFI_PHY_RATE_24M, WIFI_PS_NONE},
+    {WIFI_PHY_RATE_LORA_250K, WIFI_PS_NONE},
+    {WIFI_PHY_RATE_11M_L, WIFI_PS_MIN_MODEM},
+};
+
+bool applyRadioProfile(RadioProfile profile) {
+    uint8_t index = (uint8_t)profile % (sizeof(settings) / sizeof(settings[0]));
+    bool ok = esp_wifi_set_protocol(WIFI_IF_STA, WIFI_PROTOCOL_11B | WIFI_PROTOCOL_11G |
+                                                 WIFI_PROTOCOL_11N | WIFI_PROTOCOL_LR) == ESP_OK;
+    ok = esp_wifi_config_espnow_rate(WIFI_IF_STA, settings[index].rate) == ESP_OK && ok;
+    ok = esp_wifi_set_ps(settings[index].powerSave) == ESP_OK && ok;
+    ok = setRadioTxPower(limits[index].maxTxPower) && ok;
+    if (!ok) {
+        Serial.printf("Radio profile %u partly applied\n", index);
+    }
+    return ok;
+}
+
+bool setRadioTxPower(int8_t power) {
+    return esp_wifi_set_max_tx_power(power) == ESP_OK;
+}
+
+#else
+
+// Host nodes have no PHY to configure
+bool applyRadioProfile(RadioProfile) {
+    return true;
+}
+
+bool setRadioTxPower(int8_t) {
+    return true;
+}
+
+#endif
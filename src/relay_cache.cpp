@@ -0,0 +1,19 @@
+#include "relay_cache.h"
+#include <string.h>
+
+bool RelayCache::firstSighting(const uint8_t* origin, uint16_t relaySeq) {
+    for (uint8_t i = 0; i < count; i++) {
+        if (entries[i].seq == relaySeq && memcmp(entries[i].origin, origin, 6) == 0) {
+            return false;
+        }
+    }
+
+    Entry& entry = entries[next];
+    memcpy(entry.origin, origin, 6);
+    entry.seq = relaySeq;
+    next = (next + 1) % RELAY_SEEN_CACHE;
+    if (count < RELAY_SEEN_CACHE) {
+        count++;
+    }
+    return true;
+}
@@ -0,0 +1,50 @@
+#include "rx_queue.h"
+#include <string.h>
+
+bool RxQueue::push(const uint8_t* mac, const uint8_t* data, int len, int64_t rxUs, int8_t rssi) {
+    if (len <= 0 || len > RX_FRAME_MAX_LEN) {
+        dropCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    uint8_t h = head.load(std::memory_order_relaxed);
+    uint8_t next = (h + 1) % RX_QUEUE_DEPTH;
+    if (next == tail.load(std::memory_order_acquire)) {
+        // Full - keep the frames already queued, drop the newest
+        dropCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    RxFrame& slot = slots[h];
+    slot.rxUs = rxUs;
+    memcpy(slot.mac, mac, sizeof(slot.mac));
+    slot.rssi = rssi;
+    slot.hops = 0;
+    memset(slot.via, 0, sizeof(slot.via));
+    slot.len = (uint8_t)len;
+    memcpy(slot.data, data, len);
+
+    // Publish the slot only after its contents are written
+    head.store(next, std::memory_order_release);
+    return true;
+}
+
+bool RxQueue::pop(RxFrame& out) {
+    uint8_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    const RxFrame& slot = slots[t];
+    out.rxUs = slot.rxUs;
+    memcpy(out.mac, slot.mac, sizeof(out.mac));
+    out.rssi = slot.rssi;
+    out.hops = slot.hops;
+    memcpy(out.via, slot.via, sizeof(out.via));
+    out.len = slot.len;
+    memcpy(out.data, slot.data, slot.len);
+
+    // Hand the slot back to the producer only after it has been copied out
+    tail.store((t + 1) % RX_QUEUE_DEPTH, std::memory_order_release);
+    return true;
+}
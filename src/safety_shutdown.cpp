@@ -0,0 +1,37 @@
+#include "safety_shutdown.h"
+
+#define WARNING_COLOR 0xFF0000
+
+void SafetyShutdown::begin(uint32_t nowMs) {
+    if (active()) {
+        return;
+    }
+    current = Phase::FLASHING;
+    phaseStartMs = nowMs;
+    leds.setOverlay(WARNING_COLOR, Wave::SQUARE, SHUTDOWN_FLASH_INTERVAL_MS * 2, 65535, nowMs);
+}
+
+void SafetyShutdown::service(uint32_t nowMs) {
+    if (current == Phase::FLASHING && nowMs - phaseStartMs >= SHUTDOWN_FLASH_DURATION_MS) {
+        // The fade starts where the flashing was due to end, however late this call is
+        current = Phase::FADING;
+        phaseStartMs += SHUTDOWN_FLASH_DURATION_MS;
+        leds.setOverlay(WARNING_COLOR, Wave::CONSTANT, 0, 65535, phaseStartMs);
+    }
+    if (current == Phase::FADING) {
+        uint32_t elapsed = nowMs - phaseStartMs;
+        if (elapsed >= SHUTDOWN_FADE_DURATION_MS) {
+            abort();
+            return;
+        }
+        // Even to the eye: the overlay level is perceptual
+        leds.setOverlayLevel(65535 - elapsed * 65535 / SHUTDOWN_FADE_DURATION_MS);
+    }
+}
+
+void SafetyShutdown::abort() {
+    if (active()) {
+        leds.clearOverlay();
+    }
+    current = Phase::IDLE;
+}
@@ -0,0 +1,60 @@
+#ifdef ARDUINO
+
+#include "safety_watchdog.h"
+#include "layout.h"
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <esp_task_wdt.h>
+#include <atomic>
+
+static esp_timer_handle_t timer = nullptr;
+static LedcFanOutput* fanOutput = nullptr;
+static std::atomic<bool> expired{false};
+
+// Runs in the esp_timer task, which outranks our tasks and keeps running when they hang
+static void onDeadline(void* arg) {
+    fanOutput->halt(FAN_HALT_WATCHDOG);
+    expired.store(true, std::memory_order_release);
+}
+
+bool SafetyWatchdog::begin(LedcFanOutput& fans) {
+    fanOutput = &fans;
+    esp_timer_create_args_t args = {};
+    args.callback = onDeadline;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "safety";
+    if (esp_timer_create(&args, &timer) != ESP_OK) {
+        Serial.println("Error creating the safety watchdog timer");
+        return false;
+    }
+    return true;
+}
+
+void SafetyWatchdog::feed() {
+    if (!timer) {
+        return;
+    }
+    // Stopping a timer that already fired fails harmlessly
+    esp_timer_stop(timer);
+    esp_timer_start_once(timer, RECEIVER_TIMEOUT_MS * 1000ULL);
+    // The interface is back: a deadline comms hadn't handled yet no longer matters
+    expired.store(false, std::memory_order_release);
+    fanOutput->release(FAN_HALT_WATCHDOG);
+}
+
+bool SafetyWatchdog::takeExpired() {
+    return expired.exchange(false, std::memory_order_acq_rel);
+}
+
+// The Arduino cores start the task watchdog with a 5 s timeout
+void SafetyWatchdog::supervise() {
+    if (esp_task_wdt_add(nullptr) != ESP_OK) {
+        Serial.println("Error adding a task to the task watchdog");
+    }
+}
+
+void SafetyWatchdog::checkIn() {
+    esp_task_wdt_reset();
+}
+
+#endif
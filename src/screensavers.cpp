@@ -1,6 +1,7 @@
 #include "screensavers.h"
 #include "layout.h"
 #include "spartan_image.h"
+#include "communication.h"
 #include <Arduino.h>
 
 // --- Matrix Screen Saver ---
@@ -307,6 +308,42 @@ static void drawBioLabels(TFT_eSPI& tft) {
     snprintf(o2Str, sizeof(o2Str), "%d%%", bioState.oxygenSat);
     tft.print(o2Str);
 
+    // Suit readings from receiver telemetry (dashes when no receiver is reporting)
+    const NodeTelemetry* telemetry = hudTelemetry();
+    char suitStr[12];
+    tft.setCursor(BIO_ECG_X + 6, BIO_ECG_Y + BIO_ECG_HEIGHT + 40);
+    tft.print("SUIT TMP:");
+    tft.setCursor(BIO_ECG_X + 62, BIO_ECG_Y + BIO_ECG_HEIGHT + 40);
+    if (telemetry) {
+        snprintf(suitStr, sizeof(suitStr), "%dC  ", telemetry->current.chipTempDeciC / 10);
+    } else {
+        snprintf(suitStr, sizeof(suitStr), "--   ");
+    }
+    tft.print(suitStr);
+
+    tft.setCursor(BIO_ECG_X + 6, BIO_ECG_Y + BIO_ECG_HEIGHT + 55);
+    tft.print("SUIT PWR:");
+    tft.setCursor(BIO_ECG_X + 62, BIO_ECG_Y + BIO_ECG_HEIGHT + 55);
+    if (telemetry) {
+        snprintf(suitStr, sizeof(suitStr), "%u.%02uV ", telemetry->current.supplyMv / 1000,
+                 (telemetry->current.supplyMv % 1000) / 10);
+    } else {
+        snprintf(suitStr, sizeof(suitStr), "--    ");
+    }
+    tft.print(suitStr);
+
+    // Busier fan of the two, as a percentage of full duty
+    tft.setCursor(BIO_ECG_X + 6, BIO_ECG_Y + BIO_ECG_HEIGHT + 70);
+    tft.print("SUIT FAN:");
+    tft.setCursor(BIO_ECG_X + 62, BIO_ECG_Y + BIO_ECG_HEIGHT + 70);
+    if (telemetry) {
+        uint8_t duty = max(telemetry->current.fanDuty[0], telemetry->current.fanDuty[1]);
+        snprintf(suitStr, sizeof(suitStr), "%u%%  ", duty * 100 / 255);
+    } else {
+        snprintf(suitStr, sizeof(suitStr), "--   ");
+    }
+    tft.print(suitStr);
+
     tft.setCursor(BIO_DNA_X + 5, BIO_DNA_Y + BIO_DNA_HEIGHT + 10);
     tft.print("DNA ANALYSIS");
 }
@@ -0,0 +1,345 @@
+#include "squad.h"
+#include <string.h>
+
+// SipHash-2-4 - a keyed hash small enough to authenticate every squad frame
+static inline uint64_t rotl(uint64_t x, int b) {
+    return (x << b) | (x >> (64 - b));
+}
+
+static uint64_t siphash(const uint64_t key[2], const uint8_t* data, size_t len) {
+    uint64_t v0 = 0x736f6d6570736575ULL ^ key[0];
+    uint64_t v1 = 0x646f72616e646f6dULL ^ key[1];
+    uint64_t v2 = 0x6c7967656e657261ULL ^ key[0];
+    uint64_t v3 = 0x7465646279746573ULL ^ key[1];
+    auto round = [&]() {
+        v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);
+        v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;
+        v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;
+        v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);
+    };
+
+    size_t whole = len - len % 8;
+    for (size_t i = 0; i < whole; i += 8) {
+        uint64_t m;
+        memcpy(&m, data + i, 8);
+        v3 ^= m;
+        round();
+        round();
+        v0 ^= m;
+    }
+    uint64_t last = (uint64_t)len << 56;
+    for (size_t i = whole; i < len; i++) {
+        last |= (uint64_t)data[i] << (8 * (i - whole));
+    }
+    v3 ^= last;
+    round();
+    round();
+    v0 ^= last;
+
+    v2 ^= 0xff;
+    for (int i = 0; i < 4; i++) {
+        round();
+    }
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+void SquadSync::begin(const uint8_t* selfMac, const char* passphrase, uint8_t priority, int64_t nowUs) {
+    // Key and group id come from the passphrase, so units only need to share that
+    static const uint64_t salt[2][2] = {{0, 0}, {1, 0}};
+    size_t keyLen = strlen(passphrase);
+    key[0] = siphash(salt[0], (const uint8_t*)passphrase, keyLen);
+    key[1] = siphash(salt[1], (const uint8_t*)passphrase, keyLen);
+    groupId = (uint16_t)tag((const uint8_t*)"squad", 5);
+
+    selfId = ((uint32_t)selfMac[2] << 24) | ((uint32_t)selfMac[3] << 16) | ((uint32_t)selfMac[4] << 8) | selfMac[5];
+    selfPriority = priority;
+    randomState = selfId | 1;
+    counter = 0;
+    joinedUs = nowUs;
+
+    memberCount = 0;
+    claimsLead = false;
+    leader = 0;
+    offsetUs = 0;
+    syncCount = 0;
+    syncNext = 0;
+    repeatsLeft = 0;
+    haveCue = false;
+    cueScheduled = false;
+    // First hello after a random spread, so units switched on together don't collide
+    nextHelloUs = nowUs + nextRandom() % (SQUAD_BEACON_MS * 1000LL);
+    tokens = SQUAD_TOKEN_BURST;
+    tokensUpdatedUs = nowUs;
+    waitingForToken = false;
+    running = true;
+}
+
+uint32_t SquadSync::nextRandom() {
+    // xorshift32 - only spreads transmissions, nothing depends on it being unpredictable
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+uint64_t SquadSync::tag(const uint8_t* data, size_t len) const {
+    return siphash(key, data, len);
+}
+
+bool SquadSync::outranks(uint8_t priorityA, uint32_t idA, uint8_t priorityB, uint32_t idB) const {
+    return priorityA != priorityB ? priorityA > priorityB : idA > idB;
+}
+
+int64_t SquadSync::helloIntervalUs() const {
+    // The squad as a whole stays near the aggregate rate however many units join
+    int64_t spread = (int64_t)size() * 1000000LL / SQUAD_HELLO_AGGREGATE_HZ;
+    return spread > SQUAD_HELLO_MIN_MS * 1000LL ? spread : SQUAD_HELLO_MIN_MS * 1000LL;
+}
+
+void SquadSync::expireMembers(int64_t nowUs) {
+    int64_t timeout = helloIntervalUs() * SQUAD_MEMBER_TIMEOUT_HELLOS;
+    for (uint8_t i = 0; i < memberCount;) {
+        Member& member = members[i];
+        bool leaderLost = member.claimsLead && nowUs - member.lastSeenUs > SQUAD_LEADER_TIMEOUT_MS * 1000LL;
+        if (leaderLost) {
+            member.claimsLead = false;
+        }
+        if (nowUs - member.lastSeenUs > timeout) {
+            members[i] = members[--memberCount];
+        } else {
+            i++;
+        }
+    }
+}
+
+void SquadSync::setLeader(uint32_t id) {
+    if (id == leader) {
+        return;
+    }
+    leader = id;
+    // The new leader carries on the squad clock we already had, so only samples restart
+    syncCount = 0;
+    syncNext = 0;
+    haveCue = false;
+}
+
+void SquadSync::elect(int64_t nowUs) {
+    expireMembers(nowUs);
+
+    // Best claimant heard, which settles two leaders meeting after a split
+    const Member* claimant = nullptr;
+    const Member* best = nullptr;
+    for (uint8_t i = 0; i < memberCount; i++) {
+        const Member& member = members[i];
+        if (member.claimsLead && (!claimant || outranks(member.priority, member.id, claimant->priority, claimant->id))) {
+            claimant = &member;
+        }
+        if (!best || outranks(member.priority, member.id, best->priority, best->id)) {
+            best = &member;
+        }
+    }
+
+    if (claimsLead) {
+        if (claimant && outranks(claimant->priority, claimant->id, selfPriority, selfId)) {
+            claimsLead = false;
+            setLeader(claimant->id);
+        }
+        return;
+    }
+
+    if (claimant) {
+        setLeader(claimant->id);
+        // A higher priority unit takes over; equal priority leaves the incumbent be
+        if (selfPriority > claimant->priority) {
+            claimsLead = true;
+            setLeader(selfId);
+        }
+        return;
+    }
+
+    // No leader heard: once we've listened for one, the best-ranked unit claims
+    if (nowUs - joinedUs >= SQUAD_LEADER_TIMEOUT_MS * 1000LL &&
+        (!best || outranks(selfPriority, selfId, best->priority, best->id))) {
+        claimsLead = true;
+        setLeader(selfId);
+        nextHelloUs = nowUs; // Announce straight away
+    } else {
+        setLeader(0);
+    }
+}
+
+bool SquadSync::spendToken(int64_t nowUs) {
+    tokens += (nowUs - tokensUpdatedUs) * (SQUAD_TOKENS_PER_SEC / 1e6f);
+    tokensUpdatedUs = nowUs;
+    if (tokens > SQUAD_TOKEN_BURST) {
+        tokens = SQUAD_TOKEN_BURST;
+    }
+    if (tokens < 1.0f) {
+        return false;
+    }
+    tokens -= 1.0f;
+    return true;
+}
+
+size_t SquadSync::seal(uint8_t* out, SquadKind kind, const void* body, size_t bodyLen) {
+    SquadHeader header = {groupId, selfId, ++counter, kind};
+    size_t len = encodeHeader(out, MessageType::SQUAD, (uint16_t)counter);
+    memcpy(out + len, &header, sizeof(header));
+    len += sizeof(header);
+    memcpy(out + len, body, bodyLen);
+    len += bodyLen;
+    uint64_t mac = tag(out, len);
+    memcpy(out + len, &mac, SQUAD_TAG_LEN);
+    sent++;
+    return len + SQUAD_TAG_LEN;
+}
+
+size_t SquadSync::poll(int64_t nowUs, uint8_t* out) {
+    if (!running) {
+        return 0;
+    }
+    elect(nowUs);
+
+    bool cueDue = repeatsLeft > 0 && nowUs >= nextRepeatUs;
+    bool helloDue = nowUs >= nextHelloUs;
+    if (!cueDue && !helloDue) {
+        return 0;
+    }
+    if (!spendToken(nowUs)) {
+        if (!waitingForToken) {
+            waitingForToken = true;
+            throttled++;
+        }
+        return 0;
+    }
+    waitingForToken = false;
+
+    // Cues go first; a hello can wait for the next token
+    if (cueDue) {
+        repeatsLeft--;
+        nextRepeatUs = nowUs + SQUAD_CUE_REPEAT_MS * 1000LL;
+        return seal(out, SquadKind::CUE, &outgoing, sizeof(outgoing));
+    }
+
+    SquadHello hello;
+    hello.priority = selfPriority;
+    hello.flags = claimsLead ? SQUAD_FLAG_LEADER : 0;
+    if (claimsLead) {
+        nextHelloUs = nowUs + SQUAD_BEACON_MS * 1000LL;
+    } else {
+        // +/- 25% so followers don't settle into colliding in step
+        int64_t interval = helloIntervalUs();
+        nextHelloUs = nowUs + interval * 3 / 4 + nextRandom() % (interval / 2);
+    }
+    hello.clockUs = toSquadUs(nowUs);
+    return seal(out, SquadKind::HELLO, &hello, sizeof(hello));
+}
+
+bool SquadSync::receive(const uint8_t* data, size_t len, int64_t rxUs) {
+    const size_t fixed = sizeof(FrameHeader) + sizeof(SquadHeader) + SQUAD_TAG_LEN;
+    if (!running || len < fixed) {
+        return false;
+    }
+    SquadHeader header;
+    memcpy(&header, data + sizeof(FrameHeader), sizeof(header));
+    if (header.groupId != groupId || header.unitId == selfId) {
+        return false;
+    }
+    uint64_t expected = tag(data, len - SQUAD_TAG_LEN);
+    if (memcmp(&expected, data + len - SQUAD_TAG_LEN, SQUAD_TAG_LEN) != 0) {
+        rejected++;
+        return false;
+    }
+
+    Member* member = nullptr;
+    for (uint8_t i = 0; i < memberCount; i++) {
+        if (members[i].id == header.unitId) {
+            member = &members[i];
+        }
+    }
+    if (member && header.counter <= member->lastCounter) {
+        // A unit that restarted is heard again once its old entry has expired
+        rejected++;
+        return false;
+    }
+    if (!member) {
+        if (memberCount == SQUAD_MAX_UNITS) {
+            return false;
+        }
+        member = &members[memberCount++];
+        member->id = header.unitId;
+        member->priority = 0;
+        member->claimsLead = false;
+    }
+    member->lastSeenUs = rxUs;
+    member->lastCounter = header.counter;
+
+    const uint8_t* body = data + sizeof(FrameHeader) + sizeof(SquadHeader);
+    size_t bodyLen = len - fixed;
+    if (header.kind == SquadKind::HELLO && bodyLen >= sizeof(SquadHello)) {
+        SquadHello hello;
+        memcpy(&hello, body, sizeof(hello));
+        member->priority = hello.priority;
+        member->claimsLead = hello.flags & SQUAD_FLAG_LEADER;
+        elect(rxUs);
+
+        if (member->claimsLead && member->id == leader) {
+            // Largest offset of the window = the beacon that was delayed least
+            offsetSamples[syncNext] = hello.clockUs - rxUs;
+            syncNext = (syncNext + 1) % SQUAD_SYNC_WINDOW;
+            if (syncCount < SQUAD_SYNC_WINDOW) {
+                syncCount++;
+            }
+            offsetUs = offsetSamples[0];
+            for (uint8_t i = 1; i < syncCount; i++) {
+                if (offsetSamples[i] > offsetUs) {
+                    offsetUs = offsetSamples[i];
+                }
+            }
+        }
+    } else if (header.kind == SquadKind::CUE && bodyLen >= sizeof(SquadCue)) {
+        SquadCue cue;
+        memcpy(&cue, body, sizeof(cue));
+        // Only leaders cue, so this also stands in for a missed beacon
+        member->claimsLead = true;
+        elect(rxUs);
+        bool newer = !haveCue || (int16_t)(cue.cueSeq - lastCueSeq) > 0;
+        if (member->id != leader || claimsLead || !newer) {
+            return true;
+        }
+        haveCue = true;
+        lastCueSeq = cue.cueSeq;
+        cueScheduled = true;
+        cueLocalUs = cue.applyAtUs - offsetUs;
+        scheduledScene = cue.scene;
+        if (cueLocalUs < rxUs) {
+            late++; // Only heard after its time, it applies straight away
+        }
+    }
+    return true;
+}
+
+bool SquadSync::cue(const SquadScene& scene, int64_t nowUs) {
+    if (!leading()) {
+        return false;
+    }
+    outgoing.cueSeq = ++cueSeq;
+    outgoing.applyAtUs = toSquadUs(nowUs) + SQUAD_CUE_LEAD_MS * 1000LL;
+    outgoing.scene = scene;
+    repeatsLeft = SQUAD_CUE_REPEATS;
+    nextRepeatUs = nowUs;
+
+    cueScheduled = true;
+    cueLocalUs = nowUs + SQUAD_CUE_LEAD_MS * 1000LL;
+    scheduledScene = scene;
+    return true;
+}
+
+bool SquadSync::cueDue(int64_t nowUs, SquadScene& scene) {
+    if (!cueScheduled || nowUs < cueLocalUs) {
+        return false;
+    }
+    cueScheduled = false;
+    scene = scheduledScene;
+    return true;
+}
@@ -0,0 +1,10 @@
+#include "stop_path.h"
+
+bool StopPath::service() {
+    if (!pending.exchange(false, std::memory_order_acq_rel)) {
+        return false;
+    }
+    cut();
+    lastCutUs.store(clock(), std::memory_order_release);
+    return true;
+}
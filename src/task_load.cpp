@@ -0,0 +1,14 @@
+#include "task_load.h"
+
+void TaskLoad::add(uint32_t us) {
+    busyUs.fetch_add(us, std::memory_order_relaxed);
+    uint32_t longest = longestPassUs.load(std::memory_order_relaxed);
+    while (us > longest && !longestPassUs.compare_exchange_weak(longest, us, std::memory_order_relaxed)) {
+    }
+}
+
+float TaskLoad::take(uint32_t elapsedUs, uint32_t& longestUs) {
+    longestUs = longestPassUs.exchange(0, std::memory_order_relaxed);
+    uint32_t busy = busyUs.exchange(0, std::memory_order_relaxed);
+    return elapsedUs > 0 ? (float)busy / elapsedUs : 0;
+}
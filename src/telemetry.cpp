@@ -0,0 +1,113 @@
+#include "telemetry.h"
+#include "layout.h"
+#include <string.h>
+
+static bool differs(int32_t a, int32_t b, int32_t deadband) {
+    int32_t delta = a - b;
+    return delta > deadband || -delta > deadband;
+}
+
+// Fields of `current` that moved away from `base`
+static uint8_t changedFields(const TelemetrySnapshot& current, const TelemetrySnapshot& base) {
+    uint8_t mask = 0;
+    if (current.fans != base.fans ||
+        differs(current.fanDuty[0], base.fanDuty[0], TELEMETRY_DUTY_DEADBAND) ||
+        differs(current.fanDuty[1], base.fanDuty[1], TELEMETRY_DUTY_DEADBAND)) mask |= TELEMETRY_FIELD_FANS;
+    if (differs(current.chipTempDeciC, base.chipTempDeciC, TELEMETRY_TEMP_DEADBAND)) mask |= TELEMETRY_FIELD_TEMP;
+    if (differs(current.supplyMv, base.supplyMv, TELEMETRY_SUPPLY_DEADBAND)) mask |= TELEMETRY_FIELD_SUPPLY;
+    if (current.ledFps != base.ledFps) mask |= TELEMETRY_FIELD_FPS;
+    if (differs(current.watchdogMarginMs, base.watchdogMarginMs, TELEMETRY_MARGIN_DEADBAND)) mask |= TELEMETRY_FIELD_MARGIN;
+    if (current.safeFlags != base.safeFlags) mask |= TELEMETRY_FIELD_FLAGS;
+    if (differs(current.currentDeciMa, base.currentDeciMa, TELEMETRY_CURRENT_DEADBAND) ||
+        differs(current.powerMw, base.powerMw, TELEMETRY_POWER_DEADBAND)) mask |= TELEMETRY_FIELD_CURRENT;
+    return mask;
+}
+
+size_t TelemetryEncoder::encode(const TelemetrySnapshot& current, uint8_t* out) {
+    uint8_t mask;
+    if (!hasKeyframe || ++sinceKeyframe >= TELEMETRY_KEYFRAME_EVERY) {
+        hasKeyframe = true;
+        keyframeId++;
+        sinceKeyframe = 0;
+        keyframe = current;
+        mask = TELEMETRY_FIELD_ALL | TELEMETRY_KEYFRAME;
+    } else {
+        mask = changedFields(current, keyframe);
+    }
+
+    // Fields follow in bit order, little-endian
+    size_t len = 0;
+    out[len++] = keyframeId;
+    out[len++] = mask;
+    if (mask & TELEMETRY_FIELD_FANS) {
+        out[len++] = current.fans;
+        out[len++] = current.fanDuty[0];
+        out[len++] = current.fanDuty[1];
+    }
+    if (mask & TELEMETRY_FIELD_TEMP) {
+        memcpy(out + len, &current.chipTempDeciC, 2);
+        len += 2;
+    }
+    if (mask & TELEMETRY_FIELD_SUPPLY) {
+        memcpy(out + len, &current.supplyMv, 2);
+        len += 2;
+    }
+    if (mask & TELEMETRY_FIELD_FPS) {
+        out[len++] = current.ledFps;
+    }
+    if (mask & TELEMETRY_FIELD_MARGIN) {
+        memcpy(out + len, &current.watchdogMarginMs, 2);
+        len += 2;
+    }
+    if (mask & TELEMETRY_FIELD_FLAGS) {
+        out[len++] = current.safeFlags;
+    }
+    if (mask & TELEMETRY_FIELD_CURRENT) {
+        memcpy(out + len, &current.currentDeciMa, 2);
+        memcpy(out + len + 2, &current.powerMw, 2);
+        len += 4;
+    }
+    return len;
+}
+
+bool decodeTelemetry(const uint8_t* data, size_t len, NodeTelemetry& cache) {
+    if (len < 2) {
+        return false;
+    }
+    uint8_t id = data[0];
+    uint8_t mask = data[1];
+    bool isKeyframe = mask & TELEMETRY_KEYFRAME;
+    if (isKeyframe && (mask & TELEMETRY_FIELD_ALL) != TELEMETRY_FIELD_ALL) {
+        return false;
+    }
+    if (!isKeyframe && (!cache.valid || id != cache.keyframeId)) {
+        return false;
+    }
+
+    // Unsent fields are unchanged from the keyframe
+    TelemetrySnapshot snapshot = isKeyframe ? TelemetrySnapshot() : cache.keyframe;
+    size_t pos = 2;
+    auto take = [&](void* field, size_t size) {
+        if (pos + size > len) {
+            return false;
+        }
+        memcpy(field, data + pos, size);
+        pos += size;
+        return true;
+    };
+    if ((mask & TELEMETRY_FIELD_FANS) && (!take(&snapshot.fans, 1) || !take(snapshot.fanDuty, 2))) return false;
+    if ((mask & TELEMETRY_FIELD_TEMP) && !take(&snapshot.chipTempDeciC, 2)) return false;
+    if ((mask & TELEMETRY_FIELD_SUPPLY) && !take(&snapshot.supplyMv, 2)) return false;
+    if ((mask & TELEMETRY_FIELD_FPS) && !take(&snapshot.ledFps, 1)) return false;
+    if ((mask & TELEMETRY_FIELD_MARGIN) && !take(&snapshot.watchdogMarginMs, 2)) return false;
+    if ((mask & TELEMETRY_FIELD_FLAGS) && !take(&snapshot.safeFlags, 1)) return false;
+    if ((mask & TELEMETRY_FIELD_CURRENT) && (!take(&snapshot.currentDeciMa, 2) || !take(&snapshot.powerMw, 2))) return false;
+
+    if (isKeyframe) {
+        cache.valid = true;
+        cache.keyframeId = id;
+        cache.keyframe = snapshot;
+    }
+    cache.current = snapshot;
+    return true;
+}
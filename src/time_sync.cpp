@@ -0,0 +1,41 @@
+#include "time_sync.h"
+#include "layout.h"
+
+bool TimeSync::addSample(int64_t t1, int64_t t2, int64_t t3, int64_t t4) {
+    int64_t roundTrip = (t4 - t1) - (t3 - t2);
+    if (roundTrip < 0 || (hasSample && roundTrip > TIME_SYNC_MAX_RTT_US)) {
+        // A slow exchange was queued somewhere; its offset is skewed by up to half of it
+        return false;
+    }
+
+    int64_t offset = ((t2 - t1) + (t3 - t4)) / 2;
+    int64_t localMid = t1 + (t4 - t1) / 2;
+
+    if (hasSample) {
+        errorUs = offset - (toShared(localMid) - localMid);
+
+        int64_t elapsed = localMid - refLocalUs;
+        bool stepped = errorUs > TIME_SYNC_STEP_US || -errorUs > TIME_SYNC_STEP_US;
+        if (elapsed >= TIME_SYNC_MIN_DRIFT_SPAN_US && !stepped) {
+            double measured = (double)(offset - refOffsetUs) / elapsed;
+            drift += (measured - drift) * TIME_SYNC_DRIFT_GAIN;
+        }
+    }
+
+    refLocalUs = localMid;
+    refOffsetUs = offset;
+    delayUs = roundTrip;
+    hasSample = true;
+    return true;
+}
+
+int64_t TimeSync::toShared(int64_t localUs) const {
+    if (!hasSample) {
+        return localUs;
+    }
+    return localUs + refOffsetUs + (int64_t)(drift * (localUs - refLocalUs));
+}
+
+bool TimeSync::needsSync(int64_t localUs, int64_t intervalUs) const {
+    return !hasSample || localUs - refLocalUs >= intervalUs;
+}
@@ -0,0 +1,144 @@
+#ifdef ARDUINO
+
+#include "transport_espnow.h"
+#include "layout.h"
+#include <Arduino.h>
+#include <esp_now.h>
+#include <esp_wifi.h>
+#include <math.h>
+#include <esp_idf_version.h>
+#include <string.h>
+
+static Transport::ReceiveCallback receiveCallback = nullptr;
+static Transport::SendStatusCallback sendStatusCallback = nullptr;
+
+// ESP-NOW callback signatures changed across core versions; normalize them here
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+static void espNowRecv(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+    if (receiveCallback) {
+        receiveCallback(info->src_addr, data, len, info->rx_ctrl ? info->rx_ctrl->rssi : RSSI_UNKNOWN);
+    }
+}
+#else
+// Older cores don't pass the radio metadata, so RSSI isn't available
+static void espNowRecv(const uint8_t *mac, const uint8_t *data, int len) {
+    if (receiveCallback) {
+        receiveCallback(mac, data, len, RSSI_UNKNOWN);
+    }
+}
+#endif
+
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 5, 0)
+static void espNowSent(const wifi_tx_info_t *info, esp_now_send_status_t status) {
+    if (sendStatusCallback) {
+        sendStatusCallback(info->des_addr, status == ESP_NOW_SEND_SUCCESS);
+    }
+}
+#else
+static void espNowSent(const uint8_t *mac, esp_now_send_status_t status) {
+    if (sendStatusCallback) {
+        sendStatusCallback(mac, status == ESP_NOW_SEND_SUCCESS);
+    }
+}
+#endif
+
+bool EspNowTransport::begin() {
+    if (esp_now_init() != ESP_OK) {
+        Serial.println("Error initializing ESP-NOW");
+        return false;
+    }
+    esp_now_register_recv_cb(espNowRecv);
+    esp_now_register_send_cb(espNowSent);
+    return true;
+}
+
+bool EspNowTransport::send(const uint8_t* mac, const uint8_t* data, size_t len) {
+    if (asleep || esp_now_send(mac, data, len) != ESP_OK) {
+        return false;
+    }
+    countSent(len);
+    return true;
+}
+
+bool EspNowTransport::addPeer(const uint8_t* mac) {
+    esp_now_peer_info_t peerInfo = {};
+    memcpy(peerInfo.peer_addr, mac, 6);
+    peerInfo.channel = 0;
+    peerInfo.encrypt = false;
+    return esp_now_add_peer(&peerInfo) == ESP_OK;
+}
+
+bool EspNowTransport::removePeer(const uint8_t* mac) {
+    return esp_now_del_peer(mac) == ESP_OK;
+}
+
+bool EspNowTransport::hasPeer(const uint8_t* mac) {
+    return esp_now_is_peer_exist(mac);
+}
+
+void EspNowTransport::onReceive(ReceiveCallback callback) {
+    receiveCallback = callback;
+}
+
+void EspNowTransport::onSendStatus(SendStatusCallback callback) {
+    sendStatusCallback = callback;
+}
+
+bool EspNowTransport::setChannel(uint8_t channel) {
+    return esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE) == ESP_OK;
+}
+
+uint8_t EspNowTransport::channel() {
+    uint8_t primary = 0;
+    wifi_second_chan_t second;
+    esp_wifi_get_channel(&primary, &second);
+    return primary;
+}
+
+bool EspNowTransport::surveyChannel(uint8_t ch, ChannelSurvey& survey) {
+    // Passive so the survey itself adds no traffic to the channels it measures
+    wifi_scan_config_t config = {};
+    config.channel = ch;
+    config.show_hidden = true;
+    config.scan_type = WIFI_SCAN_TYPE_PASSIVE;
+    config.scan_time.passive = CHANNEL_SCAN_DWELL_MS;
+
+    uint8_t home = channel();
+    bool ok = esp_wifi_scan_start(&config, true) == ESP_OK;
+    if (ok) {
+        static wifi_ap_record_t records[CHANNEL_SCAN_MAX_APS];
+        uint16_t count = CHANNEL_SCAN_MAX_APS;
+        esp_wifi_scan_get_ap_records(&count, records);
+        for (uint16_t i = 0; i < count; i++) {
+            uint8_t heard = records[i].primary;
+            if (heard > 0 && heard < RADIO_CHANNEL_SLOTS) {
+                survey.networks[heard]++;
+                survey.energyMw[heard] += powf(10.0f, records[i].rssi / 10.0f);
+            }
+        }
+    }
+    setChannel(home);
+    return ok;
+}
+
+bool EspNowTransport::setRadioSleep(bool sleep) {
+    if (sleep == asleep) {
+        return true;
+    }
+    if (sleep) {
+        // Stopping WiFi powers the RF down; ESP-NOW and its peers survive it
+        awakeChannel = channel();
+        esp_wifi_get_max_tx_power(&awakeTxPower);
+        asleep = esp_wifi_stop() == ESP_OK;
+        return asleep;
+    }
+    if (esp_wifi_start() != ESP_OK) {
+        return false;
+    }
+    asleep = false;
+    setChannel(awakeChannel);
+    esp_wifi_set_max_tx_power(awakeTxPower);
+    return true;
+}
+
+#endif
@@ -0,0 +1,300 @@
+#ifndef ARDUINO
+
+#include "transport_host.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+static const uint8_t broadcastMac[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+// Datagram layout: kind, sender's channel, sender's MAC, then the frame for data
+#define HOST_DATAGRAM_HEADER_LEN 8
+#define HOST_KIND_BROADCAST 0
+#define HOST_KIND_UNICAST 1
+#define HOST_KIND_ACK 2
+
+static uint64_t nowUs() {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+HostTransport::HostTransport(const uint8_t* mac, LinkModel model, uint16_t basePort)
+    : basePort(basePort), model(model), rng(mac[5]) {
+    memcpy(selfMac, mac, 6);
+}
+
+HostTransport::~HostTransport() {
+    running = false;
+    wake.notify_all();
+    if (sock >= 0) {
+        shutdown(sock, SHUT_RDWR);
+        close(sock);
+    }
+    if (receiver.joinable()) receiver.join();
+    if (sender.joinable()) sender.join();
+}
+
+uint16_t HostTransport::portFor(const uint8_t* mac) const {
+    return basePort + mac[5] % HOST_TRANSPORT_MAX_NODES;
+}
+
+bool HostTransport::begin() {
+    sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        perror("HostTransport socket");
+        return false;
+    }
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(portFor(selfMac));
+    if (bind(sock, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        perror("HostTransport bind");
+        close(sock);
+        sock = -1;
+        return false;
+    }
+
+    running = true;
+    receiver = std::thread(&HostTransport::receiveLoop, this);
+    sender = std::thread(&HostTransport::deliveryLoop, this);
+    return true;
+}
+
+bool HostTransport::send(const uint8_t* mac, const uint8_t* data, size_t len) {
+    if (!running || asleep || len == 0 || len > 250 || !hasPeer(mac)) {
+        return false;
+    }
+    countSent(len);
+
+    if (memcmp(mac, broadcastMac, 6) == 0) {
+        // Every listener rolls its own loss and latency, as separate stations would
+        for (uint16_t node = 0; node < HOST_TRANSPORT_MAX_NODES; node++) {
+            uint16_t port = basePort + node;
+            if (port != portFor(selfMac)) {
+                schedule(mac, port, false, data, len);
+            }
+        }
+    } else {
+        schedule(mac, portFor(mac), true, data, len);
+    }
+    return true;
+}
+
+void HostTransport::schedule(const uint8_t* dest, uint16_t port, bool unicast, const uint8_t* data, size_t len) {
+    std::lock_guard<std::mutex> guard(lock);
+
+    int64_t delay = model.latencyUs;
+    if (model.jitterUs > 0) {
+        std::uniform_int_distribution<int64_t> spread(-(int64_t)model.jitterUs, model.jitterUs);
+        delay += spread(rng);
+    }
+    if (delay < 0) {
+        delay = 0;
+    }
+
+    uint8_t channel = currentChannel;
+    float delivery = (1.0f - model.lossRate) * (1.0f - model.channelLoss[channel]) *
+                     (1.0f - model.nodeLoss[port - basePort]);
+
+    PendingFrame frame;
+    frame.dueUs = nowUs() + delay;
+    frame.port = port;
+    frame.lost = std::uniform_real_distribution<float>(0.0f, 1.0f)(rng) >= delivery;
+    frame.unicast = unicast;
+    memcpy(frame.dest, dest, 6);
+    frame.bytes.push_back(unicast ? HOST_KIND_UNICAST : HOST_KIND_BROADCAST);
+    frame.bytes.push_back(channel);
+    frame.bytes.insert(frame.bytes.end(), selfMac, selfMac + 6);
+    frame.bytes.insert(frame.bytes.end(), data, data + len);
+    outbox.push(std::move(frame));
+    wake.notify_one();
+}
+
+void HostTransport::deliveryLoop() {
+    std::unique_lock<std::mutex> guard(lock);
+    while (running) {
+        // Unicasts whose ack never came back count as failed
+        uint64_t now = nowUs();
+        if (!awaitedAcks.empty() && awaitedAcks.front().deadlineUs <= now) {
+            AwaitedAck expired = awaitedAcks.front();
+            awaitedAcks.erase(awaitedAcks.begin());
+            guard.unlock();
+            SendStatusCallback statusCallback = sendStatusCallback.load();
+            if (statusCallback) {
+                statusCallback(expired.dest, false);
+            }
+            guard.lock();
+            continue;
+        }
+
+        uint64_t next = awaitedAcks.empty() ? UINT64_MAX : awaitedAcks.front().deadlineUs;
+        if (!outbox.empty()) {
+            next = std::min<uint64_t>(next, outbox.top().dueUs);
+        }
+        if (next == UINT64_MAX) {
+            wake.wait(guard);
+            continue;
+        }
+        if (next > now) {
+            wake.wait_for(guard, std::chrono::microseconds(next - now));
+            continue;
+        }
+
+        PendingFrame frame = outbox.top();
+        outbox.pop();
+        if (frame.unicast) {
+            AwaitedAck awaited;
+            awaited.deadlineUs = now + 2 * ((uint64_t)model.latencyUs + model.jitterUs) + 5000;
+            memcpy(awaited.dest, frame.dest, 6);
+            awaitedAcks.push_back(awaited);
+        }
+        guard.unlock();
+
+        if (!frame.lost) {
+            sendDatagram(frame.port, frame.bytes.data(), frame.bytes.size());
+        }
+
+        guard.lock();
+    }
+}
+
+void HostTransport::sendDatagram(uint16_t port, const uint8_t* bytes, size_t len) {
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    sendto(sock, bytes, len, 0, (sockaddr*)&addr, sizeof(addr));
+}
+
+// Completes the oldest unicast waiting on an ack from `mac`
+void HostTransport::resolveAck(const uint8_t* mac, bool delivered) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = awaitedAcks.begin();
+        while (it != awaitedAcks.end() && memcmp(it->dest, mac, 6) != 0) {
+            ++it;
+        }
+        if (it == awaitedAcks.end()) {
+            return; // Already timed out
+        }
+        awaitedAcks.erase(it);
+    }
+    SendStatusCallback statusCallback = sendStatusCallback.load();
+    if (statusCallback) {
+        statusCallback(mac, delivered);
+    }
+}
+
+void HostTransport::receiveLoop() {
+    uint8_t buffer[HOST_DATAGRAM_HEADER_LEN + 250];
+    while (running) {
+        ssize_t n = recv(sock, buffer, sizeof(buffer), 0);
+        if (n < HOST_DATAGRAM_HEADER_LEN || buffer[1] != currentChannel || asleep) {
+            continue; // Tuned elsewhere or powered down - never heard it
+        }
+        const uint8_t* source = buffer + 2;
+        if (buffer[0] == HOST_KIND_ACK) {
+            resolveAck(source, true);
+            continue;
+        }
+        if (n == HOST_DATAGRAM_HEADER_LEN) {
+            continue;
+        }
+
+        // Unicasts get a link-level ack straight back
+        if (buffer[0] == HOST_KIND_UNICAST) {
+            uint8_t ack[HOST_DATAGRAM_HEADER_LEN] = {HOST_KIND_ACK, currentChannel};
+            memcpy(ack + 2, selfMac, 6);
+            sendDatagram(portFor(source), ack, sizeof(ack));
+        }
+
+        ReceiveCallback callback = receiveCallback.load();
+        if (callback) {
+            int8_t rssi;
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                rssi = model.rssi;
+            }
+            callback(source, buffer + HOST_DATAGRAM_HEADER_LEN, (int)(n - HOST_DATAGRAM_HEADER_LEN), rssi);
+        }
+    }
+}
+
+bool HostTransport::addPeer(const uint8_t* mac) {
+    if (hasPeer(mac)) {
+        return false; // Matches ESP-NOW, which refuses duplicate peers
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    peers.emplace_back(mac, mac + 6);
+    return true;
+}
+
+bool HostTransport::removePeer(const uint8_t* mac) {
+    std::lock_guard<std::mutex> guard(lock);
+    for (auto it = peers.begin(); it != peers.end(); ++it) {
+        if (memcmp(it->data(), mac, 6) == 0) {
+            peers.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool HostTransport::hasPeer(const uint8_t* mac) {
+    std::lock_guard<std::mutex> guard(lock);
+    for (const auto& peer : peers) {
+        if (memcmp(peer.data(), mac, 6) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void HostTransport::onReceive(ReceiveCallback callback) {
+    receiveCallback = callback;
+}
+
+void HostTransport::onSendStatus(SendStatusCallback callback) {
+    sendStatusCallback = callback;
+}
+
+bool HostTransport::setChannel(uint8_t channel) {
+    if (channel == 0 || channel >= RADIO_CHANNEL_SLOTS) {
+        return false;
+    }
+    currentChannel = channel;
+    return true;
+}
+
+uint8_t HostTransport::channel() {
+    return currentChannel;
+}
+
+bool HostTransport::surveyChannel(uint8_t ch, ChannelSurvey& survey) {
+    if (ch == 0 || ch >= RADIO_CHANNEL_SLOTS) {
+        return false;
+    }
+    // Congestion shows up as the activity a real scan would hear
+    std::lock_guard<std::mutex> guard(lock);
+    survey.networks[ch] = (uint8_t)(model.channelLoss[ch] * 10);
+    survey.energyMw[ch] = model.channelLoss[ch] * 1e-6f;
+    return true;
+}
+
+bool HostTransport::setRadioSleep(bool sleep) {
+    asleep = sleep;
+    return true;
+}
+
+void HostTransport::setLinkModel(const LinkModel& newModel) {
+    std::lock_guard<std::mutex> guard(lock);
+    model = newModel;
+}
+
+#endif
@@ -0,0 +1,36 @@
+#include "tx_power.h"
+#include "layout.h"
+#include "transport.h"
+
+void TxPowerControl::reset(RadioProfile profile) {
+    limits = radioProfileLimits(profile);
+    txPower = limits.maxTxPower;
+    lastMarginDb = 0;
+}
+
+bool TxPowerControl::update(int8_t weakestRssi, bool missedAck, uint32_t nowMs) {
+    // A lost ack means the estimate was too optimistic - go straight back to full power
+    if (missedAck) {
+        lastAdjustMs = nowMs;
+        bool changed = txPower != limits.maxTxPower;
+        txPower = limits.maxTxPower;
+        return changed;
+    }
+    if (weakestRssi == RSSI_UNKNOWN || nowMs - lastAdjustMs < TX_POWER_ADJUST_INTERVAL_MS) {
+        return false;
+    }
+    lastAdjustMs = nowMs;
+
+    int stepDownDb = (limits.maxTxPower - txPower) / 4;
+    lastMarginDb = weakestRssi - stepDownDb - limits.sensitivityDbm;
+
+    int8_t next = txPower;
+    if (lastMarginDb > TX_POWER_TARGET_MARGIN_DB + TX_POWER_HYSTERESIS_DB) {
+        next = txPower - TX_POWER_STEP < TX_POWER_MIN ? TX_POWER_MIN : txPower - TX_POWER_STEP;
+    } else if (lastMarginDb < TX_POWER_TARGET_MARGIN_DB) {
+        next = txPower + TX_POWER_STEP > limits.maxTxPower ? limits.maxTxPower : txPower + TX_POWER_STEP;
+    }
+    bool changed = next != txPower;
+    txPower = next;
+    return changed;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+// The few Arduino calls the portable protocol code makes, for native test builds.
+// ARDUINO stays undefined, so device-only modules compile out and HostTransport in.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+using std::max;
+using std::min;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+uint32_t esp_random();
+
+// Serial goes to stdout, so a test's output shows what a node would have logged
+class HardwareSerial {
+public:
+    void print(const char* text) { fputs(text, stdout); }
+    void print(long value) { printf("%ld", value); }
+    void println(const char* text = "") { puts(text); }
+    void println(long value) { printf("%ld\n", value); }
+    void flush() { fflush(stdout); }
+    template <typename... Args>
+    void printf(const char* format, Args... args) { ::printf(format, args...); }
+};
+
+extern HardwareSerial Serial;
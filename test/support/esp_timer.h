@@ -0,0 +1,6 @@
+#pragma once
+
+#include <stdint.h>
+
+// Microseconds since the process started, like esp_timer_get_time() since boot
+int64_t esp_timer_get_time();
@@ -0,0 +1,35 @@
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <chrono>
+#include <random>
+#include <thread>
+
+// Node globals main.cpp defines on device, for the protocol code under test
+uint8_t broadcastAddress[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+uint8_t selfAddress[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+HardwareSerial Serial;
+
+static const std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+
+int64_t esp_timer_get_time() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count();
+}
+
+unsigned long micros() {
+    return (unsigned long)esp_timer_get_time();
+}
+
+unsigned long millis() {
+    return (unsigned long)(esp_timer_get_time() / 1000);
+}
+
+void delay(unsigned long ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+uint32_t esp_random() {
+    static std::random_device seed;
+    static std::mt19937 rng(seed());
+    return rng();
+}
@@ -0,0 +1,39 @@
+#include "host_node.h"
+#include <esp_timer.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+RxQueue hostRx;
+
+static std::vector<pid_t> nodes;
+
+void queueHostFrame(const uint8_t* mac, const uint8_t* data, int len, int8_t rssi) {
+    hostRx.push(mac, data, len, esp_timer_get_time(), rssi);
+}
+
+pid_t spawnNode(void (*body)(int), int index) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        body(index);
+        fflush(stdout);
+        _exit(0);
+    }
+    if (pid > 0) {
+        nodes.push_back(pid);
+    }
+    return pid;
+}
+
+void stopNodes() {
+    for (pid_t pid : nodes) {
+        kill(pid, SIGTERM);
+    }
+    for (pid_t pid : nodes) {
+        waitpid(pid, nullptr, 0);
+    }
+    nodes.clear();
+}
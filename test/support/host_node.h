@@ -0,0 +1,24 @@
+#pragma once
+
+// Helpers for protocol tests that run several nodes on one host.
+// communication.cpp keeps one set of singletons per process, so each node is forked.
+
+#include <sys/types.h>
+#include <stdint.h>
+#include "rx_queue.h"
+
+// Node addresses; each node sets selfAddress before it attaches a transport (main.cpp owns both on device)
+extern uint8_t broadcastAddress[];
+extern uint8_t selfAddress[];
+
+// Frames the node's transport delivered, drained by the test's service loop
+extern RxQueue hostRx;
+
+// Receive callback that queues frames into hostRx, as the device callback does
+void queueHostFrame(const uint8_t* mac, const uint8_t* data, int len, int8_t rssi);
+
+// Runs `body(index)` in a child process that exits when it returns
+pid_t spawnNode(void (*body)(int), int index);
+
+// Stops every node spawned so far and reaps them
+void stopNodes();
@@ -0,0 +1,105 @@
+#include <unity.h>
+#include <random>
+#include "change_batcher.h"
+#include "layout.h"
+
+// Someone clicking through the visor colours: runs of a few presses 150-350 ms apart,
+// a few seconds of looking at the result between runs, with the comms task polling
+// the batchers every COMMS_POLL_MS as flushStateChanges does
+#define BATCH_TEST_RUNS 40
+#define BATCH_TEST_MIN_PRESSES 2
+#define BATCH_TEST_MAX_PRESSES 8
+#define BATCH_TEST_MIN_GAP_MS 150
+#define BATCH_TEST_MAX_GAP_MS 350
+#define BATCH_TEST_PAUSE_MS 4000
+
+struct BatchRun {
+    uint32_t presses;
+    uint32_t frames;
+    uint32_t saves;
+    uint32_t worstLagMs;    // Longest from a press to the frame that carried it
+};
+
+static BatchRun runPresses(uint32_t stateQuietMs, uint32_t stateMaxMs) {
+    ChangeBatcher stateBatch(stateQuietMs, stateMaxMs);
+    ChangeBatcher saveBatch(SAVE_COALESCE_MS, SAVE_FLUSH_MAX_MS);
+    std::mt19937 rng(29);
+    BatchRun run = {0, 0, 0, 0};
+    uint32_t nowMs = 1000;
+    uint32_t oldestUnsentMs = 0;
+    bool unsent = false;
+
+    auto pollUntil = [&](uint32_t untilMs) {
+        for (; nowMs < untilMs; nowMs += COMMS_POLL_MS) {
+            if (stateBatch.due(nowMs)) {
+                run.frames++;
+                if (unsent && nowMs - oldestUnsentMs > run.worstLagMs) {
+                    run.worstLagMs = nowMs - oldestUnsentMs;
+                }
+                unsent = false;
+            }
+            if (saveBatch.due(nowMs)) {
+                run.saves++;
+            }
+        }
+    };
+
+    for (int r = 0; r < BATCH_TEST_RUNS; r++) {
+        int presses = BATCH_TEST_MIN_PRESSES + rng() % (BATCH_TEST_MAX_PRESSES - BATCH_TEST_MIN_PRESSES + 1);
+        for (int p = 0; p < presses; p++) {
+            stateBatch.mark(nowMs);
+            saveBatch.mark(nowMs);
+            run.presses++;
+            if (!unsent) {
+                unsent = true;
+                oldestUnsentMs = nowMs;
+            }
+            pollUntil(nowMs + BATCH_TEST_MIN_GAP_MS + rng() % (BATCH_TEST_MAX_GAP_MS - BATCH_TEST_MIN_GAP_MS + 1));
+        }
+        pollUntil(nowMs + BATCH_TEST_PAUSE_MS);
+    }
+    TEST_ASSERT_FALSE(stateBatch.pending());
+    TEST_ASSERT_FALSE(saveBatch.pending());
+    return run;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_clicks_share_frames_and_saves() {
+    BatchRun run = runPresses(STATE_COALESCE_MS, STATE_FLUSH_MAX_MS);
+    printf("%u presses in %d runs: %u frames, %u saves, a press waited up to %u ms for its frame\n",
+           run.presses, BATCH_TEST_RUNS, run.frames, run.saves, run.worstLagMs);
+
+    // About one frame per run, with the max delay splitting only the longest runs
+    TEST_ASSERT_LESS_OR_EQUAL(BATCH_TEST_RUNS * 2, run.frames);
+    TEST_ASSERT_LESS_THAN(run.presses / 2, run.frames);
+    TEST_ASSERT_EQUAL(BATCH_TEST_RUNS, run.saves);
+    TEST_ASSERT_LESS_OR_EQUAL(STATE_FLUSH_MAX_MS + COMMS_POLL_MS, run.worstLagMs);
+}
+
+void test_short_window_merges_nothing() {
+    // The window this replaced sent a frame for every press
+    BatchRun run = runPresses(30, 100);
+    printf("30 ms window: %u presses, %u frames\n", run.presses, run.frames);
+    TEST_ASSERT_EQUAL(run.presses, run.frames);
+}
+
+void test_held_stream_still_flushes() {
+    // A change every poll never goes quiet, so the max delay sends it
+    ChangeBatcher batch(STATE_COALESCE_MS, STATE_FLUSH_MAX_MS);
+    uint32_t flushes = 0;
+    for (uint32_t t = 0; t < 10 * STATE_FLUSH_MAX_MS; t += COMMS_POLL_MS) {
+        batch.mark(t);
+        flushes += batch.due(t);
+    }
+    TEST_ASSERT_UINT32_WITHIN(1, 10, flushes);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_clicks_share_frames_and_saves);
+    RUN_TEST(test_short_window_merges_nothing);
+    RUN_TEST(test_held_stream_still_flushes);
+    return UNITY_END();
+}
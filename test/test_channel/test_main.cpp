@@ -0,0 +1,102 @@
+#include <unity.h>
+#include <Arduino.h>
+#include "communication.h"
+#include "host_node.h"
+#include "transport_host.h"
+
+#define CHANNEL_PORT 47400
+
+static const uint8_t interfaceMac[6] = {0x02, 0, 0, 0, 0, 1};
+
+void setUp() {}
+void tearDown() {}
+
+void test_pick_prefers_quiet_candidate() {
+    ChannelSurvey survey;
+    survey.networks[1] = 6;
+    survey.networks[11] = 2;
+    TEST_ASSERT_EQUAL(6, ChannelManager::pickChannel(survey));
+    TEST_ASSERT_EQUAL(11, ChannelManager::pickChannel(survey, 6));
+
+    // Spill-over from channel 4 counts against 6 as well
+    survey.networks[4] = 8;
+    TEST_ASSERT_EQUAL(11, ChannelManager::pickChannel(survey));
+}
+
+void test_bad_window_triggers_one_migration() {
+    ChannelManager manager;
+    for (int i = 0; i < CHANNEL_DELIVERY_WINDOW; i++) {
+        manager.recordDelivery(i % 2, 1);
+    }
+    TEST_ASSERT_TRUE(manager.shouldMigrate(1000));
+    TEST_ASSERT_FALSE(manager.shouldMigrate(1001));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.5f, manager.lastDeliveryRate());
+}
+
+void test_hunt_cycles_candidates() {
+    ChannelManager manager;
+    const uint8_t candidates[] = CHANNEL_CANDIDATES;
+    manager.startHunt(0, 30, 120);
+    uint8_t seen[3] = {};
+    for (uint32_t t = 0, hops = 0; hops < 3; t += 10) {
+        uint8_t channel = manager.huntStep(t);
+        if (channel) {
+            seen[hops++] = channel;
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        bool candidate = seen[i] == candidates[0] || seen[i] == candidates[1] || seen[i] == candidates[2];
+        TEST_ASSERT_TRUE(candidate);
+    }
+    TEST_ASSERT_TRUE(seen[0] != seen[1] && seen[1] != seen[2]);
+}
+
+void test_migration_surveys_a_channel_per_pass() {
+    // The interface sits on a crowded channel 1 with channel 11 clear
+    LinkModel link;
+    link.channelLoss[1] = 0.6f;
+    link.channelLoss[6] = 0.3f;
+    memcpy(selfAddress, interfaceMac, 6);
+    HostTransport radio(selfAddress, link, CHANNEL_PORT);
+    radio.begin();
+    radio.addPeer(broadcastAddress);
+    radio.setChannel(1);
+    attachTransport(radio);
+
+    // Opening pairing only queues the survey; nothing is scanned yet
+    migrateChannel(true);
+    serviceChannelMigration();
+    TEST_ASSERT_FALSE(channelManager.switchPending());
+
+    int slices = 0;
+    while (!channelManager.switchPending() && slices < RADIO_CHANNEL_SLOTS + 2) {
+        serviceChannelSurvey();
+        serviceChannelMigration();
+        slices++;
+    }
+    TEST_ASSERT_EQUAL(RADIO_CHANNEL_SLOTS - 1, slices);
+    TEST_ASSERT_TRUE(channelManager.switchPending());
+    TEST_ASSERT_EQUAL(1, radio.channel());  // Receivers are told first
+
+    delay(CHANNEL_SWITCH_DELAY_MS + 10);
+    serviceChannelMigration();
+    TEST_ASSERT_EQUAL(11, radio.channel());
+
+    // Already on the cleanest channel: a survey finds nothing clearly better
+    migrateChannel(true);
+    for (int i = 0; i < RADIO_CHANNEL_SLOTS; i++) {
+        serviceChannelSurvey();
+        serviceChannelMigration();
+    }
+    TEST_ASSERT_FALSE(channelManager.switchPending());
+    TEST_ASSERT_EQUAL(11, radio.channel());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_pick_prefers_quiet_candidate);
+    RUN_TEST(test_bad_window_triggers_one_migration);
+    RUN_TEST(test_hunt_cycles_candidates);
+    RUN_TEST(test_migration_surveys_a_channel_per_pass);
+    return UNITY_END();
+}
@@ -0,0 +1,92 @@
+#include <unity.h>
+#include <stdlib.h>
+#include "duty_cycle.h"
+#include "power_model.h"
+
+// One minute on a virtual clock. The receiver's estimate of the shared clock is off by
+// up to DUTY_CLOCK_ERROR_US, flipping sign every few seconds.
+#define DUTY_SIM_US 60000000LL
+#define DUTY_SIM_STEP_US 1000
+#define DUTY_CLOCK_ERROR_US 1500
+
+void setUp() {}
+void tearDown() {}
+
+void test_phases_follow_schedule() {
+    DutyCycle schedule;
+    TEST_ASSERT_TRUE(schedule.phase(0) == DutyCycle::Phase::WINDOW);
+    TEST_ASSERT_TRUE(schedule.phase(DUTY_WINDOW_MS * 1000LL - 1) == DutyCycle::Phase::WINDOW);
+    TEST_ASSERT_TRUE(schedule.phase(DUTY_WINDOW_MS * 1000LL + 10000) == DutyCycle::Phase::ASLEEP);
+    TEST_ASSERT_TRUE(schedule.phase(DUTY_SLOT_PERIOD_MS * 1000LL) == DutyCycle::Phase::SLOT);
+    TEST_ASSERT_EQUAL(1, (int)schedule.period(DUTY_PERIOD_MS * 1000LL + 5));
+
+    // Listening starts a guard interval early
+    int64_t slotUs = DUTY_SLOT_PERIOD_MS * 1000LL;
+    TEST_ASSERT_EQUAL(slotUs - DUTY_GUARD_US, schedule.nextWakeUs(slotUs - 50000));
+    TEST_ASSERT_TRUE(schedule.awake(slotUs - DUTY_GUARD_US / 2));
+    TEST_ASSERT_FALSE(schedule.awake(slotUs - DUTY_GUARD_US * 2));
+
+    // Traffic keeps the radio up for the linger time
+    int64_t quietUs = DUTY_WINDOW_MS * 1000LL + 20000;
+    TEST_ASSERT_FALSE(schedule.awake(quietUs));
+    schedule.noteTraffic(quietUs);
+    TEST_ASSERT_TRUE(schedule.awake(quietUs + DUTY_LINGER_MS * 1000LL - 1000));
+}
+
+void test_receiver_hears_every_send_and_saves_power() {
+    DutyCycle interfaceSchedule;
+    DutyCycle receiverSchedule;
+    PowerModel power;
+    srand(7);
+
+    int sends = 0;
+    int missed = 0;
+    bool menuChange = false;
+    int64_t lastPeriod = -1;
+    power.restart(PowerState::RADIO_ON, 0);
+    for (int64_t t = 0; t < DUTY_SIM_US; t += DUTY_SIM_STEP_US) {
+        if (rand() % 2000 == 0) {
+            menuChange = true;
+        }
+        // Heartbeat as each window opens; menu changes at the next window or slot
+        DutyCycle::Phase phase = interfaceSchedule.phase(t);
+        bool send = false;
+        if (phase == DutyCycle::Phase::WINDOW && interfaceSchedule.period(t) != lastPeriod) {
+            lastPeriod = interfaceSchedule.period(t);
+            send = true;
+        }
+        if (menuChange && phase != DutyCycle::Phase::ASLEEP) {
+            menuChange = false;
+            send = true;
+        }
+
+        int64_t receiverUs = t + ((t / 7000000) % 2 ? DUTY_CLOCK_ERROR_US : -DUTY_CLOCK_ERROR_US);
+        if (send) {
+            sends++;
+            if (receiverSchedule.awake(receiverUs)) {
+                receiverSchedule.noteTraffic(receiverUs);
+            } else {
+                missed++;
+            }
+            power.noteSent(1, 60, 24000);
+        }
+        power.enter(receiverSchedule.awake(receiverUs) ? PowerState::RADIO_ON : PowerState::LIGHT_SLEEP, t);
+    }
+
+    PowerModel alwaysOn;
+    alwaysOn.restart(PowerState::RADIO_ON, 0);
+    printf("%d sends, %d missed, ~%.1f mA duty-cycled vs %.1f mA always on, radio on %.1f%%\n", sends, missed,
+           power.averageMa(DUTY_SIM_US), alwaysOn.averageMa(DUTY_SIM_US),
+           power.share(PowerState::RADIO_ON, DUTY_SIM_US) * 100);
+
+    TEST_ASSERT_GREATER_THAN(DUTY_SIM_US / (DUTY_PERIOD_MS * 1000LL), sends);
+    TEST_ASSERT_EQUAL(0, missed);
+    TEST_ASSERT_LESS_THAN(alwaysOn.averageMa(DUTY_SIM_US) / 4, power.averageMa(DUTY_SIM_US));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_phases_follow_schedule);
+    RUN_TEST(test_receiver_hears_every_send_and_saves_power);
+    return UNITY_END();
+}
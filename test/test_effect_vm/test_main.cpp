@@ -0,0 +1,94 @@
+#include <unity.h>
+#include <limits.h>
+#include "effect_programs.h"
+#include "effect_vm.h"
+
+#define OP(op) (uint8_t)VmOp::op
+#define PUSH16(v) OP(PUSH16), (uint8_t)((v) & 0xFF), (uint8_t)(((v) >> 8) & 0xFF)
+
+// Leaves INT32_MIN on the stack: -32768 * 256 * 256
+#define PUSH_INT32_MIN PUSH16(-32768), PUSH16(256), OP(MUL), PUSH16(256), OP(MUL)
+
+static const VmContext context = {1000, 3, 16, 0x00FF8000};
+
+static EffectVm vm;
+
+static uint32_t runProgram(const uint8_t* code, uint16_t len) {
+    TEST_ASSERT_TRUE(vm.load(code, len));
+    return vm.run(context);
+}
+
+void setUp() {
+    vm.takeFault();
+}
+
+void tearDown() {}
+
+void test_arithmetic_wraps_on_overflow() {
+    // INT32_MIN - 1 wraps to INT32_MAX, whose low byte is 0xFF
+    const uint8_t sub[] = {PUSH_INT32_MIN, PUSH16(1), OP(SUB), OP(OUT)};
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFF, runProgram(sub, sizeof(sub)));
+
+    // INT32_MIN * 2 wraps to 0
+    const uint8_t mul[] = {PUSH_INT32_MIN, PUSH16(2), OP(MUL), OP(OUT)};
+    TEST_ASSERT_EQUAL_HEX32(0, runProgram(mul, sizeof(mul)));
+    TEST_ASSERT_FALSE(vm.takeFault());
+}
+
+void test_division_edge_cases() {
+    // INT32_MIN / -1 wraps back to INT32_MIN instead of trapping
+    const uint8_t div[] = {PUSH_INT32_MIN, PUSH16(-1), OP(DIV), PUSH_INT32_MIN, OP(EQ), OP(OUT)};
+    TEST_ASSERT_EQUAL_HEX32(1, runProgram(div, sizeof(div)));
+
+    const uint8_t mod[] = {PUSH_INT32_MIN, PUSH16(-1), OP(MOD), OP(OUT)};
+    TEST_ASSERT_EQUAL_HEX32(0, runProgram(mod, sizeof(mod)));
+
+    const uint8_t byZero[] = {PUSH16(100), PUSH16(0), OP(DIV), PUSH16(100), PUSH16(0), OP(MOD), OP(ADD), OP(OUT)};
+    TEST_ASSERT_EQUAL_HEX32(0, runProgram(byZero, sizeof(byZero)));
+
+    const uint8_t ordinary[] = {PUSH16(-7), PUSH16(2), OP(DIV), PUSH16(-1), OP(DIV), OP(OUT)};
+    TEST_ASSERT_EQUAL_HEX32(3, runProgram(ordinary, sizeof(ordinary)));
+    TEST_ASSERT_FALSE(vm.takeFault());
+}
+
+void test_verify_rejects_bad_programs() {
+    const uint8_t jumpIntoOperand[] = {OP(JMP), 1, 0, OP(OUT)};
+    TEST_ASSERT_FALSE(vm.load(jumpIntoOperand, sizeof(jumpIntoOperand)));
+    const uint8_t truncated[] = {OP(PUSH16), 1};
+    TEST_ASSERT_FALSE(vm.load(truncated, sizeof(truncated)));
+    const uint8_t badRegister[] = {OP(LOAD), VM_REGISTERS, OP(OUT)};
+    TEST_ASSERT_FALSE(vm.load(badRegister, sizeof(badRegister)));
+    const uint8_t badOpcode[] = {(uint8_t)VmOp::OP_COUNT};
+    TEST_ASSERT_FALSE(vm.load(badOpcode, sizeof(badOpcode)));
+}
+
+void test_runaway_programs_fault_to_black() {
+    const uint8_t spin[] = {OP(JMP), 0, 0};
+    TEST_ASSERT_EQUAL_HEX32(0, runProgram(spin, sizeof(spin)));
+    TEST_ASSERT_TRUE(vm.takeFault());
+
+    const uint8_t underflow[] = {OP(ADD), OP(OUT)};
+    TEST_ASSERT_EQUAL_HEX32(0, runProgram(underflow, sizeof(underflow)));
+    TEST_ASSERT_TRUE(vm.takeFault());
+}
+
+void test_builtin_programs_run_clean() {
+    for (int p = 0; p < EFFECT_PROGRAM_COUNT; p++) {
+        TEST_ASSERT_TRUE(vm.load(effectPrograms[p].code, effectPrograms[p].length));
+        for (uint16_t i = 0; i < 500; i++) {
+            VmContext led = {1000u * p + i * 37, i, 500, 0x00FF8000};
+            vm.run(led);
+        }
+        TEST_ASSERT_FALSE(vm.takeFault());
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_arithmetic_wraps_on_overflow);
+    RUN_TEST(test_division_edge_cases);
+    RUN_TEST(test_verify_rejects_bad_programs);
+    RUN_TEST(test_runaway_programs_fault_to_black);
+    RUN_TEST(test_builtin_programs_run_clean);
+    return UNITY_END();
+}
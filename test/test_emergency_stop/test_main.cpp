@@ -0,0 +1,122 @@
+#include <unity.h>
+#include <Arduino.h>
+#include <thread>
+#include "communication.h"
+#include "host_node.h"
+#include "transport_host.h"
+
+// The interface in this process, receivers forked onto the same HostTransport port
+#define ESTOP_TEST_PORT 47900
+#define ESTOP_TEST_RECEIVERS 3
+
+static const uint8_t interfaceMac[6] = {0x02, 0, 0, 0, 0, 1};
+
+static void receiverMac(int index, uint8_t* mac) {
+    const uint8_t base[6] = {0x02, 0, 0, 0, 0, 0};
+    memcpy(mac, base, 6);
+    mac[5] = (uint8_t)(index + 2);
+}
+
+// Acks each stop copy the way applyEmergencyStop does on device
+static void runReceiver(int index) {
+    receiverMac(index, selfAddress);
+    HostTransport radio(selfAddress, LinkModel(), ESTOP_TEST_PORT);
+    radio.begin();
+    radio.onReceive(queueHostFrame);
+    attachTransport(radio);
+
+    for (;;) {
+        RxFrame frame{};
+        while (hostRx.pop(frame)) {
+            EmergencyStop stop;
+            FrameHeader header;
+            if (decodeEmergencyStop(frame.data, frame.len, stop) && decodeHeader(frame.data, frame.len, header)) {
+                sendEmergencyAck(frame.mac, header.seq, stop.stopId, -1, nullptr);
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+}
+
+static HostTransport* interfaceRadio = nullptr;
+
+static void startInterface() {
+    memcpy(selfAddress, interfaceMac, 6);
+    static HostTransport radio(selfAddress, LinkModel(), ESTOP_TEST_PORT);
+    interfaceRadio = &radio;
+    radio.begin();
+    radio.onReceive(queueHostFrame);
+    radio.addPeer(broadcastAddress);
+    attachTransport(radio);
+}
+
+void setUp() {
+    receiverTable.clear();
+    uint8_t mac[6];
+    for (int i = 0; i < ESTOP_TEST_RECEIVERS; i++) {
+        receiverMac(i, mac);
+        receiverTable.add(mac, NODE_CAP_ALL);
+    }
+}
+
+void tearDown() {
+    setReceiverSleep(false);
+}
+
+void test_burst_ignores_listen_window() {
+    // Receivers duty-cycled, and nobody due to listen for a while
+    setReceiverSleep(true);
+    while (receiversListening() || dutyCycle.phase(sharedTimeUs() + 50000) != DutyCycle::Phase::ASLEEP) {
+        delay(1);
+    }
+
+    uint32_t before = interfaceRadio->framesSent();
+    startEmergencyStop(sharedTimeUs());
+    unsigned long start = millis();
+    while (millis() - start < 30) {
+        serviceEmergencyStop();
+        delay(1);
+    }
+    TEST_ASSERT_FALSE(receiversListening());
+    // The whole burst went out at once; the repeats after it wait for a slot
+    TEST_ASSERT_EQUAL(ESTOP_BURST, interfaceRadio->framesSent() - before);
+    TEST_ASSERT_TRUE(emergencyStopActive());
+}
+
+void test_acks_complete_the_stop() {
+    for (int i = 0; i < ESTOP_TEST_RECEIVERS; i++) {
+        spawnNode(runReceiver, i);
+    }
+    delay(200);
+
+    uint32_t before = interfaceRadio->framesSent();
+    startEmergencyStop(sharedTimeUs());
+    unsigned long start = millis();
+    while (emergencyStopActive() && millis() - start < ESTOP_GIVE_UP_MS) {
+        RxFrame frame{};
+        while (hostRx.pop(frame)) {
+            FrameHeader header;
+            if (decodeHeader(frame.data, frame.len, header) && header.type == MessageType::EMERGENCY_ACK) {
+                handleEmergencyAck(frame);
+            }
+        }
+        serviceEmergencyStop();
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    unsigned long tookMs = millis() - start;
+    stopNodes();
+
+    printf("%d receivers acked the stop in %lu ms\n", ESTOP_TEST_RECEIVERS, tookMs);
+    TEST_ASSERT_FALSE(emergencyStopActive());
+    TEST_ASSERT_LESS_THAN(100, tookMs);
+    // Early acks don't cut the burst short
+    TEST_ASSERT_GREATER_OR_EQUAL(ESTOP_BURST, interfaceRadio->framesSent() - before);
+}
+
+int main() {
+    startInterface();
+    UNITY_BEGIN();
+    RUN_TEST(test_burst_ignores_listen_window);
+    RUN_TEST(test_acks_complete_the_stop);
+    return UNITY_END();
+}
@@ -0,0 +1,91 @@
+#include <unity.h>
+#include "fan_control.h"
+
+// Controller updates on a virtual clock at FAN_UPDATE_INTERVAL_MS
+#define FAN_TEST_START_MS 100000
+
+static FanController fans;
+static uint32_t nowMs;
+
+static uint8_t runFor(int16_t tempDeciC, uint32_t durationMs) {
+    uint8_t duty = fans.duty();
+    for (uint32_t t = 0; t < durationMs; t += FAN_UPDATE_INTERVAL_MS) {
+        nowMs += FAN_UPDATE_INTERVAL_MS;
+        duty = fans.update(tempDeciC, nowMs);
+    }
+    return duty;
+}
+
+void setUp() {
+    fans = FanController();
+    nowMs = FAN_TEST_START_MS;
+}
+
+void tearDown() {}
+
+// Points of the default FAN_CURVE
+void test_curve_interpolates_points() {
+    TEST_ASSERT_EQUAL(0, FanController::curveDuty(449));
+    TEST_ASSERT_EQUAL(80, FanController::curveDuty(450));
+    TEST_ASSERT_EQUAL(120, FanController::curveDuty(500));
+    TEST_ASSERT_EQUAL(160, FanController::curveDuty(550));
+    TEST_ASSERT_EQUAL(255, FanController::curveDuty(650));
+    TEST_ASSERT_EQUAL(255, FanController::curveDuty(900));
+    uint8_t previous = 0;
+    for (int16_t t = 300; t <= 800; t++) {
+        TEST_ASSERT_GREATER_OR_EQUAL(previous, FanController::curveDuty(t));
+        previous = FanController::curveDuty(t);
+    }
+}
+
+void test_rises_ramp_and_falls_are_immediate() {
+    fans.setMode(ThermalsMode::MAX);
+    // The first call after power-on ramps one interval, not from whenever the clock started
+    TEST_ASSERT_LESS_THAN(16, fans.update(300, nowMs));
+
+    uint32_t reachedMs = 0;
+    for (uint32_t t = FAN_UPDATE_INTERVAL_MS; t <= FAN_SOFT_START_MS * 2 && !reachedMs; t += FAN_UPDATE_INTERVAL_MS) {
+        if (runFor(300, FAN_UPDATE_INTERVAL_MS) == 255) {
+            reachedMs = t;
+        }
+    }
+    printf("full duty %u ms after turning on\n", reachedMs);
+    TEST_ASSERT_UINT32_WITHIN(FAN_UPDATE_INTERVAL_MS, FAN_SOFT_START_MS, reachedMs);
+
+    fans.setMode(ThermalsMode::OFF);
+    TEST_ASSERT_EQUAL(0, runFor(300, FAN_UPDATE_INTERVAL_MS));
+}
+
+void test_auto_holds_through_hysteresis() {
+    fans.setMode(ThermalsMode::AUTO);
+    TEST_ASSERT_EQUAL(FanController::curveDuty(600), runFor(600, FAN_SOFT_START_MS));
+
+    // Small dips hold the duty; beyond the hysteresis it follows down at once
+    TEST_ASSERT_EQUAL(FanController::curveDuty(600), runFor(600 - FAN_HYSTERESIS_DECIC / 2, 1000));
+    TEST_ASSERT_EQUAL(FanController::curveDuty(600), runFor(600 - FAN_HYSTERESIS_DECIC, 1000));
+    TEST_ASSERT_EQUAL(FanController::curveDuty(540 + FAN_HYSTERESIS_DECIC), runFor(540, FAN_UPDATE_INTERVAL_MS));
+
+    // Back up and it follows the rise
+    TEST_ASSERT_EQUAL(FanController::curveDuty(600), runFor(600, FAN_SOFT_START_MS));
+
+    // Below the curve's first point the fans stop
+    TEST_ASSERT_EQUAL(0, runFor(400, FAN_UPDATE_INTERVAL_MS));
+}
+
+void test_stop_drops_to_off() {
+    fans.setMode(ThermalsMode::MAX);
+    runFor(300, FAN_SOFT_START_MS);
+    fans.stop();
+    TEST_ASSERT_EQUAL(0, fans.duty());
+    TEST_ASSERT_TRUE(fans.mode() == ThermalsMode::OFF);
+    TEST_ASSERT_EQUAL(0, runFor(700, 1000));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_curve_interpolates_points);
+    RUN_TEST(test_rises_ramp_and_falls_are_immediate);
+    RUN_TEST(test_auto_holds_through_hysteresis);
+    RUN_TEST(test_stop_drops_to_off);
+    return UNITY_END();
+}
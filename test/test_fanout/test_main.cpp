@@ -0,0 +1,161 @@
+#include <unity.h>
+#include <Arduino.h>
+#include <thread>
+#include "communication.h"
+#include "host_node.h"
+#include "transport_host.h"
+
+// One interface driving a full squad of receivers over a lossy link
+#define FANOUT_RECEIVERS 24
+#define FANOUT_UPDATES 30
+#define FANOUT_INTERVAL_MS 100
+#define FANOUT_PORT 47100
+
+static const uint8_t interfaceMac[6] = {0x02, 0, 0, 0, 0, 63};
+
+static LinkModel fanoutLink() {
+    LinkModel link;
+    link.latencyUs = 1000;
+    link.jitterUs = 500;
+    link.lossRate = 0.05f;
+    return link;
+}
+
+static void receiverMac(int index, uint8_t* mac) {
+    const uint8_t base[6] = {0x02, 0, 0, 0, 0, 0};
+    memcpy(mac, base, 6);
+    mac[5] = (uint8_t)(index + 1);
+}
+
+// Acks every state update that carries a command for this node
+static void runReceiver(int index) {
+    receiverMac(index, selfAddress);
+    HostTransport radio(selfAddress, fanoutLink(), FANOUT_PORT);
+    radio.begin();
+    radio.onReceive(queueHostFrame);
+    radio.addPeer(broadcastAddress);
+    attachTransport(radio);
+
+    for (;;) {
+        RxFrame frame{};
+        while (hostRx.pop(frame)) {
+            FrameHeader header;
+            CommandPayload command;
+            if (decodeHeader(frame.data, frame.len, header) && header.type == MessageType::STATE_UPDATE &&
+                findNodeCommand(frame.data, frame.len, selfAddress, command)) {
+                sendAck(frame.mac, header.seq);
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_peer_table_round_trip() {
+    PeerTable table;
+    uint8_t mac[6];
+    for (int i = 0; i < FANOUT_RECEIVERS; i++) {
+        receiverMac(i, mac);
+        TEST_ASSERT_EQUAL(i, table.add(mac, NODE_CAP_ALL));
+    }
+    receiverMac(3, mac);
+    TEST_ASSERT_EQUAL(3, table.add(mac, NODE_CAP_VISOR));  // Known nodes are updated, not duplicated
+
+    uint8_t records[MAX_RECEIVERS * PEER_RECORD_LEN];
+    size_t len = table.serialize(records);
+    TEST_ASSERT_EQUAL(FANOUT_RECEIVERS * PEER_RECORD_LEN, len);
+
+    PeerTable restored;
+    restored.deserialize(records, len);
+    TEST_ASSERT_EQUAL(FANOUT_RECEIVERS, restored.size());
+    TEST_ASSERT_EQUAL(3, restored.find(mac));
+    TEST_ASSERT_EQUAL(NODE_CAP_VISOR, restored[3].capabilities);
+}
+
+void test_ack_round_bookkeeping() {
+    PeerTable table;
+    uint8_t a[6], b[6];
+    receiverMac(0, a);
+    receiverMac(1, b);
+    table.add(a, NODE_CAP_ALL);
+    table.add(b, NODE_CAP_ALL);
+
+    table.beginAckRound(7, 1000);
+    TEST_ASSERT_EQUAL(2, table.pendingCount());
+    TEST_ASSERT_TRUE(table.recordAck(a, 7, 4000));
+    TEST_ASSERT_TRUE(table.recordAck(a, 7, 5000));   // Duplicate from a retry, not counted again
+    TEST_ASSERT_EQUAL(1, table[0].acked);
+    TEST_ASSERT_FALSE(table.recordAck(b, 6, 5000));  // Stale round
+    TEST_ASSERT_EQUAL(1, table.pendingCount());
+    TEST_ASSERT_EQUAL(3000, table[0].lastRttUs);
+
+    table.expireAckRound();
+    TEST_ASSERT_EQUAL(0, table.pendingCount());
+    TEST_ASSERT_EQUAL(1, table[1].missed);
+}
+
+void test_fanout_reaches_every_receiver() {
+    for (int i = 0; i < FANOUT_RECEIVERS; i++) {
+        TEST_ASSERT_TRUE(spawnNode(runReceiver, i) > 0);
+    }
+
+    memcpy(selfAddress, interfaceMac, 6);
+    HostTransport radio(selfAddress, fanoutLink(), FANOUT_PORT);
+    radio.begin();
+    radio.onReceive(queueHostFrame);
+    radio.addPeer(broadcastAddress);
+    attachTransport(radio);
+
+    receiverTable.clear();
+    uint8_t mac[6];
+    for (int i = 0; i < FANOUT_RECEIVERS; i++) {
+        receiverMac(i, mac);
+        receiverTable.add(mac, NODE_CAP_ALL);
+    }
+    delay(300);  // Let the receivers bind their ports
+
+    int sent = 0;
+    unsigned long lastSend = millis();
+    unsigned long end = lastSend + (FANOUT_UPDATES + 3) * FANOUT_INTERVAL_MS;
+    while (millis() < end) {
+        RxFrame frame{};
+        while (hostRx.pop(frame)) {
+            FrameHeader header;
+            if (decodeHeader(frame.data, frame.len, header) && header.type == MessageType::ACK) {
+                handleAck(frame);
+            }
+        }
+        if (sent < FANOUT_UPDATES && millis() - lastSend >= FANOUT_INTERVAL_MS) {
+            lastSend = millis();
+            sendStateUpdate();
+            sent++;
+        }
+        serviceStateAcks();
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    stopNodes();
+
+    uint32_t worstRttUs = 0;
+    uint32_t fewestAcks = FANOUT_UPDATES;
+    for (uint8_t i = 0; i < receiverTable.size(); i++) {
+        worstRttUs = max(worstRttUs, receiverTable[i].maxRttUs);
+        fewestAcks = min(fewestAcks, receiverTable[i].acked);
+    }
+    printf("fan-out: %d receivers, %d updates, fewest acks %u, worst RTT %u us\n",
+           FANOUT_RECEIVERS, FANOUT_UPDATES, fewestAcks, worstRttUs);
+
+    // Retries cover the lossy link, so at most the final round may still be open
+    TEST_ASSERT_GREATER_OR_EQUAL(FANOUT_UPDATES - 1, fewestAcks);
+    // Even a node reached only on the last retry hears within the retry budget
+    TEST_ASSERT_LESS_THAN((ACK_MAX_RETRIES + 1) * ACK_TIMEOUT_MS * 1000 + 20000, worstRttUs);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_peer_table_round_trip);
+    RUN_TEST(test_ack_round_bookkeeping);
+    RUN_TEST(test_fanout_reaches_every_receiver);
+    return UNITY_END();
+}
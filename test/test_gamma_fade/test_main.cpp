@@ -0,0 +1,87 @@
+#include <unity.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include "gamma.h"
+#include "led_compositor.h"
+
+// The shutdown fade, red from full to off over SHUTDOWN_FADE_DURATION_MS, rendered at
+// the LED task's 100 Hz
+#define FADE_TEST_STEP_MS 10
+#define FADE_TEST_DITHER_FRAMES (1 << LED_DITHER_BITS)
+
+void setUp() {}
+void tearDown() {}
+
+void test_gamma_tables_rise() {
+    for (int i = 1; i < 256; i++) {
+        TEST_ASSERT_GREATER_OR_EQUAL(gamma16(i - 1), gamma16(i));
+    }
+    uint16_t previous = 0;
+    for (uint32_t level = 0; level <= 65535; level++) {
+        uint16_t value = gammaLevel16(level);
+        TEST_ASSERT_GREATER_OR_EQUAL(previous, value);
+        previous = value;
+    }
+    TEST_ASSERT_EQUAL(0, gamma16(0));
+    TEST_ASSERT_EQUAL(65535, gamma16(255));
+    TEST_ASSERT_EQUAL(65535, gammaLevel16(65535));
+}
+
+void test_fade_never_brightens() {
+    static LedCompositor compositor;
+    compositor.setBase(0);
+    compositor.setOverlay(0xFF0000, Wave::CONSTANT, 0, 65535, 0);
+
+    // Red channel of the first LED, in 8-bit codes, before and after dithering
+    std::vector<double> linear;
+    std::vector<int> shown;
+    for (uint32_t t = 0; t <= SHUTDOWN_FADE_DURATION_MS; t += FADE_TEST_STEP_MS) {
+        compositor.setOverlayLevel(65535 - t * 65535 / SHUTDOWN_FADE_DURATION_MS);
+        compositor.render(t);
+        linear.push_back(compositor.linearFrame()[0] * 255.0 / 65535);
+        shown.push_back(compositor.frame()[0] >> 16);
+    }
+    TEST_ASSERT_EQUAL(255, shown.front());
+    TEST_ASSERT_EQUAL(0, shown.back());
+
+    // The linear frame falls on every step
+    for (size_t i = 1; i < linear.size(); i++) {
+        TEST_ASSERT_TRUE(linear[i] <= linear[i - 1]);
+    }
+
+    // Dithered frames may flicker a code up, but over each dither cycle the average falls
+    // and the running total never drifts from the linear one
+    double previous = 256;
+    for (size_t i = 0; i + FADE_TEST_DITHER_FRAMES <= shown.size(); i += FADE_TEST_DITHER_FRAMES) {
+        double sum = 0;
+        for (int k = 0; k < FADE_TEST_DITHER_FRAMES; k++) {
+            sum += shown[i + k];
+        }
+        TEST_ASSERT_TRUE(sum / FADE_TEST_DITHER_FRAMES <= previous);
+        previous = sum / FADE_TEST_DITHER_FRAMES;
+    }
+    double linearTotal = 0, shownTotal = 0, worstDrift = 0;
+    for (size_t i = 0; i < linear.size(); i++) {
+        linearTotal += linear[i];
+        shownTotal += shown[i];
+        worstDrift = std::max(worstDrift, fabs(linearTotal - shownTotal));
+    }
+
+    // The last second, where plain rounding runs out of codes
+    size_t lastSecond = linear.size() - 1000 / FADE_TEST_STEP_MS;
+    int steps = 0;
+    for (size_t i = lastSecond + 1; i < linear.size(); i++) {
+        steps += (int)(linear[i] + 0.5) != (int)(linear[i - 1] + 0.5);
+    }
+    printf("%zu frames, dither drift at most %.2f codes, last second %.2f -> 0 codes, which plain rounding shows in %d steps\n",
+           linear.size(), worstDrift, linear[lastSecond], steps);
+    TEST_ASSERT_TRUE(worstDrift < 2.0);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_gamma_tables_rise);
+    RUN_TEST(test_fade_never_brightens);
+    return UNITY_END();
+}
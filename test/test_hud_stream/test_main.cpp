@@ -0,0 +1,164 @@
+#include <unity.h>
+#include <Arduino.h>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "hud_stream.h"
+#include "transport_host.h"
+
+// Interface screen mirrored to a receiver over HostTransport, measured while the
+// screen animates and then checked once it has held still past a keyframe
+#define HUD_TEST_PORT 47800
+#define HUD_TEST_ANIMATE_MS 4000
+#define HUD_TEST_SETTLE_MS (HUD_KEYFRAME_MS + 1000)
+#define HUD_TEST_RENDER_MS 33
+
+static const uint8_t interfaceMac[6] = {0x02, 0, 0, 0, 0, 1};
+static const uint8_t receiverMac[6] = {0x02, 0, 0, 0, 0, 2};
+
+static std::mutex boxLock;
+static std::deque<std::vector<uint8_t>> toReceiver;
+static HudEncoder* activeEncoder = nullptr;
+
+static void receiverHeard(const uint8_t*, const uint8_t* data, int len, int8_t) {
+    std::lock_guard<std::mutex> guard(boxLock);
+    toReceiver.emplace_back(data, data + len);
+}
+
+static bool takeFrame(std::vector<uint8_t>& out) {
+    std::lock_guard<std::mutex> guard(boxLock);
+    if (toReceiver.empty()) {
+        return false;
+    }
+    out = std::move(toReceiver.front());
+    toReceiver.pop_front();
+    return true;
+}
+
+static void interfaceSent(const uint8_t*, bool delivered) {
+    activeEncoder->sent(delivered);
+}
+
+static uint8_t canvas[SCREEN_WIDTH * SCREEN_HEIGHT];
+static uint16_t mirror[SCREEN_WIDTH * SCREEN_HEIGHT];
+
+// A menu-like screen: border, a block of text, and a bar sliding across.
+// `busy` adds a full-width gradient band that changes every frame.
+static void drawScreen(uint32_t t, bool busy) {
+    memset(canvas, 0, sizeof(canvas));
+    for (int x = 0; x < SCREEN_WIDTH; x++) {
+        canvas[x] = canvas[(SCREEN_HEIGHT - 1) * SCREEN_WIDTH + x] = 0xFF;
+    }
+    for (int y = 20; y < 40; y++) {
+        for (int x = 10; x < 200 && x < SCREEN_WIDTH; x++) {
+            canvas[y * SCREEN_WIDTH + x] = (x / 3 + y / 4) % 3 == 0 ? 0xE0 : 0x00;
+        }
+    }
+    int barX = (t / 20) % SCREEN_WIDTH;
+    for (int y = 60; y < 100 && y < SCREEN_HEIGHT; y++) {
+        for (int x = barX; x < barX + 30 && x < SCREEN_WIDTH; x++) {
+            canvas[y * SCREEN_WIDTH + x] = 0x1C;
+        }
+    }
+    if (busy) {
+        for (int y = 110; y < 160 && y < SCREEN_HEIGHT; y++) {
+            for (int x = 0; x < SCREEN_WIDTH; x++) {
+                canvas[y * SCREEN_WIDTH + x] = (uint8_t)(x + y + t / 10);
+            }
+        }
+    }
+}
+
+struct HudRun {
+    float fps;             // Frames the receiver completed per second of animation
+    float bytesPerSec;     // Payload the receiver took in per second of animation
+    uint32_t lost;
+    int mismatched;        // Pixels differing from the interface once settled
+};
+
+static HudRun runMirror(float lossRate, bool busy, uint16_t port) {
+    HudEncoder encoder;
+    HudDecoder decoder;
+    MemoryHudDisplay display(mirror);
+    activeEncoder = &encoder;
+
+    LinkModel link;
+    link.latencyUs = 300;
+    link.jitterUs = 100;
+    link.lossRate = lossRate;
+    HostTransport interfaceRadio(interfaceMac, link, port);
+    HostTransport receiverRadio(receiverMac, link, port);
+    interfaceRadio.begin();
+    receiverRadio.begin();
+    receiverRadio.onReceive(receiverHeard);
+    interfaceRadio.onSendStatus(interfaceSent);
+    interfaceRadio.addPeer(receiverMac);
+
+    HudRun run = {};
+    std::vector<uint8_t> frame;
+    uint8_t out[PROTOCOL_MAX_FRAME_LEN];
+    unsigned long start = millis();
+    unsigned long lastDraw = 0;
+    bool measured = false;
+    while (millis() - start < HUD_TEST_ANIMATE_MS + HUD_TEST_SETTLE_MS) {
+        unsigned long now = millis();
+        bool animating = now - start < HUD_TEST_ANIMATE_MS;
+        if (!animating && !measured) {
+            measured = true;
+            run.fps = decoder.framesReceived() * 1000.0f / HUD_TEST_ANIMATE_MS;
+            run.bytesPerSec = decoder.bytesReceived() * 1000.0f / HUD_TEST_ANIMATE_MS;
+        }
+        if (now - lastDraw >= HUD_TEST_RENDER_MS) {
+            lastDraw = now;
+            drawScreen(animating ? now - start : HUD_TEST_ANIMATE_MS, busy);
+            encoder.scan(canvas);
+        }
+        if (encoder.wantsFrame(now)) {
+            encoder.beginFrame(now);
+        }
+        size_t len = encoder.poll(now, out);
+        if (len && !interfaceRadio.send(receiverMac, out, len)) {
+            encoder.sent(false);
+        }
+        while (takeFrame(frame)) {
+            TEST_ASSERT_TRUE(decoder.apply(frame.data(), frame.size(), display));
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+
+    run.lost = decoder.packetsLost();
+    for (int i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++) {
+        run.mismatched += mirror[i] != hudColor565(canvas[i]);
+    }
+    printf("%s screen, %.0f%% loss: %.1f fps, %.0f B/s, %u packets lost, %d pixels off once settled\n",
+           busy ? "busy" : "menu", lossRate * 100, run.fps, run.bytesPerSec, run.lost, run.mismatched);
+    return run;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_menu_screen_streams_at_full_rate() {
+    HudRun run = runMirror(0.0f, false, HUD_TEST_PORT);
+    TEST_ASSERT_GREATER_OR_EQUAL(HUD_MAX_FPS * 0.8f, run.fps);
+    TEST_ASSERT_LESS_OR_EQUAL(HUD_MAX_BYTES_PER_SEC, run.bytesPerSec);
+    TEST_ASSERT_EQUAL(0, run.mismatched);
+}
+
+void test_busy_screen_stays_in_budget_and_heals() {
+    HudRun run = runMirror(0.1f, true, HUD_TEST_PORT + 10);
+    // The frame rate gives way so the bandwidth cap holds
+    TEST_ASSERT_LESS_OR_EQUAL(HUD_MAX_BYTES_PER_SEC * 1.1f, run.bytesPerSec);
+    TEST_ASSERT_GREATER_THAN(0, run.fps);
+    TEST_ASSERT_GREATER_THAN(0, run.lost);
+    // The keyframe repairs whatever the loss left behind
+    TEST_ASSERT_EQUAL(0, run.mismatched);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_menu_screen_streams_at_full_rate);
+    RUN_TEST(test_busy_screen_stays_in_budget_and_heals);
+    return UNITY_END();
+}
@@ -0,0 +1,70 @@
+#include <unity.h>
+#include "led_compositor.h"
+
+// Frames at the 100 Hz the LED task renders at
+#define COMPOSITOR_TEST_STEP_MS 10
+#define COMPOSITOR_TEST_FRAMES 1000
+
+static LedCompositor compositor;
+
+void setUp() {
+    compositor = LedCompositor();
+    compositor.setBase(0x0000FF);
+}
+
+void tearDown() {}
+
+static int framesShown() {
+    int shown = 0;
+    for (int i = 0; i < COMPOSITOR_TEST_FRAMES; i++) {
+        shown += compositor.render(i * COMPOSITOR_TEST_STEP_MS);
+    }
+    return shown;
+}
+
+void test_solid_shows_once() {
+    compositor.setSegment(0, 0x0000FF, VisorMode::SOLID, 192);
+    TEST_ASSERT_FALSE(compositor.animated());
+    TEST_ASSERT_EQUAL(1, framesShown());
+}
+
+void test_pulse_shows_while_moving() {
+    compositor.setSegment(0, 0x0000FF, VisorMode::PULSING, 192);
+    TEST_ASSERT_TRUE(compositor.animated());
+    int shown = framesShown();
+    printf("pulse shows %d of %d frames\n", shown, COMPOSITOR_TEST_FRAMES);
+    TEST_ASSERT_GREATER_THAN(COMPOSITOR_TEST_FRAMES / 2, shown);
+}
+
+void test_unknown_mode_renders_solid() {
+    // A mode byte from a newer interface
+    compositor.setSegment(0, 0x0000FF, (VisorMode)200, 192);
+    TEST_ASSERT_FALSE(compositor.animated());
+    TEST_ASSERT_TRUE(compositor.render(0));
+    uint32_t unknown = compositor.frame()[0];
+
+    compositor.setSegment(0, 0x0000FF, VisorMode::SOLID, 192);
+    compositor.render(COMPOSITOR_TEST_STEP_MS);
+    TEST_ASSERT_EQUAL_HEX32(compositor.frame()[0], unknown);
+}
+
+void test_overlay_blends_over_base() {
+    compositor.setSegment(0, 0x0000FF, VisorMode::SOLID, MAX_BRIGHTNESS);
+    compositor.setOverlay(0xFF0000, Wave::CONSTANT, 0, 65535, 0);
+    TEST_ASSERT_TRUE(compositor.animated());
+    compositor.render(0);
+    TEST_ASSERT_EQUAL_HEX32(0xFF0000, compositor.frame()[0]);
+
+    compositor.clearOverlay();
+    compositor.render(COMPOSITOR_TEST_STEP_MS);
+    TEST_ASSERT_EQUAL_HEX32(0x0000FF, compositor.frame()[0]);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_solid_shows_once);
+    RUN_TEST(test_pulse_shows_while_moving);
+    RUN_TEST(test_unknown_mode_renders_solid);
+    RUN_TEST(test_overlay_blends_over_base);
+    return UNITY_END();
+}
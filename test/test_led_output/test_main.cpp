@@ -0,0 +1,89 @@
+#include <unity.h>
+#include <chrono>
+#include <vector>
+#include "led_output.h"
+
+// The CPU's part of a frame on both strips: encoding the bytes in show(), and the symbol
+// expansion the RMT driver does as it queues them, next to the frame's wire time
+#define OUTPUT_TEST_FRAMES 2000
+#define OUTPUT_TEST_SYMBOL_BLOCK 64     // Channel memory the driver refills at a time
+
+static int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint32_t wireUs(uint16_t leds) {
+    return leds * 24 * 125 / 100 + LED_LATCH_US;
+}
+
+struct OutputCost {
+    float encodeUs;
+    float queueUs;
+};
+
+static OutputCost benchStrips(uint16_t leds) {
+    std::vector<uint32_t> frame(leds * 2);
+    std::vector<uint8_t> bytes(leds * 3);
+    uint32_t symbols[OUTPUT_TEST_SYMBOL_BLOCK];
+    uint32_t checksum = 0;
+
+    int64_t encodeUs = 0;
+    int64_t queueUs = 0;
+    for (int f = 0; f < OUTPUT_TEST_FRAMES; f++) {
+        for (uint16_t i = 0; i < leds * 2; i++) {
+            frame[i] = (f * 7 + i * 0x010203) & 0xFFFFFF;
+        }
+        for (int strip = 0; strip < 2; strip++) {
+            int64_t start = nowUs();
+            encodeGrb(frame.data() + strip * leds, leds, bytes.data());
+            int64_t encoded = nowUs();
+            for (size_t done = 0; done < bytes.size();) {
+                done += expandWs2812Symbols(bytes.data() + done, bytes.size() - done, symbols, OUTPUT_TEST_SYMBOL_BLOCK);
+                checksum += symbols[0];
+            }
+            queueUs += nowUs() - encoded;
+            encodeUs += encoded - start;
+        }
+    }
+    OutputCost cost = {(float)encodeUs / OUTPUT_TEST_FRAMES, (float)queueUs / OUTPUT_TEST_FRAMES};
+    printf("%3u LEDs a strip: encode %.2f us, queue %.2f us a frame, wire time %u us (%08X)\n", leds,
+           cost.encodeUs, cost.queueUs, wireUs(leds), checksum);
+    return cost;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_bytes_and_symbols() {
+    const uint32_t pixels[2] = {0x112233, 0xA05000};
+    uint8_t bytes[6];
+    encodeGrb(pixels, 2, bytes);
+    const uint8_t grb[6] = {0x22, 0x11, 0x33, 0x50, 0xA0, 0x00};
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(grb, bytes, 6);
+
+    // 0xA0 = 1010 0000, long high for a 1 and short for a 0, level high then low
+    uint32_t symbols[16];
+    TEST_ASSERT_EQUAL(1, expandWs2812Symbols(&bytes[4], 2, symbols, 15));
+    TEST_ASSERT_EQUAL_HEX32(9 | 1u << 15 | 3u << 16, symbols[0]);
+    TEST_ASSERT_EQUAL_HEX32(3 | 1u << 15 | 9u << 16, symbols[1]);
+    TEST_ASSERT_EQUAL_HEX32(9 | 1u << 15 | 3u << 16, symbols[2]);
+    TEST_ASSERT_EQUAL_HEX32(3 | 1u << 15 | 9u << 16, symbols[7]);
+    TEST_ASSERT_EQUAL(2, expandWs2812Symbols(&bytes[4], 2, symbols, 16));
+}
+
+void test_cpu_cost_is_a_fraction_of_wire_time() {
+    const uint16_t sizes[] = {2, 60, 300};
+    for (uint16_t leds : sizes) {
+        OutputCost cost = benchStrips(leds);
+        // Host numbers, but the work scales the same way on the S3
+        TEST_ASSERT_LESS_THAN(wireUs(leds) / 4, cost.encodeUs + cost.queueUs);
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_bytes_and_symbols);
+    RUN_TEST(test_cpu_cost_is_a_fraction_of_wire_time);
+    return UNITY_END();
+}
@@ -0,0 +1,94 @@
+#include <unity.h>
+#include <chrono>
+#include "led_compositor.h"
+#include "led_segments.h"
+
+// The native env builds 300-LED strips, a 600-LED chain; the layout below fills most of it
+#define SEGMENT_TEST_CONFIG "visor=0:0+20,1:0+20;edge=0:20+140,1:20+140;chest=0:160+100;pack=1:160+140"
+#define SEGMENT_TEST_FRAMES 20000
+#define SEGMENT_TEST_STEP_MS 10
+
+static LedSegmentMap segmentMap;
+static LedCompositor compositor;
+static uint32_t programPixels[LED_CHAIN_LEN];
+
+void setUp() {}
+void tearDown() {}
+
+void test_config_rejects_bad_layouts() {
+    const char* bad[] = {
+        "",
+        "visor",
+        "visor=0:0+0",                               // Empty range
+        "visor=2:0+1",                               // No third strip
+        "visor=0:299+2",                             // Runs off the strip
+        "a=0:0+2;b=0:1+1",                           // Overlapping ranges
+        "toolongname=0:0+1",
+        "a=0:0+1;b=0:1+1;c=0:2+1;d=0:3+1;e=0:4+1",   // More than LED_SEGMENTS
+        "a=0:0+1;",
+        "a=0:0+1,",
+        "a=0:0+1x",
+    };
+    for (const char* config : bad) {
+        TEST_ASSERT_TRUE(segmentMap.load("visor=0:0+4;edge=1:0+4"));
+        TEST_ASSERT_FALSE_MESSAGE(segmentMap.load(config), config);
+        // Everything falls back to the visor
+        TEST_ASSERT_EQUAL(1, segmentMap.count());
+        TEST_ASSERT_EQUAL(0, segmentMap.segmentOf(LED_CHAIN_LEN - 1));
+    }
+}
+
+void test_config_maps_both_strips() {
+    TEST_ASSERT_TRUE(segmentMap.load(SEGMENT_TEST_CONFIG));
+    TEST_ASSERT_EQUAL(4, segmentMap.count());
+    TEST_ASSERT_EQUAL_STRING("pack", segmentMap.name(3));
+    TEST_ASSERT_EQUAL(40, segmentMap.length(0));
+    TEST_ASSERT_EQUAL(280, segmentMap.length(1));
+    TEST_ASSERT_EQUAL(0, segmentMap.segmentOf(NUM_LEDS));          // Second strip's first LED
+    TEST_ASSERT_EQUAL(2, segmentMap.segmentOf(200));
+    TEST_ASSERT_EQUAL(LED_NO_SEGMENT, segmentMap.segmentOf(270));  // Past chest on strip 0
+}
+
+void test_render_600_leds() {
+    TEST_ASSERT_GREATER_OR_EQUAL(500, LED_CHAIN_LEN);
+    TEST_ASSERT_TRUE(segmentMap.load(SEGMENT_TEST_CONFIG));
+    for (uint16_t i = 0; i < LED_CHAIN_LEN; i++) {
+        programPixels[i] = i * 2654435761u & 0xFFFFFF;
+    }
+    compositor.setSegmentMap(&segmentMap);
+    compositor.setBasePixels(programPixels);
+    compositor.setSegment(0, 0x0000FF, VisorMode::PULSING, 200);
+    compositor.setSegment(1, 0xFF8000, VisorMode::FLASHING, 255);
+    compositor.setSegment(2, 0, VisorMode::PROGRAM, 255);
+    compositor.setSegment(3, 0x00FF00, VisorMode::STROBE, 100);
+
+    for (int overlay = 0; overlay < 2; overlay++) {
+        if (overlay) {
+            compositor.setOverlay(0xFF0000, Wave::SQUARE, 500, 40000, 0);
+        }
+        auto start = std::chrono::steady_clock::now();
+        for (int f = 0; f < SEGMENT_TEST_FRAMES; f++) {
+            compositor.render(f * SEGMENT_TEST_STEP_MS);
+        }
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() /
+                    SEGMENT_TEST_FRAMES;
+        printf("%d LEDs in 4 segments%s: %.1f us per frame\n", LED_CHAIN_LEN, overlay ? " with overlay" : "", us);
+        // Far inside the 10 ms frame, even allowing for a much slower core
+        TEST_ASSERT_LESS_THAN(1000, us);
+    }
+
+    // A steady segment shows its colour and LEDs in no segment stay dark
+    compositor.clearOverlay();
+    compositor.setSegment(0, 0xFFFFFF, VisorMode::SOLID, MAX_BRIGHTNESS);
+    compositor.render(0);
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFF, compositor.frame()[0]);
+    TEST_ASSERT_EQUAL_HEX32(0, compositor.frame()[270]);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_config_rejects_bad_layouts);
+    RUN_TEST(test_config_maps_both_strips);
+    RUN_TEST(test_render_600_leds);
+    return UNITY_END();
+}
@@ -0,0 +1,237 @@
+#include <unity.h>
+#include <Arduino.h>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include "ota.h"
+#include "sha256.h"
+#include "transport_host.h"
+
+// Interface and receiver in one process, an update carried between them over HostTransport
+#define OTA_TEST_PORT 47700
+#define OTA_TEST_IMAGE_LEN (256UL * 1024)
+#define OTA_TEST_LIMIT_MS 60000
+
+static const uint8_t interfaceMac[6] = {0x02, 0, 0, 0, 0, 1};
+static const uint8_t receiverMac[6] = {0x02, 0, 0, 0, 0, 2};
+
+struct FrameBox {
+    std::mutex lock;
+    std::deque<std::vector<uint8_t>> frames;
+
+    void put(const uint8_t* data, int len) {
+        std::lock_guard<std::mutex> guard(lock);
+        frames.emplace_back(data, data + len);
+    }
+
+    bool take(std::vector<uint8_t>& out) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (frames.empty()) {
+            return false;
+        }
+        out = std::move(frames.front());
+        frames.pop_front();
+        return true;
+    }
+};
+
+static FrameBox toInterface;
+static FrameBox toReceiver;
+static OtaSender* activeSender = nullptr;
+
+static void interfaceHeard(const uint8_t*, const uint8_t* data, int len, int8_t) {
+    toInterface.put(data, len);
+}
+
+static void receiverHeard(const uint8_t*, const uint8_t* data, int len, int8_t) {
+    toReceiver.put(data, len);
+}
+
+static void interfaceSent(const uint8_t*, bool delivered) {
+    activeSender->sent(delivered);
+}
+
+// How the link misbehaves during a transfer
+struct OtaScenario {
+    float lossRate;
+    int dropAtPercent;     // Link goes dead for 3 s once this share is confirmed; -1 for never
+    bool corruptFlash;     // A byte already written to flash flips before verification
+};
+
+struct OtaOutcome {
+    bool succeeded;
+    bool committed;
+    bool matches;
+    uint32_t chunks;
+    uint32_t chunksSent;
+    uint32_t heldAtReconnect;
+};
+
+static OtaOutcome runTransfer(const OtaScenario& scenario, uint16_t port) {
+    std::vector<uint8_t> image(OTA_TEST_IMAGE_LEN);
+    std::vector<uint8_t> flash(OTA_TEST_IMAGE_LEN);
+    std::mt19937 rng(1);
+    for (uint8_t& byte : image) {
+        byte = rng();
+    }
+    MemoryImageSource source(image.data(), image.size());
+    MemoryImageSink sink(flash.data(), flash.size());
+    OtaSender sender;
+    OtaReceiver receiver(sink);
+    activeSender = &sender;
+
+    LinkModel link;
+    link.latencyUs = 300;
+    link.jitterUs = 100;
+    link.lossRate = scenario.lossRate;
+    HostTransport interfaceRadio(interfaceMac, link, port);
+    HostTransport receiverRadio(receiverMac, link, port);
+    interfaceRadio.begin();
+    receiverRadio.begin();
+    interfaceRadio.onReceive(interfaceHeard);
+    receiverRadio.onReceive(receiverHeard);
+    interfaceRadio.onSendStatus(interfaceSent);
+    interfaceRadio.addPeer(receiverMac);
+    receiverRadio.addPeer(interfaceMac);
+
+    OtaOutcome outcome = {};
+    bool dropped = false;
+    bool corrupted = false;
+    unsigned long reconnectAt = 0;
+    std::vector<uint8_t> frame;
+    uint8_t out[PROTOCOL_MAX_FRAME_LEN];
+    unsigned long start = millis();
+    sender.begin(source, millis());
+    while (sender.active() && millis() - start < OTA_TEST_LIMIT_MS) {
+        size_t len = sender.poll(millis(), out);
+        if (len && !interfaceRadio.send(receiverMac, out, len)) {
+            sender.sent(false);
+        }
+        while (toReceiver.take(frame)) {
+            size_t reply = receiver.handle(frame.data(), frame.size(), out);
+            if (reply) {
+                receiverRadio.send(interfaceMac, out, reply);
+            }
+        }
+        while (toInterface.take(frame)) {
+            sender.receive(frame.data(), frame.size(), millis());
+        }
+
+        uint32_t percent = sender.chunksConfirmed() * 100 / sender.chunkCount();
+        if (scenario.dropAtPercent >= 0 && !dropped && percent >= (uint32_t)scenario.dropAtPercent) {
+            dropped = true;
+            reconnectAt = millis() + 3000;
+            LinkModel dead = link;
+            dead.lossRate = 1.0f;
+            interfaceRadio.setLinkModel(dead);
+            receiverRadio.setLinkModel(dead);
+        }
+        if (reconnectAt && millis() >= reconnectAt) {
+            interfaceRadio.setLinkModel(link);
+            receiverRadio.setLinkModel(link);
+            reconnectAt = 0;
+            outcome.heldAtReconnect = receiver.chunksReceived();
+        }
+        if (scenario.corruptFlash && !corrupted && receiver.chunksReceived() > 100) {
+            corrupted = true;
+            flash[10] ^= 0xFF;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+
+    outcome.succeeded = sender.succeeded();
+    outcome.committed = sink.committedImage();
+    outcome.matches = flash == image;
+    outcome.chunks = sender.chunkCount();
+    outcome.chunksSent = sender.chunksSent();
+    printf("loss %.0f%%: %s in %u ms, %.1f KB/s, %u of %u chunks sent again, %u delivery failures\n",
+           scenario.lossRate * 100, outcome.succeeded ? "done" : "failed", sender.elapsedMs(), sender.kbPerSec(),
+           outcome.chunksSent - outcome.chunks, outcome.chunks, sender.deliveryFailures());
+    return outcome;
+}
+
+static void assertDigest(const char* expectedHex, const uint8_t* digest) {
+    char hex[65];
+    for (int i = 0; i < 32; i++) {
+        snprintf(hex + i * 2, 3, "%02x", digest[i]);
+    }
+    TEST_ASSERT_EQUAL_STRING(expectedHex, hex);
+}
+
+void setUp() {}
+void tearDown() {}
+
+// FIPS 180-2 vectors
+void test_sha256_vectors() {
+    const char* messages[] = {"", "abc", "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"};
+    const char* digests[] = {
+        "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+        "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+        "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+    };
+    for (int i = 0; i < 3; i++) {
+        Sha256 hash;
+        hash.update((const uint8_t*)messages[i], strlen(messages[i]));
+        uint8_t digest[32];
+        hash.finish(digest);
+        assertDigest(digests[i], digest);
+    }
+
+    // A million 'a's, fed in uneven pieces so blocks straddle update() calls
+    Sha256 hash;
+    uint8_t run[997];
+    memset(run, 'a', sizeof(run));
+    for (uint32_t fed = 0; fed < 1000000;) {
+        uint32_t piece = std::min<uint32_t>(1 + fed % sizeof(run), 1000000 - fed);
+        hash.update(run, piece);
+        fed += piece;
+    }
+    uint8_t digest[32];
+    hash.finish(digest);
+    assertDigest("cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0", digest);
+}
+
+void test_ota_clean_link() {
+    OtaOutcome outcome = runTransfer({0.0f, -1, false}, OTA_TEST_PORT);
+    TEST_ASSERT_TRUE(outcome.succeeded);
+    TEST_ASSERT_TRUE(outcome.committed);
+    TEST_ASSERT_TRUE(outcome.matches);
+    TEST_ASSERT_EQUAL(outcome.chunks, outcome.chunksSent);
+}
+
+void test_ota_lossy_link() {
+    OtaOutcome outcome = runTransfer({0.1f, -1, false}, OTA_TEST_PORT + 10);
+    TEST_ASSERT_TRUE(outcome.succeeded);
+    TEST_ASSERT_TRUE(outcome.matches);
+    // Only what was lost goes out again
+    TEST_ASSERT_LESS_THAN(outcome.chunks * 13 / 10, outcome.chunksSent);
+}
+
+void test_ota_resumes_after_link_drop() {
+    OtaOutcome outcome = runTransfer({0.0f, 40, false}, OTA_TEST_PORT + 20);
+    TEST_ASSERT_TRUE(outcome.succeeded);
+    TEST_ASSERT_TRUE(outcome.matches);
+    TEST_ASSERT_GREATER_OR_EQUAL(outcome.chunks * 2 / 5, outcome.heldAtReconnect);
+    // Picks up where it left off rather than starting over
+    TEST_ASSERT_LESS_THAN(outcome.chunks * 3 / 2, outcome.chunksSent);
+}
+
+void test_ota_recovers_from_bad_flash() {
+    OtaOutcome outcome = runTransfer({0.0f, -1, true}, OTA_TEST_PORT + 30);
+    // The hash catches the flipped byte, and the image is sent again rather than booted
+    TEST_ASSERT_TRUE(outcome.succeeded);
+    TEST_ASSERT_TRUE(outcome.matches);
+    TEST_ASSERT_GREATER_OR_EQUAL(outcome.chunks * 2, outcome.chunksSent);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_sha256_vectors);
+    RUN_TEST(test_ota_clean_link);
+    RUN_TEST(test_ota_lossy_link);
+    RUN_TEST(test_ota_resumes_after_link_drop);
+    RUN_TEST(test_ota_recovers_from_bad_flash);
+    return UNITY_END();
+}
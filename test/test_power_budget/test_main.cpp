@@ -0,0 +1,112 @@
+#include <unity.h>
+#include <algorithm>
+#include "led_compositor.h"
+#include "power_budget.h"
+
+// Synthetic frames through the compositor and budget: ten fan updates of ten frames each,
+// with the draw worked out from the 8-bit frame actually sent to the strips
+#define BUDGET_TEST_BASE_MA POWER_RADIO_RX_MA
+#define BUDGET_TEST_FAN_UPDATES 10
+#define BUDGET_TEST_FRAMES_PER_UPDATE 10
+
+static PowerBudget budget;
+static LedCompositor compositor;
+
+static float shownFrameMa() {
+    float ma = LED_CHAIN_LEN * POWER_LED_IDLE_MA;
+    for (uint16_t i = 0; i < LED_CHAIN_LEN; i++) {
+        uint32_t pixel = compositor.frame()[i];
+        ma += ((pixel >> 16 & 0xFF) + (pixel >> 8 & 0xFF) + (pixel & 0xFF)) * POWER_LED_CHANNEL_MA / 255;
+    }
+    return ma;
+}
+
+static float fansMa(uint8_t duty) {
+    return duty * 2 * POWER_FAN_MA / 255;
+}
+
+void setUp() {
+    budget = PowerBudget();
+    budget.setBaseMa(BUDGET_TEST_BASE_MA);
+    compositor = LedCompositor();
+    compositor.setPowerBudget(&budget);
+}
+
+void tearDown() {}
+
+struct BudgetRun {
+    float worstMa;
+    uint8_t fanDuty;
+};
+
+static BudgetRun runFrames(uint32_t color, uint8_t fanRequest, bool hot) {
+    compositor.setBase(color);
+    budget.setHot(hot);
+    BudgetRun run = {0, 0};
+    for (int u = 0; u < BUDGET_TEST_FAN_UPDATES; u++) {
+        run.fanDuty = budget.fanDuty(fanRequest);
+        for (int f = 0; f < BUDGET_TEST_FRAMES_PER_UPDATE; f++) {
+            compositor.render(u * 100 + f * 10);
+            float total = BUDGET_TEST_BASE_MA + shownFrameMa() + fansMa(run.fanDuty);
+            run.worstMa = std::max(run.worstMa, total);
+        }
+    }
+    printf("%06X, fans asked %3u got %3u: LEDs asked %.0f mA got %.0f, worst %.0f of %d mA\n", color, fanRequest,
+           run.fanDuty, budget.ledDemandMa(), budget.ledMa(), run.worstMa, POWER_BUDGET_MA);
+    return run;
+}
+
+void test_full_white_stays_in_budget() {
+    BudgetRun run = runFrames(0xFFFFFF, 0, false);
+    TEST_ASSERT_TRUE(budget.limiting());
+    TEST_ASSERT_LESS_OR_EQUAL(POWER_BUDGET_MA, run.worstMa);
+    // Scaled down, not blacked out
+    TEST_ASSERT_GREATER_THAN(0, compositor.frame()[0]);
+}
+
+void test_leds_and_fans_share_when_cool() {
+    BudgetRun run = runFrames(0xFFFFFF, 255, false);
+    TEST_ASSERT_LESS_OR_EQUAL(POWER_BUDGET_MA, run.worstMa);
+    TEST_ASSERT_LESS_THAN(255, run.fanDuty);
+}
+
+void test_fans_go_first_when_hot() {
+    BudgetRun run = runFrames(0xFFFFFF, 255, true);
+    TEST_ASSERT_LESS_OR_EQUAL(POWER_BUDGET_MA, run.worstMa);
+    TEST_ASSERT_EQUAL(255, run.fanDuty);
+    TEST_ASSERT_GREATER_THAN(0, budget.ledMa());
+}
+
+void test_light_load_is_untouched() {
+    BudgetRun run = runFrames(0, 255, true);
+    TEST_ASSERT_FALSE(budget.limiting());
+    TEST_ASSERT_EQUAL(255, run.fanDuty);
+    TEST_ASSERT_LESS_OR_EQUAL(POWER_BUDGET_MA, run.worstMa);
+}
+
+void test_pulse_while_priority_flips() {
+    // Pulsing white with the suit crossing the hot threshold every second
+    compositor.setSegment(0, 0xFFFFFF, VisorMode::PULSING, MAX_BRIGHTNESS);
+    float worstMa = 0;
+    uint8_t fanDuty = 0;
+    for (uint32_t t = 0; t < 8000; t += 10) {
+        if (t % 100 == 0) {
+            budget.setHot((t / 1000) % 2);
+            fanDuty = budget.fanDuty(255);
+        }
+        compositor.render(t);
+        worstMa = std::max(worstMa, BUDGET_TEST_BASE_MA + shownFrameMa() + fansMa(fanDuty));
+    }
+    printf("pulsing white with the priority flipping: worst %.0f of %d mA\n", worstMa, POWER_BUDGET_MA);
+    TEST_ASSERT_LESS_OR_EQUAL(POWER_BUDGET_MA, worstMa);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_full_white_stays_in_budget);
+    RUN_TEST(test_leds_and_fans_share_when_cool);
+    RUN_TEST(test_fans_go_first_when_hot);
+    RUN_TEST(test_light_load_is_untouched);
+    RUN_TEST(test_pulse_while_priority_flips);
+    return UNITY_END();
+}
@@ -0,0 +1,174 @@
+#include <unity.h>
+#include <Arduino.h>
+#include <thread>
+#include "communication.h"
+#include "host_node.h"
+#include "transport_host.h"
+
+// Interface, relay and a far node. The far node barely hears the interface,
+// but both hear the relay well.
+#define RELAY_PORT_DIRECT 47500
+#define RELAY_PORT_RELAYED 47600
+#define RELAY_UPDATES 30
+#define RELAY_INTERVAL_MS 200
+#define RELAY_POOR_LOSS 0.75f
+#define RELAY_GOOD_LOSS 0.05f
+
+static const uint8_t interfaceMac[6] = {0x02, 0, 0, 0, 0, 1};
+static const uint8_t relayMac[6] = {0x02, 0, 0, 0, 0, 2};
+static const uint8_t farMac[6] = {0x02, 0, 0, 0, 0, 3};
+
+static uint16_t testPort = RELAY_PORT_DIRECT;
+static bool relayOn = false;
+
+static LinkModel linkFrom(const uint8_t* mac) {
+    LinkModel link;
+    link.latencyUs = 1000;
+    link.jitterUs = 500;
+    bool isInterface = mac[5] == interfaceMac[5];
+    bool isFar = mac[5] == farMac[5];
+    link.nodeLoss[interfaceMac[5]] = isFar ? RELAY_POOR_LOSS : RELAY_GOOD_LOSS;
+    link.nodeLoss[relayMac[5]] = RELAY_GOOD_LOSS;
+    link.nodeLoss[farMac[5]] = isInterface ? RELAY_POOR_LOSS : RELAY_GOOD_LOSS;
+    return link;
+}
+
+// Index 0 is the relay, 1 the far node. Both ack their own entries; the relay also
+// forwards for the far node when relayOn.
+static void runReceiver(int index) {
+    memcpy(selfAddress, index == 0 ? relayMac : farMac, 6);
+    HostTransport radio(selfAddress, linkFrom(selfAddress), testPort);
+    radio.begin();
+    radio.onReceive(queueHostFrame);
+    radio.addPeer(broadcastAddress);
+    attachTransport(radio);
+
+    for (;;) {
+        RxFrame frame{};
+        while (hostRx.pop(frame)) {
+            FrameHeader header;
+            if (!decodeHeader(frame.data, frame.len, header)) {
+                continue;
+            }
+            const RxFrame* received = &frame;
+            RxFrame inner{};
+            if (header.type == MessageType::RELAY) {
+                if (!handleRelayFrame(frame, selfAddress, interfaceMac, index == 0 && relayOn, inner) ||
+                    !decodeHeader(inner.data, inner.len, header)) {
+                    continue;
+                }
+                received = &inner;
+            }
+            CommandPayload command;
+            if (header.type == MessageType::STATE_UPDATE &&
+                findNodeCommand(received->data, received->len, selfAddress, command)) {
+                sendAck(received->mac, header.seq, received->hops > 0 ? received->via : nullptr);
+            }
+        }
+        serviceRelay();
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+}
+
+// Runs the interface against both receivers and returns the far node's record
+static ReceiverNode runInterface(bool withRelay, uint16_t port) {
+    testPort = port;
+    relayOn = withRelay;
+    spawnNode(runReceiver, 0);
+    spawnNode(runReceiver, 1);
+
+    memcpy(selfAddress, interfaceMac, 6);
+    HostTransport radio(selfAddress, linkFrom(selfAddress), port);
+    radio.begin();
+    radio.onReceive(queueHostFrame);
+    radio.addPeer(broadcastAddress);
+    attachTransport(radio);
+    RxFrame stale{};
+    while (hostRx.pop(stale)) {
+        // Left over from the previous run
+    }
+    receiverTable.clear();
+    receiverTable.add(relayMac, NODE_CAP_ALL | (withRelay ? NODE_CAP_RELAY : 0));
+    receiverTable.add(farMac, NODE_CAP_ALL);
+    delay(300);
+
+    int sent = 0;
+    unsigned long lastSend = millis();
+    unsigned long end = lastSend + (RELAY_UPDATES + 3) * RELAY_INTERVAL_MS;
+    while (millis() < end) {
+        RxFrame frame{};
+        while (hostRx.pop(frame)) {
+            FrameHeader header;
+            if (!decodeHeader(frame.data, frame.len, header)) {
+                continue;
+            }
+            const RxFrame* received = &frame;
+            RxFrame inner{};
+            if (header.type == MessageType::RELAY) {
+                if (!handleRelayFrame(frame, selfAddress, selfAddress, false, inner) ||
+                    !decodeHeader(inner.data, inner.len, header)) {
+                    continue;
+                }
+                received = &inner;
+            }
+            if (header.type == MessageType::ACK) {
+                handleAck(*received);
+            }
+        }
+        if (sent < RELAY_UPDATES && millis() - lastSend >= RELAY_INTERVAL_MS) {
+            lastSend = millis();
+            sendStateUpdate();
+            sent++;
+        }
+        serviceStateAcks();
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    stopNodes();
+
+    ReceiverNode far = receiverTable[receiverTable.find(farMac)];
+    printf("%s: far node acked %u/%d (%u through the relay), missed %u, worst RTT %u us\n",
+           withRelay ? "relay" : "direct", far.acked, RELAY_UPDATES, far.relayedAcks, far.missed, far.maxRttUs);
+    return far;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_queue_carries_route() {
+    RxQueue queue;
+    uint8_t data[4] = {1, 2, 3, 4};
+    TEST_ASSERT_TRUE(queue.push(farMac, data, sizeof(data), 1234, -60));
+
+    // A frame recycled from an earlier relayed packet mustn't keep its route
+    RxFrame frame;
+    memset(&frame, 0xFF, sizeof(frame));
+    TEST_ASSERT_TRUE(queue.pop(frame));
+    TEST_ASSERT_EQUAL(0, frame.hops);
+    const uint8_t none[6] = {};
+    TEST_ASSERT_EQUAL_MEMORY(none, frame.via, 6);
+    TEST_ASSERT_EQUAL(1234, frame.rxUs);
+    TEST_ASSERT_EQUAL(-60, frame.rssi);
+    TEST_ASSERT_EQUAL_MEMORY(data, frame.data, sizeof(data));
+    TEST_ASSERT_FALSE(queue.pop(frame));
+}
+
+void test_relay_reaches_far_node() {
+    ReceiverNode direct = runInterface(false, RELAY_PORT_DIRECT);
+    ReceiverNode relayed = runInterface(true, RELAY_PORT_RELAYED);
+
+    // Direct, even four attempts lose a good share of updates at 75% loss each way
+    TEST_ASSERT_EQUAL(0, direct.relayedAcks);
+    TEST_ASSERT_LESS_THAN(RELAY_UPDATES * 9 / 10, direct.acked);
+    // Through the relay the far node hears nearly everything
+    TEST_ASSERT_GREATER_OR_EQUAL(RELAY_UPDATES - 2, relayed.acked);
+    TEST_ASSERT_GREATER_THAN(0, relayed.relayedAcks);
+    TEST_ASSERT_EQUAL(1, relayed.hops);
+    TEST_ASSERT_EQUAL_MEMORY(relayMac, relayed.via, 6);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_queue_carries_route);
+    RUN_TEST(test_relay_reaches_far_node);
+    return UNITY_END();
+}
@@ -0,0 +1,102 @@
+#include <unity.h>
+#include "safety_shutdown.h"
+
+// The warning on a virtual clock, serviced before each render every 10 ms like the
+// LED task, starting at an arbitrary time
+#define SHUTDOWN_TEST_STEP_MS 10
+#define SHUTDOWN_TEST_START_MS 123456
+
+static LedCompositor compositor;
+static SafetyShutdown warning(compositor);
+
+static void renderAt(uint32_t nowMs) {
+    warning.service(nowMs);
+    compositor.render(nowMs);
+}
+
+void setUp() {
+    warning.abort();
+    compositor = LedCompositor();
+    compositor.setBase(0);
+}
+
+void tearDown() {}
+
+void test_flashes_then_fades_on_time() {
+    uint32_t t0 = SHUTDOWN_TEST_START_MS;
+    warning.begin(t0);
+    int toggles = 0;
+    uint32_t previous = 0xFFFFFFFF;
+    uint32_t fadeFrom = 0;
+    uint32_t doneAt = 0;
+    uint16_t previousLinear = 65535;
+    for (uint32_t t = t0; t < t0 + SHUTDOWN_FLASH_DURATION_MS + SHUTDOWN_FADE_DURATION_MS + 1000;
+         t += SHUTDOWN_TEST_STEP_MS) {
+        renderAt(t);
+        uint32_t pixel = compositor.frame()[0];
+        if (warning.phase() == SafetyShutdown::Phase::FLASHING) {
+            TEST_ASSERT_TRUE(pixel == 0xFF0000 || pixel == 0);
+            toggles += previous != 0xFFFFFFFF && pixel != previous;
+        } else if (warning.phase() == SafetyShutdown::Phase::FADING) {
+            if (!fadeFrom) {
+                fadeFrom = t - t0;
+            }
+            TEST_ASSERT_LESS_OR_EQUAL(previousLinear, compositor.linearFrame()[0]);
+            previousLinear = compositor.linearFrame()[0];
+        } else if (!doneAt) {
+            doneAt = t - t0;
+            TEST_ASSERT_FALSE(compositor.overlayActive());
+            TEST_ASSERT_EQUAL_HEX32(0, pixel);
+        }
+        previous = pixel;
+    }
+    printf("%d flash toggles, fade from %u ms, done at %u ms\n", toggles, fadeFrom, doneAt);
+
+    // One toggle every interval, less the first frame
+    TEST_ASSERT_INT_WITHIN(1, SHUTDOWN_FLASH_DURATION_MS / SHUTDOWN_FLASH_INTERVAL_MS - 1, toggles);
+    TEST_ASSERT_EQUAL(SHUTDOWN_FLASH_DURATION_MS, fadeFrom);
+    TEST_ASSERT_EQUAL(SHUTDOWN_FLASH_DURATION_MS + SHUTDOWN_FADE_DURATION_MS, doneAt);
+}
+
+void test_command_cancels_within_a_frame() {
+    warning.begin(0);
+    uint32_t t = 0;
+    for (; t < SHUTDOWN_FLASH_DURATION_MS / 2; t += SHUTDOWN_TEST_STEP_MS) {
+        renderAt(t);
+    }
+    // What handleIncomingFrame does with a command
+    warning.abort();
+    compositor.setSegment(0, 0x0000FF, VisorMode::SOLID, MAX_BRIGHTNESS);
+    renderAt(t);
+    TEST_ASSERT_FALSE(warning.active());
+    TEST_ASSERT_EQUAL_HEX32(0x0000FF, compositor.frame()[0]);
+
+    // And again part way into the fade
+    warning.begin(t);
+    uint32_t fadeMiddle = t + SHUTDOWN_FLASH_DURATION_MS + SHUTDOWN_FADE_DURATION_MS / 2;
+    for (; t < fadeMiddle; t += SHUTDOWN_TEST_STEP_MS) {
+        renderAt(t);
+    }
+    TEST_ASSERT_TRUE(warning.phase() == SafetyShutdown::Phase::FADING);
+    warning.abort();
+    renderAt(t);
+    TEST_ASSERT_EQUAL_HEX32(0x0000FF, compositor.frame()[0]);
+}
+
+void test_late_service_keeps_schedule() {
+    // A 300 ms stall across the end of the flashing doesn't stretch the sequence
+    warning.begin(0);
+    renderAt(SHUTDOWN_FLASH_DURATION_MS - 10);
+    renderAt(SHUTDOWN_FLASH_DURATION_MS + 290);
+    TEST_ASSERT_TRUE(warning.phase() == SafetyShutdown::Phase::FADING);
+    renderAt(SHUTDOWN_FLASH_DURATION_MS + SHUTDOWN_FADE_DURATION_MS);
+    TEST_ASSERT_FALSE(warning.active());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_flashes_then_fades_on_time);
+    RUN_TEST(test_command_cancels_within_a_frame);
+    RUN_TEST(test_late_service_keeps_schedule);
+    return UNITY_END();
+}
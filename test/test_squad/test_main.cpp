@@ -0,0 +1,248 @@
+#include <unity.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "squad.h"
+
+// A squad of interfaces on a virtual clock. Every unit has its own clock offset and
+// drift; frames take 1-3 ms to arrive and some are lost.
+#define SQUAD_SIM_UNITS 12
+#define SQUAD_SIM_LOSS 0.1f
+#define SQUAD_SIM_STEP_US 500
+#define SQUAD_SIM_KEY "spartan-squad"
+
+struct SimUnit {
+    SquadSync sync;
+    uint8_t mac[6];
+    int64_t clockOffsetUs;
+    double drift;
+    int64_t startUs;
+    bool started = false;
+    bool alive = true;
+    int64_t appliedUs = -1;    // When the latest cue fired, on the true clock
+    int64_t lastDueUs = 0;     // A unit's frames leave its radio in order
+};
+
+struct AirFrame {
+    int64_t dueUs;
+    int from;
+    std::vector<uint8_t> bytes;
+};
+
+class SquadSim {
+public:
+    std::vector<SimUnit> units;
+    std::vector<AirFrame> air;
+    std::mt19937 rng{42};
+    int64_t nowUs = 0;
+
+    explicit SquadSim(int count) : units(count) {
+        for (int i = 0; i < count; i++) {
+            SimUnit& unit = units[i];
+            const uint8_t mac[6] = {0x24, 0x6F, 0x28, (uint8_t)rng(), (uint8_t)rng(), (uint8_t)i};
+            memcpy(unit.mac, mac, 6);
+            unit.clockOffsetUs = rng() % 50000000;
+            unit.drift = ((int)(rng() % 40) - 20) * 1e-6;
+            unit.startUs = rng() % 3000000;  // Staggered power-on
+        }
+    }
+
+    int64_t local(const SimUnit& unit) const {
+        return (int64_t)(nowUs * (1 + unit.drift)) + unit.clockOffsetUs;
+    }
+
+    void broadcast(int from, const uint8_t* out, size_t len) {
+        int64_t due = nowUs + 1000 + rng() % 2000;
+        if (from >= 0) {
+            due = std::max(due, units[from].lastDueUs + 1);
+            units[from].lastDueUs = due;
+        }
+        air.push_back({due, from, std::vector<uint8_t>(out, out + len)});
+    }
+
+    void runUntil(int64_t endUs) {
+        for (; nowUs < endUs; nowUs += SQUAD_SIM_STEP_US) {
+            for (int i = 0; i < (int)units.size(); i++) {
+                SimUnit& unit = units[i];
+                if (!unit.started && nowUs >= unit.startUs) {
+                    unit.started = true;
+                    unit.sync.begin(unit.mac, SQUAD_SIM_KEY, 0, local(unit));
+                }
+                if (!unit.started || !unit.alive) {
+                    continue;
+                }
+                uint8_t out[PROTOCOL_MAX_FRAME_LEN];
+                size_t len;
+                while ((len = unit.sync.poll(local(unit), out)) > 0) {
+                    broadcast(i, out, len);
+                }
+                SquadScene scene;
+                if (unit.sync.cueDue(local(unit), scene)) {
+                    unit.appliedUs = nowUs;
+                }
+            }
+            deliver();
+        }
+    }
+
+    void deliver() {
+        for (size_t k = 0; k < air.size();) {
+            if (air[k].dueUs > nowUs) {
+                k++;
+                continue;
+            }
+            for (int i = 0; i < (int)units.size(); i++) {
+                SimUnit& unit = units[i];
+                if (i == air[k].from || !unit.started || !unit.alive ||
+                    std::uniform_real_distribution<float>(0.0f, 1.0f)(rng) < SQUAD_SIM_LOSS) {
+                    continue;
+                }
+                unit.sync.receive(air[k].bytes.data(), air[k].bytes.size(), local(unit));
+            }
+            air.erase(air.begin() + k);
+        }
+    }
+
+    int leader() {
+        for (int i = 0; i < (int)units.size(); i++) {
+            if (units[i].alive && units[i].sync.leading()) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    int leaderCount() {
+        int count = 0;
+        for (const SimUnit& unit : units) {
+            count += unit.alive && unit.sync.leading();
+        }
+        return count;
+    }
+
+    bool allFollow(uint32_t id) {
+        for (const SimUnit& unit : units) {
+            if (unit.alive && unit.sync.leaderId() != id) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Has the leader cue a scene, runs past it and returns the spread of apply times (µs)
+    int64_t cueAndMeasure(int& applied) {
+        for (SimUnit& unit : units) {
+            unit.appliedUs = -1;
+        }
+        SimUnit& lead = units[leader()];
+        SquadScene scene = {true, VisorMode::PULSING, VisorColor::RED, 3, 0};
+        TEST_ASSERT_TRUE(lead.sync.cue(scene, local(lead)));
+        runUntil(nowUs + 1000000);
+
+        int64_t first = INT64_MAX, last = INT64_MIN;
+        applied = 0;
+        for (const SimUnit& unit : units) {
+            if (unit.alive && unit.appliedUs >= 0) {
+                first = std::min(first, unit.appliedUs);
+                last = std::max(last, unit.appliedUs);
+                applied++;
+            }
+        }
+        return applied ? last - first : 0;
+    }
+};
+
+void setUp() {}
+void tearDown() {}
+
+void test_squad_elects_one_leader_and_cues_together() {
+    SquadSim sim(SQUAD_SIM_UNITS);
+    sim.runUntil(8000000);
+
+    TEST_ASSERT_EQUAL(1, sim.leaderCount());
+    int lead = sim.leader();
+    TEST_ASSERT_TRUE(sim.allFollow(sim.units[lead].sync.unitId()));
+    for (const SimUnit& unit : sim.units) {
+        TEST_ASSERT_EQUAL(SQUAD_SIM_UNITS, unit.sync.size());
+        TEST_ASSERT_TRUE(unit.sync.synced());
+    }
+
+    int64_t worstSpreadUs = 0;
+    int fewestApplied = SQUAD_SIM_UNITS;
+    for (int cue = 0; cue < 5; cue++) {
+        int applied;
+        worstSpreadUs = std::max(worstSpreadUs, sim.cueAndMeasure(applied));
+        fewestApplied = std::min(fewestApplied, applied);
+        sim.runUntil(sim.nowUs + 2000000);
+    }
+    uint32_t throttled = 0;
+    for (const SimUnit& unit : sim.units) {
+        throttled += unit.sync.framesThrottled();
+    }
+    printf("squad of %d at %.0f%% loss: cues applied by at least %d, worst spread %.2f ms, %u frames throttled\n",
+           SQUAD_SIM_UNITS, SQUAD_SIM_LOSS * 100, fewestApplied, worstSpreadUs / 1000.0, throttled);
+
+    // Repeats cover the loss; clocks agree to within a few frame delays
+    TEST_ASSERT_GREATER_OR_EQUAL(SQUAD_SIM_UNITS - 1, fewestApplied);
+    TEST_ASSERT_LESS_THAN(5000, worstSpreadUs);
+}
+
+void test_squad_recovers_from_lost_leader() {
+    SquadSim sim(SQUAD_SIM_UNITS);
+    sim.runUntil(8000000);
+    int old = sim.leader();
+    sim.units[old].alive = false;
+
+    sim.runUntil(sim.nowUs + SQUAD_LEADER_TIMEOUT_MS * 1000LL + 8000000);
+    TEST_ASSERT_EQUAL(1, sim.leaderCount());
+    int lead = sim.leader();
+    TEST_ASSERT_NOT_EQUAL(old, lead);
+    TEST_ASSERT_TRUE(sim.allFollow(sim.units[lead].sync.unitId()));
+    TEST_ASSERT_EQUAL(SQUAD_SIM_UNITS - 1, sim.units[lead].sync.size());
+
+    int applied;
+    sim.cueAndMeasure(applied);
+    TEST_ASSERT_GREATER_OR_EQUAL(SQUAD_SIM_UNITS - 2, applied);
+}
+
+void test_squad_ignores_foreign_and_forged_frames() {
+    SquadSim sim(2);
+    sim.runUntil(5000000);
+    SimUnit& unit = sim.units[0];
+    uint8_t size = unit.sync.size();
+
+    // A unit with another key isn't counted
+    SquadSync rogue;
+    const uint8_t rogueMac[6] = {1, 2, 3, 4, 5, 6};
+    rogue.begin(rogueMac, "wrong-key", 9, 0);
+    uint8_t out[PROTOCOL_MAX_FRAME_LEN];
+    size_t len = 0;
+    for (int64_t t = 0; t < 3000000 && !len; t += 100000) {
+        len = rogue.poll(t, out);
+    }
+    TEST_ASSERT_GREATER_THAN(0, len);
+    TEST_ASSERT_FALSE(unit.sync.receive(out, len, sim.local(unit)));
+    TEST_ASSERT_EQUAL(size, unit.sync.size());
+
+    // A tampered frame from a squad member fails its tag, and a replay its counter
+    SimUnit& peer = sim.units[1];
+    for (int64_t t = sim.local(peer); !(len = peer.sync.poll(t, out)); t += 100000) {
+    }
+    uint32_t rejected = unit.sync.framesRejected();
+    out[len - SQUAD_TAG_LEN - 1] ^= 0x01;
+    TEST_ASSERT_FALSE(unit.sync.receive(out, len, sim.local(unit)));
+    out[len - SQUAD_TAG_LEN - 1] ^= 0x01;
+    TEST_ASSERT_TRUE(unit.sync.receive(out, len, sim.local(unit)));
+    TEST_ASSERT_FALSE(unit.sync.receive(out, len, sim.local(unit)));
+    TEST_ASSERT_EQUAL(rejected + 2, unit.sync.framesRejected());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_squad_elects_one_leader_and_cues_together);
+    RUN_TEST(test_squad_recovers_from_lost_leader);
+    RUN_TEST(test_squad_ignores_foreign_and_forged_frames);
+    return UNITY_END();
+}
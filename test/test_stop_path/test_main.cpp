@@ -0,0 +1,109 @@
+#include <unity.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include "stop_path.h"
+
+// The receiver's tasks as threads: an LED task holding the state lock through a long
+// frame, a stop task and a comms task both woken by the "receive callback"
+#define STOP_TEST_FRAME_US 50000
+#define STOP_TEST_POLL_US 50
+
+static std::mutex stateLock;
+static std::atomic<bool> fansOn{true};
+static std::atomic<bool> stopWake{false};
+static std::atomic<bool> commsWake{false};
+static std::atomic<bool> running{true};
+
+static int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void cutFans() {
+    fansOn.store(false);
+}
+
+static StopPath stopPath(cutFans, nowUs);
+
+// runStopTask: never touches the state lock
+static void stopTask() {
+    while (running.load()) {
+        if (stopWake.exchange(false)) {
+            stopPath.service();
+            commsWake.store(true);
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(STOP_TEST_POLL_US));
+    }
+}
+
+void setUp() {
+    fansOn.store(true);
+}
+
+void tearDown() {}
+
+void test_fans_cut_before_the_lock_is_free() {
+    running.store(true);
+    std::thread stopper(stopTask);
+
+    // The LED task takes the lock for a whole frame
+    std::atomic<bool> locked{false};
+    int64_t lockFreedUs = 0;
+    std::thread leds([&] {
+        std::lock_guard<std::mutex> guard(stateLock);
+        locked.store(true);
+        std::this_thread::sleep_for(std::chrono::microseconds(STOP_TEST_FRAME_US));
+        lockFreedUs = nowUs();
+    });
+    while (!locked.load()) {
+        std::this_thread::yield();
+    }
+
+    // OnDataRecv hears a stop while the frame is rendering
+    int64_t heardUs = nowUs();
+    stopPath.heard();
+    stopWake.store(true);
+
+    // Comms does the rest once it gets the lock
+    while (!commsWake.load()) {
+        std::this_thread::sleep_for(std::chrono::microseconds(STOP_TEST_POLL_US));
+    }
+    int64_t commsLockedUs;
+    {
+        std::lock_guard<std::mutex> guard(stateLock);
+        commsLockedUs = nowUs();
+    }
+    leds.join();
+    running.store(false);
+    stopper.join();
+
+    int64_t cutUs = stopPath.cutUs();
+    printf("fans off %lld us after the stop was heard; the lock came free after %lld us\n",
+           (long long)(cutUs - heardUs), (long long)(lockFreedUs - heardUs));
+    TEST_ASSERT_FALSE(fansOn.load());
+    TEST_ASSERT_TRUE(cutUs >= heardUs);
+    TEST_ASSERT_TRUE(cutUs < lockFreedUs);
+    TEST_ASSERT_TRUE(cutUs < commsLockedUs);
+    TEST_ASSERT_LESS_THAN(STOP_TEST_FRAME_US / 2, cutUs - heardUs);
+}
+
+void test_service_only_cuts_for_a_stop() {
+    TEST_ASSERT_FALSE(stopPath.service());
+    TEST_ASSERT_TRUE(fansOn.load());
+
+    // One cut covers however many copies came in before the task ran
+    stopPath.heard();
+    stopPath.heard();
+    TEST_ASSERT_TRUE(stopPath.service());
+    TEST_ASSERT_FALSE(stopPath.service());
+    TEST_ASSERT_FALSE(fansOn.load());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_fans_cut_before_the_lock_is_free);
+    RUN_TEST(test_service_only_cuts_for_a_stop);
+    return UNITY_END();
+}
@@ -0,0 +1,65 @@
+#include <unity.h>
+#include <algorithm>
+#include <thread>
+#include "task_load.h"
+
+// A worker thread adds passes while the test thread takes reports, as the report in the
+// comms task does with the other tasks' loads
+#define LOAD_TEST_PASSES 1000000
+#define LOAD_TEST_PASS_US 3
+#define LOAD_TEST_LONG_PASS_US 5000
+#define LOAD_TEST_LONG_EVERY 1000
+#define LOAD_TEST_INTERVAL_US 1000000
+
+void setUp() {}
+void tearDown() {}
+
+void test_share_and_longest_pass() {
+    TaskLoad load;
+    load.add(250);
+    load.add(750);
+    uint32_t longestUs;
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, 0.1f, load.take(10000, longestUs));
+    TEST_ASSERT_EQUAL(750, longestUs);
+
+    // Each take starts the next interval
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, 0.0f, load.take(10000, longestUs));
+    TEST_ASSERT_EQUAL(0, longestUs);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, 0.0f, load.take(0, longestUs));
+}
+
+void test_reports_lose_nothing_across_threads() {
+    TaskLoad load;
+    std::thread worker([&load] {
+        for (int i = 0; i < LOAD_TEST_PASSES; i++) {
+            load.add(i % LOAD_TEST_LONG_EVERY == 0 ? LOAD_TEST_LONG_PASS_US : LOAD_TEST_PASS_US);
+        }
+    });
+
+    // Shares over whole seconds add up to the busy seconds, wherever the takes fell
+    float busySeconds = 0;
+    uint32_t longestUs = 0;
+    uint32_t passLongestUs;
+    for (int k = 0; k < 50; k++) {
+        busySeconds += load.take(LOAD_TEST_INTERVAL_US, passLongestUs);
+        longestUs = std::max(longestUs, passLongestUs);
+        std::this_thread::yield();
+    }
+    worker.join();
+    busySeconds += load.take(LOAD_TEST_INTERVAL_US, passLongestUs);
+    longestUs = std::max(longestUs, passLongestUs);
+
+    int longPasses = LOAD_TEST_PASSES / LOAD_TEST_LONG_EVERY;
+    double expected = ((double)longPasses * LOAD_TEST_LONG_PASS_US +
+                       (double)(LOAD_TEST_PASSES - longPasses) * LOAD_TEST_PASS_US) / LOAD_TEST_INTERVAL_US;
+    printf("%.4f busy seconds reported, %.4f added, longest pass %u us\n", busySeconds, expected, longestUs);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, (float)expected, busySeconds);
+    TEST_ASSERT_EQUAL(LOAD_TEST_LONG_PASS_US, longestUs);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_share_and_longest_pass);
+    RUN_TEST(test_reports_lose_nothing_across_threads);
+    return UNITY_END();
+}
@@ -0,0 +1,138 @@
+#include <unity.h>
+#include <random>
+#include "layout.h"
+#include "telemetry.h"
+
+// A receiver's readings drifting for a few minutes, one record a second, some lost
+#define TELEMETRY_TEST_RECORDS 300
+#define TELEMETRY_TEST_LOSS 0.2f
+
+static TelemetrySnapshot sampleSnapshot() {
+    TelemetrySnapshot snapshot;
+    snapshot.fans = 0x03;
+    snapshot.fanDuty[0] = 100;
+    snapshot.fanDuty[1] = 102;
+    snapshot.chipTempDeciC = 412;
+    snapshot.supplyMv = 4950;
+    snapshot.ledFps = 100;
+    snapshot.watchdogMarginMs = 2500;
+    snapshot.safeFlags = SAFE_FLAG_UNPAIRED;
+    snapshot.currentDeciMa = 903;
+    snapshot.powerMw = 7800;
+    return snapshot;
+}
+
+static void assertSnapshot(const TelemetrySnapshot& expected, const TelemetrySnapshot& actual) {
+    TEST_ASSERT_EQUAL(expected.fans, actual.fans);
+    TEST_ASSERT_EQUAL(expected.fanDuty[0], actual.fanDuty[0]);
+    TEST_ASSERT_EQUAL(expected.fanDuty[1], actual.fanDuty[1]);
+    TEST_ASSERT_EQUAL(expected.chipTempDeciC, actual.chipTempDeciC);
+    TEST_ASSERT_EQUAL(expected.supplyMv, actual.supplyMv);
+    TEST_ASSERT_EQUAL(expected.ledFps, actual.ledFps);
+    TEST_ASSERT_EQUAL(expected.watchdogMarginMs, actual.watchdogMarginMs);
+    TEST_ASSERT_EQUAL(expected.safeFlags, actual.safeFlags);
+    TEST_ASSERT_EQUAL(expected.currentDeciMa, actual.currentDeciMa);
+    TEST_ASSERT_EQUAL(expected.powerMw, actual.powerMw);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_keyframe_then_deltas() {
+    TelemetryEncoder encoder;
+    NodeTelemetry cache;
+    TelemetrySnapshot snapshot = sampleSnapshot();
+    uint8_t record[TELEMETRY_MAX_LEN];
+
+    size_t len = encoder.encode(snapshot, record);
+    TEST_ASSERT_EQUAL(TELEMETRY_MAX_LEN, len);
+    TEST_ASSERT_TRUE(decodeTelemetry(record, len, cache));
+    TEST_ASSERT_TRUE(cache.valid);
+    assertSnapshot(snapshot, cache.current);
+
+    // Inside the dead-band nothing but the header goes out
+    snapshot.fanDuty[0] += TELEMETRY_DUTY_DEADBAND - 1;
+    snapshot.chipTempDeciC += TELEMETRY_TEMP_DEADBAND;
+    TEST_ASSERT_EQUAL(2, encoder.encode(snapshot, record));
+
+    // One field past it costs only that field
+    snapshot.fanDuty[0] = 110;
+    len = encoder.encode(snapshot, record);
+    TEST_ASSERT_LESS_THAN(TELEMETRY_MAX_LEN / 2, len);
+    TEST_ASSERT_TRUE(decodeTelemetry(record, len, cache));
+    TEST_ASSERT_EQUAL(110, cache.current.fanDuty[0]);
+    TEST_ASSERT_EQUAL(snapshot.supplyMv, cache.current.supplyMv);
+
+    // Flags have no dead-band
+    snapshot.safeFlags |= SAFE_FLAG_TIMED_OUT;
+    len = encoder.encode(snapshot, record);
+    TEST_ASSERT_TRUE(decodeTelemetry(record, len, cache));
+    TEST_ASSERT_EQUAL(SAFE_FLAG_UNPAIRED | SAFE_FLAG_TIMED_OUT, cache.current.safeFlags);
+}
+
+void test_deltas_wait_for_their_keyframe() {
+    TelemetryEncoder encoder;
+    NodeTelemetry cache;
+    TelemetrySnapshot snapshot = sampleSnapshot();
+    uint8_t record[TELEMETRY_MAX_LEN];
+
+    // The keyframe is lost, so its deltas can't be applied
+    encoder.encode(snapshot, record);
+    snapshot.supplyMv -= 200;
+    size_t len = encoder.encode(snapshot, record);
+    TEST_ASSERT_FALSE(decodeTelemetry(record, len, cache));
+    TEST_ASSERT_FALSE(cache.valid);
+
+    // Bad lengths are refused
+    TEST_ASSERT_FALSE(decodeTelemetry(record, 1, cache));
+    TEST_ASSERT_FALSE(decodeTelemetry(record, len - 1, cache));
+
+    // The next keyframe brings the cache in
+    for (int i = 2; i < TELEMETRY_KEYFRAME_EVERY; i++) {
+        encoder.encode(snapshot, record);
+    }
+    len = encoder.encode(snapshot, record);
+    TEST_ASSERT_TRUE(record[1] & TELEMETRY_KEYFRAME);
+    TEST_ASSERT_TRUE(decodeTelemetry(record, len, cache));
+    assertSnapshot(snapshot, cache.current);
+}
+
+void test_lossy_stream_tracks_within_deadbands() {
+    TelemetryEncoder encoder;
+    NodeTelemetry cache;
+    TelemetrySnapshot snapshot = sampleSnapshot();
+    std::mt19937 rng(5);
+    uint8_t record[TELEMETRY_MAX_LEN];
+    size_t bytes = 0;
+    int applied = 0;
+    for (int i = 0; i < TELEMETRY_TEST_RECORDS; i++) {
+        snapshot.chipTempDeciC += (int)(rng() % 5) - 2;
+        snapshot.supplyMv += (int)(rng() % 21) - 10;
+        snapshot.fanDuty[0] = 100 + rng() % 40;
+        size_t len = encoder.encode(snapshot, record);
+        bytes += len;
+        if (std::uniform_real_distribution<float>(0.0f, 1.0f)(rng) < TELEMETRY_TEST_LOSS) {
+            continue;
+        }
+        if (decodeTelemetry(record, len, cache)) {
+            applied++;
+            // What arrived is the truth to within each field's dead-band
+            TEST_ASSERT_INT_WITHIN(TELEMETRY_TEMP_DEADBAND, snapshot.chipTempDeciC, cache.current.chipTempDeciC);
+            TEST_ASSERT_INT_WITHIN(TELEMETRY_SUPPLY_DEADBAND, snapshot.supplyMv, cache.current.supplyMv);
+            TEST_ASSERT_INT_WITHIN(TELEMETRY_DUTY_DEADBAND, snapshot.fanDuty[0], cache.current.fanDuty[0]);
+        }
+    }
+    printf("%d records, %d applied at %.0f%% loss, %.1f bytes per record vs %d for full ones\n",
+           TELEMETRY_TEST_RECORDS, applied, TELEMETRY_TEST_LOSS * 100, (float)bytes / TELEMETRY_TEST_RECORDS,
+           TELEMETRY_MAX_LEN);
+    TEST_ASSERT_GREATER_THAN(TELEMETRY_TEST_RECORDS / 2, applied);
+    TEST_ASSERT_LESS_THAN(TELEMETRY_MAX_LEN * TELEMETRY_TEST_RECORDS, bytes);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_keyframe_then_deltas);
+    RUN_TEST(test_deltas_wait_for_their_keyframe);
+    RUN_TEST(test_lossy_stream_tracks_within_deadbands);
+    return UNITY_END();
+}
@@ -0,0 +1,200 @@
+#include <unity.h>
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <atomic>
+#include <thread>
+#include "host_node.h"
+#include "transport_host.h"
+
+#define TRANSPORT_PORT 47200
+#define ECHO_PORT 47300
+#define ECHO_ROUND_TRIPS 500
+#define ECHO_BURST_FRAMES 4000
+#define ECHO_WINDOW 16
+#define LINK_LATENCY_US 500
+
+static const uint8_t macA[6] = {0x02, 0, 0, 0, 0, 1};
+static const uint8_t macB[6] = {0x02, 0, 0, 0, 0, 2};
+static const uint8_t macAbsent[6] = {0x02, 0, 0, 0, 0, 9};
+
+static std::atomic<uint32_t> heardByB{0};
+static std::atomic<uint32_t> delivered{0};
+static std::atomic<uint32_t> undelivered{0};
+
+static void countAtB(const uint8_t*, const uint8_t*, int, int8_t) {
+    heardByB++;
+}
+
+static void countStatus(const uint8_t*, bool ok) {
+    (ok ? delivered : undelivered)++;
+}
+
+static void waitQuiet() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+}
+
+void setUp() {
+    heardByB = 0;
+    delivered = 0;
+    undelivered = 0;
+}
+
+void tearDown() {}
+
+void test_unicast_reports_delivery() {
+    HostTransport a(macA, LinkModel(), TRANSPORT_PORT);
+    HostTransport b(macB, LinkModel(), TRANSPORT_PORT);
+    TEST_ASSERT_TRUE(a.begin());
+    TEST_ASSERT_TRUE(b.begin());
+    b.onReceive(countAtB);
+    a.onSendStatus(countStatus);
+
+    const uint8_t frame[4] = {1, 2, 3, 4};
+    TEST_ASSERT_FALSE(a.send(macB, frame, sizeof(frame)));  // Not a peer yet
+    TEST_ASSERT_TRUE(a.addPeer(macB));
+    TEST_ASSERT_FALSE(a.addPeer(macB));
+    TEST_ASSERT_TRUE(a.send(macB, frame, sizeof(frame)));
+    waitQuiet();
+    TEST_ASSERT_EQUAL(1, heardByB.load());
+    TEST_ASSERT_EQUAL(1, delivered.load());
+
+    // Nobody answers for an absent node, or for one tuned elsewhere
+    a.addPeer(macAbsent);
+    a.send(macAbsent, frame, sizeof(frame));
+    b.setChannel(6);
+    a.send(macB, frame, sizeof(frame));
+    waitQuiet();
+    TEST_ASSERT_EQUAL(1, heardByB.load());
+    TEST_ASSERT_EQUAL(2, undelivered.load());
+
+    // A sleeping radio refuses frames
+    a.setRadioSleep(true);
+    TEST_ASSERT_FALSE(a.send(macB, frame, sizeof(frame)));
+}
+
+void test_loss_rate_follows_model() {
+    LinkModel lossy;
+    lossy.lossRate = 0.3f;
+    HostTransport a(macA, lossy, TRANSPORT_PORT);
+    HostTransport b(macB, LinkModel(), TRANSPORT_PORT);
+    a.begin();
+    b.begin();
+    b.onReceive(countAtB);
+    a.addPeer(macB);
+
+    const uint32_t frames = 2000;
+    const uint8_t frame[8] = {};
+    for (uint32_t i = 0; i < frames; i++) {
+        a.send(macB, frame, sizeof(frame));
+        if (i % 100 == 99) {
+            waitQuiet();  // Keep the socket buffers from overflowing
+        }
+    }
+    waitQuiet();
+    float heard = (float)heardByB.load() / frames;
+    printf("loss 0.30 configured: %.3f of %u frames arrived\n", heard, frames);
+    TEST_ASSERT_FLOAT_WITHIN(0.04f, 0.7f, heard);
+}
+
+// --- Two-process benchmark ---
+
+static HostTransport* echoRadio = nullptr;
+
+static void echoBack(const uint8_t* mac, const uint8_t* data, int len, int8_t) {
+    echoRadio->send(mac, data, len);
+}
+
+static LinkModel benchLink() {
+    LinkModel link;
+    link.latencyUs = LINK_LATENCY_US;
+    return link;
+}
+
+// Sends every frame straight back to its sender
+static void runEcho(int) {
+    HostTransport radio(macB, benchLink(), ECHO_PORT);
+    echoRadio = &radio;
+    radio.begin();
+    radio.addPeer(macA);
+    radio.onReceive(echoBack);
+    for (;;) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+}
+
+static std::atomic<uint32_t> echoes{0};
+static std::atomic<int64_t> echoRttSumUs{0};
+static std::atomic<int64_t> echoRttMaxUs{0};
+
+static void timeEcho(const uint8_t*, const uint8_t* data, int, int8_t) {
+    int64_t sentUs;
+    memcpy(&sentUs, data, sizeof(sentUs));
+    int64_t rttUs = esp_timer_get_time() - sentUs;
+    echoRttSumUs += rttUs;
+    if (rttUs > echoRttMaxUs) {
+        echoRttMaxUs = rttUs;
+    }
+    echoes++;
+}
+
+static void sendStamped(HostTransport& radio, size_t len) {
+    uint8_t frame[250] = {};
+    int64_t nowUs = esp_timer_get_time();
+    memcpy(frame, &nowUs, sizeof(nowUs));
+    radio.send(macB, frame, len);
+}
+
+void test_two_process_latency_and_throughput() {
+    TEST_ASSERT_TRUE(spawnNode(runEcho, 0) > 0);
+    HostTransport radio(macA, benchLink(), ECHO_PORT);
+    radio.begin();
+    radio.addPeer(macB);
+    radio.onReceive(timeEcho);
+    delay(200);
+
+    // Ping-pong: one frame in flight at a time
+    for (uint32_t i = 0; i < ECHO_ROUND_TRIPS; i++) {
+        uint32_t before = echoes;
+        sendStamped(radio, 32);
+        int64_t deadline = esp_timer_get_time() + 50000;
+        while (echoes == before && esp_timer_get_time() < deadline) {
+            std::this_thread::yield();
+        }
+    }
+    uint32_t answered = echoes;
+    int64_t meanRttUs = answered ? echoRttSumUs / answered : 0;
+    printf("ping-pong: %u/%u answered, mean RTT %lld us, max %lld us (%d us each way configured)\n",
+           answered, ECHO_ROUND_TRIPS, (long long)meanRttUs, (long long)echoRttMaxUs.load(), LINK_LATENCY_US);
+    TEST_ASSERT_EQUAL(ECHO_ROUND_TRIPS, answered);
+    TEST_ASSERT_GREATER_OR_EQUAL(2 * LINK_LATENCY_US, meanRttUs);
+    TEST_ASSERT_LESS_THAN(2 * LINK_LATENCY_US + 2000, meanRttUs);
+
+    // Windowed burst of full-size frames
+    echoes = 0;
+    int64_t startUs = esp_timer_get_time();
+    for (uint32_t i = 0; i < ECHO_BURST_FRAMES; i++) {
+        int64_t deadline = esp_timer_get_time() + 50000;
+        while (i - echoes >= ECHO_WINDOW && esp_timer_get_time() < deadline) {
+            std::this_thread::yield();
+        }
+        sendStamped(radio, 250);
+    }
+    int64_t deadline = esp_timer_get_time() + 200000;
+    while (echoes < ECHO_BURST_FRAMES && esp_timer_get_time() < deadline) {
+        std::this_thread::yield();
+    }
+    double seconds = (esp_timer_get_time() - startUs) / 1e6;
+    stopNodes();
+
+    printf("burst: %u/%u frames echoed, %.0f frames/s, %.1f kB/s each way\n", echoes.load(), ECHO_BURST_FRAMES,
+           echoes / seconds, echoes * 250 / seconds / 1000);
+    TEST_ASSERT_GREATER_OR_EQUAL(ECHO_BURST_FRAMES * 99 / 100, echoes.load());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_unicast_reports_delivery);
+    RUN_TEST(test_loss_rate_follows_model);
+    RUN_TEST(test_two_process_latency_and_throughput);
+    return UNITY_END();
+}
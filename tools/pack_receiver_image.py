@@ -0,0 +1,39 @@
+#!/usr/bin/env python3
+"""Pack a receiver firmware.bin for the interface's rx_image partition."""
+
+import hashlib
+import os
+import struct
+import sys
+
+RX_IMAGE_MAGIC = 0x4D495852   # "RXIM", as in include/ota_flash.h
+RX_IMAGE_OFFSET = 0xc90000    # rx_image in partitions_interface.csv
+RX_IMAGE_SIZE = 0x360000
+HEADER_FORMAT = "<II32s"      # RxImageHeader: magic, length, SHA-256
+
+def pack_image(firmware_path, output_path):
+    """Write the RxImageHeader followed by the firmware."""
+    with open(firmware_path, "rb") as f:
+        firmware = f.read()
+
+    header = struct.pack(HEADER_FORMAT, RX_IMAGE_MAGIC, len(firmware), hashlib.sha256(firmware).digest())
+    if len(header) + len(firmware) > RX_IMAGE_SIZE:
+        sys.exit(f"{firmware_path} is too large for the rx_image partition")
+
+    with open(output_path, "wb") as f:
+        f.write(header)
+        f.write(firmware)
+
+    print(f"Generated {output_path} ({len(firmware)} byte image, sha256 {hashlib.sha256(firmware).hexdigest()})")
+    print(f"Flash it with: esptool.py write_flash 0x{RX_IMAGE_OFFSET:x} {output_path}")
+
+if __name__ == "__main__":
+    # Default paths for this project
+    script_dir = os.path.dirname(os.path.abspath(__file__))
+    project_dir = os.path.dirname(script_dir)
+
+    input_file = sys.argv[1] if len(sys.argv) > 1 else os.path.join(
+        project_dir, ".pio", "build", "esp32-s3-supermini", "firmware.bin")
+    output_file = sys.argv[2] if len(sys.argv) > 2 else os.path.join(project_dir, "rx_image.bin")
+
+    pack_image(input_file, output_file)